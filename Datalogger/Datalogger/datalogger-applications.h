@@ -18,6 +18,7 @@
 #include "../types.h"
 
 #include "datalogger-file.h"
+#include "datalogger-config.h"
 
 typedef struct {
 	uint16_t sampleCount;
@@ -36,12 +37,31 @@ typedef struct {
  */
 uint8_t Datalogger_ProcessAutoTerminate();
 
+/**
+ * Initializes the CAN recorder, should be called before a new file is started.
+ * Any overflow summary not yet written is dropped.
+ * @param config Logging configuration, which may be changed while recording.
+ */
+void Datalogger_InitCANRecorder(DataloggerConfig *config);
+
 /**
  * Processes CAN messages, writing the received messages to the file.
+ * While the RAM buffer is full, messages are kept in a per-SID overflow
+ * summary instead (count, last payload, first and last time), which is
+ * written as a whole once there is room.
  * @param file Datalogger file to write to.
  */
 void Datalogger_ProcessCANMessages(DataloggerFile *dlgFile);
 
+/**
+ * Writes out any overflow summary, and any counts of frames not logged
+ * because of the logging policies, should be called before closing the file.
+ * @param dlgFile Datalogger file to write to.
+ * @return Whether the overflow summary, if any, was written. If not, there
+ * was no room for it yet.
+ */
+uint8_t Datalogger_FlushCANRecorder(DataloggerFile *dlgFile);
+
 /**
  * Processes CAN communications, such as heartbeat transmission.
  */
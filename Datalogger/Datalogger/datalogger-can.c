@@ -7,11 +7,23 @@
  * Revision History
  * Date			Author	Change
  * 13 Aug 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Added binary (PRM FMT 2) CAN records.
+ * 17 Oct 2026	agent	Read frames from the interrupt-driven receive queue.
+ * 17 Oct 2026	agent	Software filtering from the logging configuration.
+ * 17 Oct 2026	agent	Per-SID CHANGE / EVERY logging policies.
+ * 17 Oct 2026	agent	Delta-encoded CAN records.
+ * 17 Oct 2026	agent	Per-SID overflow summary while the RAM buffer is full.
+ * 17 Oct 2026	agent	UART copies of records no longer block.
+ * 17 Oct 2026	agent	Live binary CAN stream out the UART.
+ * 17 Oct 2026	agent	Clear the overflow summary when starting a new file.
+ * 17 Oct 2026	agent	UART copies of binary records are sent as ASCII lines.
  *
  * @file
  * Datalogger CAN recorder and CAN communications routines.
  */
 
+#include <string.h>
+
 #include "../types.h"
 
 #include "../ecan.h"
@@ -22,6 +34,9 @@
 
 #include "datalogger-stringutil.h"
 #include "datalogger-file.h"
+#include "datalogger-config.h"
+#include "datalogger-records.h"
+#include "datalogger-stream.h"
 
 #define DEBUG_UART
 #define DEBUG_UART_DATA
@@ -29,16 +44,721 @@
 #define DBG_MODULE "DLG/CAN"
 #include "../debug-common.h"
 
+/**
+ * Uncomment to also send each CAN record out the UART. Records are dropped
+ * rather than stalling the loop when the UART ring is full. The UART copy is
+ * always an ASCII CM line, even with DATALOGGER_CAN_BINARY, so the output can
+ * still be read on a terminal.
+ */
 //#define DATALOGGER_CAN_UART
 
+#ifdef DATALOGGER_CAN_UART
+	#include "../uart-dma.h"
+#endif
+
+#if defined(DATALOGGER_CAN_UART) && defined(DATALOGGER_CAN_STREAM)
+	#error "DATALOGGER_CAN_UART and DATALOGGER_CAN_STREAM both use the UART"
+#endif
+
+/**
+ * Most SIDs tracked at once. Untracked SIDs are always logged, and with
+ * DATALOGGER_CAN_DELTA, always logged as keyframes.
+ */
+#ifndef DLG_CAN_MAX_TRACKED
+#define DLG_CAN_MAX_TRACKED	32
+#endif
+
+/**
+ * Most SIDs in the overflow summary. Frames of other SIDs which could not be
+ * logged are only counted.
+ */
+#ifndef DLG_CAN_MAX_OVERFLOW
+#define DLG_CAN_MAX_OVERFLOW	32
+#endif
+
+/**
+ * State of a SID with a CHANGE or EVERY logging policy, or with
+ * DATALOGGER_CAN_DELTA, of every SID logged.
+ */
+typedef struct {
+	uint16_t sid;
+	uint8_t dlc;			/// DLC of the last frame logged, 0xff if none yet.
+	uint8_t data[8];		/// Payload of the last frame logged.
+	uint32_t lastTime;		/// Time of the last frame logged.
+	uint16_t seen;			/// Frames not logged since the last frames seen record.
+#ifdef DATALOGGER_CAN_DELTA
+	uint8_t deltas;			/// Delta records logged since the last keyframe.
+#endif
+} DataloggerTrackedSID;
+
+/**
+ * Frames of a SID which could not be logged because the RAM buffer was full.
+ */
+typedef struct {
+	uint16_t sid;
+	uint8_t dlc;			/// DLC of the last frame.
+	uint8_t data[8];		/// Payload of the last frame.
+	uint16_t count;			/// Number of frames, saturating at 0xffff.
+	uint32_t firstTime;		/// Time of the first frame.
+	uint32_t lastTime;		/// Time of the last frame.
+} DataloggerOverflowSID;
+
+static DataloggerConfig *canConfig;	/// Logging configuration.
+
+static DataloggerTrackedSID tracked[DLG_CAN_MAX_TRACKED];	/// Tracked SIDs, sorted by SID.
+static uint8_t numTracked = 0;		/// Number of entries in tracked.
+static uint32_t lastSeenTime = 0;	/// Time the frames seen records were last written.
+
+static DataloggerOverflowSID overflowSIDs[DLG_CAN_MAX_OVERFLOW];	/// Overflow summary, sorted by SID.
+static uint8_t numOverflowSIDs = 0;	/// Number of entries in overflowSIDs.
+static uint16_t overflowUntracked = 0;	/// Frames of SIDs which did not fit in the summary.
+static uint32_t overflowStart = 0;	/// Time the overflow started.
+static uint8_t overflowing = 0;		/// Whether frames are going into the overflow summary.
+
+#ifdef DATALOGGER_CAN_BINARY
+static uint32_t binLastTime = 0;	/// Time of the last binary record written.
+static uint8_t binTimeValid = 0;	/// Whether binLastTime has been written to the file.
+
+/**
+ * Gets the time delta for the next binary record, writing an absolute time
+ * record first if the delta would not fit or if no time base has been written.
+ * @param dlgFile Datalogger file to write to.
+ * @param currTime Timestamp of the next record.
+ * @param dt Output for the time delta.
+ * @return Result.
+ * @retval 0 Failure - a time record was needed but could not be written.
+ * @retval 1 Success.
+ */
+static uint8_t Datalogger_GetBinaryTimeDelta(DataloggerFile *dlgFile,
+		uint32_t currTime, uint8_t *dt) {
+	uint32_t diffTime = currTime - binLastTime;
+	if (!binTimeValid || diffTime > DLG_REC_MAX_DT) {
+		uint8_t *record = DataloggerFile_Reserve(dlgFile, DLG_REC_TIME_LEN);
+		if (record == NULL) {
+			return 0;
+		}
+		record[0] = DLG_REC_TIME;
+		record[1] = currTime & 0xff;
+		record[2] = (currTime >> 8) & 0xff;
+		record[3] = (currTime >> 16) & 0xff;
+		record[4] = (currTime >> 24) & 0xff;
+		DataloggerFile_Commit(dlgFile, DLG_REC_TIME_LEN);
+		binLastTime = currTime;
+		binTimeValid = 1;
+		diffTime = 0;
+	}
+	*dt = (uint8_t)diffTime;
+	return 1;
+}
+#endif
+
+/**
+ * Writes a COVF or MOVF overflow marker to the file.
+ * @param dlgFile Datalogger file to write to.
+ * @param ovf 'C' for a CAN hardware overflow, 'M' for a message buffer overflow.
+ * @param currTime Current timestamp.
+ * @param diffTime Time since the last CAN processing loop, capped at 255.
+ * @return Result.
+ * @retval 0 Failure - nothing was written.
+ * @retval 1 Success.
+ */
+static uint8_t Datalogger_WriteOverflowRecord(DataloggerFile *dlgFile,
+		char ovf, uint32_t currTime, uint8_t diffTime) {
+#ifdef DATALOGGER_CAN_BINARY
+	uint8_t dt;
+	uint8_t *record;
+
+	if (!Datalogger_GetBinaryTimeDelta(dlgFile, currTime, &dt)) {
+		return 0;
+	}
+	if ((record = DataloggerFile_Reserve(dlgFile, DLG_REC_MARKER_LEN)) == NULL) {
+		return 0;
+	}
+	record[0] = (ovf == 'C') ? DLG_REC_COVF : DLG_REC_MOVF;
+	record[1] = dt;
+	DataloggerFile_Commit(dlgFile, DLG_REC_MARKER_LEN);
+	binLastTime = currTime;
+	return 1;
+#else
+	char *record = (char*)DataloggerFile_Reserve(dlgFile, 20);
+	if (record == NULL) {
+		return 0;
+	}
+
+	record[0] = 'C';	record[1] = 'M';	record[2] = ' ';
+	Int32ToString(currTime, record+3);
+	record[11] = '/';
+	Int8ToString(diffTime, record+12);
+	record[14] = ' ';	record[15] = ovf;
+	record[16] = 'O';	record[17] = 'V';	record[18] = 'F';
+	record[19] = '\n';
+	DataloggerFile_Commit(dlgFile, 20);
+	return 1;
+#endif
+}
+
+#ifdef DATALOGGER_CAN_DELTA
+/**
+ * Formats the tag and payload of a delta record against the SID's last logged
+ * payload, if one is allowed and shorter than a keyframe, and counts it
+ * towards the next keyframe.
+ * @param record Record to format into, DLG_REC_CAN_HEADER_LEN+dlc bytes long.
+ * The dt and SID are left to the caller.
+ * @param entry SID tracking entry, or NULL if the SID is not tracked.
+ * @param dlc Message data length.
+ * @param data Message payload.
+ * @return Record length, or 0 if a keyframe must be written instead.
+ */
+static uint8_t Datalogger_FormatCANDelta(uint8_t *record,
+		DataloggerTrackedSID *entry, uint8_t dlc, uint8_t *data) {
+	uint8_t len = DLG_REC_CAN_DELTA_HEADER_LEN;
+	uint8_t mask = 0;
+	uint8_t i;
+
+	if (entry == NULL) {
+		return 0;
+	}
+	// A delta is never shorter than a keyframe below 2 bytes of payload
+	if (entry->dlc != dlc || dlc < 2 || entry->deltas >= DLG_REC_DELTA_KEYFRAME) {
+		entry->deltas = 0;
+		return 0;
+	}
+	for (i=0;i<dlc;i++) {
+		uint8_t diff = data[i] ^ entry->data[i];
+		if (diff != 0) {
+			if (len >= DLG_REC_CAN_HEADER_LEN + dlc - 1) {
+				entry->deltas = 0;
+				return 0;
+			}
+			mask |= 1 << i;
+			record[len++] = diff;
+		}
+	}
+	record[0] = DLG_REC_CAN_DELTA | dlc;
+	record[DLG_REC_CAN_DELTA_HEADER_LEN-1] = mask;
+	entry->deltas++;
+	return len;
+}
+#endif
+
+#if !defined(DATALOGGER_CAN_BINARY) || defined(DATALOGGER_CAN_UART)
+/**
+ * Formats an ASCII CM line for a CAN message.
+ * @param record Buffer to write to, at least 26+dlc*3 bytes long.
+ * @param currTime Message timestamp.
+ * @param diffTime Time since the last CAN processing loop, capped at 255.
+ * @param sid Message standard identifier.
+ * @param dlc Message data length.
+ * @param data Message payload.
+ * @return Length of the line, including the newline.
+ */
+static uint8_t Datalogger_FormatCANLine(char *record,
+		uint32_t currTime, uint8_t diffTime,
+		uint16_t sid, uint8_t dlc, uint8_t *data) {
+	uint8_t i;
+
+	// Generate message timestamp
+	record[0] = 'C';	record[1] = 'M';	record[2] = ' ';
+	Int32ToString(currTime, record+3);
+	record[11] = '/';
+	Int8ToString(diffTime, record+12);
+
+	// Generate message contents
+	record[14] = ' ';	record[15] = '0';	record[16] = ' ';
+	record[17] = '0';	record[18] = '0';	record[19] = ' ';
+	Int4ToString(dlc, record+20);
+	record[21] = ' ';
+	Int12ToString(sid, record+22);
+	record[25] = ' ';
+
+	for (i=0;i<dlc;i++) {
+		Int8ToString(data[i], record+26+i*3);
+		record[28+i*3] = ',';
+	}
+	record[25+dlc*3] = '\n';
+	return 26+dlc*3;
+}
+#endif
+
+/**
+ * Writes a received CAN message to the file.
+ * @param dlgFile Datalogger file to write to.
+ * @param currTime Current timestamp.
+ * @param diffTime Time since the last CAN processing loop, capped at 255.
+ * @param sid Message standard identifier.
+ * @param dlc Message data length.
+ * @param data Message payload.
+ * @param entry SID tracking entry, or NULL if the SID is not tracked. Only
+ * used with DATALOGGER_CAN_DELTA.
+ * @return Result.
+ * @retval 0 Failure - nothing was written.
+ * @retval 1 Success.
+ */
+static uint8_t Datalogger_WriteCANRecord(DataloggerFile *dlgFile,
+		uint32_t currTime, uint8_t diffTime,
+		uint16_t sid, uint8_t dlc, uint8_t *data, DataloggerTrackedSID *entry) {
+#ifdef DATALOGGER_CAN_BINARY
+	uint8_t dt;
+	uint8_t *record;
+	uint8_t len = 0;
+	uint8_t i;
+
+	if (!Datalogger_GetBinaryTimeDelta(dlgFile, currTime, &dt)) {
+		return 0;
+	}
+	record = DataloggerFile_Reserve(dlgFile, DLG_REC_CAN_HEADER_LEN+dlc);
+	if (record == NULL) {
+		return 0;
+	}
+
+	record[1] = dt;
+	record[2] = sid & 0xff;
+	record[3] = (sid >> 8) & 0xff;
+#ifdef DATALOGGER_CAN_DELTA
+	len = Datalogger_FormatCANDelta(record, entry, dlc, data);
+#endif
+	if (len == 0) {
+		record[0] = DLG_REC_CAN | dlc;
+		for (i=0;i<dlc;i++) {
+			record[DLG_REC_CAN_HEADER_LEN+i] = data[i];
+		}
+		len = DLG_REC_CAN_HEADER_LEN+dlc;
+	}
+
+#ifdef DATALOGGER_CAN_UART
+	{
+		char line[26+8*3];
+		UART_DMA_WriteAtomic(line, Datalogger_FormatCANLine(line, currTime, diffTime,
+				sid, dlc, data));
+	}
+#endif
+
+	DataloggerFile_Commit(dlgFile, len);
+	binLastTime = currTime;
+	return 1;
+#else
+	char *record = (char*)DataloggerFile_Reserve(dlgFile, 26+dlc*3);
+	uint8_t len;
+
+	if (record == NULL) {
+		return 0;
+	}
+	len = Datalogger_FormatCANLine(record, currTime, diffTime, sid, dlc, data);
+
+#ifdef DATALOGGER_CAN_UART
+	UART_DMA_WriteAtomic(record, len);
+#endif
+
+	DataloggerFile_Commit(dlgFile, len);
+	return 1;
+#endif
+}
+
+/**
+ * Writes a frames seen record to the file.
+ * @param dlgFile Datalogger file to write to.
+ * @param currTime Current timestamp.
+ * @param diffTime Time since the last CAN processing loop, capped at 255.
+ * @param sid Message standard identifier.
+ * @param count Number of frames not logged.
+ * @return Result.
+ * @retval 0 Failure - nothing was written.
+ * @retval 1 Success.
+ */
+static uint8_t Datalogger_WriteSeenRecord(DataloggerFile *dlgFile,
+		uint32_t currTime, uint8_t diffTime, uint16_t sid, uint16_t count) {
+#ifdef DATALOGGER_CAN_BINARY
+	uint8_t dt;
+	uint8_t *record;
+
+	if (!Datalogger_GetBinaryTimeDelta(dlgFile, currTime, &dt)) {
+		return 0;
+	}
+	if ((record = DataloggerFile_Reserve(dlgFile, DLG_REC_SEEN_LEN)) == NULL) {
+		return 0;
+	}
+	record[0] = DLG_REC_SEEN;
+	record[1] = dt;
+	record[2] = sid & 0xff;
+	record[3] = (sid >> 8) & 0xff;
+	record[4] = count & 0xff;
+	record[5] = (count >> 8) & 0xff;
+	DataloggerFile_Commit(dlgFile, DLG_REC_SEEN_LEN);
+	binLastTime = currTime;
+	return 1;
+#else
+	char *record = (char*)DataloggerFile_Reserve(dlgFile, 24);
+	if (record == NULL) {
+		return 0;
+	}
+
+	record[0] = 'C';	record[1] = 'S';	record[2] = ' ';
+	Int32ToString(currTime, record+3);
+	record[11] = '/';
+	Int8ToString(diffTime, record+12);
+	record[14] = ' ';
+	Int12ToString(sid, record+15);
+	record[18] = ' ';
+	Int16ToString(count, record+19);
+	record[23] = '\n';
+	DataloggerFile_Commit(dlgFile, 24);
+	return 1;
+#endif
+}
+
+/**
+ * Starts an overflow: until the overflow summary is written, frames are added
+ * to it instead of being logged, so they stay in order.
+ * @param currTime Current timestamp.
+ */
+static void Datalogger_BeginOverflow(uint32_t currTime) {
+	if (!overflowing) {
+		overflowing = 1;
+		overflowStart = currTime;
+		numOverflowSIDs = 0;
+		overflowUntracked = 0;
+		UI_LED_Pulse(&UI_LED_SD_Error);
+	}
+}
+
+/**
+ * Adds a frame which could not be logged to the overflow summary, starting an
+ * overflow if there is none.
+ * @param currTime Frame timestamp.
+ * @param sid Message standard identifier.
+ * @param dlc Message data length.
+ * @param data Message payload.
+ */
+static void Datalogger_AddOverflow(uint32_t currTime, uint16_t sid, uint8_t dlc, uint8_t *data) {
+	uint8_t low = 0, high;
+	DataloggerOverflowSID *entry;
+
+	Datalogger_BeginOverflow(currTime);
+
+	high = numOverflowSIDs;
+	while (low < high) {
+		uint8_t mid = (low + high) / 2;
+		if (overflowSIDs[mid].sid < sid) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	entry = &overflowSIDs[low];
+	if (low >= numOverflowSIDs || entry->sid != sid) {
+		if (numOverflowSIDs == DLG_CAN_MAX_OVERFLOW) {
+			if (overflowUntracked != 0xffff) {
+				overflowUntracked++;
+			}
+			return;
+		}
+		memmove(entry + 1, entry, (numOverflowSIDs - low) * sizeof(DataloggerOverflowSID));
+		numOverflowSIDs++;
+		entry->sid = sid;
+		entry->count = 0;
+		entry->firstTime = currTime;
+	}
+
+	if (entry->count != 0xffff) {
+		entry->count++;
+	}
+	entry->dlc = dlc;
+	memcpy(entry->data, data, dlc);
+	entry->lastTime = currTime;
+}
+
+#ifdef DATALOGGER_CAN_BINARY
+/**
+ * @param time Timestamp during the overflow.
+ * @return Offset of the timestamp from the start of the overflow, saturating.
+ */
+static uint16_t Datalogger_GetOverflowOffset(uint32_t time) {
+	uint32_t offset = time - overflowStart;
+	if (offset > 0x80000000) {
+		// Frames are timestamped on arrival, which may be before the start
+		return 0;
+	} else if (offset > 0xffff) {
+		return 0xffff;
+	}
+	return (uint16_t)offset;
+}
+#endif
+
+/**
+ * Writes the overflow summary to the file, if there is room for all of it,
+ * ending the overflow.
+ * @param dlgFile Datalogger file to write to.
+ * @param currTime Current timestamp.
+ * @param diffTime Time since the last CAN processing loop, capped at 255.
+ * @return Result.
+ * @retval 0 Failure - nothing was written, the overflow goes on.
+ * @retval 1 Success.
+ */
+static uint8_t Datalogger_WriteOverflowSummary(DataloggerFile *dlgFile,
+		uint32_t currTime, uint8_t diffTime) {
+	DataloggerOverflowSID *entry;
+	uint16_t len;
+	uint8_t i, j;
+#ifdef DATALOGGER_CAN_BINARY
+	uint8_t dt;
+	uint8_t *record;
+
+	len = DLG_REC_TIME_LEN + DLG_REC_OVERFLOW_LEN;
+	for (i=0;i<numOverflowSIDs;i++) {
+		len += DLG_REC_OVERFLOW_SID_HEADER_LEN + overflowSIDs[i].dlc;
+	}
+	// Each record is reserved on its own, so check there is room for them all
+	if (len > dlgFile->bufferFree || dlgFile->requestClose) {
+		return 0;
+	}
+	if (!Datalogger_GetBinaryTimeDelta(dlgFile, currTime, &dt)) {
+		return 0;
+	}
+	if ((record = DataloggerFile_Reserve(dlgFile, DLG_REC_OVERFLOW_LEN)) == NULL) {
+		return 0;
+	}
+	record[0] = DLG_REC_OVERFLOW;
+	record[1] = dt;
+	record[2] = overflowStart & 0xff;
+	record[3] = (overflowStart >> 8) & 0xff;
+	record[4] = (overflowStart >> 16) & 0xff;
+	record[5] = (overflowStart >> 24) & 0xff;
+	record[6] = numOverflowSIDs;
+	record[7] = overflowUntracked & 0xff;
+	record[8] = (overflowUntracked >> 8) & 0xff;
+	DataloggerFile_Commit(dlgFile, DLG_REC_OVERFLOW_LEN);
+	binLastTime = currTime;
+
+	for (i=0;i<numOverflowSIDs;i++) {
+		uint16_t first, last;
+		entry = &overflowSIDs[i];
+		len = DLG_REC_OVERFLOW_SID_HEADER_LEN + entry->dlc;
+		if ((record = DataloggerFile_Reserve(dlgFile, len)) == NULL) {
+			break;		// can't happen, the space was checked
+		}
+		first = Datalogger_GetOverflowOffset(entry->firstTime);
+		last = Datalogger_GetOverflowOffset(entry->lastTime);
+		record[0] = DLG_REC_OVERFLOW_SID | entry->dlc;
+		record[1] = entry->sid & 0xff;
+		record[2] = (entry->sid >> 8) & 0xff;
+		record[3] = entry->count & 0xff;
+		record[4] = (entry->count >> 8) & 0xff;
+		record[5] = first & 0xff;
+		record[6] = (first >> 8) & 0xff;
+		record[7] = last & 0xff;
+		record[8] = (last >> 8) & 0xff;
+		for (j=0;j<entry->dlc;j++) {
+			record[DLG_REC_OVERFLOW_SID_HEADER_LEN+j] = entry->data[j];
+		}
+		DataloggerFile_Commit(dlgFile, len);
+	}
+#else
+	char *record;
+
+	len = 32;
+	for (i=0;i<numOverflowSIDs;i++) {
+		len += 32 + overflowSIDs[i].dlc*3;
+	}
+	// Each line is reserved on its own, so check there is room for them all
+	if (len > dlgFile->bufferFree || dlgFile->requestClose) {
+		return 0;
+	}
+	if ((record = (char*)DataloggerFile_Reserve(dlgFile, 32)) == NULL) {
+		return 0;
+	}
+	record[0] = 'C';	record[1] = 'O';	record[2] = ' ';
+	Int32ToString(currTime, record+3);
+	record[11] = '/';
+	Int8ToString(diffTime, record+12);
+	record[14] = ' ';
+	Int32ToString(overflowStart, record+15);
+	record[23] = ' ';
+	Int8ToString(numOverflowSIDs, record+24);
+	record[26] = ' ';
+	Int16ToString(overflowUntracked, record+27);
+	record[31] = '\n';
+	DataloggerFile_Commit(dlgFile, 32);
+
+	for (i=0;i<numOverflowSIDs;i++) {
+		entry = &overflowSIDs[i];
+		len = 32 + entry->dlc*3;
+		if ((record = (char*)DataloggerFile_Reserve(dlgFile, len)) == NULL) {
+			break;		// can't happen, the space was checked
+		}
+		record[0] = 'C';	record[1] = 'P';	record[2] = ' ';
+		Int12ToString(entry->sid, record+3);
+		record[6] = ' ';
+		Int16ToString(entry->count, record+7);
+		record[11] = ' ';
+		Int32ToString(entry->firstTime, record+12);
+		record[20] = ' ';
+		Int32ToString(entry->lastTime, record+21);
+		record[29] = ' ';
+		Int4ToString(entry->dlc, record+30);
+		record[31] = ' ';
+		for (j=0;j<entry->dlc;j++) {
+			Int8ToString(entry->data[j], record+32+j*3);
+			record[34+j*3] = ',';
+		}
+		record[31+entry->dlc*3] = '\n';
+		DataloggerFile_Commit(dlgFile, len);
+	}
+#endif
+	DBG_DATA_printf("Overflow summary: %u SIDs, %u untracked frames", numOverflowSIDs, overflowUntracked);
+	overflowing = 0;
+	return 1;
+}
+
+/**
+ * Finds the tracking entry for a SID, adding one if there is room.
+ * @param sid Message standard identifier.
+ * @return Tracking entry, or NULL if the table is full.
+ */
+static DataloggerTrackedSID* Datalogger_GetTrackedSID(uint16_t sid) {
+	uint8_t low = 0, high = numTracked;
+	DataloggerTrackedSID *entry;
+
+	while (low < high) {
+		uint8_t mid = (low + high) / 2;
+		if (tracked[mid].sid < sid) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	entry = &tracked[low];
+	if (low < numTracked && entry->sid == sid) {
+		return entry;
+	} else if (numTracked == DLG_CAN_MAX_TRACKED) {
+		return NULL;
+	}
+
+	memmove(entry + 1, entry, (numTracked - low) * sizeof(DataloggerTrackedSID));
+	numTracked++;
+	entry->sid = sid;
+	entry->dlc = 0xff;
+	entry->seen = 0;
+	return entry;
+}
+
+/**
+ * Applies the logging policy of a SID to a received frame, counting the
+ * frame as seen if it is not to be logged.
+ * @param currTime Frame timestamp.
+ * @param sid Message standard identifier.
+ * @param dlc Message data length.
+ * @param data Message payload.
+ * @param entry Set to the SID's tracking entry, or NULL if it is not tracked.
+ * @return Whether to skip logging the frame.
+ */
+static uint8_t Datalogger_SkipByPolicy(uint32_t currTime,
+		uint16_t sid, uint8_t dlc, uint8_t *data, DataloggerTrackedSID **entry) {
+	DataloggerSIDPolicy *policy = DataloggerConfig_GetPolicy(canConfig, sid);
+	DataloggerTrackedSID *e;
+	uint8_t skip;
+
+#ifdef DATALOGGER_CAN_DELTA
+	// Every SID is tracked for its last payload
+	*entry = e = Datalogger_GetTrackedSID(sid);
+	if (policy == NULL || e == NULL) {
+		return 0;
+	}
+#else
+	*entry = NULL;
+	if (policy == NULL || (e = Datalogger_GetTrackedSID(sid)) == NULL) {
+		return 0;
+	}
+	*entry = e;
+#endif
+
+	if (e->dlc == 0xff || e->seen == 0xffff) {
+		// Nothing logged yet, or the count would overflow
+		return 0;
+	} else if (policy->policy == DLG_POLICY_CHANGE) {
+		skip = (dlc == e->dlc) && !memcmp(data, e->data, dlc);
+	} else {
+		skip = (currTime - e->lastTime) < policy->interval;
+	}
+	if (skip) {
+		e->seen++;
+	}
+	return skip;
+}
+
+/**
+ * Updates a SID's tracking entry after a frame is logged.
+ */
+static void Datalogger_TrackLogged(DataloggerTrackedSID *entry,
+		uint32_t currTime, uint8_t dlc, uint8_t *data) {
+	if (entry != NULL) {
+		entry->dlc = dlc;
+		memcpy(entry->data, data, dlc);
+		entry->lastTime = currTime;
+	}
+}
+
+/**
+ * Writes a frames seen record for each tracked SID with frames not logged.
+ * @param dlgFile Datalogger file to write to.
+ * @param currTime Current timestamp.
+ * @param diffTime Time since the last CAN processing loop, capped at 255.
+ */
+static void Datalogger_WriteSeenRecords(DataloggerFile *dlgFile,
+		uint32_t currTime, uint8_t diffTime) {
+	uint8_t i;
+
+	for (i=0;i<numTracked;i++) {
+		if (tracked[i].seen != 0) {
+			if (!Datalogger_WriteSeenRecord(dlgFile, currTime, diffTime,
+					tracked[i].sid, tracked[i].seen)) {
+				return;		// try again next time
+			}
+			tracked[i].seen = 0;
+		}
+	}
+	lastSeenTime = currTime;
+}
+
+void Datalogger_InitCANRecorder(DataloggerConfig *config) {
+	canConfig = config;
+	numTracked = 0;
+	overflowing = 0;
+	numOverflowSIDs = 0;
+	overflowUntracked = 0;
+	lastSeenTime = Get32bitTime();
+#ifdef DATALOGGER_CAN_BINARY
+	binTimeValid = 0;
+#endif
+#ifdef DATALOGGER_CAN_STREAM
+	Datalogger_StreamInit();
+#endif
+}
+
 void Datalogger_ProcessCANMessages(DataloggerFile *dlgFile) {
 	static uint8_t canOverflow = 0;
-	static uint8_t msgOverflow = 0;
 	static uint32_t lastTime = 0;
-	static char buffer[50] = "CM xxxxxxxx/xx 0 00 x xxx xx xx xx xx xx xx xx xx\n";
-	static char bufferMOvf[20] = "CM xxxxxxxx/xx MOVF\n";
-	static char bufferCOvf[20] = "CM xxxxxxxx/xx COVF\n";
+	DataloggerTrackedSID *entry;
+	uint32_t endTime, endDiffTime;
+
+#ifdef ECAN_RX_INTERRUPT
+	ECAN_RXFrame *frame;
+
+	while ((frame = ECAN_PeekRXFrame()) != NULL) {
+		// Frames are timestamped on arrival, which may be before lastTime
+		uint32_t currTime = frame->Time;
+		uint32_t diffTime = currTime - lastTime;
+		if (diffTime > 0x80000000) {
+			diffTime = 0;
+		} else if (diffTime > 255) {
+			diffTime = 255;
+		}
 
+		// Check overflow
+		if (ECAN_CheckRXOverflow()) {
+			UI_LED_Pulse(&UI_LED_CAN_Error);
+			canOverflow = 1;
+		}
+#else
 	int8_t nextBuf;
 
 	while ((nextBuf = ECAN_GetNextRXBuffer()) != -1) {
@@ -46,7 +766,6 @@ void Datalogger_ProcessCANMessages(DataloggerFile *dlgFile) {
 		uint32_t eid;
 		uint8_t dlc;
 		uint8_t data[8];
-		uint8_t i;
 		uint32_t currTime = Get32bitTime();
 		uint32_t diffTime = currTime - lastTime;
 		if (diffTime > 255) {
@@ -61,54 +780,93 @@ void Datalogger_ProcessCANMessages(DataloggerFile *dlgFile) {
 			UI_LED_Pulse(&UI_LED_CAN_Error);
 			canOverflow = 1;
 		}
-		if (canOverflow) {
-			Int32ToString(currTime, bufferCOvf+3);
-			Int8ToString((uint8_t)diffTime, bufferCOvf+12);
-			if (!DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)bufferCOvf, 20)) {
-				msgOverflow = 1;
-				UI_LED_Pulse(&UI_LED_SD_Error);
-			}
-			canOverflow = 0;
+#endif
+		if (overflowing) {
+			Datalogger_WriteOverflowSummary(dlgFile, currTime, (uint8_t)diffTime);
 		}
-		if (msgOverflow) {
-			Int32ToString(currTime, bufferMOvf+3);
-			Int8ToString((uint8_t)diffTime, bufferMOvf+12);
-			if (!DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)bufferMOvf, 20)) {
-				UI_LED_Pulse(&UI_LED_SD_Error);
+		if (canOverflow && !overflowing) {
+			if (Datalogger_WriteOverflowRecord(dlgFile, 'C', currTime, (uint8_t)diffTime)) {
+				canOverflow = 0;
+			} else {
+				// Written after the overflow summary instead
+				Datalogger_BeginOverflow(currTime);
 			}
-			msgOverflow = 0;
 		}
 
-		// Generate message timestamp
-		Int32ToString(currTime, buffer+3);
-		Int8ToString((uint8_t)diffTime, buffer+12);
-
+#ifdef ECAN_RX_INTERRUPT
+		if (!DataloggerConfig_KeepSID(canConfig, frame->SID)) {
+			ECAN_PopRXFrame();
+			continue;
+		}
+#ifdef DATALOGGER_CAN_STREAM
+		// The live stream gets every frame, whatever the logging policy
+		Datalogger_StreamCAN(currTime, frame->SID, frame->DLC, frame->Data);
+#endif
+		if (Datalogger_SkipByPolicy(currTime, frame->SID, frame->DLC, frame->Data, &entry)) {
+			ECAN_PopRXFrame();
+			continue;
+		}
+		if (!overflowing && Datalogger_WriteCANRecord(dlgFile, currTime, (uint8_t)diffTime,
+				frame->SID, frame->DLC, frame->Data, entry)) {
+			Datalogger_TrackLogged(entry, currTime, frame->DLC, frame->Data);
+		} else {
+			Datalogger_AddOverflow(currTime, frame->SID, frame->DLC, frame->Data);
+		}
+		ECAN_PopRXFrame();
+#else
 		// Read message
 		dlc = ECAN_ReadBuffer(nextBuf, &sid, &eid, 8, data);
-
-		// Generate message contents
-		Int4ToString(dlc, buffer+20);
-		Int12ToString(sid, buffer+22);
-
-		for (i=0;i<dlc;i++) {
-			Int8ToString(data[i], buffer+26+i*3);
-			buffer[28+i*3] = ',';
+		if (!DataloggerConfig_KeepSID(canConfig, sid)) {
+			continue;
 		}
-		buffer[25+dlc*3] = '\n';
-
-		if (!msgOverflow
-				&& !DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)buffer, 26+dlc*3)) {
-			msgOverflow = 1;
+#ifdef DATALOGGER_CAN_STREAM
+		// The live stream gets every frame, whatever the logging policy
+		Datalogger_StreamCAN(currTime, sid, dlc, data);
+#endif
+		if (Datalogger_SkipByPolicy(currTime, sid, dlc, data, &entry)) {
+			continue;
 		}
 
-#ifdef DATALOGGER_CAN_UART
-		UART_DMA_WriteBlocking(buffer, 26+dlc*3);
+		if (!overflowing && Datalogger_WriteCANRecord(dlgFile, currTime, (uint8_t)diffTime,
+				sid, dlc, data, entry)) {
+			Datalogger_TrackLogged(entry, currTime, dlc, data);
+		} else {
+			Datalogger_AddOverflow(currTime, sid, dlc, data);
+		}
 #endif
 
 		// User interface stuff
 		UI_LED_Pulse(&UI_LED_CAN_RX);
 	}
-	lastTime = Get32bitTime();
+
+	endTime = Get32bitTime();
+	endDiffTime = endTime - lastTime;
+	if (endDiffTime > 255) {
+		endDiffTime = 255;
+	}
+	if (overflowing) {
+		Datalogger_WriteOverflowSummary(dlgFile, endTime, (uint8_t)endDiffTime);
+	}
+	if (!overflowing && endTime - lastSeenTime >= canConfig->alive) {
+		Datalogger_WriteSeenRecords(dlgFile, endTime, (uint8_t)endDiffTime);
+	}
+#ifdef DATALOGGER_CAN_STREAM
+	Datalogger_StreamTasks(endTime);
+#endif
+	lastTime = endTime;
+}
+
+uint8_t Datalogger_FlushCANRecorder(DataloggerFile *dlgFile) {
+	uint32_t currTime = Get32bitTime();
+
+	if (overflowing) {
+		Datalogger_WriteOverflowSummary(dlgFile, currTime, 0);
+	}
+	Datalogger_WriteSeenRecords(dlgFile, currTime, 0);
+#ifdef DATALOGGER_CAN_STREAM
+	Datalogger_StreamFlush(currTime);
+#endif
+	return !overflowing;
 }
 
 void Datalogger_ProcessCANCommunications(DataloggerFile *dlgFile) {
@@ -0,0 +1,135 @@
+/*
+ * File:   datalogger-compress.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 10:05 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Block compressor for log files. See datalogger-compress.h for the format.
+ *
+ * The match finder is a single-entry hash table of the last position of each
+ * 3-byte prefix, taking the first match found (greedy). This is much weaker
+ * than a full search, but costs a few cycles per byte and 512 bytes of RAM,
+ * and log text is repetitive enough that most matches are found anyway.
+ */
+
+#include <string.h>
+
+#include "../types.h"
+
+#include "datalogger-compress.h"
+
+#define HASH(p)		((((p)[0] * 33u ^ (p)[1]) * 33u ^ (p)[2]) & ((1 << DLG_COMPRESS_HASH_BITS) - 1))
+#define NO_POS		0xffff
+
+/**
+ * Writes a block with the raw data stored uncompressed.
+ * @return Length of the block, excluding the header.
+ */
+static uint16_t StoreBlock(uint8_t *in, uint16_t inLen, uint8_t *out) {
+	memcpy(out + DLG_COMPRESS_HEADER_LEN, in, inLen);
+	return inLen;
+}
+
+uint16_t DataloggerCompress_Block(DataloggerCompressor *comp,
+		uint8_t *in, uint16_t inLen, uint8_t *out) {
+	uint16_t ip = 0;
+	uint16_t op = DLG_COMPRESS_HEADER_LEN + 1;
+	uint16_t flagPos = DLG_COMPRESS_HEADER_LEN;
+	uint16_t opLimit = DLG_COMPRESS_HEADER_LEN + inLen;
+	uint16_t rawLen = inLen;
+	uint16_t payloadLen;
+	uint8_t flags = 0, flagBit = 0;
+	uint8_t sum1 = 0, sum2 = 0;
+	uint8_t i;
+
+	memset(comp->head, 0xff, sizeof(comp->head));
+
+	while (ip < inLen) {
+		uint16_t matchLen = 0;
+		uint16_t matchPos = 0;
+
+		if (flagBit == 8) {
+			out[flagPos] = flags;
+			flagPos = op++;
+			flags = 0;
+			flagBit = 0;
+		}
+		if (op >= opLimit) {
+			break;		// not compressible, store instead
+		}
+
+		if (inLen - ip >= DLG_COMPRESS_MIN_MATCH) {
+			uint8_t h = HASH(in + ip);
+			matchPos = comp->head[h];
+			comp->head[h] = ip;
+			if (matchPos != NO_POS && ip - matchPos <= DLG_COMPRESS_MAX_DISTANCE
+					&& in[matchPos] == in[ip] && in[matchPos+1] == in[ip+1]
+					&& in[matchPos+2] == in[ip+2]) {
+				uint16_t maxLen = inLen - ip;
+				if (maxLen > DLG_COMPRESS_MAX_MATCH) {
+					maxLen = DLG_COMPRESS_MAX_MATCH;
+				}
+				matchLen = DLG_COMPRESS_MIN_MATCH;
+				while (matchLen < maxLen && in[matchPos+matchLen] == in[ip+matchLen]) {
+					matchLen++;
+				}
+			}
+		}
+
+		if (matchLen != 0) {
+			uint16_t dist = ip - matchPos - 1;
+			uint16_t end = ip + matchLen;
+			flags |= 1 << flagBit;
+			if (matchLen - DLG_COMPRESS_MIN_MATCH >= 15) {
+				out[op++] = ((dist >> 4) & 0xf0) | 15;
+				out[op++] = dist & 0xff;
+				out[op++] = matchLen - DLG_COMPRESS_MIN_MATCH - 15;
+			} else {
+				out[op++] = ((dist >> 4) & 0xf0) | (matchLen - DLG_COMPRESS_MIN_MATCH);
+				out[op++] = dist & 0xff;
+			}
+			// Index the positions inside the match too
+			for (ip++;ip<end;ip++) {
+				if (inLen - ip >= DLG_COMPRESS_MIN_MATCH) {
+					comp->head[HASH(in + ip)] = ip;
+				}
+			}
+		} else {
+			out[op++] = in[ip++];
+		}
+		flagBit++;
+	}
+
+	if (ip < inLen || op >= opLimit) {
+		payloadLen = StoreBlock(in, inLen, out);
+		rawLen |= DLG_COMPRESS_STORED;
+	} else {
+		out[flagPos] = flags;
+		payloadLen = op - DLG_COMPRESS_HEADER_LEN;
+	}
+
+	for (ip=0;ip<inLen;ip++) {
+		sum1 += in[ip];
+		sum2 += sum1;
+	}
+
+	out[0] = DLG_COMPRESS_MAGIC_0;
+	out[1] = DLG_COMPRESS_MAGIC_1;
+	out[2] = rawLen & 0xff;
+	out[3] = (rawLen >> 8) & 0xff;
+	out[4] = payloadLen & 0xff;
+	out[5] = (payloadLen >> 8) & 0xff;
+	out[6] = sum1;
+	out[7] = sum2;
+	out[8] = 0;
+	for (i=0;i<DLG_COMPRESS_HEADER_LEN-1;i++) {
+		out[8] += out[i];
+	}
+
+	return DLG_COMPRESS_HEADER_LEN + payloadLen;
+}
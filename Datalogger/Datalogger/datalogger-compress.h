@@ -0,0 +1,102 @@
+/*
+ * File:   datalogger-compress.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 10:05 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Block compressor for log files, shared between the datalogger and the host
+ * tools.
+ *
+ * A compressed log (.DLZ) is a sequence of self-contained blocks. Each block
+ * is compressed on its own, with no history carried over from the previous
+ * block, so decoding can start at any block boundary, and after a damaged
+ * block a decoder can resynchronize by searching for the next block header.
+ *
+ * Block header, multi-byte fields little-endian:
+ *   [0x44 'D'] [0x5A 'Z']
+ *   [raw length, 2 bytes] High bit set if the payload is stored uncompressed.
+ *   [payload length, 2 bytes]
+ *   [check 1] [check 2] Fletcher checksum (mod 256) of the raw data.
+ *   [header check] Sum of the previous header bytes, mod 256.
+ *
+ * The payload is LZSS: a flag byte, least significant bit first, says whether
+ * each of the next 8 items is a literal (0) or a match (1). A literal is a
+ * single byte. A match is 2 bytes, [distance-1 high nibble | length-3]
+ * [distance-1 low byte], copying from up to 4096 bytes back in the block.
+ * A length nibble of 15 is followed by a byte which is added to the length.
+ */
+
+#ifndef DATALOGGER_COMPRESS_H
+#define DATALOGGER_COMPRESS_H
+
+#include "../types.h"
+
+/**
+ * Uncomment to compress log files. Compressed logs are written as .DLZ files
+ * and must be unpacked with dlg-unpack on the host.
+ */
+//#define DATALOGGER_COMPRESS
+
+#ifdef DATALOGGER_COMPRESS
+	#define DLG_FILE_EXT			"DLZ"
+#else
+	#define DLG_FILE_EXT			"DLA"
+#endif
+
+#define DLG_COMPRESS_MAGIC_0		0x44	/// First byte of a block header.
+#define DLG_COMPRESS_MAGIC_1		0x5A	/// Second byte of a block header.
+#define DLG_COMPRESS_HEADER_LEN		9
+#define DLG_COMPRESS_STORED			0x8000	/// Raw length flag for an uncompressed payload.
+
+#define DLG_COMPRESS_MIN_MATCH		3
+#define DLG_COMPRESS_MAX_MATCH		(DLG_COMPRESS_MIN_MATCH + 15 + 255)
+#define DLG_COMPRESS_MAX_DISTANCE	4096
+
+/**
+ * Largest block of raw data compressed at once. Larger blocks compress better
+ * but take more RAM and CPU time per call.
+ */
+#ifndef DLG_COMPRESS_BLOCK_SIZE
+#define DLG_COMPRESS_BLOCK_SIZE		1024
+#endif
+
+/**
+ * Time after the last block at which a partial block is compressed, so
+ * a quiet bus does not leave data sitting in RAM, in the Get32bitTime()
+ * timebase.
+ */
+#ifndef DLG_COMPRESS_FLUSH_TIME
+#define DLG_COMPRESS_FLUSH_TIME		1024
+#endif
+
+/**
+ * Size of the output buffer needed for a block. Compression stops and the
+ * block is stored once the payload would grow past the raw data, so this is
+ * the raw size plus the header and room for the last item.
+ */
+#define DLG_COMPRESS_OUT_SIZE		(DLG_COMPRESS_HEADER_LEN + DLG_COMPRESS_BLOCK_SIZE + 4)
+
+#define DLG_COMPRESS_HASH_BITS		8		/// Match finder hash table size, log 2.
+
+typedef struct {
+	uint16_t head[1 << DLG_COMPRESS_HASH_BITS];	/// Most recent block position of each hash.
+} DataloggerCompressor;
+
+/**
+ * Compresses a block of data into a self-contained compressed block.
+ *
+ * @param comp Compressor state.
+ * @param in Raw data.
+ * @param inLen Raw data length, at most DLG_COMPRESS_BLOCK_SIZE.
+ * @param out Output buffer, at least DLG_COMPRESS_OUT_SIZE bytes.
+ * @return Length of the compressed block, including the header.
+ */
+uint16_t DataloggerCompress_Block(DataloggerCompressor *comp,
+		uint8_t *in, uint16_t inLen, uint8_t *out);
+
+#endif
@@ -0,0 +1,733 @@
+/*
+ * File:   datalogger-config.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 8:20 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Added per-SID logging policies.
+ * 17 Oct 2026	agent	Mask the ECAN receive interrupt while setting the filters.
+ * 17 Oct 2026	agent	Follow the cluster chains of the directory and file.
+ *
+ * @file
+ * Datalogger configuration file loading and ECAN acceptance filter
+ * compilation.
+ */
+
+#include <string.h>
+
+#include "../types.h"
+
+#include "../ecan.h"
+
+#include "../SD-SPI-DMA/sd-spi-dma.h"
+#include "../FAT32/fat32.h"
+#include "../FAT32/fat32-util.h"
+
+#include "datalogger-config.h"
+#include "datalogger-stringutil.h"
+#include "datalogger-file.h"
+
+#define DEBUG_UART
+#define DEBUG_UART_DATA
+//#define DEBUG_UART_SPAM
+#define DBG_MODULE "DLG/Config"
+#include "../debug-common.h"
+
+#define DLG_CONFIG_SUB_DONE			0	/// Not loading
+#define DLG_CONFIG_SUB_BEGIN		1	/// Load beginning
+#define DLG_CONFIG_SUB_READDIR		2	/// Reading the root directory looking for the configuration file
+#define DLG_CONFIG_SUB_READFILE		3	/// Reading the configuration file
+#define DLG_CONFIG_SUB_READDIRFAT	4	/// Reading the FAT for the root directory's next cluster
+#define DLG_CONFIG_SUB_READFILEFAT	5	/// Reading the FAT for the configuration file's next cluster
+
+#define DLG_CONFIG_SID_MASK			(DLG_CONFIG_NUM_SIDS - 1)
+
+/**
+ * @return Whether a SID is set in a bitmap.
+ */
+static uint8_t IsSet(uint8_t *bitmap, uint16_t sid) {
+	return (bitmap[sid >> 3] >> (sid & 0x07)) & 0x01;
+}
+
+/**
+ * @return Whether a SID is in the keep bitmap.
+ */
+static uint8_t IsKept(DataloggerConfig *config, uint16_t sid) {
+	return IsSet(config->keep, sid);
+}
+
+/**
+ * @return Milliseconds converted to the Get32bitTime() timebase, rounded up.
+ */
+static uint16_t MsToTicks(uint16_t ms) {
+	return (((uint32_t)ms << 10) + 999) / 1000;
+}
+
+/**
+ * @return The largest aligned block of SIDs starting at low and not going
+ * past high.
+ */
+static uint16_t LargestBlock(uint16_t low, uint16_t high) {
+	uint16_t size = 1;
+	while (size < DLG_CONFIG_NUM_SIDS && (low & (size*2 - 1)) == 0
+			&& low + size*2 - 1 <= high) {
+		size *= 2;
+	}
+	return size;
+}
+
+/**
+ * Compiles the keep bitmap into filters which accept exactly the kept SIDs.
+ * Each run of kept SIDs is split into the largest aligned blocks, each taking
+ * a filter, with a mask per block size.
+ * @param config Configuration.
+ * @return Whether the rules fit in the hardware filters.
+ */
+static uint8_t CompileExactFilters(DataloggerConfig *config) {
+	uint16_t sid = 0;
+
+	config->numFilters = 0;
+	config->numMasks = 0;
+
+	while (sid < DLG_CONFIG_NUM_SIDS) {
+		uint16_t high = sid;
+		if (!IsKept(config, sid)) {
+			sid++;
+			continue;
+		}
+		while (high + 1 < DLG_CONFIG_NUM_SIDS && IsKept(config, high + 1)) {
+			high++;
+		}
+
+		while (sid <= high) {
+			uint16_t size = LargestBlock(sid, high);
+			uint16_t mask = DLG_CONFIG_SID_MASK & ~(size - 1);
+			uint8_t maskNum;
+
+			for (maskNum=0;maskNum<config->numMasks;maskNum++) {
+				if (config->maskSID[maskNum] == mask) {
+					break;
+				}
+			}
+			if (maskNum == config->numMasks) {
+				if (config->numMasks == DLG_CONFIG_NUM_MASKS) {
+					return 0;
+				}
+				config->maskSID[config->numMasks++] = mask;
+			}
+			if (config->numFilters == DLG_CONFIG_NUM_FILTERS) {
+				return 0;
+			}
+			config->filterSID[config->numFilters] = sid;
+			config->filterMask[config->numFilters] = maskNum;
+			config->numFilters++;
+
+			sid += size;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Compiles the keep bitmap into filters which accept a superset of the kept
+ * SIDs, using the smallest single block size that fits in the filters.
+ * @param config Configuration.
+ */
+static void CompileSupersetFilters(DataloggerConfig *config) {
+	uint16_t size, block, sid;
+	uint16_t numKept = 0;
+
+	for (sid=0;sid<DLG_CONFIG_NUM_SIDS;sid++) {
+		numKept += IsKept(config, sid);
+	}
+
+	for (size=1;size<=DLG_CONFIG_NUM_SIDS;size*=2) {
+		uint8_t numBlocks = 0;
+		for (block=0;block<DLG_CONFIG_NUM_SIDS && numBlocks<=DLG_CONFIG_NUM_FILTERS;block+=size) {
+			for (sid=block;sid<block+size;sid++) {
+				if (IsKept(config, sid)) {
+					if (numBlocks < DLG_CONFIG_NUM_FILTERS) {
+						config->filterSID[numBlocks] = block;
+						config->filterMask[numBlocks] = 0;
+					}
+					numBlocks++;
+					break;
+				}
+			}
+		}
+		if (numBlocks <= DLG_CONFIG_NUM_FILTERS) {
+			config->numFilters = numBlocks;
+			break;
+		}
+	}
+
+	config->numMasks = 1;
+	config->maskSID[0] = DLG_CONFIG_SID_MASK & ~(size - 1);
+	config->softwareFilter = (uint16_t)config->numFilters * size != numKept;
+}
+
+/**
+ * Compiles the keep bitmap into acceptance filters.
+ * @param config Configuration.
+ */
+static void CompileFilters(DataloggerConfig *config) {
+	config->softwareFilter = 0;
+	if (config->keepAll) {
+		config->numFilters = 1;
+		config->numMasks = 1;
+		config->filterSID[0] = 0x000;
+		config->filterMask[0] = 0;
+		config->maskSID[0] = 0x000;
+	} else if (!CompileExactFilters(config)) {
+		CompileSupersetFilters(config);
+	}
+}
+
+/**
+ * Parses a hexadecimal SID, with or without a leading 0x.
+ * @param pos Parse position, advanced past the SID.
+ * @param sid Parsed SID.
+ * @return Whether a valid SID was parsed.
+ */
+static uint8_t ParseSID(char **pos, uint16_t *sid) {
+	char *p = *pos;
+	uint16_t value = 0;
+	uint8_t digits = 0;
+
+	if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+		p += 2;
+	}
+	while (1) {
+		char c = *p;
+		if (c >= '0' && c <= '9') {
+			c -= '0';
+		} else if (c >= 'A' && c <= 'F') {
+			c -= 'A' - 10;
+		} else if (c >= 'a' && c <= 'f') {
+			c -= 'a' - 10;
+		} else {
+			break;
+		}
+		value = (value << 4) | c;
+		if (value > DLG_CONFIG_SID_MASK) {
+			return 0;
+		}
+		digits++;
+		p++;
+	}
+
+	*pos = p;
+	*sid = value;
+	return digits != 0;
+}
+
+/**
+ * Parses a decimal time in milliseconds.
+ * @param pos Parse position, advanced past the time.
+ * @param ms Parsed time.
+ * @return Whether a valid time, from 1 to DLG_CONFIG_MAX_MS, was parsed.
+ */
+static uint8_t ParseMs(char **pos, uint16_t *ms) {
+	char *p = *pos;
+	uint32_t value = 0;
+
+	while (*p >= '0' && *p <= '9') {
+		value = value * 10 + (*p - '0');
+		if (value > DLG_CONFIG_MAX_MS) {
+			return 0;
+		}
+		p++;
+	}
+	if (p == *pos || value == 0 || (*p != ' ' && *p != '\t' && *p != '\0')) {
+		return 0;
+	}
+
+	*pos = p;
+	*ms = value;
+	return 1;
+}
+
+/**
+ * @return Pointer to the first non-whitespace character at or after p.
+ */
+static char* SkipSpace(char *p) {
+	while (*p == ' ' || *p == '\t') {
+		p++;
+	}
+	return p;
+}
+
+/**
+ * Parses a SID or SID range, followed by whitespace or the end of the line.
+ * @param pos Parse position, advanced past the range.
+ * @param low First SID of the range.
+ * @param high Last SID of the range.
+ * @return Whether a valid range was parsed.
+ */
+static uint8_t ParseSIDRange(char **pos, uint16_t *low, uint16_t *high) {
+	char *p = *pos;
+
+	if (!ParseSID(&p, low)) {
+		return 0;
+	}
+	*high = *low;
+	if (*p == '-') {
+		p++;
+		if (!ParseSID(&p, high) || *high < *low) {
+			return 0;
+		}
+	}
+	if (*p != ' ' && *p != '\t' && *p != '\0') {
+		return 0;
+	}
+
+	*pos = p;
+	return 1;
+}
+
+/**
+ * Parses the arguments of a KEEP rule, adding the SIDs to the keep bitmap.
+ * @param config Configuration.
+ * @param p Arguments.
+ * @return Whether the arguments were valid.
+ */
+static uint8_t ParseKeepRule(DataloggerConfig *config, char *p) {
+	uint16_t low, high;
+	uint8_t count = 0;
+
+	while (*(p = SkipSpace(p)) != '\0') {
+		if (!ParseSIDRange(&p, &low, &high)) {
+			return 0;
+		}
+		config->keepAll = 0;
+		for (;low<=high;low++) {
+			config->keep[low >> 3] |= 1 << (low & 0x07);
+		}
+		count++;
+	}
+	return count != 0;
+}
+
+/**
+ * Parses the arguments of a CHANGE, EVERY or ALWAYS rule, adding a policy
+ * rule for each SID range.
+ * @param config Configuration.
+ * @param p Arguments.
+ * @param policy One of the DLG_POLICY values.
+ * @return Whether the arguments were valid and fit in the policy table.
+ */
+static uint8_t ParsePolicyRule(DataloggerConfig *config, char *p, uint8_t policy) {
+	uint16_t low, high, intervalMs = 0;
+	uint8_t count = 0;
+
+	if (policy == DLG_POLICY_EVERY) {
+		p = SkipSpace(p);
+		if (!ParseMs(&p, &intervalMs)) {
+			return 0;
+		}
+	}
+
+	while (*(p = SkipSpace(p)) != '\0') {
+		DataloggerSIDPolicy *rule = &config->policies[config->numPolicies];
+		if (!ParseSIDRange(&p, &low, &high)
+				|| config->numPolicies == DLG_CONFIG_MAX_POLICIES) {
+			return 0;
+		}
+		rule->low = low;
+		rule->high = high;
+		rule->policy = policy;
+		rule->intervalMs = intervalMs;
+		rule->interval = MsToTicks(intervalMs);
+		config->numPolicies++;
+
+		// Later rules override earlier ones
+		for (;low<=high;low++) {
+			if (policy == DLG_POLICY_ALWAYS) {
+				config->hasPolicy[low >> 3] &= ~(1 << (low & 0x07));
+			} else {
+				config->hasPolicy[low >> 3] |= 1 << (low & 0x07);
+			}
+		}
+		count++;
+	}
+	return count != 0;
+}
+
+/**
+ * Parses the argument of an ALIVE rule.
+ * @param config Configuration.
+ * @param p Arguments.
+ * @return Whether the arguments were valid.
+ */
+static uint8_t ParseAliveRule(DataloggerConfig *config, char *p) {
+	p = SkipSpace(p);
+	if (!ParseMs(&p, &config->aliveMs) || *SkipSpace(p) != '\0') {
+		return 0;
+	}
+	config->alive = MsToTicks(config->aliveMs);
+	return 1;
+}
+
+/**
+ * Parses the line buffered in the configuration struct.
+ * @param config Configuration.
+ */
+static void ParseLine(DataloggerConfig *config) {
+	char *p = config->line;
+	char *comment;
+	uint8_t valid = 0;
+
+	if (config->lineLength == DLG_CONFIG_LINE_LENGTH) {
+		DBG_DATA_printf("Ignoring overlong line");
+		config->lineLength = 0;
+		if (config->badLines < 0xff) {
+			config->badLines++;
+		}
+		return;
+	}
+	config->line[config->lineLength] = '\0';
+	config->lineLength = 0;
+	if ((comment = strchr(p, '#')) != NULL) {
+		*comment = '\0';
+	}
+
+	p = SkipSpace(p);
+	if (*p == '\0') {
+		return;
+	}
+	DBG_SPAM_printf("Parsing '%s'", p);
+
+	if (!strncmp(p, "KEEP", 4) && (p[4] == ' ' || p[4] == '\t')) {
+		valid = ParseKeepRule(config, p + 4);
+	} else if (!strncmp(p, "CHANGE", 6) && (p[6] == ' ' || p[6] == '\t')) {
+		valid = ParsePolicyRule(config, p + 6, DLG_POLICY_CHANGE);
+	} else if (!strncmp(p, "EVERY", 5) && (p[5] == ' ' || p[5] == '\t')) {
+		valid = ParsePolicyRule(config, p + 5, DLG_POLICY_EVERY);
+	} else if (!strncmp(p, "ALWAYS", 6) && (p[6] == ' ' || p[6] == '\t')) {
+		valid = ParsePolicyRule(config, p + 6, DLG_POLICY_ALWAYS);
+	} else if (!strncmp(p, "ALIVE", 5) && (p[5] == ' ' || p[5] == '\t')) {
+		valid = ParseAliveRule(config, p + 5);
+	}
+
+	if (!valid) {
+		DBG_DATA_printf("Ignoring bad line '%s'", p);
+		if (config->badLines < 0xff) {
+			config->badLines++;
+		}
+	}
+}
+
+/**
+ * Parses a block of the configuration file.
+ * @param config Configuration.
+ * @param data Block data.
+ * @param length Number of bytes of data.
+ */
+static void ParseBlock(DataloggerConfig *config, uint8_t *data, uint16_t length) {
+	uint16_t i;
+	for (i=0;i<length;i++) {
+		char c = data[i];
+		if (c == '\n') {
+			ParseLine(config);
+		} else if (c == '\r' || config->lineLength == DLG_CONFIG_LINE_LENGTH) {
+		} else if (config->lineLength < DLG_CONFIG_LINE_LENGTH - 1) {
+			config->line[config->lineLength++] = c;
+		} else {
+			config->lineLength = DLG_CONFIG_LINE_LENGTH;
+		}
+	}
+}
+
+/**
+ * Searches a block of the root directory for the configuration file.
+ * @param config Configuration.
+ * @param data Block data.
+ * @return Search result.
+ * @retval 1 Found, the location and size of the file are populated.
+ * @retval 0 Not found in this block.
+ * @retval -1 End of the directory reached.
+ */
+static int8_t ProcessDirectoryBlock(DataloggerConfig *config, uint8_t *data) {
+	uint16_t pos = 0;
+	for (pos=0;pos<config->fs->bytesPerSector;pos+=32) {
+		if (data[pos] == 0x00) {
+			return -1;
+		} else if (data[pos] == 0xe5 || (data[pos+11] & 0x18)) {
+			continue;	// deleted, long file name, volume label or directory
+		} else if (!strncmp((char*)data+pos, DLG_CONFIG_FILE_NAME, 11)) {
+			uint32_t cluster = FATSplitDataToInt32(data+pos+0x14, data+pos+0x1a);
+			config->remaining = FATDataToInt32(data+pos+0x1c);
+			config->cluster = cluster;
+			config->lba = GetClusterLBA(config->fs, cluster);
+			config->lbaClusterOffset = 0;
+			if (cluster == 0) {
+				config->remaining = 0;
+			}
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Moves on to the next cluster of the directory or file being read, from a
+ * block of the FAT.
+ * @param config Configuration.
+ * @param data FAT block data, containing the entry for the current cluster.
+ * @return Whether there is a next cluster.
+ */
+static uint8_t NextCluster(DataloggerConfig *config, uint8_t *data) {
+	uint32_t cluster = FATDataToInt32(data + GetClusterFATOffset(config->fs, config->cluster)) & 0x0fffffff;
+	if (cluster < 2 || cluster >= 0x0ffffff8) {
+		return 0;
+	}
+	config->cluster = cluster;
+	config->lba = GetClusterLBA(config->fs, cluster);
+	config->lbaClusterOffset = 0;
+	return 1;
+}
+
+/**
+ * Completes loading, compiling the filters.
+ * @param config Configuration.
+ */
+static void FinishLoad(DataloggerConfig *config) {
+	if (config->lineLength != 0) {
+		ParseLine(config);
+	}
+	config->state = DLG_CONFIG_SUB_DONE;
+	CompileFilters(config);
+	DBG_DATA_printf("Compiled %u filters, %u masks, %s filtering",
+			config->numFilters, config->numMasks,
+			config->softwareFilter ? "software" : "hardware");
+}
+
+void DataloggerConfig_Init(DataloggerConfig *config) {
+	config->found = 0;
+	config->keepAll = 1;
+	config->badLines = 0;
+	memset(config->keep, 0, sizeof(config->keep));
+	config->numPolicies = 0;
+	memset(config->hasPolicy, 0, sizeof(config->hasPolicy));
+	config->aliveMs = DLG_CONFIG_DEFAULT_ALIVE_MS;
+	config->alive = MsToTicks(DLG_CONFIG_DEFAULT_ALIVE_MS);
+	config->state = DLG_CONFIG_SUB_DONE;
+	config->lineLength = 0;
+	CompileFilters(config);
+}
+
+fs_result_t DataloggerConfig_Load(DataloggerConfig *config, FS_FAT32 *fs) {
+	DataloggerConfig_Init(config);
+	config->fs = fs;
+	config->state = DLG_CONFIG_SUB_BEGIN;
+	config->cluster = fs->rootDirectory.directoryTableBeginCluster;
+	config->lba = GetClusterLBA(fs, config->cluster);
+	config->lbaClusterOffset = 0;
+	return DataloggerConfig_GetLoadResult(config);
+}
+
+fs_result_t DataloggerConfig_GetLoadResult(DataloggerConfig *config) {
+	SD_Card *card = config->fs->card;
+	uint8_t *data = card->DataBlocks[0].Data + 2;
+	sd_result_t result = SD_BUSY;
+
+	if (config->state == DLG_CONFIG_SUB_DONE) {
+		return FS_SUCCESS;
+	} else if (config->state == DLG_CONFIG_SUB_BEGIN) {
+		config->state = DLG_CONFIG_SUB_READDIR;
+		DBG_SPAM_printf("Read directory table at LBA 0x%08lx", config->lba);
+		result = SD_DMA_SingleBlockRead(card, config->lba, &card->DataBlocks[0]);
+		if (result == SD_BUSY) {
+			return FS_BUSY;
+		}
+	}
+
+	while (config->state != DLG_CONFIG_SUB_DONE) {
+		if (result == SD_BUSY) {
+			result = SD_DMA_GetSingleBlockReadResult(card);
+		}
+
+		if (result == SD_BUSY) {
+			return FS_BUSY;
+		} else if (result != SD_SUCCESS) {
+			DBG_ERR_printf("Failed: Error reading LBA 0x%08lx, got 0x%02x", config->lba, result);
+			DataloggerConfig_Init(config);
+			return FS_PHY_ERR;
+		}
+
+		if (config->state == DLG_CONFIG_SUB_READDIR) {
+			int8_t found = ProcessDirectoryBlock(config, data);
+			if (found > 0) {
+				DBG_DATA_printf("Found configuration file, %lu bytes", config->remaining);
+				config->found = 1;
+				config->state = DLG_CONFIG_SUB_READFILE;
+				if (config->remaining == 0) {
+					FinishLoad(config);
+					return FS_SUCCESS;
+				}
+			} else if (found < 0) {
+				DBG_DATA_printf("No configuration file");
+				FinishLoad(config);
+				return FS_SUCCESS;
+			} else if (++config->lbaClusterOffset == config->fs->sectorsPerCluster) {
+				config->state = DLG_CONFIG_SUB_READDIRFAT;
+				config->lba = GetClusterFATLBA(config->fs, config->cluster);
+			} else {
+				config->lba++;
+			}
+		} else if (config->state == DLG_CONFIG_SUB_READDIRFAT) {
+			if (!NextCluster(config, data)) {
+				DBG_DATA_printf("No configuration file");
+				FinishLoad(config);
+				return FS_SUCCESS;
+			}
+			config->state = DLG_CONFIG_SUB_READDIR;
+		} else if (config->state == DLG_CONFIG_SUB_READFILEFAT) {
+			if (!NextCluster(config, data)) {
+				DBG_ERR_printf("Configuration file cluster chain ends %lu bytes short", config->remaining);
+				FinishLoad(config);
+				return FS_SUCCESS;
+			}
+			config->state = DLG_CONFIG_SUB_READFILE;
+		} else {
+			uint16_t length = config->fs->bytesPerSector;
+			if (config->remaining < length) {
+				length = config->remaining;
+			}
+			ParseBlock(config, data, length);
+			config->remaining -= length;
+
+			config->lba++;
+			if (config->remaining == 0) {
+				FinishLoad(config);
+				return FS_SUCCESS;
+			} else if (++config->lbaClusterOffset == config->fs->sectorsPerCluster) {
+				config->state = DLG_CONFIG_SUB_READFILEFAT;
+				config->lba = GetClusterFATLBA(config->fs, config->cluster);
+			}
+		}
+
+		DBG_SPAM_printf("Read LBA 0x%08lx", config->lba);
+		result = SD_DMA_SingleBlockRead(card, config->lba, &card->DataBlocks[0]);
+		if (result == SD_BUSY) {
+			return FS_BUSY;
+		}
+		// Otherwise continue on for another loop...
+	}
+
+	return FS_SUCCESS;
+}
+
+void DataloggerConfig_ApplyFilters(DataloggerConfig *config) {
+	uint8_t i;
+	uint8_t rxInterrupt;
+
+	// The receive interrupt is already running at mount. The filter window
+	// maps the receive buffer full registers to the buffer pointers, so the
+	// ISR can't run until the filters are set up.
+	rxInterrupt = ECAN_DisableRXInterrupt();
+	ECAN_SetMode(ECAN_MODE_CONFIG);
+	for (i=0;i<DLG_CONFIG_NUM_FILTERS;i++) {
+		ECAN_DisableFilter(i);
+	}
+	for (i=0;i<config->numMasks;i++) {
+		ECAN_SetStandardMask(i, config->maskSID[i]);
+	}
+	for (i=0;i<config->numFilters;i++) {
+		ECAN_SetStandardFilter(i, config->filterSID[i], config->filterMask[i], 15);
+	}
+	ECAN_SetMode(ECAN_MODE_OPERATE);
+	ECAN_RestoreRXInterrupt(rxInterrupt);
+}
+
+uint8_t DataloggerConfig_KeepSID(DataloggerConfig *config, uint16_t sid) {
+	if (!config->softwareFilter) {
+		return 1;
+	}
+	return IsKept(config, sid & DLG_CONFIG_SID_MASK);
+}
+
+DataloggerSIDPolicy* DataloggerConfig_GetPolicy(DataloggerConfig *config, uint16_t sid) {
+	int8_t i;
+
+	sid &= DLG_CONFIG_SID_MASK;
+	if (!IsSet(config->hasPolicy, sid)) {
+		return NULL;
+	}
+	for (i=config->numPolicies-1;i>=0;i--) {
+		if (sid >= config->policies[i].low && sid <= config->policies[i].high) {
+			return &config->policies[i];
+		}
+	}
+	return NULL;
+}
+
+void DataloggerConfig_WriteParameters(DataloggerConfig *config, DataloggerFile *dlgFile) {
+	char bufConfig[] = "PRM CANCFG DLGCFG.TXT xx\n";
+	char bufFilter[] = "PRM CANFILT xx xx x\n";
+	char bufKeep[] = "PRM CANKEEP xxx-xxx\n";
+	char bufPolicy[] = "PRM CANPOL xxx-xxx x xxxx\n";
+	char bufAlive[] = "PRM CANALIVE xxxx\n";
+	uint16_t sid = 0;
+	uint8_t runs = 0;
+	uint8_t i;
+
+	if (config->found) {
+		Int8ToString(config->badLines, bufConfig+22);
+		DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)bufConfig, 25);
+	}
+
+	bufFilter[12] = config->softwareFilter ? 'S' : 'H';
+	bufFilter[13] = 'W';
+	Int8ToString(config->numFilters, bufFilter+15);
+	Int4ToString(config->numMasks, bufFilter+18);
+	DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)bufFilter, 20);
+
+	// Policy rules in order, with C(hange), E(very) or A(lways)
+	for (i=0;i<config->numPolicies;i++) {
+		DataloggerSIDPolicy *rule = &config->policies[i];
+		Int12ToString(rule->low, bufPolicy+11);
+		Int12ToString(rule->high, bufPolicy+15);
+		if (rule->policy == DLG_POLICY_EVERY) {
+			bufPolicy[19] = 'E';
+			Int16ToString(rule->intervalMs, bufPolicy+21);
+			bufPolicy[25] = '\n';
+			DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)bufPolicy, 26);
+		} else {
+			bufPolicy[19] = (rule->policy == DLG_POLICY_CHANGE) ? 'C' : 'A';
+			bufPolicy[20] = '\n';
+			DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)bufPolicy, 21);
+			bufPolicy[20] = ' ';
+		}
+	}
+	if (config->numPolicies != 0) {
+		Int16ToString(config->aliveMs, bufAlive+13);
+		DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)bufAlive, 18);
+	}
+
+	if (config->keepAll) {
+		return;
+	}
+	while (sid < DLG_CONFIG_NUM_SIDS) {
+		uint16_t high = sid;
+		if (!IsKept(config, sid)) {
+			sid++;
+			continue;
+		}
+		while (high + 1 < DLG_CONFIG_NUM_SIDS && IsKept(config, high + 1)) {
+			high++;
+		}
+		if (runs == DLG_CONFIG_MAX_LOGGED_RUNS) {
+			DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)"PRM CANKEEP MORE\n", 17);
+			return;
+		}
+		Int12ToString(sid, bufKeep+12);
+		Int12ToString(high, bufKeep+16);
+		DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)bufKeep, 20);
+		runs++;
+		sid = high + 1;
+	}
+}
@@ -0,0 +1,166 @@
+/*
+ * File:   datalogger-config.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 8:20 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Added per-SID logging policies.
+ * 17 Oct 2026	agent	Configuration files longer than a cluster.
+ *
+ * @file
+ * Datalogger configuration file, read from the card root directory when the
+ * card is mounted.
+ *
+ * The configuration file is DLGCFG.TXT, plain text with one rule per line.
+ * Anything after a '#' is a comment. Identifiers are hexadecimal, with or
+ * without a leading 0x, times are decimal milliseconds. Rules:
+ *   KEEP sid [sid ...]		Log these SIDs. Each may also be a range, low-high.
+ *   CHANGE sid [sid ...]	Only log frames whose payload differs from the last
+ *							one logged for that SID.
+ *   EVERY ms sid [sid ...]	Log at most one frame per SID every ms.
+ *   ALWAYS sid [sid ...]	Log every frame (the default).
+ *   ALIVE ms				Period of the counts of frames not logged because
+ *							of CHANGE or EVERY (default 1000, at most 60000).
+ * If there are no KEEP rules (or no configuration file), every SID is logged.
+ * When CHANGE / EVERY / ALWAYS rules overlap, the last one wins.
+ * Unknown, malformed and overlong lines are ignored and counted.
+ *
+ * The KEEP rules are compiled into the ECAN acceptance filters so unwanted
+ * frames never reach the CPU. Each range is split into aligned power-of-two
+ * blocks, each taking one filter, with the block size selecting one of the
+ * three masks. If that does not fit, the hardware is programmed to accept a
+ * superset of the rules (aligned blocks of a single size), and the remaining
+ * frames are rejected in software by DataloggerConfig_KeepSID.
+ *
+ * Only the first cluster of the root directory and of the configuration file
+ * are read, which is plenty for a list of rules.
+ */
+
+#ifndef DATALOGGER_CONFIG_H
+#define DATALOGGER_CONFIG_H
+
+#include "../types.h"
+
+#include "../FAT32/fat32.h"
+
+#include "datalogger-file.h"
+
+#define DLG_CONFIG_FILE_NAME		"DLGCFG  TXT"	/// Directory entry name of the configuration file.
+
+#define DLG_CONFIG_LINE_LENGTH		64		/// Line buffer size, longer lines are ignored.
+#define DLG_CONFIG_NUM_SIDS			2048	/// Number of standard identifiers.
+#define DLG_CONFIG_NUM_FILTERS		16		/// ECAN acceptance filters available.
+#define DLG_CONFIG_NUM_MASKS		3		/// ECAN acceptance masks available.
+#define DLG_CONFIG_MAX_LOGGED_RUNS	32		/// Most PRM CANKEEP lines written to the log.
+#define DLG_CONFIG_MAX_POLICIES		16		/// Most CHANGE / EVERY / ALWAYS rules.
+#define DLG_CONFIG_DEFAULT_ALIVE_MS	1000	/// Default ALIVE period.
+#define DLG_CONFIG_MAX_MS			60000	/// Longest EVERY or ALIVE time.
+
+#define DLG_POLICY_ALWAYS			0		/// Log every frame.
+#define DLG_POLICY_CHANGE			1		/// Log frames whose payload changed.
+#define DLG_POLICY_EVERY			2		/// Log at most one frame every interval.
+
+typedef struct {
+	uint16_t low;			/// First SID of the rule.
+	uint16_t high;			/// Last SID of the rule.
+	uint8_t policy;			/// One of the DLG_POLICY values.
+	uint16_t intervalMs;	/// EVERY interval, in ms.
+	uint16_t interval;		/// EVERY interval, in the Get32bitTime() timebase.
+} DataloggerSIDPolicy;
+
+typedef struct {
+	// Rules
+	uint8_t found;			/// Whether a configuration file was read.
+	uint8_t keepAll;		/// Whether there are no KEEP rules, so every SID is kept.
+	uint8_t badLines;		/// Number of unknown or malformed lines, saturating.
+	uint8_t keep[DLG_CONFIG_NUM_SIDS / 8];	/// Bitmap of SIDs to keep.
+	uint8_t numPolicies;	/// Number of policy rules.
+	DataloggerSIDPolicy policies[DLG_CONFIG_MAX_POLICIES];	/// Policy rules, in file order.
+	uint8_t hasPolicy[DLG_CONFIG_NUM_SIDS / 8];	/// Bitmap of SIDs with a policy other than ALWAYS.
+	uint16_t aliveMs;		/// Period of the counts of frames not logged, in ms.
+	uint16_t alive;			/// Period of the counts of frames not logged, in the Get32bitTime() timebase.
+
+	// Compiled acceptance filters
+	uint8_t numFilters;		/// Number of filters used.
+	uint8_t numMasks;		/// Number of masks used.
+	uint16_t filterSID[DLG_CONFIG_NUM_FILTERS];
+	uint8_t filterMask[DLG_CONFIG_NUM_FILTERS];
+	uint16_t maskSID[DLG_CONFIG_NUM_MASKS];
+	uint8_t softwareFilter;	/// Whether the filters accept a superset, so frames must be checked with DataloggerConfig_KeepSID.
+
+	// Loader state
+	FS_FAT32 *fs;			/// Filesystem being read.
+	uint8_t state;			/// Loader state.
+	uint32_t cluster;		/// Cluster being read.
+	fs_addr_t lba;			/// LBA of the block being read.
+	uint8_t lbaClusterOffset;	/// Offset of the block being read within its cluster.
+	uint32_t remaining;		/// Bytes of the configuration file left to read.
+	char line[DLG_CONFIG_LINE_LENGTH];	/// Line being parsed, which may span blocks.
+	uint8_t lineLength;		/// Characters in line, DLG_CONFIG_LINE_LENGTH if it overflowed.
+} DataloggerConfig;
+
+/**
+ * Initializes a configuration to the defaults (log everything), without
+ * changing the ECAN filters.
+ * @param config Configuration to initialize.
+ */
+void DataloggerConfig_Init(DataloggerConfig *config);
+
+/**
+ * Begins loading the configuration file from the root directory of a
+ * filesystem in the background, replacing any previous configuration.
+ * This uses the card's first data block, so no file operations may be in
+ * progress.
+ * @param config Configuration to load into.
+ * @param fs Initialized filesystem.
+ * @return Same as DataloggerConfig_GetLoadResult.
+ */
+fs_result_t DataloggerConfig_Load(DataloggerConfig *config, FS_FAT32 *fs);
+
+/**
+ * Continues loading the configuration file.
+ * On completion, the filters are compiled but not yet applied.
+ * @param config Configuration being loaded.
+ * @return Result.
+ * @retval FS_BUSY Still loading.
+ * @retval FS_SUCCESS Done, check config->found for whether a configuration
+ * file exists. Otherwise, the defaults are loaded.
+ * @retval FS_PHY_ERR Storage medium access error, the defaults are loaded.
+ */
+fs_result_t DataloggerConfig_GetLoadResult(DataloggerConfig *config);
+
+/**
+ * Programs the ECAN acceptance filters from the configuration, with all
+ * accepted frames going into the receive FIFO. This briefly puts the ECAN
+ * module into configuration mode, and frames on the bus meanwhile are missed.
+ * @param config Configuration to apply.
+ */
+void DataloggerConfig_ApplyFilters(DataloggerConfig *config);
+
+/**
+ * Checks whether a frame accepted by the ECAN filters should be logged.
+ * @param config Applied configuration.
+ * @param sid Frame standard identifier.
+ * @return Whether to log the frame.
+ */
+uint8_t DataloggerConfig_KeepSID(DataloggerConfig *config, uint16_t sid);
+
+/**
+ * Looks up the logging policy of a SID.
+ * @param config Loaded configuration.
+ * @param sid Frame standard identifier.
+ * @return Policy rule for the SID, or NULL to log every frame.
+ */
+DataloggerSIDPolicy* DataloggerConfig_GetPolicy(DataloggerConfig *config, uint16_t sid);
+
+/**
+ * Writes PRM lines describing the configuration to the file.
+ * @param config Loaded configuration.
+ * @param dlgFile Datalogger file to write to.
+ */
+void DataloggerConfig_WriteParameters(DataloggerConfig *config, DataloggerFile *dlgFile);
+
+#endif
@@ -7,6 +7,11 @@
  * Revision History
  * Date			Author	Change
  * 12 Aug 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Added reserve/commit for formatting records in place.
+ * 17 Oct 2026	agent	Added the compression stage.
+ * 17 Oct 2026	agent	Time-based sync points.
+ * 17 Oct 2026	agent	File rotation.
+ * 17 Oct 2026	agent	SD Card busy time budget.
  *
  * @file
  * Datalogger file operations, including a large circular buffer in RAM.
@@ -14,7 +19,10 @@
 
 #include <string.h>
 
+#include "../timing.h"
+
 #include "datalogger-file.h"
+#include "datalogger-compress.h"
 
 #define DEBUG_UART
 #define DEBUG_UART_DATA
@@ -30,21 +38,36 @@ void DataloggerFile_Init(DataloggerFile *dlgFile, FS_File *file,
 	dlgFile->bufferFree = bufferSize;
 	dlgFile->readPos = 0;
 	dlgFile->writePos = 0;
+	dlgFile->reservePtr = NULL;
+	dlgFile->reserveDirect = 0;
 	dlgFile->requestClose = 0;
+	dlgFile->nextFile = NULL;
+	dlgFile->rotateRemaining = 0;
+	dlgFile->lastSyncTime = Get32bitTime();
+	dlgFile->statBytes = 0;
+	dlgFile->statTime = Get32bitTime();
+#ifdef DATALOGGER_COMPRESS
+	dlgFile->compressLength = 0;
+	dlgFile->compressPos = 0;
+	dlgFile->lastBlockTime = Get32bitTime();
+#endif
 }
 
 uint16_t DataloggerFile_WriteAtomic(DataloggerFile *dlgFile, uint8_t *data,
 		uint16_t dataLen) {
 	// Check if there is enough free space in the buffer for an atomic write
 	if (dataLen > dlgFile->bufferFree) {
+		dlgFile->statBytes += dataLen;
 		return 0;
 	}
 	if (dlgFile->requestClose) {
 		return 0;
 	}
+	dlgFile->statBytes += dataLen;
 
+#ifndef DATALOGGER_COMPRESS
 	// If the buffer is clear and the file is ready, write directly to the file
-	if (dlgFile->bufferFree == dlgFile->bufferSize
+	if (dlgFile->bufferFree == dlgFile->bufferSize && dlgFile->nextFile == NULL
 			&& dlgFile->file->state != FILE_Uninitialized
 			&& dlgFile->file->state != FILE_Creating) {
 		fs_length_t writeLength = FS_WriteFile(dlgFile->file, data, dataLen);
@@ -53,6 +76,7 @@ uint16_t DataloggerFile_WriteAtomic(DataloggerFile *dlgFile, uint8_t *data,
 
 		DBG_SPAM_printf("DLGFile: write->card %u bytes", writeLength);
 	}
+#endif
 	while (dataLen > 0) {
 		fs_length_t writeLength;
 		// Determine maximum contigious write length
@@ -83,8 +107,158 @@ uint16_t DataloggerFile_WriteAtomic(DataloggerFile *dlgFile, uint8_t *data,
 	return 1;
 }
 
+uint8_t* DataloggerFile_Reserve(DataloggerFile *dlgFile, uint16_t dataLen) {
+	uint16_t contiguousFree;
+
+	if (dataLen > dlgFile->bufferFree) {
+		dlgFile->statBytes += dataLen;
+		return NULL;
+	}
+	if (dataLen > DLG_FILE_WRAP_SIZE) {
+		return NULL;
+	}
+	if (dlgFile->requestClose) {
+		return NULL;
+	}
+
+#ifndef DATALOGGER_COMPRESS
+	// If the buffer is clear and the file is ready, try writing in place in the file
+	if (dlgFile->bufferFree == dlgFile->bufferSize && dlgFile->nextFile == NULL
+			&& dlgFile->file->state != FILE_Uninitialized
+			&& dlgFile->file->state != FILE_Creating) {
+		dlgFile->reservePtr = FS_ReserveFile(dlgFile->file, dataLen);
+		if (dlgFile->reservePtr != NULL) {
+			dlgFile->reserveDirect = 1;
+			return dlgFile->reservePtr;
+		}
+	}
+#endif
+	dlgFile->reserveDirect = 0;
+
+	// Determine maximum contigious write length
+	if (dlgFile->readPos > dlgFile->writePos) {
+		contiguousFree = dlgFile->bufferFree;
+	} else {
+		contiguousFree = dlgFile->bufferSize - dlgFile->writePos;
+	}
+
+	if (dataLen <= contiguousFree) {
+		dlgFile->reservePtr = dlgFile->buffer + dlgFile->writePos;
+	} else {
+		dlgFile->reservePtr = dlgFile->wrapBuffer;
+	}
+	return dlgFile->reservePtr;
+}
+
+void DataloggerFile_Commit(DataloggerFile *dlgFile, uint16_t dataLen) {
+	dlgFile->statBytes += dataLen;
+	if (dlgFile->reserveDirect) {
+		FS_CommitFile(dlgFile->file, dataLen);
+		dlgFile->reservePtr = NULL;
+		dlgFile->reserveDirect = 0;
+
+		DBG_SPAM_printf("DLGFile: commit->card %u bytes", dataLen);
+		return;
+	} else if (dlgFile->reservePtr == dlgFile->wrapBuffer) {
+		// Copy the record around the buffer end
+		uint16_t firstLength = dlgFile->bufferSize - dlgFile->writePos;
+		if (firstLength > dataLen) {
+			firstLength = dataLen;
+		}
+		memcpy(dlgFile->buffer + dlgFile->writePos, dlgFile->wrapBuffer, firstLength);
+		memcpy(dlgFile->buffer, dlgFile->wrapBuffer + firstLength, dataLen - firstLength);
+	}
+
+	dlgFile->writePos += dataLen;
+	if (dlgFile->writePos >= dlgFile->bufferSize) {
+		dlgFile->writePos -= dlgFile->bufferSize;
+	}
+	dlgFile->bufferFree -= dataLen;
+	dlgFile->reservePtr = NULL;
+
+	DBG_SPAM_printf("DLGFile: commit->buffer %u bytes, bufFree = %u", dataLen, dlgFile->bufferFree);
+}
+
+#ifdef DATALOGGER_COMPRESS
+/**
+ * Writes as much of the compressed block as possible to the file.
+ * @return Whether the whole block has been written.
+ */
+static uint8_t DataloggerFile_WriteCompressed(DataloggerFile *dlgFile) {
+	if (dlgFile->compressPos < dlgFile->compressLength) {
+		fs_length_t writeLength = FS_WriteFile(dlgFile->file,
+				dlgFile->compressBuffer + dlgFile->compressPos,
+				dlgFile->compressLength - dlgFile->compressPos);
+		dlgFile->compressPos += writeLength;
+
+		DBG_SPAM_printf("DLGFile: compressed->card %u bytes", writeLength);
+	}
+	return dlgFile->compressPos == dlgFile->compressLength;
+}
+
+/**
+ * Compresses the next block from the RAM buffer, if a block is due and the
+ * previous one has been written.
+ */
+static void DataloggerFile_CompressBlock(DataloggerFile *dlgFile) {
+	uint16_t buffered = dlgFile->bufferSize - dlgFile->bufferFree;
+	uint16_t blockLength;
+
+	// While rotating, blocks must not cross into the next file's data
+	if (dlgFile->nextFile != NULL) {
+		buffered = dlgFile->rotateRemaining;
+	}
+	if (buffered == 0) {
+		return;
+	}
+	if (buffered < DLG_COMPRESS_BLOCK_SIZE && !dlgFile->requestClose
+			&& dlgFile->nextFile == NULL
+			&& Get32bitTime() - dlgFile->lastBlockTime < DLG_COMPRESS_FLUSH_TIME) {
+		return;
+	}
+
+	// Compress the contiguous data at the read position
+	if (dlgFile->writePos > dlgFile->readPos) {
+		blockLength = dlgFile->writePos - dlgFile->readPos;
+	} else {
+		blockLength = dlgFile->bufferSize - dlgFile->readPos;
+	}
+	if (blockLength > DLG_COMPRESS_BLOCK_SIZE) {
+		blockLength = DLG_COMPRESS_BLOCK_SIZE;
+	}
+	if (blockLength > buffered) {
+		blockLength = buffered;
+	}
+	dlgFile->compressLength = DataloggerCompress_Block(&dlgFile->compressor,
+			dlgFile->buffer + dlgFile->readPos, blockLength,
+			dlgFile->compressBuffer);
+	dlgFile->compressPos = 0;
+	dlgFile->lastBlockTime = Get32bitTime();
+
+	dlgFile->readPos += blockLength;
+	if (dlgFile->readPos >= dlgFile->bufferSize) {
+		dlgFile->readPos = 0;
+	}
+	dlgFile->bufferFree += blockLength;
+	if (dlgFile->nextFile != NULL) {
+		dlgFile->rotateRemaining -= blockLength;
+	}
+
+	DBG_SPAM_printf("DLGFile: buffer->compressed %u -> %u bytes, bufFree = %u", blockLength, dlgFile->compressLength, dlgFile->bufferFree);
+}
+#endif
+
 fs_result_t DataloggerFile_Tasks(DataloggerFile *dlgFile) {
 	// Check if there is data to write
+#ifdef DATALOGGER_COMPRESS
+	if (dlgFile->file->state != FILE_Uninitialized
+			&& dlgFile->file->state != FILE_Creating) {
+		if (DataloggerFile_WriteCompressed(dlgFile)) {
+			DataloggerFile_CompressBlock(dlgFile);
+			DataloggerFile_WriteCompressed(dlgFile);
+		}
+	}
+#else
 	if (dlgFile->file->state != FILE_Uninitialized
 			&& dlgFile->file->state != FILE_Creating) {
 		while (dlgFile->bufferFree != dlgFile->bufferSize) {
@@ -95,6 +269,14 @@ fs_result_t DataloggerFile_Tasks(DataloggerFile *dlgFile) {
 			} else {
 				writeLength = dlgFile->bufferSize - dlgFile->readPos;
 			}
+			// While rotating, only the data written before the rotation goes to this file
+			if (dlgFile->nextFile != NULL) {
+				if (dlgFile->rotateRemaining == 0) {
+					break;
+				} else if (writeLength > dlgFile->rotateRemaining) {
+					writeLength = dlgFile->rotateRemaining;
+				}
+			}
 			writeLength = FS_WriteFile(dlgFile->file, dlgFile->buffer + dlgFile->readPos, writeLength);
 			if (writeLength > 0) {
 				dlgFile->readPos += writeLength;
@@ -102,6 +284,9 @@ fs_result_t DataloggerFile_Tasks(DataloggerFile *dlgFile) {
 					dlgFile->readPos = 0;
 				}
 				dlgFile->bufferFree += writeLength;
+				if (dlgFile->nextFile != NULL) {
+					dlgFile->rotateRemaining -= writeLength;
+				}
 
 				DBG_SPAM_printf("DLGFile: buffer->card %u bytes, bufFree = %u", writeLength, dlgFile->bufferFree);
 			} else {
@@ -110,14 +295,37 @@ fs_result_t DataloggerFile_Tasks(DataloggerFile *dlgFile) {
 			}
 		}
 	}
+#endif
 
-	// Check if we want to close the file
-	if (dlgFile->requestClose && !dlgFile->file->requestClose
-			&& dlgFile->bufferFree == dlgFile->bufferSize) {
+	// Check if we want to close the file, after any rotation in progress
+	if (dlgFile->requestClose && dlgFile->nextFile == NULL
+			&& !dlgFile->file->requestClose
+			&& dlgFile->bufferFree == dlgFile->bufferSize
+#ifdef DATALOGGER_COMPRESS
+			&& dlgFile->compressPos == dlgFile->compressLength
+#endif
+			) {
 		DBG_DATA_printf("DLGFile: Request file close");
 		FS_RequestFileClose(dlgFile->file);
 	}
 
+	// Close the file being rotated out once all of its data has been handed over
+	if (dlgFile->nextFile != NULL && dlgFile->rotateRemaining == 0
+			&& !dlgFile->file->requestClose
+#ifdef DATALOGGER_COMPRESS
+			&& dlgFile->compressPos == dlgFile->compressLength
+#endif
+			) {
+		DBG_DATA_printf("DLGFile: Request file close (rotation)");
+		FS_RequestFileClose(dlgFile->file);
+	}
+
+	// Request a sync point if the last one was too long ago
+	if (Get32bitTime() - dlgFile->lastSyncTime >= DLG_FILE_SYNC_TIME) {
+		FS_RequestFileSync(dlgFile->file);
+		dlgFile->lastSyncTime = Get32bitTime();
+	}
+
 	if (T1CON == 0x00) {
 		DBG_ERR_printf("T1CON = 0");
 		T1CON = 0x8002;
@@ -126,7 +334,16 @@ fs_result_t DataloggerFile_Tasks(DataloggerFile *dlgFile) {
 	// Do filesystem tasks
 	if (dlgFile->file->state != FILE_Uninitialized
 			&& dlgFile->file->state != FILE_Creating) {
-		return FS_FileTasks(dlgFile->file);
+		fs_result_t result = FS_FileTasks(dlgFile->file);
+		if (result == FS_CLOSED && dlgFile->nextFile != NULL) {
+			// Old file closed, the buffered data now goes to the next one
+			DBG_DATA_printf("DLGFile: Rotated");
+			dlgFile->file = dlgFile->nextFile;
+			dlgFile->nextFile = NULL;
+			dlgFile->lastSyncTime = Get32bitTime();
+			return FS_BUSY;
+		}
+		return result;
 	} else {
 		return FS_UNREADY;
 	}
@@ -135,3 +352,38 @@ fs_result_t DataloggerFile_Tasks(DataloggerFile *dlgFile) {
 void DataloggerFile_RequestClose(DataloggerFile *dlgFile) {
 	dlgFile->requestClose = 1;
 }
+
+uint8_t DataloggerFile_Rotate(DataloggerFile *dlgFile, FS_File *nextFile) {
+	if (dlgFile->nextFile != NULL || dlgFile->requestClose
+			|| dlgFile->reservePtr != NULL) {
+		return 0;
+	}
+	dlgFile->nextFile = nextFile;
+	dlgFile->rotateRemaining = dlgFile->bufferSize - dlgFile->bufferFree;
+
+	DBG_DATA_printf("DLGFile: Rotate, %u bytes left for the old file", dlgFile->rotateRemaining);
+	return 1;
+}
+
+uint32_t DataloggerFile_GetLatencyBudget(DataloggerFile *dlgFile) {
+	uint32_t currTime = Get32bitTime();
+	uint32_t elapsed = currTime - dlgFile->statTime;
+	uint32_t bytes = dlgFile->statBytes;
+	uint32_t budgetBytes = dlgFile->bufferSize
+			+ (uint32_t)(FS_NUM_DATA_BUFFERS - 1) * FS_SECTOR_SIZE;
+
+	dlgFile->statBytes = 0;
+	dlgFile->statTime = currTime;
+
+	// Rates are in bytes per elapsed 1/1024 s, floored at DLG_FILE_BUDGET_MIN_RATE
+	if (elapsed == 0) {
+		elapsed = 1;
+	}
+	if ((uint64_t)bytes * 1024 < (uint64_t)DLG_FILE_BUDGET_MIN_RATE * elapsed) {
+		bytes = (uint64_t)DLG_FILE_BUDGET_MIN_RATE * elapsed / 1024;
+		if (bytes == 0) {
+			bytes = 1;
+		}
+	}
+	return (uint64_t)budgetBytes * Fcy * elapsed / ((uint64_t)bytes * 1024);
+}
@@ -7,9 +7,25 @@
  * Revision History
  * Date			Author	Change
  * 12 Aug 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Added the compression stage.
+ * 17 Oct 2026	agent	Time-based sync points.
+ * 17 Oct 2026	agent	File rotation.
+ * 17 Oct 2026	agent	SD Card busy time budget.
  *
  * @file
  * Datalogger file operations, including a large circular buffer in RAM.
+ *
+ * With DATALOGGER_COMPRESS, data is compressed a block at a time on the way
+ * from the RAM buffer to the file. Data is never written to the file
+ * directly, and a partial block is compressed when the file is closing or
+ * DLG_COMPRESS_FLUSH_TIME after the last block.
+ *
+ * Rotation switches writing to another, already created, file without
+ * stopping intake: everything buffered before DataloggerFile_Rotate goes to
+ * the current file, which is then closed, while data written afterwards waits
+ * in the RAM buffer until the next file takes over. The RAM buffer needs to be
+ * large enough to cover the close of the old file and the first cluster
+ * allocation of the new one.
  */
 
 #ifndef DATALOGGER_FILE_H
@@ -17,6 +33,32 @@
 
 #include "../FAT32/fat32-file.h"
 
+#include "datalogger-compress.h"
+
+/**
+ * Size of the bounce buffer used for reservations which would straddle the
+ * end of the circular buffer. This is the largest length which can be passed
+ * to DataloggerFile_Reserve.
+ */
+#define DLG_FILE_WRAP_SIZE	64
+
+/**
+ * Lowest data rate, in bytes per second, which the SD Card busy time budget
+ * is worked out for, so that slow cards are still flagged on a quiet bus.
+ */
+#ifndef DLG_FILE_BUDGET_MIN_RATE
+#define DLG_FILE_BUDGET_MIN_RATE	65536
+#endif
+
+/**
+ * Longest time between sync points of the file, in the Get32bitTime()
+ * timebase, on top of the filesystem's byte-based FS_SYNC_INTERVAL. This
+ * bounds the time span of data lost on a power loss when logging slowly.
+ */
+#ifndef DLG_FILE_SYNC_TIME
+#define DLG_FILE_SYNC_TIME	(5 * 1024)
+#endif
+
 typedef struct {
 	FS_File *file;			/// Pointer to the open file.
 
@@ -27,8 +69,31 @@ typedef struct {
 	uint16_t readPos;		/// Position to read from, the beginning of the buffer.
 	uint16_t writePos;		/// Position to write to, the end of the buffer.
 
+	// Reservation variables
+	uint8_t *reservePtr;	/// Pointer returned by the last reservation, or NULL if none is outstanding.
+	uint8_t wrapBuffer[DLG_FILE_WRAP_SIZE];	/// Bounce buffer for reservations which wrap around the buffer end.
+	uint8_t reserveDirect;	/// Whether the outstanding reservation is directly in the file's DMA buffer.
+
+#ifdef DATALOGGER_COMPRESS
+	// Compression variables
+	DataloggerCompressor compressor;
+	uint8_t compressBuffer[DLG_COMPRESS_OUT_SIZE];	/// Compressed block waiting to be written to the file.
+	uint16_t compressLength;	/// Length of the compressed block.
+	uint16_t compressPos;		/// Bytes of the compressed block already written to the file.
+	uint32_t lastBlockTime;		/// Get32bitTime() when the last block was compressed.
+#endif
+
+	// Rotation variables
+	FS_File *nextFile;		/// File to switch to once the current file is closed, or NULL if not rotating.
+	uint16_t rotateRemaining;	/// Bytes at the read position still belonging to the current file while rotating.
+
 	// Random
 	uint8_t requestClose;	/// If the file is requested to be closed.
+	uint32_t lastSyncTime;	/// Get32bitTime() when the last sync point was requested.
+
+	// Statistics
+	uint32_t statBytes;		/// Bytes offered (written, or refused for lack of space) since the busy time budget was last worked out.
+	uint32_t statTime;		/// Get32bitTime() when the busy time budget was last worked out.
 } DataloggerFile;
 
 /**
@@ -59,9 +124,37 @@ void DataloggerFile_Init(DataloggerFile *dlgFile, FS_File *file,
 uint16_t DataloggerFile_WriteAtomic(DataloggerFile *dlgFile, uint8_t *data,
 		uint16_t dataLen);
 
+/**
+ * Reserves space in the RAM buffer so a record can be formatted in place,
+ * avoiding a copy. The record is not part of the file until
+ * DataloggerFile_Commit is called, and only one reservation may be outstanding
+ * at a time.
+ *
+ * The returned space is always contiguous. When the RAM buffer is empty and
+ * the record fits in the file's current block, the space is reserved directly
+ * in the file's DMA buffer, skipping the RAM buffer entirely. Records which
+ * would straddle the end of the circular buffer are formatted into a small
+ * bounce buffer instead and copied into place on commit.
+ *
+ * @param dlgFile Datalogger file to be written to.
+ * @param dataLen Maximum record length, in bytes, at most DLG_FILE_WRAP_SIZE.
+ * @return Pointer to write the record to, or NULL if there is not enough space.
+ */
+uint8_t* DataloggerFile_Reserve(DataloggerFile *dlgFile, uint16_t dataLen);
+
+/**
+ * Commits a record previously reserved with DataloggerFile_Reserve.
+ *
+ * @param dlgFile Datalogger file to be written to.
+ * @param dataLen Actual record length, in bytes. This may be shorter than the
+ * reserved length, and 0 cancels the reservation.
+ */
+void DataloggerFile_Commit(DataloggerFile *dlgFile, uint16_t dataLen);
+
 /**
  * Called periodically to perform tasks for the Datalogger file, such as
  * writing the RAM buffer to the file and performing filesystem file tasks.
+ * With DATALOGGER_COMPRESS, this compresses at most one block per call.
  *
  * @param dlgFile Datalogger file to process.
  * @return Result of the call to FS_FileTasks.
@@ -75,4 +168,34 @@ fs_result_t DataloggerFile_Tasks(DataloggerFile *dlgFile);
  */
 void DataloggerFile_RequestClose(DataloggerFile *dlgFile);
 
+/**
+ * Begins switching to another file. Data already written (or committed) goes
+ * to the current file, which is closed in the background, and data written
+ * from now on goes to /a nextFile. Writes keep being accepted into the RAM
+ * buffer throughout, but bypass the file until the switch completes, which is
+ * when dlgFile->file becomes /a nextFile.
+ *
+ * @param dlgFile Datalogger file.
+ * @param nextFile File to switch to, already created (in the FILE_Idle state)
+ * and not yet written.
+ * @return Result.
+ * @retval 0 Rotation not started - a rotation or close is already in progress,
+ * or a reservation is outstanding.
+ * @retval 1 Rotation started.
+ */
+uint8_t DataloggerFile_Rotate(DataloggerFile *dlgFile, FS_File *nextFile);
+
+/**
+ * Works out how long the SD Card can stay busy before data is lost: the time
+ * the RAM buffer and the FS data buffers not being written take to fill, at
+ * the rate data was offered since the last call (including writes refused
+ * because the buffer was full), or DLG_FILE_BUDGET_MIN_RATE if higher. This
+ * assumes the buffers start empty, so a busy period longer than this always
+ * loses data. Should be called about once a second.
+ *
+ * @param dlgFile Datalogger file.
+ * @return Budget, in Fcy cycles.
+ */
+uint32_t DataloggerFile_GetLatencyBudget(DataloggerFile *dlgFile);
+
 #endif
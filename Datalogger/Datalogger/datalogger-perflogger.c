@@ -3,6 +3,12 @@
  * Author: Ducky
  *
  * Created on August 14, 2011, 11:18 AM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Added the per-stage loop profile records.
+ * 17 Oct 2026	agent	Added the UART ring record.
+ * 17 Oct 2026	agent	Added the SD Card busy time records.
  */
 
 #include <stdlib.h>
@@ -12,12 +18,16 @@
 
 #include "../ecan.h"
 #include "../timing.h"
+#include "../uart-dma.h"
+
+#include "../SD-SPI-DMA/sd-spi-dma.h"
 
 #include "../UserInterface/datalogger-ui-hardware.h"
 #include "../UserInterface/datalogger-ui-leds.h"
 
 #include "datalogger-stringutil.h"
 #include "datalogger-file.h"
+#include "datalogger-profile.h"
 #include "datalogger-applications.h"
 
 #define DEBUG_UART
@@ -28,13 +38,121 @@
 
 StatisticalMeasurement Performance = {0,0,0,0};
 
+/**
+ * Writes the per-stage loop profile records, as described in
+ * datalogger-profile.h, and clears the profile counters.
+ * @param dlgFile Datalogger file to write to.
+ */
+static void Datalogger_WriteProfile(DataloggerFile *dlgFile) {
+	uint32_t currTime = Get32bitTime();
+	uint8_t i, j;
+
+	for (i=0;i<DLG_PROF_NUM_STAGES;i++) {
+		DataloggerProfileStage *stage = &Datalogger_Profile.stages[i];
+		char *buffer = (char*)DataloggerFile_Reserve(dlgFile, 44);
+
+		if (buffer != NULL) {
+			strcpy(buffer, "PS xxxxxxxx Sxxx ");
+			Int32ToString(currTime, buffer+3);
+			memcpy(buffer+13, DLG_PROF_STAGE_NAMES + 3*i, 3);
+			Int32ToString(Datalogger_Profile.loops, buffer+17);
+			buffer[25] = ' ';
+			Int32ToString(stage->totalCycles, buffer+26);
+			buffer[34] = ' ';
+			Int32ToString(stage->maxCycles, buffer+35);
+			buffer[43] = '\n';
+
+			DataloggerFile_Commit(dlgFile, 44);
+		}
+
+		buffer = (char*)DataloggerFile_Reserve(dlgFile, 17 + 5*DLG_PROF_NUM_BINS);
+		if (buffer != NULL) {
+			strcpy(buffer, "PS xxxxxxxx Hxxx");
+			Int32ToString(currTime, buffer+3);
+			memcpy(buffer+13, DLG_PROF_STAGE_NAMES + 3*i, 3);
+			for (j=0;j<DLG_PROF_NUM_BINS;j++) {
+				buffer[16 + 5*j] = ' ';
+				Int16ToString(stage->bins[j], buffer + 17 + 5*j);
+			}
+			buffer[16 + 5*DLG_PROF_NUM_BINS] = '\n';
+
+			DataloggerFile_Commit(dlgFile, 17 + 5*DLG_PROF_NUM_BINS);
+		}
+	}
+
+	Datalogger_ProfileClear();
+}
+
+/**
+ * Writes the SD Card busy time records, clears the histograms, and sets the
+ * budget for the next interval. All numbers are hexadecimal, times are in Fcy
+ * cycles, and x is the SD_LATENCY_KIND_NAMES letter:
+ *   PS tttttttt SDLx nnnn oooo cccccccc mmmmmmmm bbbbbbbb
+ *     nnnn operations took cccccccc cycles in total and at most mmmmmmmm,
+ *     with oooo of them over the budget of bbbbbbbb (0 if not set yet).
+ *   PS tttttttt SDHx hhhh hhhh hhhh hhhh hhhh hhhh hhhh hhhh hhhh hhhh hhhh hhhh
+ *     Histogram, see sd-latency.c.
+ * @param dlgFile Datalogger file to write to.
+ */
+static void Datalogger_WriteSDLatency(DataloggerFile *dlgFile) {
+	SD_Card *card = dlgFile->file->fs->card;
+	uint32_t currTime = Get32bitTime();
+	uint8_t i, j;
+
+	for (i=0;i<SD_LATENCY_NUM_KINDS;i++) {
+		SD_Latency *latency = &card->Latency[i];
+		char *buffer = (char*)DataloggerFile_Reserve(dlgFile, 54);
+
+		if (buffer != NULL) {
+			strcpy(buffer, "PS xxxxxxxx SDLx ");
+			Int32ToString(currTime, buffer+3);
+			buffer[15] = SD_LATENCY_KIND_NAMES[i];
+			Int16ToString(latency->Count, buffer+17);
+			buffer[21] = ' ';
+			Int16ToString(latency->OverBudget, buffer+22);
+			buffer[26] = ' ';
+			Int32ToString(latency->TotalCycles, buffer+27);
+			buffer[35] = ' ';
+			Int32ToString(latency->MaxCycles, buffer+36);
+			buffer[44] = ' ';
+			Int32ToString(card->LatencyBudget, buffer+45);
+			buffer[53] = '\n';
+
+			DataloggerFile_Commit(dlgFile, 54);
+		}
+
+		buffer = (char*)DataloggerFile_Reserve(dlgFile, 17 + 5*SD_LATENCY_NUM_BINS);
+		if (buffer != NULL) {
+			strcpy(buffer, "PS xxxxxxxx SDHx");
+			Int32ToString(currTime, buffer+3);
+			buffer[15] = SD_LATENCY_KIND_NAMES[i];
+			for (j=0;j<SD_LATENCY_NUM_BINS;j++) {
+				buffer[16 + 5*j] = ' ';
+				Int16ToString(latency->Bins[j], buffer + 17 + 5*j);
+			}
+			buffer[16 + 5*SD_LATENCY_NUM_BINS] = '\n';
+
+			DataloggerFile_Commit(dlgFile, 17 + 5*SD_LATENCY_NUM_BINS);
+		}
+
+		if (latency->OverBudget != 0) {
+			DBG_ERR_printf("Slow card: %s busy up to %lu us, %u times over the %lu us budget",
+					(i == SD_LATENCY_BLOCK) ? "block" : "Stop Tran", latency->MaxCycles / (Fcy / 1000000),
+					latency->OverBudget, card->LatencyBudget / (Fcy / 1000000));
+		}
+	}
+
+	SD_Latency_Clear(card);
+	SD_Latency_SetBudget(card, DataloggerFile_GetLatencyBudget(dlgFile));
+}
+
 void Datalogger_ProcessPerfLogger(DataloggerFile *dlgFile) {
 	static uint16_t lastTime = 0;
 	uint16_t currTime = GetbmsecOffset();
 	uint16_t diffTime = 0;
 	
 	if (lastTime > currTime ) {
-		static char buffer[64] = "PS xxxxxxxx LPTM ";
+		char *buffer = (char*)DataloggerFile_Reserve(dlgFile, 64);
 		uint8_t bufferPos = 17;
 
 		uint16_t average = ((Performance.runningAverage/Performance.sampleCount)
@@ -43,23 +161,74 @@ void Datalogger_ProcessPerfLogger(DataloggerFile *dlgFile) {
 		uint16_t low = (((uint32_t)Performance.low) * 1015762) >> 18;
 		DBG_SPAM_printf("Loop time: Low %u, Avg %u, High %u, Samp %u", low, average, high, Performance.sampleCount);
 
-		Int32ToString(Get32bitTime(), buffer+3);
-
-		itoa(buffer+bufferPos, Performance.sampleCount, 10);
-		bufferPos += strlen(buffer+bufferPos);
-		buffer[bufferPos] = ' ';	bufferPos++;
-		itoa(buffer+bufferPos, low, 10);
-		bufferPos += strlen(buffer+bufferPos);
-		buffer[bufferPos] = ' ';	bufferPos++;
-		itoa(buffer+bufferPos, average, 10);
-		bufferPos += strlen(buffer+bufferPos);
-		buffer[bufferPos] = ' ';	bufferPos++;
-		itoa(buffer+bufferPos, high, 10);
-		bufferPos += strlen(buffer+bufferPos);
-		buffer[bufferPos] = '\n';	bufferPos++;
-		buffer[bufferPos] = 0;
-
-		DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)buffer, bufferPos);
+		if (buffer != NULL) {
+			strcpy(buffer, "PS xxxxxxxx LPTM ");
+			Int32ToString(Get32bitTime(), buffer+3);
+
+			itoa(buffer+bufferPos, Performance.sampleCount, 10);
+			bufferPos += strlen(buffer+bufferPos);
+			buffer[bufferPos] = ' ';	bufferPos++;
+			itoa(buffer+bufferPos, low, 10);
+			bufferPos += strlen(buffer+bufferPos);
+			buffer[bufferPos] = ' ';	bufferPos++;
+			itoa(buffer+bufferPos, average, 10);
+			bufferPos += strlen(buffer+bufferPos);
+			buffer[bufferPos] = ' ';	bufferPos++;
+			itoa(buffer+bufferPos, high, 10);
+			bufferPos += strlen(buffer+bufferPos);
+			buffer[bufferPos] = '\n';	bufferPos++;
+
+			DataloggerFile_Commit(dlgFile, bufferPos);
+		}
+
+		// Log the file write pipeline statistics
+		buffer = (char*)DataloggerFile_Reserve(dlgFile, 64);
+		bufferPos = 17;
+		if (buffer != NULL) {
+			FS_File *file = dlgFile->file;
+
+			strcpy(buffer, "PS xxxxxxxx FSBF ");
+			Int32ToString(Get32bitTime(), buffer+3);
+
+			itoa(buffer+bufferPos, FS_NUM_DATA_BUFFERS, 10);
+			bufferPos += strlen(buffer+bufferPos);
+			buffer[bufferPos] = ' ';	bufferPos++;
+			itoa(buffer+bufferPos, file->statMaxFilled, 10);
+			bufferPos += strlen(buffer+bufferPos);
+			buffer[bufferPos] = ' ';	bufferPos++;
+			itoa(buffer+bufferPos, file->statStalls, 10);
+			bufferPos += strlen(buffer+bufferPos);
+			buffer[bufferPos] = '\n';	bufferPos++;
+
+			DataloggerFile_Commit(dlgFile, bufferPos);
+
+			file->statMaxFilled = file->dataBufferNumFilled;
+			file->statStalls = 0;
+		}
+
+		// Log the UART ring usage and drops, in hexadecimal:
+		// PS tttttttt UART ssss mmmm wwww bbbbbbbb - ring size, most bytes
+		// queued since the last record, writes and bytes dropped since power on
+		buffer = (char*)DataloggerFile_Reserve(dlgFile, 41);
+		if (buffer != NULL) {
+			strcpy(buffer, "PS xxxxxxxx UART ");
+			Int32ToString(Get32bitTime(), buffer+3);
+			Int16ToString(UART_DMA_RING_SIZE, buffer+17);
+			buffer[21] = ' ';
+			Int16ToString(UART_DMA_MaxUsed, buffer+22);
+			buffer[26] = ' ';
+			Int16ToString(UART_DMA_DroppedWrites, buffer+27);
+			buffer[31] = ' ';
+			Int32ToString(UART_DMA_DroppedBytes, buffer+32);
+			buffer[40] = '\n';
+
+			DataloggerFile_Commit(dlgFile, 41);
+
+			UART_DMA_MaxUsed = 0;
+		}
+
+		Datalogger_WriteProfile(dlgFile);
+		Datalogger_WriteSDLatency(dlgFile);
 
 		// Reset statistical counters
 		Performance.sampleCount = 0;
@@ -0,0 +1,77 @@
+/*
+ * File:   datalogger-profile.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:20 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Per-stage cycle profiler for the datalogger main loop.
+ */
+
+#include <string.h>
+
+#include "../types.h"
+#include "../timing.h"
+
+#include "datalogger-profile.h"
+
+DataloggerProfile Datalogger_Profile;
+
+void Datalogger_ProfileInit() {
+	memset(&Datalogger_Profile, 0, sizeof(Datalogger_Profile));
+	Datalogger_Profile.lastMark = GetCycleCount();
+}
+
+void Datalogger_ProfileClear() {
+	uint8_t i;
+
+	Datalogger_Profile.loops = 0;
+	for (i=0;i<DLG_PROF_NUM_STAGES;i++) {
+		DataloggerProfileStage *stage = &Datalogger_Profile.stages[i];
+
+		stage->totalCycles = 0;
+		stage->maxCycles = 0;
+		memset(stage->bins, 0, sizeof(stage->bins));
+	}
+}
+
+void Datalogger_ProfileMark(uint8_t stage) {
+	uint32_t currMark = GetCycleCount();
+
+	Datalogger_Profile.stages[stage].loopCycles += currMark - Datalogger_Profile.lastMark;
+	Datalogger_Profile.lastMark = currMark;
+}
+
+uint8_t Datalogger_ProfileGetBin(uint32_t cycles) {
+	uint32_t limit = DLG_PROF_BIN0_CYCLES;
+	uint8_t bin = 0;
+
+	while (bin < DLG_PROF_NUM_BINS - 1 && cycles >= limit) {
+		limit <<= DLG_PROF_BIN_SHIFT;
+		bin++;
+	}
+	return bin;
+}
+
+void Datalogger_ProfileEndLoop() {
+	uint8_t i;
+
+	Datalogger_Profile.loops++;
+	for (i=0;i<DLG_PROF_NUM_STAGES;i++) {
+		DataloggerProfileStage *stage = &Datalogger_Profile.stages[i];
+		uint8_t bin = Datalogger_ProfileGetBin(stage->loopCycles);
+
+		stage->totalCycles += stage->loopCycles;
+		if (stage->loopCycles > stage->maxCycles) {
+			stage->maxCycles = stage->loopCycles;
+		}
+		if (stage->bins[bin] != 0xffff) {
+			stage->bins[bin]++;
+		}
+		stage->loopCycles = 0;
+	}
+}
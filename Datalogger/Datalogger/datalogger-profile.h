@@ -0,0 +1,97 @@
+/*
+ * File:   datalogger-profile.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:20 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Per-stage cycle profiler for the datalogger main loop, shared between the
+ * datalogger and the host tools.
+ *
+ * The main loop calls Datalogger_ProfileMark after each stage, which charges
+ * the cycles since the previous mark to that stage, and
+ * Datalogger_ProfileEndLoop at the end of each iteration, which adds the
+ * per-stage time of that iteration to a histogram.
+ * Histogram bin 0 counts iterations where the stage took less than
+ * DLG_PROF_BIN0_CYCLES, and each following bin ends at 1 << DLG_PROF_BIN_SHIFT
+ * times the previous limit, with the last bin counting everything longer.
+ *
+ * Every second, Datalogger_ProcessPerfLogger writes two ASCII records per
+ * stage, then clears the counters. All numbers are hexadecimal, times are in
+ * Fcy cycles:
+ *   PS tttttttt Sxxx llllllll cccccccc mmmmmmmm
+ *     Stage xxx, over llllllll loop iterations, took cccccccc cycles in total
+ *     and at most mmmmmmmm cycles in one iteration.
+ *   PS tttttttt Hxxx hhhh hhhh hhhh hhhh hhhh hhhh hhhh hhhh
+ *     Histogram of stage xxx. Counts saturate at 0xffff.
+ */
+
+#ifndef DATALOGGER_PROFILE_H
+#define DATALOGGER_PROFILE_H
+
+#include "../types.h"
+
+#define DLG_PROF_CAN			0	/// CAN communications and recording.
+#define DLG_PROF_VOLTAGE		1	/// Voltage recorder.
+#define DLG_PROF_FILE			2	/// DataloggerFile_Tasks.
+#define DLG_PROF_FS				3	/// File state transitions, rotation and the free map.
+#define DLG_PROF_LED			4	/// UI_LED_Update.
+#define DLG_PROF_OTHER			5	/// Everything else in the loop.
+#define DLG_PROF_NUM_STAGES		6
+
+/**
+ * Three letter stage names used in the records, in stage order.
+ */
+#define DLG_PROF_STAGE_NAMES	"CANVLTFILFSTLEDOTH"
+
+#define DLG_PROF_NUM_BINS		8
+#define DLG_PROF_BIN0_CYCLES	320		/// Upper limit of the first bin, 16 us at 20 MHz.
+#define DLG_PROF_BIN_SHIFT		2		/// Each bin limit is 4 times the last.
+
+typedef struct {
+	uint32_t loopCycles;				/// Cycles in the current iteration.
+	uint32_t totalCycles;				/// Cycles since the counters were cleared.
+	uint32_t maxCycles;					/// Longest iteration since the counters were cleared.
+	uint16_t bins[DLG_PROF_NUM_BINS];	/// Histogram of iterations.
+} DataloggerProfileStage;
+
+typedef struct {
+	uint32_t lastMark;					/// GetCycleCount() at the last mark.
+	uint32_t loops;						/// Iterations since the counters were cleared.
+	DataloggerProfileStage stages[DLG_PROF_NUM_STAGES];
+} DataloggerProfile;
+
+extern DataloggerProfile Datalogger_Profile;
+
+/**
+ * Clears the profile, and starts timing from now.
+ */
+void Datalogger_ProfileInit();
+
+/**
+ * Clears the counters, keeping the time of the current iteration.
+ */
+void Datalogger_ProfileClear();
+
+/**
+ * Charges the cycles since the last mark to a stage.
+ * @param stage Stage which just ran, DLG_PROF_*.
+ */
+void Datalogger_ProfileMark(uint8_t stage);
+
+/**
+ * Ends a loop iteration, adding the time of each stage to its histogram.
+ */
+void Datalogger_ProfileEndLoop();
+
+/**
+ * @param cycles Stage time, in cycles.
+ * @return Histogram bin for the time.
+ */
+uint8_t Datalogger_ProfileGetBin(uint32_t cycles);
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * File:   datalogger-records.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 10:12 AM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Added the frames seen (CS) record.
+ * 17 Oct 2026	agent	Added delta-encoded CAN records (PRM FMT 3).
+ * 17 Oct 2026	agent	Added the overflow summary (CO / CP) records.
+ *
+ * @file
+ * Log record format definitions shared between the datalogger and the host
+ * tools.
+ *
+ * Format 1 (PRM FMT 1) is all ASCII lines. Format 2 (PRM FMT 2) keeps the
+ * ASCII PRM / CRD / MNT / VS / PS lines, but CAN traffic is written as compact
+ * binary records. Every binary record starts with a tag byte with the high bit
+ * set, which can never start an ASCII line, so a decoder can tell them apart by
+ * looking at the first byte. Multi-byte fields are little-endian.
+ *
+ * Binary record timestamps are a single byte delta, in the Get32bitTime()
+ * timebase (1/1024 s), from the previous binary record. A time record is
+ * written whenever the delta would overflow, and as the first binary record
+ * in a file.
+ *
+ * Format 3 (PRM FMT 3) is format 2 plus delta CAN records, which store only
+ * the bytes of a payload which differ from the previous payload logged for
+ * the same SID. Each SID starts with a full CAN record (a keyframe), and a
+ * keyframe is repeated every DLG_REC_DELTA_KEYFRAME records of the SID, or
+ * whenever the DLC changes, so a decoder which lost its place (say, after a
+ * damaged compressed block) recovers within a few records.
+ */
+
+#ifndef DATALOGGER_RECORDS_H
+#define DATALOGGER_RECORDS_H
+
+/**
+ * Uncomment to log CAN traffic using the binary (PRM FMT 2) records instead
+ * of ASCII "CM" lines.
+ */
+//#define DATALOGGER_CAN_BINARY
+
+/**
+ * Uncomment to log CAN payloads as deltas against the previous payload of the
+ * same SID (PRM FMT 3). Requires DATALOGGER_CAN_BINARY.
+ */
+//#define DATALOGGER_CAN_DELTA
+
+#if defined(DATALOGGER_CAN_DELTA) && !defined(DATALOGGER_CAN_BINARY)
+	#error "DATALOGGER_CAN_DELTA requires DATALOGGER_CAN_BINARY"
+#endif
+
+#if defined(DATALOGGER_CAN_DELTA)
+	#define DLG_PRM_FMT			"PRM FMT 3\n"
+#elif defined(DATALOGGER_CAN_BINARY)
+	#define DLG_PRM_FMT			"PRM FMT 2\n"
+#else
+	#define DLG_PRM_FMT			"PRM FMT 1\n"
+#endif
+
+/** Mask to check whether a byte starts a binary record. */
+#define DLG_REC_BINARY_MASK		0x80
+
+/**
+ * CAN frame, low nibble is the DLC.
+ * Format: [tag] [dt] [SID low] [SID high] [payload, DLC bytes]
+ */
+#define DLG_REC_CAN				0x80
+#define DLG_REC_CAN_DLC_MASK	0x0f
+/** Length of a CAN frame record excluding the payload. */
+#define DLG_REC_CAN_HEADER_LEN	4
+
+/**
+ * CAN frame delta against the previous frame logged for the SID, which had
+ * the same DLC, low nibble is the DLC. Bit n of the change mask is set if
+ * payload byte n changed, and only those bytes are stored, XORed with the
+ * previous payload byte.
+ * Format: [tag] [dt] [SID low] [SID high] [change mask] [changed bytes]
+ */
+#define DLG_REC_CAN_DELTA		0x90
+/** Length of a CAN delta record excluding the changed bytes. */
+#define DLG_REC_CAN_DELTA_HEADER_LEN	5
+/** Most delta records of a SID between keyframes. */
+#define DLG_REC_DELTA_KEYFRAME	32
+
+/**
+ * Absolute time, sets the base for the following deltas.
+ * Format: [tag] [Get32bitTime(), 4 bytes]
+ */
+#define DLG_REC_TIME			0xf0
+#define DLG_REC_TIME_LEN		5
+
+/**
+ * CAN hardware receive buffer overflow (same meaning as the ASCII COVF).
+ * Format: [tag] [dt]
+ */
+#define DLG_REC_COVF			0xf1
+/**
+ * Datalogger RAM buffer overflow, frames were dropped (same meaning as the
+ * ASCII MOVF).
+ * Format: [tag] [dt]
+ */
+#define DLG_REC_MOVF			0xf2
+#define DLG_REC_MARKER_LEN		2
+
+/**
+ * Number of frames of a SID received but not logged because of its logging
+ * policy (CHANGE or EVERY) since the previous count for that SID, so gaps can
+ * be told apart from lost frames. For CHANGE, these frames repeated the last
+ * payload logged. The ASCII equivalent is "CS tttttttt/dd sss nnnn".
+ * Format: [tag] [dt] [SID low] [SID high] [count low] [count high]
+ */
+#define DLG_REC_SEEN			0xf3
+#define DLG_REC_SEEN_LEN		6
+
+/**
+ * Overflow summary of the frames which could not be logged while the RAM
+ * buffer was full, written once there is room for the whole summary. It is
+ * followed directly by the given number of overflow summary SID records.
+ * Frames of SIDs which did not fit in the summary are only counted.
+ * The ASCII equivalent is "CO tttttttt/dd ffffffff nn uuuu", with the start
+ * time in full.
+ * Format: [tag] [dt] [start time, 4 bytes] [number of SID records]
+ * [untracked count low] [untracked count high]
+ */
+#define DLG_REC_OVERFLOW		0xf4
+#define DLG_REC_OVERFLOW_LEN	9
+
+/**
+ * Frames of a SID not logged during an overflow, low nibble is the DLC of the
+ * last one. The first and last frame times are offsets from the summary's
+ * start time, saturating at 0xffff. These have no time delta of their own.
+ * The ASCII equivalent is "CP sss nnnn ffffffff llllllll d [payload]", with
+ * the times in full.
+ * Format: [tag] [SID low] [SID high] [count low] [count high] [first low]
+ * [first high] [last low] [last high] [last payload, DLC bytes]
+ */
+#define DLG_REC_OVERFLOW_SID	0xa0
+/** Length of an overflow summary SID record excluding the payload. */
+#define DLG_REC_OVERFLOW_SID_HEADER_LEN	9
+
+/** Largest time delta which fits in a record. */
+#define DLG_REC_MAX_DT			0xff
+
+#endif
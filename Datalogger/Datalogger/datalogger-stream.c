@@ -0,0 +1,176 @@
+/*
+ * File:   datalogger-stream.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:59 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Only built with DATALOGGER_CAN_STREAM, to save the RAM.
+ *
+ * @file
+ * Live binary CAN stream out the UART, see datalogger-stream.h.
+ */
+
+#include "../types.h"
+
+#include "../timing.h"
+#include "../uart-dma.h"
+
+#include "datalogger-stream.h"
+
+// The packet buffers take about 500 bytes of RAM, so they are left out unless
+// streaming. Host builds keep the code, so it is compiled with everything else.
+#if defined(DATALOGGER_CAN_STREAM) || defined(HARDWARE_HOST)
+
+#if DLG_STREAM_MAX_ENCODED > UART_DMA_RING_SIZE - 1
+	#error "UART_DMA_RING_SIZE too small for a whole stream packet"
+#endif
+
+static uint8_t streamPacket[DLG_STREAM_MAX_PACKET];		/// Packet being filled.
+static uint8_t streamEncoded[DLG_STREAM_MAX_ENCODED];	/// COBS encoded packet being sent.
+static uint8_t streamLen = 0;			/// Bytes in streamPacket, 0 if no packet is open.
+static uint8_t streamFrames = 0;		/// Frames in streamPacket.
+static uint8_t streamSequence = 0;		/// Sequence number of the next packet.
+static uint16_t streamDropped = 0;		/// Frames dropped since the last packet sent.
+static uint32_t streamBaseTime = 0;		/// Base time of the open packet.
+static uint32_t streamLastSent = 0;		/// Time a packet was last sent or dropped.
+
+/**
+ * Adds a byte to a CRC-16/CCITT, without a table or a loop over the bits.
+ * @return The new CRC.
+ */
+static uint16_t Datalogger_StreamCRC(uint16_t crc, uint8_t data) {
+	uint8_t x = (crc >> 8) ^ data;
+
+	x ^= x >> 4;
+	return (crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x;
+}
+
+/**
+ * COBS encodes a packet and adds the zero delimiter.
+ * @return Encoded length.
+ */
+static uint16_t Datalogger_StreamEncode(uint8_t *out, const uint8_t *in, uint16_t len) {
+	uint16_t codePos = 0;
+	uint16_t outPos = 1;
+	uint8_t code = 1;
+	uint16_t i;
+
+	for (i=0;i<len;i++) {
+		if (in[i] == 0) {
+			out[codePos] = code;
+			codePos = outPos++;
+			code = 1;
+		} else {
+			out[outPos++] = in[i];
+			code++;
+			if (code == 0xff) {
+				out[codePos] = code;
+				codePos = outPos++;
+				code = 1;
+			}
+		}
+	}
+	out[codePos] = code;
+	out[outPos++] = 0;
+	return outPos;
+}
+
+/**
+ * Starts a packet.
+ */
+static void Datalogger_StreamOpen(uint32_t currTime) {
+	streamPacket[0] = DLG_STREAM_TYPE_CAN;
+	streamPacket[4] = currTime & 0xff;
+	streamPacket[5] = (currTime >> 8) & 0xff;
+	streamPacket[6] = (currTime >> 16) & 0xff;
+	streamPacket[7] = (currTime >> 24) & 0xff;
+	streamLen = DLG_STREAM_HEADER_LEN;
+	streamFrames = 0;
+	streamBaseTime = currTime;
+}
+
+/**
+ * Finishes the open packet and writes it to the UART, or counts its frames as
+ * dropped if it does not fit.
+ */
+static void Datalogger_StreamSend(uint32_t currTime) {
+	uint16_t crc = DLG_STREAM_CRC_INIT;
+	uint16_t len;
+	uint8_t i;
+
+	streamPacket[1] = streamSequence++;
+	streamPacket[2] = streamDropped & 0xff;
+	streamPacket[3] = (streamDropped >> 8) & 0xff;
+	for (i=0;i<streamLen;i++) {
+		crc = Datalogger_StreamCRC(crc, streamPacket[i]);
+	}
+	streamPacket[streamLen++] = crc & 0xff;
+	streamPacket[streamLen++] = (crc >> 8) & 0xff;
+
+	len = Datalogger_StreamEncode(streamEncoded, streamPacket, streamLen);
+	if (UART_DMA_WriteAtomic((char*)streamEncoded, len) != 0) {
+		streamDropped = 0;
+	} else if (streamDropped <= 0xffff - streamFrames) {
+		streamDropped += streamFrames;
+	} else {
+		streamDropped = 0xffff;
+	}
+
+	streamLen = 0;
+	streamLastSent = currTime;
+}
+
+void Datalogger_StreamInit() {
+	streamLen = 0;
+	streamSequence = 0;
+	streamDropped = 0;
+	streamLastSent = Get32bitTime();
+}
+
+void Datalogger_StreamCAN(uint32_t currTime, uint16_t sid, uint8_t dlc, uint8_t *data) {
+	uint8_t i;
+
+	if (dlc > 8) {
+		dlc = 8;
+	}
+	if (streamLen != 0
+			&& (streamLen + DLG_STREAM_FRAME_HEADER_LEN + dlc + DLG_STREAM_CRC_LEN > DLG_STREAM_MAX_PACKET
+			|| currTime - streamBaseTime > 255)) {
+		Datalogger_StreamSend(currTime);
+	}
+	if (streamLen == 0) {
+		Datalogger_StreamOpen(currTime);
+	}
+
+	streamPacket[streamLen++] = currTime - streamBaseTime;
+	streamPacket[streamLen++] = sid & 0xff;
+	streamPacket[streamLen++] = ((sid >> 8) & 0x07) | (dlc << 4);
+	for (i=0;i<dlc;i++) {
+		streamPacket[streamLen++] = data[i];
+	}
+	streamFrames++;
+}
+
+void Datalogger_StreamTasks(uint32_t currTime) {
+	if (streamLen != 0) {
+		if (currTime - streamBaseTime >= DLG_STREAM_MAX_LATENCY) {
+			Datalogger_StreamSend(currTime);
+		}
+	} else if (currTime - streamLastSent >=
+			(streamDropped != 0 ? DLG_STREAM_MAX_LATENCY : DLG_STREAM_IDLE_TIME)) {
+		// Keepalive, or report dropped frames without waiting for traffic
+		Datalogger_StreamOpen(currTime);
+		Datalogger_StreamSend(currTime);
+	}
+}
+
+void Datalogger_StreamFlush(uint32_t currTime) {
+	if (streamLen != 0) {
+		Datalogger_StreamSend(currTime);
+	}
+}
+
+#endif
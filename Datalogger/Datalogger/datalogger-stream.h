@@ -0,0 +1,112 @@
+/*
+ * File:   datalogger-stream.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:59 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Live binary CAN stream out the UART, shared between the datalogger and the
+ * host tools.
+ *
+ * Received CAN frames which pass the acceptance filters are batched into
+ * packets, each sent as a single non-blocking UART write. A packet is sent
+ * when the next frame would not fit, when its first frame is
+ * DLG_STREAM_MAX_LATENCY old, or when a frame is too far from the packet base
+ * time. A packet which does not fit in the UART ring is dropped, and its
+ * frames are counted in the next packet sent. When nothing is received, an
+ * empty packet is sent every DLG_STREAM_IDLE_TIME as a keepalive.
+ *
+ * Packet, multi-byte fields little-endian:
+ *   [type] DLG_STREAM_TYPE_CAN.
+ *   [sequence] Incremented for every packet, including dropped ones.
+ *   [dropped, 2 bytes] Frames dropped since the previous packet sent,
+ *     saturating.
+ *   [base time, 4 bytes] Get32bitTime() timebase (1/1024 s).
+ *   [frames] Each [dt] [SID low] [SID high | DLC << 4] [payload, DLC bytes],
+ *     where dt is the time from the base time.
+ *   [CRC, 2 bytes] CRC-16/CCITT (polynomial 0x1021, initial value 0xffff) of
+ *     the bytes above.
+ * The packet is then COBS encoded, so it contains no zero bytes, and followed
+ * by a zero byte. A receiver synchronizes on the zero bytes and discards
+ * anything which fails the CRC, such as debug messages sharing the UART.
+ */
+
+#ifndef DATALOGGER_STREAM_H
+#define DATALOGGER_STREAM_H
+
+#include "../types.h"
+
+/**
+ * Uncomment to stream received CAN frames out the UART.
+ */
+//#define DATALOGGER_CAN_STREAM
+
+#define DLG_STREAM_TYPE_CAN			0x01
+#define DLG_STREAM_HEADER_LEN		8
+#define DLG_STREAM_FRAME_HEADER_LEN	3
+#define DLG_STREAM_CRC_LEN			2
+#define DLG_STREAM_CRC_INIT			0xffff
+
+/**
+ * Longest packet, before COBS encoding. This fits 20 full frames and keeps the
+ * encoding to one overhead byte.
+ */
+#ifndef DLG_STREAM_MAX_PACKET
+	#define DLG_STREAM_MAX_PACKET	240
+#endif
+
+/**
+ * Longest packet after COBS encoding, including the delimiter.
+ */
+#define DLG_STREAM_MAX_ENCODED		(DLG_STREAM_MAX_PACKET + DLG_STREAM_MAX_PACKET / 254 + 2)
+
+/**
+ * Longest time a frame is held before its packet is sent, in 1/1024 s.
+ */
+#ifndef DLG_STREAM_MAX_LATENCY
+	#define DLG_STREAM_MAX_LATENCY	10
+#endif
+
+/**
+ * Time without frames after which an empty packet is sent, in 1/1024 s.
+ */
+#ifndef DLG_STREAM_IDLE_TIME
+	#define DLG_STREAM_IDLE_TIME	1024
+#endif
+
+/**
+ * Starts a new stream.
+ */
+void Datalogger_StreamInit();
+
+/**
+ * Adds a received frame to the stream, sending the current packet first if
+ * the frame does not fit in it.
+ *
+ * @param currTime Frame timestamp.
+ * @param sid Standard identifier.
+ * @param dlc Data length.
+ * @param data Payload.
+ */
+void Datalogger_StreamCAN(uint32_t currTime, uint16_t sid, uint8_t dlc, uint8_t *data);
+
+/**
+ * Sends the current packet once it is DLG_STREAM_MAX_LATENCY old, and a
+ * keepalive packet when idle. Should be called every loop.
+ *
+ * @param currTime Current time.
+ */
+void Datalogger_StreamTasks(uint32_t currTime);
+
+/**
+ * Sends the current packet now, if there is one.
+ *
+ * @param currTime Current time.
+ */
+void Datalogger_StreamFlush(uint32_t currTime);
+
+#endif
@@ -102,7 +102,7 @@ void Datalogger_ProcessVoltageRecorder(DataloggerFile *dlgFile) {
 	uint16_t currTime = GetbmsecOffset();
 
 	if (lastTime > currTime ) {
-		static char buffer[64] = "VS xxxxxxxx +12v ";
+		char *buffer = (char*)DataloggerFile_Reserve(dlgFile, 64);
 		uint8_t bufferPos = 17;
 
 		uint16_t average = ((Voltage12v.runningAverage/Voltage12v.sampleCount)
@@ -111,23 +111,25 @@ void Datalogger_ProcessVoltageRecorder(DataloggerFile *dlgFile) {
 		uint16_t low = (((uint32_t)Voltage12v.low) * 1015762) >> 18;
 		DBG_SPAM_printf("+12v measurement: Low %u, Avg %u, High %u, Samp %u", low, average, high, Voltage12v.sampleCount);
 
-		Int32ToString(Get32bitTime(), buffer+3);
-
-		itoa(buffer+bufferPos, Voltage12v.sampleCount, 10);
-		bufferPos += strlen(buffer+bufferPos);
-		buffer[bufferPos] = ' ';	bufferPos++;
-		itoa(buffer+bufferPos, low, 10);
-		bufferPos += strlen(buffer+bufferPos);
-		buffer[bufferPos] = ' ';	bufferPos++;
-		itoa(buffer+bufferPos, average, 10);
-		bufferPos += strlen(buffer+bufferPos);
-		buffer[bufferPos] = ' ';	bufferPos++;
-		itoa(buffer+bufferPos, high, 10);
-		bufferPos += strlen(buffer+bufferPos);
-		buffer[bufferPos] = '\n';	bufferPos++;
-		buffer[bufferPos] = 0;
-
-		DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)buffer, bufferPos);
+		if (buffer != NULL) {
+			strcpy(buffer, "VS xxxxxxxx +12v ");
+			Int32ToString(Get32bitTime(), buffer+3);
+
+			itoa(buffer+bufferPos, Voltage12v.sampleCount, 10);
+			bufferPos += strlen(buffer+bufferPos);
+			buffer[bufferPos] = ' ';	bufferPos++;
+			itoa(buffer+bufferPos, low, 10);
+			bufferPos += strlen(buffer+bufferPos);
+			buffer[bufferPos] = ' ';	bufferPos++;
+			itoa(buffer+bufferPos, average, 10);
+			bufferPos += strlen(buffer+bufferPos);
+			buffer[bufferPos] = ' ';	bufferPos++;
+			itoa(buffer+bufferPos, high, 10);
+			bufferPos += strlen(buffer+bufferPos);
+			buffer[bufferPos] = '\n';	bufferPos++;
+
+			DataloggerFile_Commit(dlgFile, bufferPos);
+		}
 
 		// Reset statistical counters
 		Voltage12v.sampleCount = 0;
@@ -7,12 +7,24 @@
  * Revision History
  * Date			Author	Change
  * 12 Aug 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Load the logging configuration from the card on mount.
+ * 17 Oct 2026	agent	Size and time based file rotation.
+ * 17 Oct 2026	agent	Free extent map built in the background.
+ * 17 Oct 2026	agent	Optional raw write benchmark on mount.
+ * 17 Oct 2026	agent	Per-stage loop profiling.
+ * 17 Oct 2026	agent	SD Card busy time budget from mount.
+ * 17 Oct 2026	agent	Free cluster searches once there are no free FAT sectors.
+ * 17 Oct 2026	agent	Include stdlib.h for exit.
+ * 17 Oct 2026	agent	Write the CAN overflow summary before closing or rotating.
+ * 17 Oct 2026	agent	One set of sector caches shared by both files.
+ * 17 Oct 2026	agent	RAM budget.
  *
  * @file
  * Datalogger application.
  */
 
 #include <string.h>
+#include <stdlib.h>
 
 #include "../hardware.h"
 #include "../version.h"
@@ -21,8 +33,10 @@
 #include "../timing.h"
 
 #include "../SD-SPI-DMA/sd-spi-dma.h"
+#include "../SD-SPI-DMA/sd-benchmark.h"
 #include "../FAT32/fat32.h"
 #include "../FAT32/fat32-file.h"
+#include "../FAT32/fat32-freemap.h"
 
 #include "../UserInterface/datalogger-ui-hardware.h"
 #include "../UserInterface/datalogger-ui-leds.h"
@@ -30,7 +44,10 @@
 #include "datalogger.h"
 #include "datalogger-stringutil.h"
 #include "datalogger-file.h"
+#include "datalogger-config.h"
 #include "datalogger-applications.h"
+#include "datalogger-records.h"
+#include "datalogger-profile.h"
 
 #define DEBUG_UART
 #define DEBUG_UART_DATA
@@ -45,18 +62,145 @@ char *MonthLookup[] = {
 	"Sep", "Oct", "Nov", "Dec"
 };
 
-#define DLG_BUFFER_SIZE		8192
+/**
+ * Size of the RAM buffer taking in data while the card is busy, in bytes.
+ * This is most of the RAM, so it is sized to what the rest leaves over.
+ *
+ * RAM budget, dsPIC33FJ128MC802, 16384 bytes (including the 2048 bytes of DMA
+ * RAM), default build, static sizes as laid out by C30:
+ *   dlgBuffer								8192
+ *   SD Card DMA blocks, 3 x 518 (DMA)		1554
+ *   File sector caches (FS_FileCache)		1024
+ *   files, fs, card, dlgFile				 706
+ *   dlgConfig								 822
+ *   CAN recorder tracked and overflow SIDs	1280
+ *   ECAN DMA buffers (DMA) and RX queue	 640
+ *   UART ring and DMA blocks				 296
+ *   DBG_buffer								 184
+ *   Datalogger_Profile						 176
+ *   Everything else						 344
+ *   Total									15218
+ * leaving 1166 bytes, which the linker checks against the 1024 byte minimum
+ * stack in the project (there is no heap).
+ * DEBUG_UART_DEFERRED (the 512 byte record ring) and DATALOGGER_CAN_STREAM
+ * (482 bytes of packet buffers) don't fit alongside, so with those this must
+ * be lowered, to 7680.
+ */
+#ifndef DLG_BUFFER_SIZE
+	#define DLG_BUFFER_SIZE		8192
+#endif
 uint8_t dlgBuffer[DLG_BUFFER_SIZE] __attribute__((far));
 
+/**
+ * File size at which logging moves on to the next file, in bytes, or 0 to
+ * never rotate on size.
+ */
+#ifndef DLG_ROTATE_SIZE
+#define DLG_ROTATE_SIZE		((fs_size_t)64 * 1024 * 1024)
+#endif
+/**
+ * Time after which logging moves on to the next file, in the Get32bitTime()
+ * timebase, or 0 to never rotate on time.
+ */
+#ifndef DLG_ROTATE_TIME
+#define DLG_ROTATE_TIME		((uint32_t)60 * 60 * 1024)
+#endif
+/**
+ * Number of FAT sectors scanned for the free extent map each time the file is
+ * held, each one a single block read.
+ */
+#ifndef DLG_FREEMAP_BATCH
+#define DLG_FREEMAP_BATCH	8
+#endif
+/**
+ * Number of blocks written by the raw write benchmark. When DLG_SD_BENCHMARK
+ * is defined, this runs in the largest free extent each time a card is
+ * mounted, before logging starts, with the results on the debug UART.
+ */
+#ifndef DLG_SD_BENCHMARK_BLOCKS
+#define DLG_SD_BENCHMARK_BLOCKS	8192
+#endif
+/**
+ * Longest wait for room in the RAM buffer for the CAN overflow summary before
+ * closing the file, in the Get32bitTime() timebase. After this, the file is
+ * closed without the summary.
+ */
+#ifndef DLG_CLOSE_FLUSH_TIME
+#define DLG_CLOSE_FLUSH_TIME	((uint32_t)2 * 1024)
+#endif
+
+/**
+ * What the file being written is held for, since the card can only do one
+ * thing at a time.
+ */
+typedef enum {
+	DLG_HOLD_NONE,			/// Not held.
+	DLG_HOLD_ROTATE,		/// Creating the next file.
+	DLG_HOLD_FREEMAP		/// Scanning the FAT for the free extent map.
+} DataloggerHold;
+
 SD_Card card;
 FS_FAT32 fs;
-FS_File file;
+FS_File files[2];		/// The file being written, and the next file created ahead of rotation.
+FS_FileCache fileCache;	/// Sector caches, shared as only one of the files is written at a time.
 DataloggerFile dlgFile;
+DataloggerConfig dlgConfig;
 
 #define DLG_MAX_CARD_INIT_TRIES 16
 
 uint8_t cardInfoWritten;
 uint8_t cardInitTries = 0;
+uint8_t configLoading = 0;
+uint8_t rotateFailed = 0;
+uint32_t fileStartTime;
+DataloggerHold holdOwner = DLG_HOLD_NONE;
+uint8_t freeMapBatch;
+uint8_t closePending = 0;		/// Whether the file is to be closed once the CAN recorder is flushed.
+uint32_t closePendingTime;		/// Time the close was asked for.
+
+#ifdef DLG_SD_BENCHMARK
+SD_Benchmark sdBench;
+uint8_t benchRunning = 0;		/// 1 while completing the free extent map, 2 while writing.
+
+/**
+ * Runs the raw write benchmark, first completing the free extent map scan to
+ * find free space to write to.
+ * @return Whether the benchmark is still running.
+ */
+uint8_t Datalogger_ProcessBenchmark() {
+	fs_result_t fsresult;
+	sd_result_t result;
+	fs_addr_t lba;
+	uint32_t numBlocks;
+
+	if (benchRunning == 1) {
+		fsresult = FAT32_FreeMapTasks(&fs);
+		if (fsresult == FS_BUSY || fsresult == FS_IDLE) {
+			return 1;
+		}
+		lba = FAT32_FreeMapGetLargest(&fs, &numBlocks);
+		if (fsresult != FS_SUCCESS || lba == 0) {
+			DBG_DATA_printf("SD benchmark: no free space, got 0x%02x", fsresult);
+			return 0;
+		}
+		if (numBlocks > DLG_SD_BENCHMARK_BLOCKS) {
+			numBlocks = DLG_SD_BENCHMARK_BLOCKS;
+		}
+		SD_Benchmark_Begin(&sdBench, &card, lba, numBlocks, 0);
+		benchRunning = 2;
+	}
+
+	result = SD_Benchmark_Tasks(&sdBench);
+	if (result == SD_BUSY) {
+		return 1;
+	}
+	DBG_DATA_printf("SD benchmark: %lu blocks in %lu/1024 s, %lu KiB/s at %lu kHz%s, %u errors, %u back-offs, got 0x%02x",
+			sdBench.blocks, sdBench.endTime - sdBench.startTime, SD_Benchmark_GetRate(&sdBench),
+			card.SpeedkHz, card.HighSpeed ? " (high speed)" : "",
+			sdBench.errors, card.SpeedBackoffs, result);
+	return 0;
+}
+#endif
 
 void Datalogger_TryFileInit() {
 	if (!UI_Switch_GetCardDetect()) {
@@ -64,8 +208,12 @@ void Datalogger_TryFileInit() {
 		UI_LED_SetState(&UI_LED_SD_Error, LED_Off);
 		card.State = SD_UNINITIALIZED;
 		fs.State = FS_UNINITIALIZED;
-		file.state = FILE_Uninitialized;
+		dlgFile.file->state = FILE_Uninitialized;
 		cardInitTries = 0;
+		configLoading = 0;
+#ifdef DLG_SD_BENCHMARK
+		benchRunning = 0;
+#endif
 	}
 
 	// Continue with the initializtaion process
@@ -82,6 +230,8 @@ void Datalogger_TryFileInit() {
 		if (result == SD_BUSY) {
 		} else if (result == SD_SUCCESS) {
 			DBG_DATA_printf("SD Card initialized");
+			// Check busy times against the budget at the lowest rate until there is data
+			SD_Latency_SetBudget(&card, DataloggerFile_GetLatencyBudget(&dlgFile));
 			FAT32_Initialize(&fs, &card);
 		} else if (result == SD_INITIALIZE_NOSUPPORT) {
 			DBG_DATA_printf("SD Card initialialization failed: unsupported card, got 0x%02x", result);
@@ -100,19 +250,46 @@ void Datalogger_TryFileInit() {
 		if (result == FS_BUSY) {
 		} else if (result == FS_SUCCESS) {
 			DBG_DATA_printf("FS initialized");
-			FS_CreateFileSeqName(&fs, &fs.rootDirectory, &file, "DLG0000", "DLA", 3, 4);
+			FAT32_BeginFreeMap(&fs);
+#ifdef DLG_SD_BENCHMARK
+			benchRunning = 1;
+#else
+			DataloggerConfig_Load(&dlgConfig, &fs);
+			configLoading = 1;
+#endif
 		} else {
 			DBG_DATA_printf("FS initialialization failed, got 0x%02x", result);
 			cardInitTries++;
 			UI_LED_SetState(&UI_LED_SD_Error, LED_Blink);
 		}
 	}
-	if (file.state == FILE_Creating) {
-		fs_result_t result = FS_GetCreateFileResult(&file);
-		DBG_SPAM_printf("FS_GetCreateFileResult -> 0x%02x, substate %u", result, file.subState);
+#ifdef DLG_SD_BENCHMARK
+	if (benchRunning && !Datalogger_ProcessBenchmark()) {
+		benchRunning = 0;
+		DataloggerConfig_Load(&dlgConfig, &fs);
+		configLoading = 1;
+	}
+#endif
+	if (configLoading) {
+		fs_result_t result = DataloggerConfig_GetLoadResult(&dlgConfig);
+		if (result == FS_BUSY) {
+		} else {
+			if (result != FS_SUCCESS) {
+				DBG_DATA_printf("Config load failed, got 0x%02x, using defaults", result);
+			}
+			configLoading = 0;
+			DataloggerConfig_ApplyFilters(&dlgConfig);
+			DataloggerConfig_WriteParameters(&dlgConfig, &dlgFile);
+			FS_CreateFileSeqName(&fs, &fs.rootDirectory, dlgFile.file, "DLG0000", DLG_FILE_EXT, 3, 4);
+		}
+	}
+	if (dlgFile.file->state == FILE_Creating) {
+		fs_result_t result = FS_GetCreateFileResult(dlgFile.file);
+		DBG_SPAM_printf("FS_GetCreateFileResult -> 0x%02x, substate %u", result, dlgFile.file->subState);
 		if (result == FS_BUSY) {
 		} else if (result == FS_SUCCESS) {
 			DBG_DATA_printf("File created");
+			fileStartTime = Get32bitTime();
 		} else {
 			DBG_DATA_printf("File creation failed, got 0x%02x", result);
 			cardInitTries++;
@@ -148,45 +325,175 @@ uint8_t Datalogger_WriteCardInfo(DataloggerFile *dlgFile) {
 			&& DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)bufMount, 13);
 }
 
+/**
+ * Writes the parameters at the beginning of each file, specifying the file
+ * format, etc.
+ * @param dlgFile Datalogger file to write to.
+ */
+void Datalogger_WriteHeader(DataloggerFile *dlgFile) {
+	char buffer[] = "PRM INIT xxxxxxxx xxxx\n";
+
+	DataloggerFile_WriteAtomic(dlgFile,
+(uint8_t*)DLG_PRM_FMT "\
+PRM SW 0.2\n\
+PRM TIMEBASE 1/1024s\n\
+PRM VOLTBASE 1/1024Vdd\n\
+PRM VOLTMEAS 0 12vPwr 68 18\n\
+PRM VOLTMEAS 1 ExtAnalog0\n\
+PRM CANCHA 0 Vehicle\n", 140);
+
+#ifdef HARDWARE_RUN_2
+	DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)"PRM HW RUN2\n", 12);
+#elif defined HARDWARE_RUN_3
+	DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)"PRM HW RUN3\n", 12);
+#endif
+
+
+	Int32ToString(Get32bitTime(), buffer+9);
+	Int16ToString(T1CON, buffer+18);
+	DataloggerFile_WriteAtomic(dlgFile, (uint8_t*)buffer, 23);
+}
+
+/**
+ * Creates the next log file in the background while the current one is being
+ * written, and switches to it once the current file is large or old enough.
+ * The card can only do one thing at a time, so the current file is held
+ * between blocks while the next file is created, with the RAM buffer taking
+ * in the data meanwhile. The next file's directory entry and clusters are
+ * only claimed once it starts being written, after the current file closes.
+ */
+void Datalogger_ProcessRotation() {
+	FS_File *current = dlgFile.file;
+	FS_File *next = (current == &files[0]) ? &files[1] : &files[0];
+
+	if (dlgFile.nextFile != NULL || rotateFailed
+			|| (DLG_ROTATE_SIZE == 0 && DLG_ROTATE_TIME == 0)) {
+		return;
+	}
+
+	if (next->state == FILE_Uninitialized || next->state == FILE_Closed) {
+		if (holdOwner == DLG_HOLD_ROTATE) {
+			if (FS_IsFileHeld(current)) {
+				DBG_DATA_printf("Creating next file");
+				FS_CreateFileSeqName(&fs, &fs.rootDirectory, next, "DLG0000", DLG_FILE_EXT, 3, 4);
+			}
+		} else if (holdOwner == DLG_HOLD_NONE
+				&& current->startCluster != 0 && !current->dirTableDirty
+				&& !dlgFile.requestClose
+				&& dlgFile.bufferFree >= DLG_BUFFER_SIZE / 4 * 3) {
+			// The current file's entry is on disk, so the next file's name
+			// and entry will follow it
+			FS_HoldFile(current, 1);
+			holdOwner = DLG_HOLD_ROTATE;
+		}
+	}
+	if (next->state == FILE_Creating) {
+		fs_result_t result = FS_GetCreateFileResult(next);
+		if (result == FS_BUSY) {
+			return;
+		} else if (result == FS_SUCCESS) {
+			DBG_DATA_printf("Next file created");
+		} else {
+			DBG_DATA_printf("Next file creation failed, got 0x%02x", result);
+			rotateFailed = 1;
+			UI_LED_Pulse(&UI_LED_Status_Error);
+		}
+		FS_HoldFile(current, 0);
+		holdOwner = DLG_HOLD_NONE;
+	}
+
+	if (next->state == FILE_Idle && !dlgFile.requestClose
+			&& dlgFile.bufferFree >= DLG_BUFFER_SIZE / 2
+			&& ((DLG_ROTATE_SIZE != 0 && current->position >= DLG_ROTATE_SIZE)
+			|| (DLG_ROTATE_TIME != 0 && Get32bitTime() - fileStartTime >= DLG_ROTATE_TIME))) {
+		// The overflow summary is written to the old file before rotating, as
+		// initializing the CAN recorder drops it
+		if (Datalogger_FlushCANRecorder(&dlgFile)
+				&& DataloggerFile_Rotate(&dlgFile, next)) {
+			DBG_DATA_printf("Rotating to next file");
+			Datalogger_InitCANRecorder(&dlgConfig);
+			Datalogger_WriteHeader(&dlgFile);
+			DataloggerConfig_WriteParameters(&dlgConfig, &dlgFile);
+			cardInfoWritten = 0;
+			fileStartTime = Get32bitTime();
+		}
+	}
+}
+
+/**
+ * Builds the free extent map in the background, so files are allocated in
+ * known free space, holding the file being written while a batch of FAT
+ * sectors is scanned, like rotation does to create the next file.
+ * The file is held when the RAM buffer is mostly empty, or when the file can't
+ * go on until the scan finds some free space.
+ */
+void Datalogger_ProcessFreeMap() {
+	FS_File *current = dlgFile.file;
+	fs_result_t result;
+
+	if (holdOwner == DLG_HOLD_NONE) {
+		if (FAT32_FreeMapWaiting(&fs) || (fs.freeMapState == FS_FREEMAP_SCANNING
+				&& dlgFile.bufferFree >= DLG_BUFFER_SIZE / 4 * 3)) {
+			FS_HoldFile(current, 1);
+			holdOwner = DLG_HOLD_FREEMAP;
+			freeMapBatch = 0;
+		}
+		return;
+	}
+	if (holdOwner != DLG_HOLD_FREEMAP || !FS_IsFileHeld(current)) {
+		return;
+	}
+
+	result = FAT32_FreeMapTasks(&fs);
+	if (result == FS_BUSY) {
+		return;
+	}
+	freeMapBatch++;
+	if (result == FS_IDLE && (FAT32_FreeMapWaiting(&fs)
+			|| (freeMapBatch < DLG_FREEMAP_BATCH && dlgFile.bufferFree >= DLG_BUFFER_SIZE / 2))) {
+		return;
+	}
+
+	if (result == FS_SUCCESS && fs.freeMapState == FS_FREEMAP_READY) {
+		DBG_DATA_printf("Free extent map complete, %u extents", fs.numFreeExtents);
+	} else if (result != FS_IDLE) {
+		DBG_DATA_printf("Free extent map scan failed, got 0x%02x", result);
+		UI_LED_Pulse(&UI_LED_Status_Error);
+	}
+	FS_HoldFile(current, 0);
+	holdOwner = DLG_HOLD_NONE;
+}
+
 void Datalogger_Init() {
 	uint8_t i=0;
 	uint8_t canDat1[] = {0xca, 0xfe, 0x0d, 0x06, 0xf0, 0x0d};
 	uint8_t canDat2[] = {0xde, 0xad, 0xbe, 0xef, 0xca, 0xfe, 0xf0, 0x0d};
 	//uint8_t canDat3[] = {0x1b, 0xad, 0xb0, 0x07};
 	uint8_t canDat4[] = {0x13, 0x37};
-	char buffer[] = "PRM INIT xxxxxxxx xxxx\n";
 	
 	DBG_printf("Datalogger Initialize")
 
 	Datalogger_InitVoltageRecorder();
+	DataloggerConfig_Init(&dlgConfig);
+	Datalogger_InitCANRecorder(&dlgConfig);
+	Datalogger_ProfileInit();
 
 	card = SD_CreateCard();
 	fs.State = FS_UNINITIALIZED;
-	file.state = FILE_Uninitialized;
-	DataloggerFile_Init(&dlgFile, &file, dlgBuffer, DLG_BUFFER_SIZE);
+	files[0].state = FILE_Uninitialized;
+	files[1].state = FILE_Uninitialized;
+	FS_SetFileCache(&files[0], &fileCache);
+	FS_SetFileCache(&files[1], &fileCache);
+	DataloggerFile_Init(&dlgFile, &files[0], dlgBuffer, DLG_BUFFER_SIZE);
 
 	cardInfoWritten = 0;
 	cardInitTries = 0;
+	configLoading = 0;
+	rotateFailed = 0;
+	holdOwner = DLG_HOLD_NONE;
+	closePending = 0;
 
-	DataloggerFile_WriteAtomic(&dlgFile,
-(uint8_t*)"PRM FMT 1\n\
-PRM SW 0.2\n\
-PRM TIMEBASE 1/1024s\n\
-PRM VOLTBASE 1/1024Vdd\n\
-PRM VOLTMEAS 0 12vPwr 68 18\n\
-PRM VOLTMEAS 1 ExtAnalog0\n\
-PRM CANCHA 0 Vehicle\n", 140);
-
-#ifdef HARDWARE_RUN_2
-	DataloggerFile_WriteAtomic(&dlgFile, (uint8_t*)"PRM HW RUN2\n", 12);
-#elif defined HARDWARE_RUN_3
-	DataloggerFile_WriteAtomic(&dlgFile, (uint8_t*)"PRM HW RUN3\n", 12);
-#endif
-
-
-	Int32ToString(Get32bitTime(), buffer+9);
-	Int16ToString(T1CON, buffer+18);
-	DataloggerFile_WriteAtomic(&dlgFile, (uint8_t*)buffer, 23);
+	Datalogger_WriteHeader(&dlgFile);
 
 	for (i=0;i<UI_LED_Count;i++) {
 		UI_LED_SetState(UI_LED_List[i], LED_Off);
@@ -242,8 +549,11 @@ void Datalogger_Loop() {
 		T1CON = 0x8002;
 	}
 
+	Datalogger_ProfileMark(DLG_PROF_OTHER);
 	Datalogger_ProcessCANCommunications(&dlgFile);
+	Datalogger_ProfileMark(DLG_PROF_CAN);
 	Datalogger_ProcessVoltageRecorder(&dlgFile);
+	Datalogger_ProfileMark(DLG_PROF_VOLTAGE);
 	Datalogger_ProcessPerfLogger(&dlgFile);
 	autoTerminate = Datalogger_ProcessAutoTerminate();
 	
@@ -258,15 +568,17 @@ void Datalogger_Loop() {
 	}
 
 	// If file is ready to go
+	Datalogger_ProfileMark(DLG_PROF_OTHER);
 	fs_result_t result = DataloggerFile_Tasks(&dlgFile);
+	Datalogger_ProfileMark(DLG_PROF_FILE);
 
 	if (T1CON == 0x00) {
 		DBG_ERR_printf("T1CON = 0");
 		T1CON = 0x8002;
 	}
 
-	if (file.state == FILE_Uninitialized && file.state == FILE_Creating 
-			&& file.state != FILE_Closed
+	if (dlgFile.file->state == FILE_Uninitialized && dlgFile.file->state == FILE_Creating 
+			&& dlgFile.file->state != FILE_Closed
 			&& result != FS_BUSY && result != FS_IDLE) {
 		DBG_DATA_printf("Error performing file tasks, got 0x%02x", result);
 		UI_LED_Pulse(&UI_LED_Status_Error);
@@ -279,14 +591,16 @@ void Datalogger_Loop() {
 
 	if (!dlgFile.requestClose) {
 		if (!cardInfoWritten
-				&& (file.state != FILE_Uninitialized && file.state != FILE_Creating)) {
+				&& (dlgFile.file->state != FILE_Uninitialized && dlgFile.file->state != FILE_Creating)) {
 			DBG_DATA_printf("Attempting to write card information");
 			if (Datalogger_WriteCardInfo(&dlgFile)) {
 				cardInfoWritten = 1;
 			}
 		}
 
+		Datalogger_ProfileMark(DLG_PROF_OTHER);
 		Datalogger_ProcessCANMessages(&dlgFile);
+		Datalogger_ProfileMark(DLG_PROF_CAN);
 	}
 
 	if (T1CON == 0x00) {
@@ -294,9 +608,10 @@ void Datalogger_Loop() {
 		T1CON = 0x8002;
 	}
 
-	if (file.state == FILE_Uninitialized || file.state == FILE_Creating) {
+	Datalogger_ProfileMark(DLG_PROF_OTHER);
+	if (dlgFile.file->state == FILE_Uninitialized || dlgFile.file->state == FILE_Creating) {
 		Datalogger_TryFileInit();
-	} else if (file.state == FILE_Closed) {
+	} else if (dlgFile.file->state == FILE_Closed) {
 		UI_LED_SetState(&UI_LED_SD_Read, LED_On);
 		UI_LED_SetState(&UI_LED_Status_Operate, LED_Off);
 		UI_LED_SetState(&UI_LED_Status_Waiting, LED_Blink);
@@ -306,12 +621,27 @@ void Datalogger_Loop() {
 		}
 	} else {
 		// Process file-based user inputs
-		if (UI_Switch_GetCardDismount() || get == 't' || autoTerminate) {
-			DataloggerFile_RequestClose(&dlgFile);
+		if (!closePending && (UI_Switch_GetCardDismount() || get == 't' || autoTerminate)) {
+			closePending = 1;
+			closePendingTime = Get32bitTime();
+		}
+		// An overflow summary waits for room in the RAM buffer
+		if (closePending && !dlgFile.requestClose) {
+			if (Datalogger_FlushCANRecorder(&dlgFile)) {
+				DataloggerFile_RequestClose(&dlgFile);
+			} else if (Get32bitTime() - closePendingTime >= DLG_CLOSE_FLUSH_TIME) {
+				DBG_ERR_printf("Closing without the CAN overflow summary");
+				DataloggerFile_RequestClose(&dlgFile);
+			}
 		}
+		Datalogger_ProcessRotation();
+		Datalogger_ProcessFreeMap();
 	}
+	Datalogger_ProfileMark(DLG_PROF_FS);
 
 	UI_LED_Update();
+	Datalogger_ProfileMark(DLG_PROF_LED);
+	Datalogger_ProfileEndLoop();
 
 	if (T1CON == 0x00) {
 		DBG_ERR_printf("T1CON = 0");
@@ -7,10 +7,16 @@
  * Revision History
  * Date			Author	Change
  * 29 Jul 2011	Ducky	Initial implementation.
- *
- * TODO
- * 01 Aug 2011	Ducky	TODO Check FAT before allocating - latest allocated
- *						cluster doesn't seem to work.
+ * 17 Oct 2026	agent	Initialize the sync point variables.
+ * 17 Oct 2026	agent	Initialize the hold and directory reload flags.
+ * 17 Oct 2026	agent	Sequential names from the FS Information Sector hint, skipping
+ *						the directory scan when the hint checks out.
+ * 17 Oct 2026	agent	Clusters are allocated from the free extent map (see
+ *						fat32-freemap.h) rather than after the most recently
+ *						allocated cluster, which doesn't check the FAT.
+ * 17 Oct 2026	agent	File struct initialization shared with opening files.
+ * 17 Oct 2026	agent	Creation leaves the (possibly shared) sector caches alone,
+ *						the entry is read back on the first directory write.
  *
  * @file
  * File creation operations for FAT32 filesystem files.
@@ -32,6 +38,36 @@
 
 #define FILE_CREATE_SUB_BEGIN			0	/// Operation beginning
 #define FILE_CREATE_SUB_READDIRTABLE	1	/// Reading directory table looking for an empty entry
+#define FILE_CREATE_SUB_READHINT		2	/// Reading the directory table block of the sequential name hint
+#define FILE_CREATE_SUB_READHINTNEXT	3	/// Reading the directory table block following the hint's
+
+/**
+ * Sets the sequential part of a file name to one more than that of an existing
+ * name, incrementing in hex.
+ *
+ * @param file File structure, with the sequential naming option.
+ * @param existing Existing name with the same prefix.
+ */
+static void IncrementSeqName(FS_File *file, uint8_t *existing) {
+	uint8_t carry = 1;
+	uint8_t i;
+	for (i=file->nameMatchChars+file->nameNumDigits-1;i>=file->nameMatchChars;i--) {
+		if (carry) {
+			file->name[i] = existing[i] + 1;
+			if (file->name[i] == '9' + 1) {
+				file->name[i] = 'A';
+				carry = 0;
+			} else if (file->name[i] > 'F') {
+				file->name[i] = '0';
+				carry = 1;
+			} else {
+				carry = 0;
+			}
+		} else {
+			file->name[i] = existing[i];
+		}
+	}
+}
 
 /**
  * Parses a directory sturcture, looking for an empty entry. If one is found,
@@ -70,23 +106,7 @@ uint8_t ProcessDirectoryTableBlock(FS_File *file, uint8_t *data) {
 					}
 				}
 				if (isSmaller) {
-					uint8_t carry = 1;
-					for (i=file->nameMatchChars+file->nameNumDigits-1;i>=file->nameMatchChars;i--) {
-						if (carry) {
-							file->name[i] = data[pos+i] + 1;
-							if (file->name[i] == '9' + 1) {
-								file->name[i] = 'A';
-								carry = 0;
-							} else if (file->name[i] > 'F') {
-								file->name[i] = '0';
-								carry = 1;
-							} else {
-								carry = 0;
-							}
-						} else {
-							file->name[i] = data[pos+i];
-						}
-					}
+					IncrementSeqName(file, data+pos);
 				}
 			}
 		}
@@ -94,23 +114,19 @@ uint8_t ProcessDirectoryTableBlock(FS_File *file, uint8_t *data) {
 	return 0;
 }
 
-/**
- * Initializes the non-filesystem dependent portions of a file struct.
- * @param file File structure to initialize.
- */
 void FAT32_InitializeEmptyFileStruct(FS_File *file) {
 	SD_Card *card = file->fs->card;
+	uint8_t i;
 
 	file->size = 0;
 	file->position = 0;
 	
-	file->currFATData = file->currFATDataAlloc;
-	file->currFATData = file->currFATDataAlloc;
 	file->currFATLBA = 0xffffffff;
 
 	file->fsBuffer = card->DataBlocks[0].Data + 2;
-	file->dataBuffer[0] = card->DataBlocks[1].Data + 2;
-	file->dataBuffer[1] = card->DataBlocks[2].Data + 2;
+	for (i=0;i<FS_NUM_DATA_BUFFERS;i++) {
+		file->dataBuffer[i] = card->DataBlocks[i+1].Data + 2;
+	}
 	file->dataBufferSize = card->BlockSize;
 	
 	file->dataBufferWrite = 0;
@@ -118,10 +134,29 @@ void FAT32_InitializeEmptyFileStruct(FS_File *file) {
 	file->dataBufferNumFilled = 0;
 	file->dataBufferPos = 0;
 
+	file->statMaxFilled = 0;
+	file->statStalls = 0;
+	file->statStalled = 0;
+	file->statSyncs = 0;
+	file->statReadStalls = 0;
+
 	file->startCluster = 0;
+	file->fatRunEndLBA = 0;
 
 	file->dirTableDirty = 0;
+	file->dirTableReload = 1;
 	file->requestClose = 0;
+	file->requestHold = 0;
+	file->requestSeek = 0;
+
+	file->syncInterval = FS_SYNC_INTERVAL;
+	file->syncPosition = 0;
+	file->requestSync = 0;
+}
+
+void FS_SetFileCache(FS_File *file, FS_FileCache *cache) {
+	file->dirTableBlockData = cache->dirTableBlock;
+	file->currFATData = cache->fatBlock;
 }
 
 fs_result_t FS_CreateFile(FS_FAT32 *fs, FS_Directory *dir, FS_File *file, char *name, char *ext) {
@@ -198,8 +233,18 @@ fs_result_t FS_GetCreateFileResult(FS_File *file) {
 		file->currLBAClusterOffset = 0;
 		file->currFATClusterEnd = 0;
 
+		if (file->nameNumDigits != 0 && file->fs->seqHintValid
+				&& file->fs->seqHintEntry / (file->fs->bytesPerSector / 32) < file->fs->sectorsPerCluster
+				&& !strncmp(file->fs->seqHintName, file->name, file->nameMatchChars)) {
+			// Check the hint first, only reading the block with the hinted entry
+			file->dirTableLBAClusterOffset = file->fs->seqHintEntry / (file->fs->bytesPerSector / 32);
+			file->dirTableLBA += file->dirTableLBAClusterOffset;
+			file->subState = FILE_CREATE_SUB_READHINT;
+		} else {
+			file->subState = FILE_CREATE_SUB_READDIRTABLE;
+		}
+
 		// Start reading in Directory Table blocks
-		file->subState = FILE_CREATE_SUB_READDIRTABLE;
 		DBG_SPAM_printf("Read directory table at LBA 0x%08lx", file->dirTableLBA);
 		result = SD_DMA_SingleBlockRead(file->fs->card, file->dirTableLBA, &file->fs->card->DataBlocks[0]);
 		if (result == SD_BUSY) {
@@ -207,6 +252,72 @@ fs_result_t FS_GetCreateFileResult(FS_File *file) {
 		}
 	}
 
+	if (file->subState == FILE_CREATE_SUB_READHINT || file->subState == FILE_CREATE_SUB_READHINTNEXT) {
+		uint16_t pos = (file->fs->seqHintEntry % (file->fs->bytesPerSector / 32)) * 32;
+		uint8_t hintValid = 0;
+
+		if (result == SD_BUSY) {
+			result = SD_DMA_GetSingleBlockReadResult(file->fs->card);
+		}
+
+		if (result == SD_BUSY) {
+			return FS_BUSY;
+		} else if (result != SD_SUCCESS) {
+			DBG_ERR_printf("Failed: Error reading directory table at LBA 0x%08lx, got 0x%02x", file->dirTableLBA, result);
+			file->state = FILE_Uninitialized;
+			return FS_PHY_ERR;
+		}
+
+		// The hint is good if the hinted entry is still the file named in the
+		// hint, and is the last entry in the directory
+		if (file->subState == FILE_CREATE_SUB_READHINTNEXT) {
+			pos = 0;
+			hintValid = (file->fsBuffer[pos] == 0x00);
+		} else if (!strncmp((char*)file->fsBuffer+pos, file->fs->seqHintName,
+						file->nameMatchChars + file->nameNumDigits)
+				&& !strncmp((char*)file->fsBuffer+pos+8, file->ext, 3)) {
+			pos += 32;
+			if (pos < file->fs->bytesPerSector) {
+				hintValid = (file->fsBuffer[pos] == 0x00);
+			} else if (file->dirTableLBAClusterOffset + 1 < file->fs->sectorsPerCluster) {
+				// Hinted entry ends its block, the next entry is in the next block
+				file->dirTableLBA++;
+				file->dirTableLBAClusterOffset++;
+				file->subState = FILE_CREATE_SUB_READHINTNEXT;
+				result = SD_DMA_SingleBlockRead(file->fs->card, file->dirTableLBA, &file->fs->card->DataBlocks[0]);
+				if (result != SD_BUSY) {
+					DBG_ERR_printf("Failed: Error reading directory table at LBA 0x%08lx, got 0x%02x", file->dirTableLBA, result);
+					file->state = FILE_Uninitialized;
+					return FS_PHY_ERR;
+				}
+				return FS_BUSY;
+			}
+		}
+
+		if (hintValid) {
+			DBG_SPAM_printf("Sequential name hint valid");
+			IncrementSeqName(file, (uint8_t*)file->fs->seqHintName);
+			file->dirTableBlockOffset = pos;
+
+			FAT32_WriteDirectoryTableEntry(file, file->fsBuffer);
+
+			file->state = FILE_Idle;
+			file->subState = 0;
+			return FS_SUCCESS;
+		}
+
+		// Hint is stale, scan the directory from the beginning
+		DBG_DATA_printf("Sequential name hint stale, scanning directory");
+		file->fs->seqHintValid = 0;
+		file->dirTableLBA = GetClusterLBA(file->fs, file->dirTableCluster);
+		file->dirTableLBAClusterOffset = 0;
+		file->subState = FILE_CREATE_SUB_READDIRTABLE;
+		result = SD_DMA_SingleBlockRead(file->fs->card, file->dirTableLBA, &file->fs->card->DataBlocks[0]);
+		if (result == SD_BUSY) {
+			return FS_BUSY;
+		}
+	}
+
 	while (file->subState == FILE_CREATE_SUB_READDIRTABLE) {
 		if (result == SD_BUSY) {
 			result = SD_DMA_GetSingleBlockReadResult(file->fs->card);
@@ -226,7 +337,6 @@ fs_result_t FS_GetCreateFileResult(FS_File *file) {
 
 			// Fill in the directory table entry
 			FAT32_WriteDirectoryTableEntry(file, file->fsBuffer);
-			memcpy(file->dirTableBlockData, file->fsBuffer, file->fs->bytesPerSector);
 
 			file->state = FILE_Idle;
 			file->subState = 0;
@@ -235,6 +345,7 @@ fs_result_t FS_GetCreateFileResult(FS_File *file) {
 			// Empty entry not found in this block, read next block
 			DBG_SPAM_printf("Empty directory table entry not found");
 
+			file->dirTableLBA++;
 			file->dirTableLBAClusterOffset++;
 			if (file->dirTableLBAClusterOffset == file->fs->sectorsPerCluster) {
 				// Todo: implement fat pointer following
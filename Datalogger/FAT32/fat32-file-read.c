@@ -0,0 +1,282 @@
+/*
+ * File:   fat32-file-read.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 8:10 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Follow the directory's cluster chain.
+ *
+ * @file
+ * File open, read and seek operations. The blocks themselves are read ahead
+ * in the background by FS_FileTasks, see fat32-file-tasks.c.
+ */
+
+#include <string.h>
+#include <ctype.h>
+
+#include "fat32-util.h"
+#include "fat32-file-util.h"
+
+#include "fat32-file.h"
+
+#define DEBUG_UART
+#define DEBUG_UART_DATA
+//#define DEBUG_UART_SPAM
+#define DBG_MODULE "File/Read"
+#include "../debug-common.h"
+#include "../debug-log.h"
+
+#define FILE_OPEN_SUB_BEGIN			0	/// Operation beginning
+#define FILE_OPEN_SUB_READDIRTABLE	1	/// Reading directory table looking for the file's entry
+#define FILE_OPEN_SUB_READFAT		2	/// Reading the FAT for the directory's next cluster
+
+/**
+ * Compares a directory table entry's name with the file's, as
+ * FAT32_WriteDirectoryTableEntry would write it.
+ *
+ * @param file File structure.
+ * @param entry Directory table entry.
+ * @return Whether the names match.
+ */
+static uint8_t MatchDirectoryTableEntry(FS_File *file, uint8_t *entry) {
+	uint8_t i;
+
+	for (i=0;i<8;i++) {
+		if (entry[i] != ((file->name[i] != '\0') ? toupper(file->name[i]) : ' ')) {
+			return 0;
+		}
+	}
+	for (i=0;i<3;i++) {
+		if (entry[i+8] != ((file->ext[i] != '\0') ? toupper(file->ext[i]) : ' ')) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Parses a directory table block, looking for the file's entry. If it is
+ * found, the file's starting cluster, size and directory table pointers are
+ * populated from it.
+ *
+ * @param file File structure.
+ * @param data Data block of the sector containing the directory table.
+ * @return Result.
+ * @retval FS_SUCCESS The entry was found.
+ * @retval FS_OPEN_NOT_FOUND The end of the directory was reached.
+ * @retval FS_BUSY The entry was not in this block.
+ */
+static fs_result_t FindDirectoryTableEntry(FS_File *file, uint8_t *data) {
+	uint16_t pos = 0;
+	for (pos=0;pos<file->fs->bytesPerSector;pos+=32) {
+		if (data[pos] == 0x00) {		// end of directory
+			return FS_OPEN_NOT_FOUND;
+		} else if (data[pos] == 0xe5		// deleted entry
+				|| (data[pos+0x0b] & 0x18) != 0) {	// long file name, volume label or directory
+			continue;
+		} else if (MatchDirectoryTableEntry(file, data+pos)) {
+			file->dirTableBlockOffset = pos;
+			file->startCluster = FATSplitDataToInt32(data+pos+0x14, data+pos+0x1a);
+			file->size = FATDataToInt32(data+pos+0x1c);
+			return FS_SUCCESS;
+		}
+	}
+	return FS_BUSY;
+}
+
+fs_result_t FS_OpenFile(FS_FAT32 *fs, FS_Directory *dir, FS_File *file, char *name, char *ext) {
+	uint8_t i = 0;
+
+	file->dir = dir;
+	file->fs = fs;
+
+	// Initialize the file structure
+	FAT32_InitializeEmptyFileStruct(file);
+
+	file->state = FILE_Opening;
+	file->subState = FILE_OPEN_SUB_BEGIN;
+
+	file->dirTableCluster = file->fs->rootDirectory.directoryTableBeginCluster;
+	file->dirTableLBA = GetClusterLBA(fs, file->dirTableCluster);
+	file->dirTableLBAClusterOffset = 0;
+
+	for (i=0;i<8 && name[i] != 0;i++) {
+		file->name[i] = name[i];
+	}
+	for (;i<8;i++) {
+		file->name[i] = '\0';
+	}
+	for (i=0;i<3 && ext[i] != 0;i++) {
+		file->ext[i] = ext[i];
+	}
+	for (;i<3;i++) {
+		file->ext[i] = '\0';
+	}
+
+	file->nameMatchChars = 0;
+	file->nameNumDigits = 0;
+
+	return FS_GetOpenFileResult(file);
+}
+
+fs_result_t FS_GetOpenFileResult(FS_File *file) {
+	sd_result_t result = SD_BUSY;
+	fs_result_t fsresult;
+
+	if (file->state != FILE_Opening) {
+		DBG_ERR_printf("Failed: File not in Opening state, got 0x%02x", file->state);
+		return FS_FAILED;
+	}
+
+	if (file->subState == FILE_OPEN_SUB_BEGIN) {
+		DBG_SPAM_printf("Read directory table at LBA 0x%08lx", file->dirTableLBA);
+		result = SD_DMA_SingleBlockRead(file->fs->card, file->dirTableLBA, &file->fs->card->DataBlocks[0]);
+		file->subState = FILE_OPEN_SUB_READDIRTABLE;
+	}
+
+	while (file->subState == FILE_OPEN_SUB_READDIRTABLE || file->subState == FILE_OPEN_SUB_READFAT) {
+		if (result == SD_BUSY) {
+			result = SD_DMA_GetSingleBlockReadResult(file->fs->card);
+		}
+
+		if (result == SD_BUSY) {
+			return FS_BUSY;
+		} else if (result != SD_SUCCESS) {
+			DBG_ERR_printf("Failed: Error reading directory table at LBA 0x%08lx, got 0x%02x", file->dirTableLBA, result);
+			file->state = FILE_Uninitialized;
+			return FS_PHY_ERR;
+		}
+
+		if (file->subState == FILE_OPEN_SUB_READFAT) {
+			uint32_t nextCluster = FATDataToInt32(file->fsBuffer
+					+ GetClusterFATOffset(file->fs, file->dirTableCluster)) & 0x0fffffff;
+			if (nextCluster < 2 || nextCluster >= 0x0ffffff8) {
+				// The directory ends with its last cluster
+				DBG_DATA_printf("File not found");
+				file->state = FILE_Uninitialized;
+				return FS_OPEN_NOT_FOUND;
+			}
+			file->dirTableCluster = nextCluster;
+			file->dirTableLBA = GetClusterLBA(file->fs, file->dirTableCluster);
+			file->dirTableLBAClusterOffset = 0;
+			file->subState = FILE_OPEN_SUB_READDIRTABLE;
+
+			DBG_SPAM_printf("Read directory table at LBA 0x%08lx", file->dirTableLBA);
+			result = SD_DMA_SingleBlockRead(file->fs->card, file->dirTableLBA, &file->fs->card->DataBlocks[0]);
+			continue;
+		}
+
+		fsresult = FindDirectoryTableEntry(file, file->fsBuffer);
+		if (fsresult == FS_SUCCESS) {
+			DBG_DATA_printf("Opened '%8.8s.%3.3s', %lu bytes at cluster %lu",
+					file->fsBuffer+file->dirTableBlockOffset, file->fsBuffer+file->dirTableBlockOffset+8,
+					file->size, file->startCluster);
+			memcpy(file->dirTableBlockData, file->fsBuffer, file->fs->bytesPerSector);
+
+			file->currCluster = file->startCluster;
+			file->currLBA = GetClusterLBA(file->fs, file->currCluster);
+			file->currLBAClusterOffset = 0;
+			file->currFATClusterEnd = FAT32_CLUSTER_EOC;
+			file->aheadPosition = 0;
+			file->aheadLinks = 0;
+			if (file->startCluster < 2 && file->size != 0) {
+				DBG_ERR_printf("Failed: no clusters for %lu bytes", file->size);
+				file->state = FILE_Uninitialized;
+				return FS_FAILED;
+			}
+
+			file->state = FILE_ReadIdle;
+			file->subState = 0;
+			return FS_SUCCESS;
+		} else if (fsresult == FS_OPEN_NOT_FOUND) {
+			DBG_DATA_printf("File not found");
+			file->state = FILE_Uninitialized;
+			return FS_OPEN_NOT_FOUND;
+		}
+
+		// Entry not found in this block, read next block, or at the end of the
+		// cluster, the FAT sector with the directory's next cluster
+		file->dirTableLBA++;
+		file->dirTableLBAClusterOffset++;
+		if (file->dirTableLBAClusterOffset == file->fs->sectorsPerCluster) {
+			DBG_SPAM_printf("Read FAT at LBA 0x%08lx", GetClusterFATLBA(file->fs, file->dirTableCluster));
+			result = SD_DMA_SingleBlockRead(file->fs->card,
+					GetClusterFATLBA(file->fs, file->dirTableCluster), &file->fs->card->DataBlocks[0]);
+			file->subState = FILE_OPEN_SUB_READFAT;
+		} else {
+			DBG_SPAM_printf("Read directory table at LBA 0x%08lx", file->dirTableLBA);
+			result = SD_DMA_SingleBlockRead(file->fs->card, file->dirTableLBA, &file->fs->card->DataBlocks[0]);
+		}
+		if (result == SD_BUSY) {
+			return FS_BUSY;
+		}
+		// Otherwise continue on for another loop...
+	}
+
+	// Code should never reach this
+	DBG_DATA_printf("Failed: Bad substate 0x%02x", file->subState);
+	return FS_FAILED;
+}
+
+fs_length_t FS_ReadFile(FS_File *file, uint8_t *data, fs_length_t dataLen) {
+	fs_length_t dataLeft = dataLen;
+
+	if (file->requestSeek || file->requestClose) {
+		return 0;
+	}
+
+	// Copy out of the read-ahead buffers until there are no more filled
+	while ((file->dataBufferNumFilled > 0) && (dataLeft > 0) && (file->position < file->size)) {
+		uint8_t *buf = file->dataBuffer[file->dataBufferFill] + file->dataBufferPos;
+		fs_length_t blockDataLen = file->dataBufferSize - file->dataBufferPos;
+
+		if (blockDataLen > dataLeft) {
+			blockDataLen = dataLeft;
+		}
+		if (blockDataLen > file->size - file->position) {
+			blockDataLen = file->size - file->position;
+		}
+
+		DBG_SPAM_printf("Copying block of %u from file buffer", blockDataLen);
+
+		memcpy((void*)data, (void*)buf, blockDataLen);
+		dataLeft -= blockDataLen;
+		data += blockDataLen;
+		file->position += blockDataLen;
+
+		// Advance buffer if necessary, freeing it to be read into
+		file->dataBufferPos += blockDataLen;
+		if (file->dataBufferPos >= file->dataBufferSize) {
+			file->dataBufferFill++;
+			if (file->dataBufferFill == FS_NUM_DATA_BUFFERS) {
+				file->dataBufferFill = 0;
+			}
+			file->dataBufferNumFilled--;
+			file->dataBufferPos = 0;
+		}
+	}
+	if (dataLeft > 0 && file->position < file->size && !file->statStalled) {
+		file->statReadStalls++;
+	}
+	file->statStalled = (dataLeft > 0 && file->position < file->size);
+
+	return dataLen - dataLeft;
+}
+
+fs_result_t FS_Seek(FS_File *file, fs_size_t position) {
+	if (file->state != FILE_ReadIdle && file->state != FILE_ReadingData
+			&& file->state != FILE_TerminatingRead && file->state != FILE_ReadingFAT) {
+		DBG_ERR_printf("Seek failed: file not open for reading, state is 0x%02x", file->state);
+		return FS_FAILED;
+	}
+	if (position > file->size) {
+		DBG_ERR_printf("Seek failed: position %lu past the end of the file (%lu bytes)", position, file->size);
+		return FS_FAILED;
+	}
+	file->seekPosition = position;
+	file->requestSeek = 1;
+	return FS_SUCCESS;
+}
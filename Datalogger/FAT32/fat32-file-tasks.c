@@ -7,6 +7,18 @@
  * Revision History
  * Date			Author	Change
  * 07 Arg 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Multiple-sector cluster preallocation.
+ * 17 Oct 2026	agent	Periodic sync points.
+ * 17 Oct 2026	agent	Holding files, first cluster chosen at the first allocation, and
+ *						directory table reload before the first directory write.
+ * 17 Oct 2026	agent	Update the sequential file name hint.
+ * 17 Oct 2026	agent	Runs placed by the free extent map, linking the previous run to
+ *						the new one when they aren't contiguous.
+ * 17 Oct 2026	agent	Read-ahead for files opened for reading.
+ * 17 Oct 2026	agent	Read-ahead with multiple block reads, carried on across
+ *						contiguous clusters.
+ * 17 Oct 2026	agent	Next run only placed once data is pending, fixing the close
+ *						of a file which exactly filled its run.
  *
  * @file
  * File background tasks.
@@ -17,6 +29,7 @@
 #include "fat32-util.h"
 #include "fat32-file.h"
 #include "fat32-file-util.h"
+#include "fat32-freemap.h"
 
 #define DEBUG_UART
 #define DEBUG_UART_DATA
@@ -32,6 +45,10 @@ fs_result_t FS_File_ProcessTerminatingData(FS_File *file);
 fs_result_t FS_File_ProcessWritingFAT(FS_File *file);
 fs_result_t FS_File_ProcessWritingFSInformation(FS_File *file);
 fs_result_t FS_File_ProcessWritingDirTable(FS_File *file);
+fs_result_t FS_File_ProcessReadIdle(FS_File *file);
+fs_result_t FS_File_ProcessReadingData(FS_File *file);
+fs_result_t FS_File_ProcessTerminatingRead(FS_File *file);
+fs_result_t FS_File_ProcessReadingFAT(FS_File *file);
 
 /**
  * Goes to a state and processes the functions for that state.
@@ -61,6 +78,22 @@ inline void FS_File_GotoStateNoInvoke(FS_File *file, FileState state, fs_result_
 	file->subState = 0;
 }
 
+/**
+ * Checks whether a sync point is due, which requires stopping the multiple
+ * block write. No sync is needed when closing, as the close commits the size.
+ *
+ * @param file File.
+ * @return Whether a sync point is due.
+ */
+static uint8_t FS_File_SyncDue(FS_File *file) {
+	if (file->requestClose || file->position == file->syncPosition) {
+		file->requestSync = 0;
+		return 0;
+	}
+	return file->requestSync || (file->syncInterval != 0
+			&& file->position - file->syncPosition >= file->syncInterval);
+}
+
 /**
  * Tasks in the Idle state - mostly involving going to a state which actually
  * does something.
@@ -70,12 +103,35 @@ inline void FS_File_GotoStateNoInvoke(FS_File *file, FileState state, fs_result_
  * @return Result of the operation.
  */
 fs_result_t FS_File_ProcessIdle(FS_File *file) {
-	if ((file->currCluster > file->currFATClusterEnd)
-			|| (file->requestClose && (file->currFATClusterEnd != FAT32_CLUSTER_EOC))) {
+	uint8_t dataPending = file->dataBufferNumFilled > 0 || file->dataBufferPos > 0;
+
+	// Leave the card alone while held, everything else waits until released
+	if (file->requestHold) {
+		return FS_IDLE;
+	}
+
+	// The multiple block write is stopped anyway, so sync early if one is due soon
+	if (!file->dirTableDirty && !file->requestClose && file->syncInterval != 0
+			&& file->position - file->syncPosition >= file->syncInterval / 2) {
+		DBG_SPAM_printf("Early sync");
+		file->dirTableDirty = 1;
+	}
+
+	// Wait for the free extent map scan to find somewhere to put the data
+	if (file->currCluster > file->currFATClusterEnd && dataPending
+			&& FAT32_FreeMapWaiting(file->fs)) {
+		return FS_IDLE;
+	}
+
+	// The next run is only placed once there is data for it. If the file
+	// exactly filled its run and is closed before any more data arrives, the
+	// termination then lands on the last cluster of that run, rather than
+	// before the start of an unused run placed elsewhere.
+	if ((file->currCluster > file->currFATClusterEnd && dataPending)
+			|| (file->requestClose && !dataPending && (file->currFATClusterEnd != FAT32_CLUSTER_EOC))) {
 		if (file->currCluster > file->currFATClusterEnd) {
 			DBG_SPAM_printf("Idle -> WriteFAT: exceeding allocated cluster");
-		}
-		if (file->requestClose && (file->currFATClusterEnd != FAT32_CLUSTER_EOC)) {
+		} else {
 			DBG_SPAM_printf("Idle -> WriteFAT: termination");
 		}
 		return FS_File_GotoState(file, FILE_WritingFAT, &FS_File_ProcessWritingFAT);
@@ -85,7 +141,8 @@ fs_result_t FS_File_ProcessIdle(FS_File *file) {
 	} else if (file->dirTableDirty) {
 		DBG_SPAM_printf("Idle -> WritingDirTable");
 		return FS_File_GotoState(file, FILE_WritingDirTable, &FS_File_ProcessWritingDirTable);
-	} else if (!file->requestClose || file->dataBufferNumFilled > 0) {
+	} else if (dataPending
+			|| (!file->requestClose && file->currCluster <= file->currFATClusterEnd)) {
 		DBG_SPAM_printf("Idle -> WritingData");
 		return FS_File_GotoState(file, FILE_WritingData, &FS_File_ProcessWritingData);
 	} else if (file->requestClose) {
@@ -132,6 +189,17 @@ fs_result_t FS_File_ProcessWritingData(FS_File *file) {
 		DBG_SPAM_printf("WritingData -> TerminatingData (allocation exceeded)");
 		return FS_File_GotoState(file, FILE_TerminatingData, &FS_File_ProcessTerminatingData);
 	}
+	// Check if a sync point is due, Idle then writes the directory table
+	if (FS_File_SyncDue(file)) {
+		DBG_SPAM_printf("WritingData -> TerminatingData (sync)");
+		file->dirTableDirty = 1;
+		return FS_File_GotoState(file, FILE_TerminatingData, &FS_File_ProcessTerminatingData);
+	}
+	// Check if the file is being held, Idle then waits with the card free
+	if (file->requestHold) {
+		DBG_SPAM_printf("WritingData -> TerminatingData (hold)");
+		return FS_File_GotoState(file, FILE_TerminatingData, &FS_File_ProcessTerminatingData);
+	}
 	// Check if there are blocks ready to be sent
 	if (file->dataBufferNumFilled > 0) {
 		DBG_SPAM_printf("WritingData -> SendingData");
@@ -248,8 +316,71 @@ fs_result_t FS_File_ProcessTerminatingData(FS_File *file) {
 	}
 }
 
+#define FILE_FAT_SUB_BEGIN		0	/// Operation beginning
+#define FILE_FAT_SUB_READ		1	/// Reading the FAT sector containing the current cluster
+#define FILE_FAT_SUB_WRITE		2	/// Beginning the write of the FAT sector containing the current cluster
+#define FILE_FAT_SUB_WRITING	3	/// Writing the FAT sector containing the current cluster
+#define FILE_FAT_SUB_FILL		4	/// Beginning the write of a following whole FAT sector
+#define FILE_FAT_SUB_FILLING	5	/// Writing a following whole FAT sector
+#define FILE_FAT_SUB_LINK		6	/// Beginning the write of the previous run's last FAT sector, linking it to the new run
+#define FILE_FAT_SUB_LINKING	7	/// Writing the previous run's last FAT sector
+#define FILE_FAT_SUB_LOAD		8	/// Getting the FAT sector containing the current cluster
+
+/**
+ * Applies the FAT operation in progress (allocation or termination) to the
+ * FAT sector containing the current cluster.
+ *
+ * @param file File.
+ * @param data Data block of the sector containing the FAT entry.
+ */
+static void FS_File_UpdateFATBlock(FS_File *file, uint8_t *data) {
+	if (file->fatTerminate) {
+		DBG_SPAM_printf("Terminate FAT Block at cluster %lu", file->currCluster);
+		FAT32_TerminateFATBlock(file, data);
+	} else {
+		DBG_SPAM_printf("Allocate FAT Block at cluster %lu", file->currCluster);
+		FAT32_AllocateFATBlock(file, data);
+	}
+}
+
+/**
+ * Finishes a FAT operation, updating the directory table entry as necessary.
+ *
+ * @param file File.
+ * @return Result of the operation.
+ */
+static fs_result_t FS_File_FinishWritingFAT(FS_File *file) {
+	if (file->startCluster == 0x0000) {
+		file->startCluster = file->currCluster;
+		FAT32_WriteDirectoryTableEntry(file, file->dirTableBlockData);
+		file->dirTableDirty = 1;
+
+		// This is now the last sequentially named file, remember where it is
+		if (file->nameNumDigits != 0) {
+			memcpy(file->fs->seqHintName, file->name, 8);
+			file->fs->seqHintEntry = file->dirTableLBAClusterOffset * (file->fs->bytesPerSector / 32)
+					+ file->dirTableBlockOffset / 32;
+			file->fs->seqHintValid = 1;
+			file->fs->fsInfoDirty = 1;
+		}
+	}
+	if (file->currFATClusterEnd == FAT32_CLUSTER_EOC) {
+		FAT32_UpdateDirectoryTableEntry(file, file->dirTableBlockData);
+		file->dirTableDirty = 1;
+	}
+
+	DBG_SPAM_printf("WritingFAT -> Idle");
+	return FS_File_GotoState(file, FILE_Idle, &FS_File_ProcessIdle);
+}
+
 /**
  * Periodically called when writing the FAT to the storage medium.
+ * When allocating, this claims the rest of the current FAT sector plus up to
+ * FS_PREALLOC_FAT_SECTORS - 1 following whole sectors as one contiguous run.
+ * The run is placed by the free extent map, and if it doesn't follow on from
+ * the file's previous run, the previous run's last cluster is linked to it.
+ * When terminating, this ends the cluster chain at the last cluster containing
+ * data and frees the rest of the run.
  *
  * @pre /a file is in the FILE_WritingFAT state.
  * @param file File.
@@ -263,28 +394,92 @@ fs_result_t FS_File_ProcessWritingFAT(FS_File *file) {
 	}
 	sd_result_t sdresult;
 
-	if (file->subState == 0) {
-		if (file->requestClose && file->dataBufferNumFilled == 0 && file->dataBufferPos == 0) {
-			// Write termination block
-			DBG_SPAM_printf("Write termination block");
-			FAT32_TerminateFATBlock(file, file->currFATData);
-			memcpy(file->fsBuffer, file->currFATData, file->fs->bytesPerSector);
-			file->subState = 2;
-		} else if (file->currFATLBA == GetClusterFATLBA(file->fs, file->currCluster)) {
+	if (file->subState == FILE_FAT_SUB_BEGIN) {
+		file->fatTerminate = file->requestClose
+				&& file->dataBufferNumFilled == 0 && file->dataBufferPos == 0;
+		if (file->fatTerminate) {
+			if (file->startCluster == 0x0000) {
+				// Nothing was ever written, so leave the file without clusters
+				DBG_SPAM_printf("Terminate empty file");
+				file->currFATClusterEnd = FAT32_CLUSTER_EOC;
+				FAT32_WriteDirectoryTableEntry(file, file->dirTableBlockData);
+				FAT32_UpdateDirectoryTableEntry(file, file->dirTableBlockData);
+				file->dirTableDirty = 1;
+				DBG_SPAM_printf("WritingFAT -> Idle");
+				return FS_File_GotoState(file, FILE_Idle, &FS_File_ProcessIdle);
+			}
+			// If the last block filled up its cluster, the current cluster is empty
+			if (file->currLBAClusterOffset == 0 && file->position > 0) {
+				file->currCluster--;
+			}
+		} else {
+			// A new file may have been created ahead of time, while another
+			// file was still allocating, so it is always placed now
+			uint32_t cluster = FAT32_FreeMapPlace(file->fs,
+					(file->startCluster == 0x0000) ? 0 : file->currCluster, &file->fatRunEndLBA);
+			if (cluster == 0) {
+				DBG_ERR_printf("Allocate FAT: no free space");
+				FS_File_GotoStateNoInvoke(file, FILE_Idle, &FS_File_ProcessIdle);
+				return FS_FAILED;
+			}
+			if (file->startCluster != 0x0000
+					&& FATDataToInt32(file->currFATData + file->currFATBlockOffset) != cluster) {
+				DBG_SPAM_printf("Link FAT run at cluster %lu to cluster %lu", file->currFATClusterEnd, cluster);
+				Int32ToFATData(file->currFATData + file->currFATBlockOffset, cluster);
+				memcpy(file->fsBuffer, file->currFATData, file->fs->bytesPerSector);
+				file->subState = FILE_FAT_SUB_LINK;
+			} else {
+				file->subState = FILE_FAT_SUB_LOAD;
+			}
+			file->currCluster = cluster;
+			file->currLBA = GetClusterLBA(file->fs, file->currCluster);
+			file->currLBAClusterOffset = 0;
+		}
+	}
+	if (file->subState == FILE_FAT_SUB_LINK || file->subState == FILE_FAT_SUB_LINKING) {
+		if (file->subState == FILE_FAT_SUB_LINK) {
+			DBG_SPAM_printf("Write FAT link at LBA %lu", file->currFATLBA);
+			sdresult = SD_DMA_SingleBlockWrite(file->fs->card,
+					file->currFATLBA, &file->fs->card->DataBlocks[0]);
+			file->subState = FILE_FAT_SUB_LINKING;
+		} else {
+			sdresult = SD_DMA_GetSingleBlockWriteResult(file->fs->card);
+		}
+
+		if (sdresult == SD_BUSY) {
+			return FS_BUSY;
+		} else if (sdresult == SD_SUCCESS) {
+			file->subState = FILE_FAT_SUB_LOAD;
+		} else {
+			DBG_ERR_printf("Write FAT link: LBA %lu, unexpected result from card: 0x%02x", file->currFATLBA, sdresult);
+			FS_File_GotoStateNoInvoke(file, FILE_Idle, &FS_File_ProcessIdle);
+			return FS_PHY_ERR;
+		}
+	}
+	if (file->subState == FILE_FAT_SUB_BEGIN || file->subState == FILE_FAT_SUB_LOAD) {
+		if (file->currFATLBA == GetClusterFATLBA(file->fs, file->currCluster)) {
 			// Access FAT from cache, if it's there
-			DBG_SPAM_printf("Allocate FAT Block from cache");
-			FAT32_AllocateFATBlock(file, file->currFATData);
+			DBG_SPAM_printf("Access FAT Block from cache");
+			FS_File_UpdateFATBlock(file, file->currFATData);
 			memcpy(file->fsBuffer, file->currFATData, file->fs->bytesPerSector);
-			file->subState = 2;
+			file->subState = FILE_FAT_SUB_WRITE;
+		} else if (!file->fatTerminate && file->fatRunEndLBA != 0) {
+			// The whole sector is known to be free, so there's no need to read it
+			DBG_SPAM_printf("Allocate free FAT Block");
+			memset(file->fsBuffer, 0, file->fs->bytesPerSector);
+			FS_File_UpdateFATBlock(file, file->fsBuffer);
+			memcpy(file->currFATData, file->fsBuffer, file->fs->bytesPerSector);
+			file->subState = FILE_FAT_SUB_WRITE;
 		}
 	}
-	if (file->subState == 0 || file->subState == 1) {
-		if (file->subState == 0) {
+	if (file->subState == FILE_FAT_SUB_BEGIN || file->subState == FILE_FAT_SUB_LOAD
+			|| file->subState == FILE_FAT_SUB_READ) {
+		if (file->subState != FILE_FAT_SUB_READ) {
 			// Read FAT from disk otherwise
 			DBG_SPAM_printf("Read FAT");
 			sdresult = SD_DMA_SingleBlockRead(file->fs->card,
 					GetClusterFATLBA(file->fs, file->currCluster), &file->fs->card->DataBlocks[0]);
-			file->subState = 1;
+			file->subState = FILE_FAT_SUB_READ;
 		} else {
 			sdresult = SD_DMA_GetSingleBlockReadResult(file->fs->card);
 		}
@@ -292,22 +487,21 @@ fs_result_t FS_File_ProcessWritingFAT(FS_File *file) {
 		if (sdresult == SD_BUSY) {
 			return FS_BUSY;
 		} else if (sdresult == SD_SUCCESS) {
-			DBG_SPAM_printf("Allocate FAT Block");
-			FAT32_AllocateFATBlock(file, file->fsBuffer);
+			FS_File_UpdateFATBlock(file, file->fsBuffer);
 			memcpy(file->currFATData, file->fsBuffer, file->fs->bytesPerSector);
-			file->subState = 2;
+			file->subState = FILE_FAT_SUB_WRITE;
 		} else {
 			DBG_ERR_printf("Read FAT: unexpected result from card: 0x%02x", sdresult);
 			FS_File_GotoStateNoInvoke(file, FILE_Idle, &FS_File_ProcessIdle);
 			return FS_PHY_ERR;
 		}
 	}
-	if (file->subState == 2 || file->subState == 3) {
-		if (file->subState == 2) {
+	if (file->subState == FILE_FAT_SUB_WRITE || file->subState == FILE_FAT_SUB_WRITING) {
+		if (file->subState == FILE_FAT_SUB_WRITE) {
 			DBG_SPAM_printf("Write FAT at LBA %lu", file->currFATLBA);
 			sdresult = SD_DMA_SingleBlockWrite(file->fs->card,
 					file->currFATLBA, &file->fs->card->DataBlocks[0]);
-			file->subState = 3;
+			file->subState = FILE_FAT_SUB_WRITING;
 		} else {
 			sdresult = SD_DMA_GetSingleBlockWriteResult(file->fs->card);
 		}
@@ -315,20 +509,45 @@ fs_result_t FS_File_ProcessWritingFAT(FS_File *file) {
 		if (sdresult == SD_BUSY) {
 			return FS_BUSY;
 		} else if (sdresult == SD_SUCCESS) {
-			if (file->startCluster == 0x0000) {
-				file->startCluster = file->currCluster;
-				FAT32_WriteDirectoryTableEntry(file, file->dirTableBlockData);
-				file->dirTableDirty = 1;
+			if (file->fatFillSectors == 0) {
+				return FS_File_FinishWritingFAT(file);
 			}
-			if (file->currFATClusterEnd == FAT32_CLUSTER_EOC) {
-				FAT32_UpdateDirectoryTableEntry(file, file->dirTableBlockData);
-				file->dirTableDirty = 1;				
+			file->subState = FILE_FAT_SUB_FILL;
+		} else {
+			DBG_ERR_printf("Write FAT: LBA %lu, unexpected result from card: 0x%02x", file->currFATLBA, sdresult);
+			FS_File_GotoStateNoInvoke(file, FILE_Idle, &FS_File_ProcessIdle);
+			return FS_PHY_ERR;
+		}
+	}
+	if (file->subState == FILE_FAT_SUB_FILL || file->subState == FILE_FAT_SUB_FILLING) {
+		if (file->subState == FILE_FAT_SUB_FILL) {
+			if (file->fatTerminate) {
+				DBG_SPAM_printf("Clear preallocated FAT at LBA %lu", file->fatFillLBA);
+				memset(file->fsBuffer, 0, file->fs->bytesPerSector);
+			} else {
+				DBG_SPAM_printf("Preallocate FAT at LBA %lu", file->fatFillLBA);
+				FAT32_ExtendFATBlock(file, file->fsBuffer);
+				memcpy(file->currFATData, file->fsBuffer, file->fs->bytesPerSector);
 			}
+			sdresult = SD_DMA_SingleBlockWrite(file->fs->card,
+					file->fatFillLBA, &file->fs->card->DataBlocks[0]);
+			file->subState = FILE_FAT_SUB_FILLING;
+		} else {
+			sdresult = SD_DMA_GetSingleBlockWriteResult(file->fs->card);
+		}
 
-			DBG_SPAM_printf("WritingFAT -> Idle");
-			return FS_File_GotoState(file, FILE_Idle, &FS_File_ProcessIdle);
+		if (sdresult == SD_BUSY) {
+			return FS_BUSY;
+		} else if (sdresult == SD_SUCCESS) {
+			file->fatFillLBA++;
+			file->fatFillSectors--;
+			if (file->fatFillSectors == 0) {
+				return FS_File_FinishWritingFAT(file);
+			}
+			file->subState = FILE_FAT_SUB_FILL;
+			return FS_BUSY;
 		} else {
-			DBG_ERR_printf("Write FAT: LBA %lu, unexpected result from card: 0x%02x", file->currFATLBA, sdresult);
+			DBG_ERR_printf("Write FAT: LBA %lu, unexpected result from card: 0x%02x", file->fatFillLBA, sdresult);
 			FS_File_GotoStateNoInvoke(file, FILE_Idle, &FS_File_ProcessIdle);
 			return FS_PHY_ERR;
 		}
@@ -377,9 +596,14 @@ fs_result_t FS_File_ProcessWritingFSInformation(FS_File *file) {
 	}
 }
 
+#define FILE_DIR_SUB_BEGIN		0	/// Operation beginning
+#define FILE_DIR_SUB_READ		1	/// Reading the directory table block back
+#define FILE_DIR_SUB_WRITING	2	/// Writing the directory table block
+
 /**
  * Periodically called when writing the Directory Table to the storage
- * medium.
+ * medium. The first write of a file reads the block back first, see
+ * dirTableReload.
  *
  * @pre /a file is in the FILE_WritingDirTable state.
  * @param file File.
@@ -391,15 +615,41 @@ fs_result_t FS_File_ProcessWritingDirTable(FS_File *file) {
 		DBG_ERR_printf("File operation failed: file not in the WritingDirTable state, state is 0x%02x", file->state);
 		return FS_FAILED;
 	}
-	sd_result_t sdresult;
+	sd_result_t sdresult = SD_BUSY;
 
-	if (file->subState == 0) {
+	if (file->subState == FILE_DIR_SUB_BEGIN && file->dirTableReload) {
+		// Other files may have written their entries into this block since
+		// it was cached, so read it back rather than overwrite them
+		DBG_SPAM_printf("Reload Directory Table");
+		sdresult = SD_DMA_SingleBlockRead(file->fs->card,
+			file->dirTableLBA, &file->fs->card->DataBlocks[0]);
+		file->subState = FILE_DIR_SUB_READ;
+	}
+	if (file->subState == FILE_DIR_SUB_READ) {
+		if (sdresult == SD_BUSY) {
+			sdresult = SD_DMA_GetSingleBlockReadResult(file->fs->card);
+		}
+
+		if (sdresult == SD_BUSY) {
+			return FS_BUSY;
+		} else if (sdresult == SD_SUCCESS) {
+			FAT32_WriteDirectoryTableEntry(file, file->fsBuffer);
+			memcpy(file->dirTableBlockData, file->fsBuffer, file->fs->bytesPerSector);
+			file->dirTableReload = 0;
+			file->subState = FILE_DIR_SUB_BEGIN;
+		} else {
+			DBG_ERR_printf("Reload Directory Table: LBA %lu, unexpected result from card: 0x%02x", file->dirTableLBA, sdresult);
+			FS_File_GotoStateNoInvoke(file, FILE_Idle, &FS_File_ProcessIdle);
+			return FS_PHY_ERR;
+		}
+	}
+	if (file->subState == FILE_DIR_SUB_BEGIN) {
 		DBG_SPAM_printf("Write Directory Table");
 		FAT32_UpdateDirectoryTableEntry(file, file->dirTableBlockData);
 		memcpy(file->fsBuffer, file->dirTableBlockData, file->fs->bytesPerSector);
 		sdresult = SD_DMA_SingleBlockWrite(file->fs->card,
 			file->dirTableLBA, &file->fs->card->DataBlocks[0]);
-		file->subState = 1;
+		file->subState = FILE_DIR_SUB_WRITING;
 	} else {
 		sdresult = SD_DMA_GetSingleBlockWriteResult(file->fs->card);
 	}
@@ -408,6 +658,9 @@ fs_result_t FS_File_ProcessWritingDirTable(FS_File *file) {
 		return FS_BUSY;
 	} else if (sdresult == SD_SUCCESS) {
 		file->dirTableDirty = 0;
+		file->syncPosition = file->position;
+		file->requestSync = 0;
+		file->statSyncs++;
 		DBG_SPAM_printf("WritingDirTable -> Idle");
 		return FS_File_GotoState(file, FILE_Idle, &FS_File_ProcessIdle);
 	} else {
@@ -417,6 +670,286 @@ fs_result_t FS_File_ProcessWritingDirTable(FS_File *file) {
 	}
 }
 
+/**
+ * Applies a requested seek, while no block is being read. Data already read
+ * ahead is kept if the new position is within it, otherwise the read-ahead
+ * starts over at the new position.
+ * The cluster containing the next block to be read ahead is aheadLinks links
+ * along the chain from currCluster, so the new cluster is found by following
+ * links from there if it is further along, or from the start of the file.
+ *
+ * @param file File.
+ */
+static void FS_File_ApplySeek(FS_File *file) {
+	fs_size_t bytesPerCluster = (fs_size_t)file->fs->bytesPerSector * file->fs->sectorsPerCluster;
+	fs_size_t bufferStart = file->position - file->dataBufferPos;
+	fs_size_t blockStart = file->seekPosition - file->seekPosition % file->dataBufferSize;
+	uint32_t currIndex, targetIndex;
+
+	file->requestSeek = 0;
+
+	if (blockStart >= bufferStart && blockStart < file->aheadPosition) {
+		// Within the read-ahead window, drop the blocks before the new position
+		DBG_SPAM_printf("Seek to %lu within read-ahead", file->seekPosition);
+		while (bufferStart < blockStart) {
+			file->dataBufferFill++;
+			if (file->dataBufferFill == FS_NUM_DATA_BUFFERS) {
+				file->dataBufferFill = 0;
+			}
+			file->dataBufferNumFilled--;
+			bufferStart += file->dataBufferSize;
+		}
+	} else {
+		DBG_SPAM_printf("Seek to %lu", file->seekPosition);
+		file->dataBufferNumFilled = 0;
+		file->dataBufferFill = file->dataBufferWrite;
+
+		currIndex = file->aheadPosition / bytesPerCluster - file->aheadLinks;
+		targetIndex = blockStart / bytesPerCluster;
+		if (targetIndex >= currIndex) {
+			file->aheadLinks = targetIndex - currIndex;
+		} else {
+			file->currCluster = file->startCluster;
+			file->aheadLinks = targetIndex;
+		}
+		file->aheadPosition = blockStart;
+		file->currLBAClusterOffset = (blockStart % bytesPerCluster) / file->dataBufferSize;
+		file->currLBA = GetClusterLBA(file->fs, file->currCluster) + file->currLBAClusterOffset;
+	}
+	file->dataBufferPos = file->seekPosition - blockStart;
+	file->position = file->seekPosition;
+}
+
+/**
+ * Tasks in the ReadIdle state - reading the next block ahead if there is a
+ * free data buffer, after following the cluster chain if necessary.
+ *
+ * @pre /a file is in the FILE_ReadIdle state.
+ * @param file File.
+ * @return Result of the operation.
+ */
+fs_result_t FS_File_ProcessReadIdle(FS_File *file) {
+	// Leave the card alone while held
+	if (file->requestHold) {
+		return FS_IDLE;
+	}
+	if (file->requestClose) {
+		DBG_SPAM_printf("ReadIdle -> Closed");
+		file->state = FILE_Closed;
+		return FS_CLOSED;
+	}
+	if (file->requestSeek) {
+		FS_File_ApplySeek(file);
+	}
+
+	if (file->aheadPosition >= file->size || file->dataBufferNumFilled >= FS_NUM_DATA_BUFFERS) {
+		return FS_IDLE;
+	} else if (file->aheadLinks > 0) {
+		DBG_SPAM_printf("ReadIdle -> ReadingFAT");
+		return FS_File_GotoState(file, FILE_ReadingFAT, &FS_File_ProcessReadingFAT);
+	} else {
+		DBG_SPAM_printf("ReadIdle -> ReadingData");
+		return FS_File_GotoState(file, FILE_ReadingData, &FS_File_ProcessReadingData);
+	}
+}
+
+#define FILE_READ_SUB_BEGIN		0	/// Beginning the multiple block read at the current LBA
+#define FILE_READ_SUB_RECEIVE	1	/// Beginning the receive of the next block
+#define FILE_READ_SUB_RECEIVING	2	/// Receiving a block
+#define FILE_READ_SUB_NEXT		3	/// Between blocks, waiting for a free data buffer
+
+/**
+ * Periodically called when reading data blocks ahead from the storage medium.
+ * Blocks are read in one multiple block read for as long as they are
+ * consecutive on the card, which includes following the cluster chain into
+ * the next cluster if it is contiguous and its FAT sector is cached. While
+ * the data buffers are full, the read waits between blocks, keeping the card.
+ * It is terminated when the chain has to be read from the FAT, or when the
+ * file is seeked, held or closed.
+ *
+ * @pre /a file is in the FILE_ReadingData state.
+ * @param file File.
+ * @return Result of the operation.
+ */
+fs_result_t FS_File_ProcessReadingData(FS_File *file) {
+	if (file->state != FILE_ReadingData) {
+		DBG_ERR_printf("File operation failed: file not in the ReadingData state, state is 0x%02x", file->state);
+		return FS_FAILED;
+	}
+	sd_result_t sdresult;
+
+	if (file->subState == FILE_READ_SUB_BEGIN) {
+		DBG_SPAM_printf("Begin data read at LBA %lu", file->currLBA);
+		sdresult = SD_DMA_MBR_Begin(file->fs->card, file->currLBA);
+		if (sdresult != SD_SUCCESS) {
+			DBG_ERR_printf("File operation failed: SD operation error, returned 0x%02x", sdresult);
+			FS_File_GotoStateNoInvoke(file, FILE_ReadIdle, &FS_File_ProcessReadIdle);
+			return FS_PHY_ERR;
+		}
+		file->subState = FILE_READ_SUB_RECEIVE;
+	}
+	if (file->subState == FILE_READ_SUB_RECEIVE || file->subState == FILE_READ_SUB_RECEIVING) {
+		if (file->subState == FILE_READ_SUB_RECEIVE) {
+			DBG_SPAM_printf("Beginning receive block at LBA %lu", file->currLBA);
+			sdresult = SD_DMA_MBR_ReceiveBlock(file->fs->card,
+					&file->fs->card->DataBlocks[file->dataBufferWrite + 1]);
+			file->subState = FILE_READ_SUB_RECEIVING;
+		} else {
+			sdresult = SD_DMA_MBR_GetReceiveBlockResult(file->fs->card);
+		}
+
+		if (sdresult == SD_BUSY) {
+			return FS_BUSY;
+		} else if (sdresult != SD_SUCCESS) {
+			DBG_ERR_printf("Block read failed: LBA %lu, unexpected result from card: 0x%02x", file->currLBA, sdresult);
+			FS_File_GotoStateNoInvoke(file, FILE_TerminatingRead, &FS_File_ProcessTerminatingRead);
+			return FS_PHY_ERR;
+		}
+		DBG_SPAM_printf("Block read");
+
+		file->dataBufferWrite++;
+		if (file->dataBufferWrite >= FS_NUM_DATA_BUFFERS) {
+			file->dataBufferWrite = 0;
+		}
+		file->dataBufferNumFilled++;
+		if (file->dataBufferNumFilled > file->statMaxFilled) {
+			file->statMaxFilled = file->dataBufferNumFilled;
+		}
+		file->aheadPosition += file->dataBufferSize;
+
+		file->currLBA++;
+		file->currLBAClusterOffset++;
+		if (file->currLBAClusterOffset >= file->fs->sectorsPerCluster) {
+			file->currLBAClusterOffset = 0;
+			file->aheadLinks++;
+		}
+		file->subState = FILE_READ_SUB_NEXT;
+	}
+	if (file->subState == FILE_READ_SUB_NEXT) {
+		// Carry on into the next cluster if it follows on, which is known
+		// without using the card if its FAT entry is cached
+		if (file->aheadLinks == 1 && file->aheadPosition < file->size
+				&& file->currFATLBA == GetClusterFATLBA(file->fs, file->currCluster)
+				&& (FATDataToInt32(file->currFATData + GetClusterFATOffset(file->fs, file->currCluster))
+						& 0x0fffffff) == file->currCluster + 1) {
+			file->currCluster++;
+			file->aheadLinks = 0;
+		}
+
+		if (file->requestHold || file->requestClose || file->requestSeek
+				|| file->aheadLinks > 0 || file->aheadPosition >= file->size) {
+			DBG_SPAM_printf("ReadingData -> TerminatingRead");
+			return FS_File_GotoState(file, FILE_TerminatingRead, &FS_File_ProcessTerminatingRead);
+		} else if (file->dataBufferNumFilled >= FS_NUM_DATA_BUFFERS) {
+			return FS_IDLE;
+		}
+		file->subState = FILE_READ_SUB_RECEIVE;
+		return FS_File_ProcessReadingData(file);
+	}
+
+	DBG_ERR_printf("Read data: unexpected substate: 0x%02x", file->subState);
+	return FS_FAILED;
+}
+
+/**
+ * Periodically called when terminating a data read operation.
+ *
+ * @pre /a file is in the FILE_TerminatingRead state.
+ * @param file File.
+ * @return Result of the operation.
+ */
+fs_result_t FS_File_ProcessTerminatingRead(FS_File *file) {
+	if (file->state != FILE_TerminatingRead) {
+		DBG_ERR_printf("File operation failed: file not in the TerminatingRead state, state is 0x%02x", file->state);
+		return FS_FAILED;
+	}
+	sd_result_t sdresult;
+
+	if (file->subState == 0) {
+		sdresult = SD_DMA_MBR_Terminate(file->fs->card);
+		file->subState = 1;
+	} else {
+		sdresult = SD_DMA_MBR_GetTerminateStatus(file->fs->card);
+	}
+
+	if (sdresult == SD_BUSY) {
+		return FS_BUSY;
+	} else if (sdresult == SD_SUCCESS) {
+		DBG_SPAM_printf("Terminate data read");
+		return FS_File_GotoState(file, FILE_ReadIdle, &FS_File_ProcessReadIdle);
+	} else {
+		DBG_ERR_printf("Data read terminate failed: unexpected result from card: 0x%02x", sdresult);
+		FS_File_GotoStateNoInvoke(file, FILE_ReadIdle, &FS_File_ProcessReadIdle);
+		return FS_PHY_ERR;
+	}
+}
+
+/**
+ * Periodically called when following the cluster chain of a file being read.
+ * This follows aheadLinks links from currCluster, reading FAT sectors into the
+ * FAT cache as needed - for a contiguous file, each FAT sector read covers
+ * the next 128 clusters.
+ *
+ * @pre /a file is in the FILE_ReadingFAT state.
+ * @param file File.
+ * @return Result of the operation.
+ */
+fs_result_t FS_File_ProcessReadingFAT(FS_File *file) {
+	if (file->state != FILE_ReadingFAT) {
+		DBG_ERR_printf("File operation failed: file not in the ReadingFAT state, state is 0x%02x", file->state);
+		return FS_FAILED;
+	}
+	sd_result_t sdresult = SD_BUSY;
+	uint32_t nextCluster;
+
+	if (file->subState == 1) {
+		sdresult = SD_DMA_GetSingleBlockReadResult(file->fs->card);
+		if (sdresult == SD_BUSY) {
+			return FS_BUSY;
+		} else if (sdresult != SD_SUCCESS) {
+			DBG_ERR_printf("Read FAT: LBA %lu, unexpected result from card: 0x%02x",
+					GetClusterFATLBA(file->fs, file->currCluster), sdresult);
+			FS_File_GotoStateNoInvoke(file, FILE_ReadIdle, &FS_File_ProcessReadIdle);
+			return FS_PHY_ERR;
+		}
+		memcpy(file->currFATData, file->fsBuffer, file->fs->bytesPerSector);
+		file->currFATLBA = GetClusterFATLBA(file->fs, file->currCluster);
+		file->subState = 0;
+	}
+
+	while (file->aheadLinks > 0) {
+		if (file->currFATLBA != GetClusterFATLBA(file->fs, file->currCluster)) {
+			DBG_SPAM_printf("Read FAT at LBA %lu", GetClusterFATLBA(file->fs, file->currCluster));
+			sdresult = SD_DMA_SingleBlockRead(file->fs->card,
+					GetClusterFATLBA(file->fs, file->currCluster), &file->fs->card->DataBlocks[0]);
+			file->subState = 1;
+			if (sdresult == SD_BUSY) {
+				return FS_BUSY;
+			}
+			DBG_ERR_printf("Read FAT: unexpected result from card: 0x%02x", sdresult);
+			FS_File_GotoStateNoInvoke(file, FILE_ReadIdle, &FS_File_ProcessReadIdle);
+			return FS_PHY_ERR;
+		}
+
+		nextCluster = FATDataToInt32(file->currFATData + GetClusterFATOffset(file->fs, file->currCluster))
+				& 0x0fffffff;
+		if (nextCluster < 2 || nextCluster >= 0x0ffffff8) {
+			// Read no further than the chain goes
+			DBG_ERR_printf("Cluster chain ends early at cluster %lu, 0x%08lx", file->currCluster, nextCluster);
+			file->size = file->aheadPosition;
+			file->aheadLinks = 0;
+			FS_File_GotoStateNoInvoke(file, FILE_ReadIdle, &FS_File_ProcessReadIdle);
+			return FS_FAILED;
+		}
+		file->currCluster = nextCluster;
+		file->aheadLinks--;
+	}
+	file->currLBA = GetClusterLBA(file->fs, file->currCluster) + file->currLBAClusterOffset;
+
+	DBG_SPAM_printf("ReadingFAT -> ReadIdle");
+	return FS_File_GotoState(file, FILE_ReadIdle, &FS_File_ProcessReadIdle);
+}
+
 fs_result_t FS_FileTasks(FS_File *file) {
 	if (file->state == FILE_Idle) {
 		return FS_File_ProcessIdle(file);
@@ -432,6 +965,14 @@ fs_result_t FS_FileTasks(FS_File *file) {
 		return FS_File_ProcessWritingFSInformation(file);
 	} else if (file->state == FILE_WritingDirTable) {
 		return FS_File_ProcessWritingDirTable(file);
+	} else if (file->state == FILE_ReadIdle) {
+		return FS_File_ProcessReadIdle(file);
+	} else if (file->state == FILE_ReadingData) {
+		return FS_File_ProcessReadingData(file);
+	} else if (file->state == FILE_TerminatingRead) {
+		return FS_File_ProcessTerminatingRead(file);
+	} else if (file->state == FILE_ReadingFAT) {
+		return FS_File_ProcessReadingFAT(file);
 	} else if (file->state == FILE_Closed) {
 		return FS_CLOSED;
 	} else {
@@ -444,3 +985,19 @@ fs_result_t FS_FileTasks(FS_File *file) {
 void FS_RequestFileClose(FS_File *file) {
 	file->requestClose = 1;
 }
+
+void FS_RequestFileSync(FS_File *file) {
+	file->requestSync = 1;
+}
+
+void FS_SetFileSyncInterval(FS_File *file, fs_size_t interval) {
+	file->syncInterval = interval;
+}
+
+void FS_HoldFile(FS_File *file, uint8_t hold) {
+	file->requestHold = hold;
+}
+
+uint8_t FS_IsFileHeld(FS_File *file) {
+	return file->requestHold && (file->state == FILE_Idle || file->state == FILE_ReadIdle);
+}
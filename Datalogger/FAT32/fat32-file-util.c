@@ -8,6 +8,10 @@
  * Date			Author	Change
  * 30 Jul 2011	Ducky	Initial implementation.
  * 08 Aug 2011	Ducky	Removed the special beginning FAT allocation function.
+ * 17 Oct 2026	agent	Multiple-sector cluster preallocation, trimmed on close.
+ * 17 Oct 2026	agent	Directory entry size is the size written to disk.
+ * 17 Oct 2026	agent	Runs limited to, and claimed from, the free extent map.
+ * 17 Oct 2026	agent	Runs of free clusters in partly used FAT sectors.
  *
  * @file
  * Utility functions for optimized FAT32 file operations.
@@ -18,6 +22,7 @@
 
 #include "fat32-file.h"
 #include "fat32-util.h"
+#include "fat32-freemap.h"
 
 void FAT32_WriteDirectoryTableEntry(FS_File *file, uint8_t *data) {
 	uint8_t i=0;
@@ -54,18 +59,28 @@ void FAT32_WriteDirectoryTableEntry(FS_File *file, uint8_t *data) {
 }
 
 void FAT32_UpdateDirectoryTableEntry(FS_File *file, uint8_t *data) {
-	Int32ToFATData(data + file->dirTableBlockOffset + 0x1c, file->size);
+	Int32ToFATData(data + file->dirTableBlockOffset + 0x1c, file->position);
 }
 
 void FAT32_AllocateFATBlock(FS_File *file, uint8_t *data) {
 	uint32_t currCluster = file->currCluster;
 	uint16_t pos = GetClusterFATOffset(file->fs, currCluster);
+	uint16_t end = file->fs->bytesPerSector;
+	fs_addr_t fatEnd = file->fs->FAT_LBA_Begin + file->fs->sectorsPerFAT;
+	uint8_t partial = file->fatRunEndLBA == 0 && file->fs->freeMapState == FS_FREEMAP_CLUSTERS;
 
-	file->fs->numFreeClusters -= (file->fs->bytesPerSector - pos) /
-			file->fs->clusterPointerSize;
+	if (file->fatRunEndLBA != 0) {
+		fatEnd = file->fatRunEndLBA;
+	}
+	if (partial) {
+		// The sector is partly used, so only the free clusters found are taken
+		end = pos + file->fs->freeMapClusterLength * file->fs->clusterPointerSize;
+	}
+
+	file->fs->numFreeClusters -= (end - pos) / file->fs->clusterPointerSize;
 	file->currFATLBA = GetClusterFATLBA(file->fs, currCluster);
 	
-	for (;pos<file->fs->bytesPerSector;pos+=file->fs->clusterPointerSize) {
+	for (;pos<end;pos+=file->fs->clusterPointerSize) {
 		currCluster++;
 		Int32ToFATData(data+pos, currCluster);
 	}
@@ -76,15 +91,66 @@ void FAT32_AllocateFATBlock(FS_File *file, uint8_t *data) {
 	file->currFATClusterEnd = currCluster;
 	file->fs->mostRecentCluster = currCluster;
 	file->fs->fsInfoDirty = 1;
+	FAT32_FreeMapClaim(file->fs, file->currFATLBA);
+
+	// Preallocate following whole sectors, up to the end of the free space
+	file->fatFillLBA = file->currFATLBA + 1;
+	file->fatFillSectors = FS_PREALLOC_FAT_SECTORS - 1;
+	if (partial) {
+		file->fatFillSectors = 0;
+	} else if (file->fatFillLBA + file->fatFillSectors > fatEnd) {
+		file->fatFillSectors = fatEnd - file->fatFillLBA;
+	}
+
+	// The next cluster isn't free, so end the chain rather than point at it
+	if (partial || (file->fatFillSectors == 0 && file->fatFillLBA == file->fatRunEndLBA)) {
+		Int32ToFATData(data+pos, FAT32_CLUSTER_EOC);
+	}
+}
+
+void FAT32_ExtendFATBlock(FS_File *file, uint8_t *data) {
+	uint32_t currCluster = file->currFATClusterEnd;
+	uint16_t pos;
+
+	for (pos=0;pos<file->fs->bytesPerSector;pos+=file->fs->clusterPointerSize) {
+		currCluster++;
+		Int32ToFATData(data+pos, currCluster + 1);
+	}
+	pos -= file->fs->clusterPointerSize;
+
+	file->fs->numFreeClusters -= file->fs->bytesPerSector / file->fs->clusterPointerSize;
+	file->currFATLBA = file->fatFillLBA;
+	file->currFATBlockOffset = pos;
+	file->currFATClusterEnd = currCluster;
+	file->fs->mostRecentCluster = currCluster;
+	file->fs->fsInfoDirty = 1;
+	FAT32_FreeMapClaim(file->fs, file->fatFillLBA);
+
+	// The next cluster isn't free, so end the chain rather than point at it
+	if (file->fatFillSectors == 1 && file->fatFillLBA + 1 == file->fatRunEndLBA) {
+		Int32ToFATData(data+pos, FAT32_CLUSTER_EOC);
+	}
 }
 
 void FAT32_TerminateFATBlock(FS_File *file, uint8_t *data) {
 	uint32_t currCluster = file->currCluster;
 	uint16_t pos = GetClusterFATOffset(file->fs, currCluster);
-	uint16_t end = GetClusterFATOffset(file->fs, file->currFATClusterEnd);
+	uint16_t end = file->fs->bytesPerSector - file->fs->clusterPointerSize;
+	fs_addr_t endLBA = GetClusterFATLBA(file->fs, file->currFATClusterEnd);
 
-	file->fs->numFreeClusters -= (end - pos) / file->fs->clusterPointerSize;
 	file->currFATLBA = GetClusterFATLBA(file->fs, currCluster);
+	if (endLBA == file->currFATLBA) {
+		end = GetClusterFATOffset(file->fs, file->currFATClusterEnd);
+	}
+
+	// Whole sectors past this one were preallocated and need to be freed too
+	file->fatFillLBA = file->currFATLBA + 1;
+	file->fatFillSectors = endLBA - file->currFATLBA;
+	FAT32_FreeMapRelease(file->fs, file->fatFillLBA, file->fatFillSectors);
+
+	file->fs->numFreeClusters += (end - pos) / file->fs->clusterPointerSize
+			+ (uint32_t)file->fatFillSectors
+			* (file->fs->bytesPerSector / file->fs->clusterPointerSize);
 
 	Int32ToFATData(data+pos, FAT32_CLUSTER_EOC);
 	file->currFATClusterEnd = FAT32_CLUSTER_EOC;
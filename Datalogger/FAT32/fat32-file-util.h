@@ -7,6 +7,9 @@
  * Revision History
  * Date			Author	Change
  * 30 Jul 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Runs limited to the free extent map.
+ * 17 Oct 2026	agent	File struct initialization, shared with opening files.
+ * 17 Oct 2026	agent	Runs of free clusters in partly used FAT sectors.
  *
  * @file
  * Utility functions for optimized FAT32 file operations.
@@ -18,6 +21,14 @@
 #include "fat32.h"
 #include "fat32-file.h"
 
+/**
+ * Initializes the non-filesystem dependent portions of a file struct, for
+ * both files being created and files being opened.
+ *
+ * @param file File structure to initialize, with the filesystem set.
+ */
+void FAT32_InitializeEmptyFileStruct(FS_File *file);
+
 /**
  * Writes the directory table entry for the file.
  *
@@ -29,6 +40,8 @@ void FAT32_WriteDirectoryTableEntry(FS_File *file, uint8_t *data);
 
 /**
  * Updates the file's directory table entry with current paramters like size.
+ * The size is that of the data written to disk, so the entry is consistent
+ * with the disk contents if written before the file is closed.
  *
  * @param file File structure.
  * @param data Data block of the sector containing the directory table.
@@ -41,6 +54,13 @@ void FAT32_UpdateDirectoryTableEntry(FS_File *file, uint8_t *data);
  * This then updates then file's FAT LBA pointers, the new last allocated
  * cluster, and the FS Information Sector's number of free clusters and
  * most recently allocated cluster.
+ * This also sets up the file to preallocate up to FS_PREALLOC_FAT_SECTORS - 1
+ * following whole FAT sectors using FAT32_ExtendFATBlock, within the known free
+ * sectors ending at the file's fatRunEndLBA, if set. If the run reaches
+ * fatRunEndLBA, its last cluster is the end of the chain until the file is
+ * allocated more clusters.
+ * When the free extent map has no free sectors left, only the run of free
+ * clusters it found in this sector is allocated, ending the chain.
  *
  * @param file File struct.
  * @param data Data block of the sector containing the FAT entry.
@@ -48,9 +68,24 @@ void FAT32_UpdateDirectoryTableEntry(FS_File *file, uint8_t *data);
 void FAT32_AllocateFATBlock(FS_File *file, uint8_t *data);
 
 /**
- * Terminates the FAT block at the file's current cluster.
+ * Generates the next whole sector of FAT data for a preallocated run,
+ * continuing the cluster chain from the file's last allocated cluster.
+ * This updates the same file and FS Information Sector variables as
+ * FAT32_AllocateFATBlock.
+ *
+ * @param file File struct.
+ * @param data Data block to fill, to be written to the sector at the file's
+ * fatFillLBA.
+ */
+void FAT32_ExtendFATBlock(FS_File *file, uint8_t *data);
+
+/**
+ * Terminates the FAT block at the file's current cluster, freeing the rest of
+ * the allocated run in that sector.
  * This updates the file's last allocated cluster, the FS Information Sector's
- * number of free clusters, and most recently allocated cluster
+ * number of free clusters, and most recently allocated cluster.
+ * If the run extended into following sectors, the file's fatFillLBA and
+ * fatFillSectors are set to the whole sectors which must be cleared.
  *
  * @param file File struct.
  * @param data Data block of the sector containing the FAT entry.
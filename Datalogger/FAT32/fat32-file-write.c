@@ -7,6 +7,7 @@
  * Revision History
  * Date			Author	Change
  * 07 Arg 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Added in-place reserve/commit.
  *
  * @file
  * File write and buffering code.
@@ -23,6 +24,41 @@
 
 #include "fat32-file.h"
 
+/**
+ * Accounts for data placed into the current data buffer, advancing to the next
+ * data buffer if the current one is full.
+ * @param file File written to.
+ * @param dataLen Number of bytes placed into the current data buffer.
+ */
+static inline void FS_File_AdvanceDataBuffer(FS_File *file, fs_length_t dataLen) {
+	file->dataBufferPos += dataLen;
+	// Advance buffer if necessary
+	if (file->dataBufferPos >= file->dataBufferSize) {
+		file->dataBufferFill++;
+		if (file->dataBufferFill == FS_NUM_DATA_BUFFERS) {
+			file->dataBufferFill = 0;
+		}
+		file->dataBufferNumFilled++;
+		file->dataBufferPos = 0;
+
+		if (file->dataBufferNumFilled > file->statMaxFilled) {
+			file->statMaxFilled = file->dataBufferNumFilled;
+		}
+	}
+}
+
+/**
+ * Updates the pipeline stall statistics after an intake attempt.
+ * @param file File written to.
+ * @param stalled Whether the attempt was refused because all buffers are full.
+ */
+static inline void FS_File_UpdateStallStats(FS_File *file, uint8_t stalled) {
+	if (stalled && !file->statStalled) {
+		file->statStalls++;
+	}
+	file->statStalled = stalled;
+}
+
 fs_length_t FS_WriteFile(FS_File *file, uint8_t *data, fs_length_t dataLen) {
 	fs_length_t dataLeft = dataLen;
 
@@ -48,18 +84,32 @@ fs_length_t FS_WriteFile(FS_File *file, uint8_t *data, fs_length_t dataLen) {
 		dataLeft -= blockDataLen;
 		data += blockDataLen;
 
-		file->dataBufferPos += blockDataLen;
-		// Advance buffer if necessary
-		if (file->dataBufferPos >= file->dataBufferSize) {
-			file->dataBufferFill++;
-			if (file->dataBufferFill == FS_NUM_DATA_BUFFERS) {
-				file->dataBufferFill = 0;
-			}
-			file->dataBufferNumFilled++;
-			file->dataBufferPos = 0;
-		}
+		FS_File_AdvanceDataBuffer(file, blockDataLen);
 	}
 	file->size += dataLen - dataLeft;
+	FS_File_UpdateStallStats(file, dataLeft > 0);
 
 	return dataLen - dataLeft;
 }
+
+uint8_t* FS_ReserveFile(FS_File *file, fs_length_t dataLen) {
+	if (file->requestClose) {
+		return NULL;
+	}
+	if (file->dataBufferNumFilled >= FS_NUM_DATA_BUFFERS) {
+		FS_File_UpdateStallStats(file, 1);
+		return NULL;
+	}
+	FS_File_UpdateStallStats(file, 0);
+	if (dataLen > file->dataBufferSize - file->dataBufferPos) {
+		return NULL;
+	}
+	return file->dataBuffer[file->dataBufferFill] + file->dataBufferPos;
+}
+
+void FS_CommitFile(FS_File *file, fs_length_t dataLen) {
+	DBG_SPAM_printf("Committing %u in place to file buffer", dataLen);
+
+	FS_File_AdvanceDataBuffer(file, dataLen);
+	file->size += dataLen;
+}
@@ -7,6 +7,13 @@
  * Revision History
  * Date			Author	Change
  * 29 Jul 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Periodic sync points.
+ * 17 Oct 2026	agent	Holding a file, so other files can be created while it is open.
+ * 17 Oct 2026	agent	Allocation from the free extent map.
+ * 17 Oct 2026	agent	Opening and reading files, with read-ahead.
+ * 17 Oct 2026	agent	Read-ahead with multiple block reads.
+ * 17 Oct 2026	agent	Sector caches shared between files.
+ * 17 Oct 2026	agent	Opening files past the directory's first cluster.
  *
  * @file
  * File operations for the FAT32 filesystem.
@@ -32,11 +39,68 @@ typedef enum {
 	FILE_WritingFSInformation,		/// Writing (updating) the FS Information sector
 	FILE_WritingDirTable,			/// Writing (updating) the FS Information sector
 
+	FILE_Opening,					/// File being opened for reading
+
+	FILE_ReadIdle,					/// File open for reading, with no blocks currently being read
+	FILE_ReadingData,				/// Reading data blocks ahead into the data buffers, in a multiple block read
+	FILE_TerminatingRead,			/// Terminating the MBR operation
+	FILE_ReadingFAT,				/// Reading the FAT to follow the cluster chain
+
 	FILE_Closed,					/// File is closed
 } FileState;
 
-#define FS_NUM_DATA_BUFFERS	2
+/**
+ * Write pipeline depth, the number of data blocks which can be filled while
+ * the card is busy, and for files opened for reading, the read-ahead window,
+ * the number of data blocks read from the card before they are needed.
+ * Each buffer is one SD Card DMA data block (block 0 is the filesystem
+ * buffer), so this defaults to, and can be at most, SD_NUM_DATA_BLOCKS - 1.
+ * This can be overridden in the project options.
+ */
+#ifndef FS_NUM_DATA_BUFFERS
+	#define FS_NUM_DATA_BUFFERS	(SD_NUM_DATA_BLOCKS - 1)
+#endif
+#if FS_NUM_DATA_BUFFERS > SD_NUM_DATA_BLOCKS - 1
+	#error "FS_NUM_DATA_BUFFERS needs more SD data blocks than SD_NUM_DATA_BLOCKS provides"
+#endif
 #define FS_SECTOR_SIZE		512
+
+/**
+ * Number of FAT sectors to claim at once when a file runs out of allocated
+ * clusters. Each FAT sector holds 128 clusters, and the multiple block write
+ * stays open across the whole run, so larger values mean fewer stop-tran / FAT
+ * write interruptions at the cost of more trimming work on close.
+ * Unused clusters are freed when the file is closed.
+ */
+#ifndef FS_PREALLOC_FAT_SECTORS
+	#define FS_PREALLOC_FAT_SECTORS	8
+#endif
+
+/**
+ * Default number of bytes written to disk between sync points, where the
+ * multiple block write is stopped to commit the file's directory entry size
+ * (and the FS Information Sector, if changed). On a power loss, the file
+ * reads back as it was at the last sync point, so this bounds the data lost,
+ * at the cost of a stop-tran and a directory write per sync.
+ * A sync is also done early, at half the interval, whenever the multiple block
+ * write is stopped anyway for a FAT allocation.
+ * 0 disables periodic syncs, so the size is only committed on close.
+ * This can be changed per file with FS_SetFileSyncInterval.
+ */
+#ifndef FS_SYNC_INTERVAL
+	#define FS_SYNC_INTERVAL	((fs_size_t)256 * 1024)
+#endif
+/**
+ * Sector caches used by a file while it is being written or read. Files which
+ * are never written at the same time, like the current file and the next file
+ * created ahead of rotation, can share one set of caches, as a file only
+ * trusts them once it has started writing or reading.
+ */
+typedef struct {
+	uint8_t dirTableBlock[FS_SECTOR_SIZE];	/// Cache for the directory table block.
+	uint8_t fatBlock[FS_SECTOR_SIZE];		/// Cache for the FAT block containing the current position.
+} FS_FileCache;
+
 /**
  * Holds data for files specific to optimizing large contigious writes.
  */
@@ -54,52 +118,93 @@ typedef struct {
 	FileState state;					/// What the file is doing.
 	uint8_t subState;					/// File substate.
 	uint8_t requestClose;				/// Whether the file should close.
+	uint8_t requestHold;				/// Whether the file should stop at the next block boundary and leave the card free.
+	uint8_t requestSeek;				/// For reading, whether the read position should move to seekPosition.
+	fs_size_t seekPosition;				/// For reading, requested read position.
 
 	/* Directory entry variables
 	 */
 	FS_Directory *dir;					/// Directory this file is in.
 	
-	uint8_t dirTableBlockData[FS_SECTOR_SIZE];		/// Cache for the directory table block.
+	uint8_t *dirTableBlockData;			/// Cache for the directory table block, see FS_SetFileCache.
 	uint32_t dirTableCluster;			/// Cluster of the directory table entry containing this file.
 	fs_addr_t dirTableLBA;				/// Block address of the directory table entry containing this file.
 	uint8_t dirTableLBAClusterOffset;	/// LBA offset of the directory table block from the beginning of the cluster.
 	uint16_t dirTableBlockOffset;		/// Byte offset (from block beginning) of the directory table entry containing this file.
 	uint8_t dirTableDirty;				/// Whether the directory table has been changed and needs to be committed to disk.
+	uint8_t dirTableReload;				/// Whether the directory table cache may be stale and must be read back before the next write.
+
+	/* Sync point variables
+	 */
+	fs_size_t syncInterval;				/// Bytes written between sync points, 0 for none.
+	fs_size_t syncPosition;				/// File size committed to the directory entry at the last sync point.
+	uint8_t requestSync;				/// Whether a sync point was requested.
 
 	/* File allocation table caches
 	 * Caching is required in case the last data block needs to be changed
 	 * without reading data from the disk.
 	 */
-	uint8_t currFATDataAlloc[FS_SECTOR_SIZE];		/// This actually allocates the cache.
-	uint8_t *currFATData;				/// Cache for the FAT block containing the current position.
+	uint8_t *currFATData;				/// Cache for the FAT block containing the current position, see FS_SetFileCache.
 	fs_addr_t currFATLBA;				/// Block address of the FAT block containing the current position.
 	uint16_t currFATBlockOffset;		/// Byte offset in currFATData containing the last cluster entry of the file.
 
-	uint32_t currFATClusterEnd;			/// Last cluster allocated in currFATData. This will be equal to FAT32_CLUSTER_EOC if the file's FAT has terminated.
+	uint32_t currFATClusterEnd;			/// Last cluster allocated in the current run, which may extend past currFATData. This will be equal to FAT32_CLUSTER_EOC if the file's FAT has terminated.
+
+	uint8_t fatTerminate;				/// Whether the FAT operation in progress is a termination (as opposed to an allocation).
+	fs_addr_t fatFillLBA;				/// Next whole FAT sector to be written as part of the FAT operation in progress.
+	uint16_t fatFillSectors;			/// Number of whole FAT sectors left to be written - chained when allocating, cleared when terminating.
+	fs_addr_t fatRunEndLBA;				/// FAT LBA past the known free sectors the current run is allocated in, 0 if not known (no free extent map).
 
 	/* File allocation variables
 	 */
 	uint32_t startCluster;				/// Starting cluster number of the file.
-	fs_size_t position;					/// Size of the data committed to disk.
+	fs_size_t position;					/// Size of the data committed to disk. For reading, the read position.
 	fs_size_t size;						/// Allocated size of the file, in bytes. This should be consistent with the number of allocated clusters
 										/// and should be committed to disk when the clusters are alloated.
+										/// For reading, the size in the directory entry.
 
 	uint32_t currCluster;				/// Cluster number of the cluster containing the current byte position.
-	fs_addr_t currLBA;					/// Block number of the next block to be written.
+	fs_addr_t currLBA;					/// Block number of the next block to be written (or read).
 	uint8_t currLBAClusterOffset;		/// Block offset from the beginning of the current cluster.
+
+	/* Read-ahead variables
+	 * The data buffers hold the blocks between the read position and
+	 * aheadPosition, the block at the read position being the one at
+	 * dataBufferFill, and dataBufferWrite is the next one read from the card.
+	 */
+	fs_size_t aheadPosition;			/// File offset of the next block to be read from the card.
+	uint32_t aheadLinks;				/// Cluster chain links to follow from currCluster before the next block can be read.
 	
 	/* Data buffering variables
 	 */
 	fs_length_t dataBufferSize;				/// Size, in bytes, of each data buffer. This is storage-medium dependent.
-	uint8_t *dataBuffer[FS_NUM_DATA_BUFFERS];	/// Dual DMA buffers holding data to be written to disk.
+	uint8_t *dataBuffer[FS_NUM_DATA_BUFFERS];	/// DMA buffers holding data to be written to disk.
 	uint8_t dataBufferWrite;				/// The next DMA buffer to be written to disk.
 	uint8_t dataBufferFill;					/// The data buffer being filled with user data.
 	uint8_t dataBufferNumFilled;			/// Number of completely filled data buffers.
 	uint16_t dataBufferPos;					/// Next byte in the data buffer that is to be filled with user data.
 
 	uint8_t *fsBuffer;						/// DMA buffer holding filesystem information to be written to disk.
+
+	/* Pipeline statistics, these may be reset by the user at any time
+	 */
+	uint8_t statMaxFilled;					/// Highest number of data buffers simultaneously filled.
+	uint16_t statStalls;					/// Number of times intake stalled because every data buffer was filled.
+	uint8_t statStalled;					/// Whether intake is currently stalled.
+	uint16_t statSyncs;						/// Number of directory entry writes.
+	uint16_t statReadStalls;				/// Number of times a read found no data read ahead.
 } FS_File;
 
+/**
+ * Sets the sector caches used by a file. This must be done once before the
+ * file is first created or opened, and the caches are kept across files.
+ *
+ * @param file[in,out] File struct.
+ * @param cache[in] Caches to use, which may be shared with other files which
+ * are never written or read at the same time.
+ */
+void FS_SetFileCache(FS_File *file, FS_FileCache *cache);
+
 /**
  * Creates and opens a file. This allocates a block for the file in FAT
  * (updating the FS information sector in the process), and writes the directory
@@ -173,13 +278,99 @@ fs_result_t FS_GetCreateFileResult(FS_File *file);
  */
 fs_length_t FS_WriteFile(FS_File *file, uint8_t *data, fs_length_t dataLen);
 
+/**
+ * Reserves space in the current data buffer so data can be generated directly
+ * in the DMA buffer, with no intermediate copy. The space is not part of the
+ * file until FS_CommitFile is called.
+ * Only space within the current block can be reserved - if the data would
+ * cross a block boundary, use FS_WriteFile.
+ *
+ * @param file File to write to.
+ * @param dataLen Length of the data, in bytes, to reserve.
+ * @return Pointer to write the data to, or NULL if the space is not available
+ * (either the buffers are full or the data would cross a block boundary).
+ */
+uint8_t* FS_ReserveFile(FS_File *file, fs_length_t dataLen);
+
+/**
+ * Commits data written into space returned by FS_ReserveFile.
+ *
+ * @param file File to write to.
+ * @param dataLen Length of the data, in bytes, to commit. This may be less than
+ * the reserved length.
+ */
+void FS_CommitFile(FS_File *file, fs_length_t dataLen);
+
+/**
+ * Opens an existing file for reading. This looks the file up in the directory
+ * table, after which the file can be read with FS_ReadFile, while FS_FileTasks
+ * reads the following blocks ahead in the background.
+ * The whole directory is searched, following its cluster chain through the FAT.
+ *
+ * @param fs[in] FAT32 filesystem containing the file.
+ * @param dir[in] Directory containing the file.
+ * @param file[in,out] File struct which will be used for this file.
+ * @param name[in] File name, in 8.3 format.
+ * @param ext[in] File extension, in 8.3 format.
+ * @return Status of the operation.
+ * @retval FS_SUCCESS Operation complete, file is ready for reading.
+ * @retval FS_BUSY Operation in progress, continuing in the background.
+ * @retval FS_OPEN_NOT_FOUND No file with that name.
+ * @retval FS_PHY_ERR Storage medium access error.
+ * @retval FS_FAILED General failure.
+ */
+fs_result_t FS_OpenFile(FS_FAT32 *fs, FS_Directory *dir, FS_File *file, char *name, char *ext);
+#define FS_OPEN_NOT_FOUND			0x10	/// No file with that name
+
+/**
+ * Gets the result of the current file open operation in progress.
+ * This should be called periodically until success is returned.
+ *
+ * @param file File being opened.
+ * @return Status of the operation, as FS_OpenFile.
+ */
+fs_result_t FS_GetOpenFileResult(FS_File *file);
+
+/**
+ * Reads data from a file opened for reading.
+ * More correctly, this copies out data already read ahead from the card by
+ * FS_FileTasks, which should be called in between.
+ *
+ * @param file File to read from.
+ * @param data Buffer to read into.
+ * @param dataLen Length of the data, in bytes, to read.
+ * @return Number of bytes read. This may be less than /a dataLen, or 0, if
+ * the data hasn't been read from the card yet, or the end of the file was
+ * reached (when the file's position equals its size).
+ */
+fs_length_t FS_ReadFile(FS_File *file, uint8_t *data, fs_length_t dataLen);
+
+/**
+ * Moves the read position of a file opened for reading. Data already read
+ * ahead is kept if the new position is within it, otherwise the read-ahead
+ * starts over at the new position, following the cluster chain from the
+ * current cluster, or from the beginning of the file if seeking backwards.
+ * The seek is done by FS_FileTasks, and FS_ReadFile returns no data until then.
+ *
+ * @param file File.
+ * @param position New read position, in bytes from the beginning of the file.
+ * @return Status.
+ * @retval FS_SUCCESS Seek requested.
+ * @retval FS_FAILED The position is past the end of the file, or the file
+ * isn't open for reading.
+ */
+fs_result_t FS_Seek(FS_File *file, fs_size_t position);
+
 /**
  * This should be periodically called on a file being written. This handles
  * tasks like sending blocks to the storage medium.
+ * For a file opened for reading, this reads blocks ahead of the read position
+ * while there are free data buffers, following the cluster chain.
  *
  * @return Status.
  * @retval FS_IDLE File is idle, no blocks are being sent to the storage medium
- * because not enough data is available for a write yet.
+ * because not enough data is available for a write yet, or for reading,
+ * because the read-ahead window is full or the end of the file was reached.
  * @retval FS_BUSY File is busy.
  * @retval FS_PHY_ERR Storage medium access error. File may be corrupt.
  * @retval FS_CLOSED File closed.
@@ -194,4 +385,44 @@ fs_result_t FS_FileTasks(FS_File *file);
  */
 void FS_RequestFileClose(FS_File *file);
 
+/**
+ * Requests a sync point at the next block boundary, committing the size of
+ * the data written to disk so far to the directory entry. Data still in the
+ * partially filled block is not included.
+ * Useful for syncing on a time budget when data is written slowly.
+ *
+ * @param file File to sync.
+ */
+void FS_RequestFileSync(FS_File *file);
+
+/**
+ * Sets the number of bytes written between sync points, replacing the
+ * FS_SYNC_INTERVAL default.
+ *
+ * @param file File.
+ * @param interval Bytes between sync points, 0 to only commit the size on close.
+ */
+void FS_SetFileSyncInterval(FS_File *file, fs_size_t interval);
+
+/**
+ * Requests that a file stop writing at the next block boundary, terminating
+ * the multiple block write, so the card is free for other operations, like
+ * creating another file, while this file stays open. Data is still accepted
+ * into the file's buffers while held, until they fill. Everything else the
+ * file needs to do, including closing, waits until the file is released.
+ * A file opened for reading stops reading ahead after the block in progress.
+ *
+ * @param file File.
+ * @param hold Whether to hold the file (1) or resume writing (0).
+ */
+void FS_HoldFile(FS_File *file, uint8_t hold);
+
+/**
+ * Checks whether a held file has stopped, leaving the card free.
+ *
+ * @param file File.
+ * @return Whether the file is held and no card operation is in progress.
+ */
+uint8_t FS_IsFileHeld(FS_File *file);
+
 #endif
@@ -0,0 +1,416 @@
+/*
+ * File:   fat32-freemap.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 6:20 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Largest free extent lookup.
+ * 17 Oct 2026	agent	Free cluster runs in partly used FAT sectors.
+ *
+ * @file
+ * Free extent map for the FAT32 filesystem.
+ */
+
+#include "fat32-freemap.h"
+#include "fat32-util.h"
+
+#define DEBUG_UART
+#define DEBUG_UART_DATA
+#define DBG_MODULE "FAT32/FreeMap"
+#include "../debug-common.h"
+#include "../debug-log.h"
+
+/**
+ * Adds a free extent to the map. If the map is full, this replaces the
+ * smallest extent, if the new one is larger, and the one left out is
+ * remembered so the FAT is scanned again once the map runs out.
+ *
+ * @param fs Filesystem.
+ * @param start First free FAT sector.
+ * @param length Number of free FAT sectors.
+ */
+static void FAT32_FreeMapAdd(FS_FAT32 *fs, uint32_t start, uint32_t length) {
+	uint8_t i, smallest = 0;
+
+	if (length == 0) {
+		return;
+	}
+	if (fs->numFreeExtents < FS_FREEMAP_EXTENTS) {
+		smallest = fs->numFreeExtents;
+		fs->numFreeExtents++;
+	} else {
+		for (i=1;i<FS_FREEMAP_EXTENTS;i++) {
+			if (fs->freeExtents[i].length < fs->freeExtents[smallest].length) {
+				smallest = i;
+			}
+		}
+		fs->freeMapDropped = 1;
+		if (length <= fs->freeExtents[smallest].length) {
+			return;
+		}
+	}
+	fs->freeExtents[smallest].start = start;
+	fs->freeExtents[smallest].length = length;
+}
+
+/**
+ * Finds whether a FAT sector is known to be free.
+ *
+ * @param fs Filesystem.
+ * @param sector FAT sector.
+ * @param[out] end Set to the sector past the end of the free sectors it is in.
+ * @return Whether the sector is known to be free.
+ */
+static uint8_t FAT32_FreeMapFind(FS_FAT32 *fs, uint32_t sector, uint32_t *end) {
+	uint8_t i;
+
+	for (i=0;i<fs->numFreeExtents;i++) {
+		if (sector >= fs->freeExtents[i].start
+				&& sector - fs->freeExtents[i].start < fs->freeExtents[i].length) {
+			*end = fs->freeExtents[i].start + fs->freeExtents[i].length;
+			return 1;
+		}
+	}
+	if (fs->freeMapState == FS_FREEMAP_SCANNING
+			&& sector >= fs->freeMapRunStart && sector < fs->freeMapScanSector) {
+		*end = fs->freeMapScanSector;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Finds the largest known run of free FAT sectors, including the run in
+ * progress at the scan position.
+ *
+ * @param fs Filesystem.
+ * @param[out] start Set to the first sector of the run.
+ * @return Number of sectors in the run, 0 if none are known.
+ */
+static uint32_t FAT32_FreeMapLargest(FS_FAT32 *fs, uint32_t *start) {
+	uint32_t length = 0;
+	uint8_t i;
+
+	for (i=0;i<fs->numFreeExtents;i++) {
+		if (fs->freeExtents[i].length > length) {
+			*start = fs->freeExtents[i].start;
+			length = fs->freeExtents[i].length;
+		}
+	}
+	if (fs->freeMapState == FS_FREEMAP_SCANNING
+			&& fs->freeMapScanSector - fs->freeMapRunStart > length) {
+		*start = fs->freeMapRunStart;
+		length = fs->freeMapScanSector - fs->freeMapRunStart;
+	}
+	return length;
+}
+
+/**
+ * @param fs Filesystem.
+ * @param data Data of a FAT sector.
+ * @return Whether every cluster in the FAT sector is free.
+ */
+static uint8_t FAT32_IsFATSectorFree(FS_FAT32 *fs, uint8_t *data) {
+	uint16_t pos;
+
+	for (pos=0;pos<fs->bytesPerSector;pos+=fs->clusterPointerSize) {
+		if ((FATDataToInt32(data+pos) & 0x0fffffff) != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Starts searching partly used FAT sectors for a run of free clusters, once
+ * there are no free FAT sectors left.
+ *
+ * @param fs Filesystem.
+ * @param cluster Cluster to search on from.
+ */
+static void FAT32_FreeMapBeginClusters(FS_FAT32 *fs, uint32_t cluster) {
+	DBG_DATA_printf("No free FAT sectors left, searching for free clusters");
+	fs->freeMapState = FS_FREEMAP_CLUSTERS;
+	fs->freeMapReading = 0;
+	fs->freeMapClusterNext = cluster;
+	fs->freeMapClusterLength = 0;
+	fs->freeMapClusterSearched = 0;
+}
+
+/**
+ * Searches the next FAT sector for a run of free clusters, from
+ * freeMapClusterNext on, wrapping around at the end of the FAT.
+ *
+ * @param fs Filesystem.
+ * @return Result, as FAT32_FreeMapTasks.
+ */
+static fs_result_t FAT32_FreeMapClusterTasks(FS_FAT32 *fs) {
+	uint16_t clustersPerSector = GetClustersPerBlock(fs);
+	uint32_t numEntries = fs->numClusters + 2;
+	sd_result_t result = SD_BUSY;
+	uint32_t sector;
+	uint16_t pos, end;
+	uint8_t *data;
+
+	if (fs->freeMapClusterLength != 0) {
+		return FS_SUCCESS;
+	}
+
+	if (fs->freeMapClusterNext >= numEntries) {
+		fs->freeMapClusterNext = 0;
+	}
+	sector = fs->freeMapClusterNext / clustersPerSector;
+	if (!fs->freeMapReading) {
+		result = SD_DMA_SingleBlockRead(fs->card,
+				fs->FAT_LBA_Begin + sector, &fs->card->DataBlocks[0]);
+		fs->freeMapReading = 1;
+	}
+	if (result == SD_BUSY) {
+		result = SD_DMA_GetSingleBlockReadResult(fs->card);
+	}
+	if (result == SD_BUSY) {
+		return FS_BUSY;
+	}
+	fs->freeMapReading = 0;
+
+	if (result != SD_SUCCESS) {
+		DBG_ERR_printf("Read FAT: LBA %lu, unexpected result from card: 0x%02x",
+				fs->FAT_LBA_Begin + sector, result);
+		fs->freeMapState = FS_FREEMAP_READY;
+		return FS_PHY_ERR;
+	}
+
+	// Clusters 0 and 1 are reserved, and their entries are never 0, and the
+	// last sector may have entries past the last cluster, which look free
+	data = fs->card->DataBlocks[0].Data + 2;
+	pos = (fs->freeMapClusterNext % clustersPerSector) * fs->clusterPointerSize;
+	end = fs->bytesPerSector;
+	if ((sector + 1) * clustersPerSector > numEntries) {
+		end = (numEntries - sector * clustersPerSector) * fs->clusterPointerSize;
+	}
+	for (;pos<end;pos+=fs->clusterPointerSize) {
+		if ((FATDataToInt32(data+pos) & 0x0fffffff) == 0) {
+			if (fs->freeMapClusterLength == 0) {
+				fs->freeMapClusterStart = sector * clustersPerSector + pos / fs->clusterPointerSize;
+			}
+			fs->freeMapClusterLength++;
+		} else if (fs->freeMapClusterLength != 0) {
+			break;
+		}
+	}
+	if (fs->freeMapClusterLength != 0) {
+		DBG_SPAM_printf("Free clusters %lu, %u long", fs->freeMapClusterStart, fs->freeMapClusterLength);
+		fs->freeMapClusterSearched = 0;
+		return FS_SUCCESS;
+	}
+
+	fs->freeMapClusterNext = (sector + 1) * clustersPerSector;
+	fs->freeMapClusterSearched++;
+	if (fs->freeMapClusterSearched > (numEntries - 1) / clustersPerSector + 1) {
+		// Every sector has been searched, including the start of the first one
+		DBG_DATA_printf("No free clusters left");
+		fs->freeMapState = FS_FREEMAP_READY;
+		return FS_SUCCESS;
+	}
+	return FS_IDLE;
+}
+
+void FAT32_BeginFreeMap(FS_FAT32 *fs) {
+	fs->freeMapState = FS_FREEMAP_SCANNING;
+	fs->freeMapReading = 0;
+	fs->freeMapScanSector = 0;
+	fs->freeMapRunStart = 0;
+	fs->numFreeExtents = 0;
+	fs->freeMapDropped = 0;
+	fs->freeMapClusterLength = 0;
+
+	// The last FAT sector may have entries past the last cluster, which look free
+	fs->freeMapScanEnd = (fs->numClusters + 2) / GetClustersPerBlock(fs);
+	if (fs->freeMapScanEnd > fs->sectorsPerFAT) {
+		fs->freeMapScanEnd = fs->sectorsPerFAT;
+	}
+}
+
+fs_result_t FAT32_FreeMapTasks(FS_FAT32 *fs) {
+	sd_result_t result = SD_BUSY;
+
+	if (fs->freeMapState == FS_FREEMAP_CLUSTERS) {
+		return FAT32_FreeMapClusterTasks(fs);
+	} else if (fs->freeMapState != FS_FREEMAP_SCANNING) {
+		return FS_SUCCESS;
+	}
+
+	if (fs->freeMapScanSector < fs->freeMapScanEnd) {
+		if (!fs->freeMapReading) {
+			result = SD_DMA_SingleBlockRead(fs->card,
+					fs->FAT_LBA_Begin + fs->freeMapScanSector, &fs->card->DataBlocks[0]);
+			fs->freeMapReading = 1;
+		}
+		if (result == SD_BUSY) {
+			result = SD_DMA_GetSingleBlockReadResult(fs->card);
+		}
+		if (result == SD_BUSY) {
+			return FS_BUSY;
+		}
+		fs->freeMapReading = 0;
+
+		if (result != SD_SUCCESS) {
+			DBG_ERR_printf("Read FAT: LBA %lu, unexpected result from card: 0x%02x",
+					fs->FAT_LBA_Begin + fs->freeMapScanSector, result);
+			fs->freeMapScanEnd = fs->freeMapScanSector;
+		} else {
+			if (!FAT32_IsFATSectorFree(fs, fs->card->DataBlocks[0].Data + 2)) {
+				FAT32_FreeMapAdd(fs, fs->freeMapRunStart,
+						fs->freeMapScanSector - fs->freeMapRunStart);
+				fs->freeMapRunStart = fs->freeMapScanSector + 1;
+			}
+			fs->freeMapScanSector++;
+		}
+	}
+
+	if (fs->freeMapScanSector >= fs->freeMapScanEnd) {
+		FAT32_FreeMapAdd(fs, fs->freeMapRunStart,
+				fs->freeMapScanSector - fs->freeMapRunStart);
+		fs->freeMapRunStart = fs->freeMapScanSector;
+		fs->freeMapState = FS_FREEMAP_READY;
+		DBG_DATA_printf("Free map complete, %u extents", fs->numFreeExtents);
+		if (fs->numFreeExtents == 0) {
+			FAT32_FreeMapBeginClusters(fs, fs->mostRecentCluster + 1);
+		}
+		if (result != SD_SUCCESS && result != SD_BUSY) {
+			return FS_PHY_ERR;
+		}
+		return FS_SUCCESS;
+	}
+	return FS_IDLE;
+}
+
+uint8_t FAT32_FreeMapWaiting(FS_FAT32 *fs) {
+	uint32_t start;
+	if (fs->freeMapState == FS_FREEMAP_CLUSTERS) {
+		return fs->numFreeExtents == 0 && fs->freeMapClusterLength == 0;
+	}
+	return fs->freeMapState == FS_FREEMAP_SCANNING && FAT32_FreeMapLargest(fs, &start) == 0;
+}
+
+uint32_t FAT32_FreeMapPlace(FS_FAT32 *fs, uint32_t cluster, fs_addr_t *runEndLBA) {
+	uint16_t clustersPerSector = GetClustersPerBlock(fs);
+	uint32_t start, end;
+
+	*runEndLBA = 0;
+	if (fs->freeMapState == FS_FREEMAP_NONE) {
+		return (cluster != 0) ? cluster : fs->mostRecentCluster + 1;
+	}
+
+	if (cluster != 0 && cluster % clustersPerSector == 0
+			&& FAT32_FreeMapFind(fs, cluster / clustersPerSector, &end)) {
+		*runEndLBA = fs->FAT_LBA_Begin + end;
+		return cluster;
+	}
+	end = FAT32_FreeMapLargest(fs, &start);
+	if (end != 0) {
+		*runEndLBA = fs->FAT_LBA_Begin + start + end;
+		return start * clustersPerSector;
+	}
+	if (fs->freeMapState == FS_FREEMAP_CLUSTERS && fs->freeMapClusterLength != 0) {
+		// The sector is partly used, so it is read and only this run allocated
+		return fs->freeMapClusterStart;
+	}
+	return 0;
+}
+
+void FAT32_FreeMapClaim(FS_FAT32 *fs, fs_addr_t fatLBA) {
+	uint32_t sector = fatLBA - fs->FAT_LBA_Begin;
+	uint8_t i;
+
+	if (fs->freeMapState == FS_FREEMAP_NONE) {
+		return;
+	}
+
+	for (i=0;i<fs->numFreeExtents;i++) {
+		FS_FreeExtent *extent = &fs->freeExtents[i];
+		if (sector >= extent->start && sector - extent->start < extent->length) {
+			uint32_t end = extent->start + extent->length;
+			if (sector == extent->start) {
+				extent->start++;
+				extent->length--;
+				if (extent->length == 0) {
+					fs->numFreeExtents--;
+					*extent = fs->freeExtents[fs->numFreeExtents];
+				}
+				if (fs->numFreeExtents == 0 && fs->freeMapState == FS_FREEMAP_READY) {
+					if (fs->freeMapDropped) {
+						// There is more free space than the map could hold, go find it
+						DBG_DATA_printf("Free map used up, scanning again");
+						FAT32_BeginFreeMap(fs);
+					} else {
+						FAT32_FreeMapBeginClusters(fs, (sector + 1) * GetClustersPerBlock(fs));
+					}
+				}
+			} else {
+				extent->length = sector - extent->start;
+				FAT32_FreeMapAdd(fs, sector + 1, end - sector - 1);
+			}
+			return;
+		}
+	}
+	if (fs->freeMapState == FS_FREEMAP_SCANNING
+			&& sector >= fs->freeMapRunStart && sector < fs->freeMapScanSector) {
+		FAT32_FreeMapAdd(fs, fs->freeMapRunStart, sector - fs->freeMapRunStart);
+		fs->freeMapRunStart = sector + 1;
+	} else if (fs->freeMapState == FS_FREEMAP_CLUSTERS && fs->freeMapClusterLength != 0
+			&& sector == fs->freeMapClusterStart / GetClustersPerBlock(fs)) {
+		// The run of free clusters was allocated, search on from after it
+		fs->freeMapClusterNext = fs->freeMapClusterStart + fs->freeMapClusterLength;
+		fs->freeMapClusterLength = 0;
+		fs->freeMapClusterSearched = 0;
+	}
+}
+
+void FAT32_FreeMapRelease(FS_FAT32 *fs, fs_addr_t fatLBA, uint32_t numSectors) {
+	uint32_t sector = fatLBA - fs->FAT_LBA_Begin;
+	uint8_t i;
+
+	// Sectors not scanned yet will be found by the scan
+	if (fs->freeMapState == FS_FREEMAP_NONE || numSectors == 0
+			|| sector + numSectors > fs->freeMapScanSector) {
+		return;
+	}
+
+	// These are usually the end of a run cut short, so join them back up
+	if (fs->freeMapState == FS_FREEMAP_SCANNING
+			&& fs->freeMapRunStart == sector + numSectors) {
+		fs->freeMapRunStart = sector;
+		return;
+	}
+	for (i=0;i<fs->numFreeExtents;i++) {
+		if (fs->freeExtents[i].start == sector + numSectors) {
+			fs->freeExtents[i].start = sector;
+			fs->freeExtents[i].length += numSectors;
+			return;
+		} else if (fs->freeExtents[i].start + fs->freeExtents[i].length == sector) {
+			fs->freeExtents[i].length += numSectors;
+			return;
+		}
+	}
+	FAT32_FreeMapAdd(fs, sector, numSectors);
+}
+
+fs_addr_t FAT32_FreeMapGetLargest(FS_FAT32 *fs, uint32_t *numBlocks) {
+	uint16_t clustersPerSector = GetClustersPerBlock(fs);
+	uint32_t start, length;
+
+	*numBlocks = 0;
+	if (fs->freeMapState == FS_FREEMAP_NONE) {
+		return 0;
+	}
+	length = FAT32_FreeMapLargest(fs, &start);
+	if (length == 0) {
+		return 0;
+	}
+	*numBlocks = length * clustersPerSector * fs->sectorsPerCluster;
+	return GetClusterLBA(fs, start * clustersPerSector);
+}
@@ -0,0 +1,124 @@
+/*
+ * File:   fat32-freemap.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 6:20 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Largest free extent lookup.
+ * 17 Oct 2026	agent	Free cluster runs in partly used FAT sectors.
+ *
+ * @file
+ * Free extent map for the FAT32 filesystem.
+ * The FS Information Sector's most recently allocated cluster can't be trusted
+ * (other systems may leave it anywhere, or not set it at all), so allocating
+ * after it blindly can run into existing files. This builds a map of the
+ * largest runs of free FAT sectors by scanning the FAT, one sector at a time,
+ * in the background, and files are then allocated in those runs.
+ *
+ * The scan needs the card, which only one thing can use at a time, so the
+ * application runs FAT32_FreeMapTasks whenever the card is free, for example
+ * while the file being written is held with FS_HoldFile.
+ * While the scan is in progress, files are allocated in free space found so
+ * far, waiting for the scan to find some if there is none yet.
+ * Only the FS_FREEMAP_EXTENTS largest extents are kept, so if there were more,
+ * the scan starts over once they are used up.
+ *
+ * Once there are no free FAT sectors left, a card can still have plenty of
+ * free clusters scattered through partly used sectors. Runs of free clusters
+ * are then found by searching the FAT on from the last allocation, one run at
+ * a time, with the same background tasks, and the file reads the FAT sector to
+ * allocate just that run.
+ */
+
+#ifndef FAT32_FREEMAP_H
+#define FAT32_FREEMAP_H
+
+#include "fat32.h"
+
+/**
+ * Starts building the free extent map. This should be called after the
+ * filesystem is initialized, and before any file is allocated clusters.
+ * Until this is called, clusters are allocated after the most recently
+ * allocated cluster without checking the FAT.
+ *
+ * @param fs Filesystem.
+ */
+void FAT32_BeginFreeMap(FS_FAT32 *fs);
+
+/**
+ * Scans the next FAT sector, building the free extent map. This should be
+ * called periodically when the card is not being used otherwise, until the
+ * scan is complete.
+ *
+ * @param fs Filesystem.
+ * @return Result.
+ * @retval FS_BUSY A FAT sector is being read, call again before using the card.
+ * @retval FS_IDLE A FAT sector was scanned, and the card is free.
+ * @retval FS_SUCCESS The scan is complete (or was never started), and the
+ * card is free.
+ * @retval FS_PHY_ERR Storage medium access error. The scan is ended early, and
+ * the rest of the FAT is treated as full.
+ */
+fs_result_t FAT32_FreeMapTasks(FS_FAT32 *fs);
+
+/**
+ * Checks whether the free extent map is being built and has not found any
+ * free space yet, or is searching for a run of free clusters, in which case
+ * allocation must wait.
+ *
+ * @param fs Filesystem.
+ * @return Whether allocation must wait for the scan.
+ */
+uint8_t FAT32_FreeMapWaiting(FS_FAT32 *fs);
+
+/**
+ * Chooses where a run of clusters is allocated. A file continues contiguously
+ * if the following FAT sector is known to be free, otherwise the run goes in
+ * the largest known free extent.
+ * With no free FAT sectors left, the run is the run of free clusters found in
+ * a partly used FAT sector.
+ * Without a free extent map, the run always continues contiguously, or for a
+ * new file, starts after the most recently allocated cluster.
+ *
+ * @param fs Filesystem.
+ * @param cluster Cluster following the file's last allocated cluster, 0 for a
+ * file with no clusters.
+ * @param[out] runEndLBA Set to the FAT LBA past the known free sectors the run
+ * is in, or 0 if they are not known, or the run is in a partly used sector.
+ * @return First cluster of the run, or 0 if there is no free space.
+ */
+uint32_t FAT32_FreeMapPlace(FS_FAT32 *fs, uint32_t cluster, fs_addr_t *runEndLBA);
+
+/**
+ * Removes an allocated FAT sector from the free extent map, or the run of free
+ * clusters found in it.
+ *
+ * @param fs Filesystem.
+ * @param fatLBA LBA of the FAT sector.
+ */
+void FAT32_FreeMapClaim(FS_FAT32 *fs, fs_addr_t fatLBA);
+
+/**
+ * Returns freed FAT sectors to the free extent map.
+ *
+ * @param fs Filesystem.
+ * @param fatLBA LBA of the first FAT sector freed.
+ * @param numSectors Number of FAT sectors freed.
+ */
+void FAT32_FreeMapRelease(FS_FAT32 *fs, fs_addr_t fatLBA, uint32_t numSectors);
+
+/**
+ * Finds the data blocks of the largest known free extent, for example to use
+ * as scratch space. Nothing is allocated, so the blocks are only free until
+ * the next file is allocated clusters.
+ *
+ * @param fs Filesystem.
+ * @param[out] numBlocks Set to the number of data blocks in the extent.
+ * @return LBA of the first data block of the extent, 0 if none are known.
+ */
+fs_addr_t FAT32_FreeMapGetLargest(FS_FAT32 *fs, uint32_t *numBlocks);
+
+#endif
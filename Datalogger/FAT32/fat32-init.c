@@ -7,6 +7,8 @@
  * Revision History
  * Date			Author	Change
  * 29 Jul 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Load the sequential file name hint.
+ * 17 Oct 2026	agent	Number of clusters, for the free extent map.
  *
  * Todo
  * 29 Jul 2011	Ducky	Consider refactoring.
@@ -15,6 +17,8 @@
  * FAT32 file system initialization subroutine.
  */
 
+#include <string.h>
+
 #include "fat32.h"
 #include "fat32-util.h"
 
@@ -127,6 +131,8 @@ fs_result_t FAT32_ParseBootSector(FS_FAT32 *fs, uint8_t *data) {
 
 	fs->FAT_LBA_Begin = fs->Partition_LBA_Begin + fs->numberOfReservedSectors;
 	fs->Cluster_LBA_Begin = fs->FAT_LBA_Begin + fs->numberOfFATs * fs->sectorsPerFAT;
+	fs->numClusters = (FATDataToInt32(data+32) - (fs->Cluster_LBA_Begin - fs->Partition_LBA_Begin))
+			/ fs->sectorsPerCluster;
 
 	fs->rootDirectory.directoryTableAvailableCluster = fs->rootDirectory.directoryTableBeginCluster;
 	fs->rootDirectory.directoryTableAvailableLBA = GetClusterLBA(fs, fs->rootDirectory.directoryTableAvailableCluster);
@@ -136,6 +142,7 @@ fs_result_t FAT32_ParseBootSector(FS_FAT32 *fs, uint8_t *data) {
 	DBG_DATA_printf("Number of Reserved Sectors = %u", fs->numberOfReservedSectors);
 	DBG_DATA_printf("Number of FATs = %u, Sectors Per FAT = %lu", fs->numberOfFATs, fs->sectorsPerFAT);
 	DBG_DATA_printf("Root Cluster Number = 0x%08lx", fs->rootDirectory.directoryTableBeginCluster);
+	DBG_DATA_printf("Number of Clusters = %lu", fs->numClusters);
 
 	DBG_DATA_printf("Partition LBA = 0x%08lx, FAT LBA = 0x%08lx, Cluster LBA = 0x%08lx",
 			fs->Partition_LBA_Begin, fs->FAT_LBA_Begin, fs->Cluster_LBA_Begin)
@@ -168,6 +175,22 @@ fs_result_t FAT32_ParseFSInfoSector(FS_FAT32 *fs, uint8_t *data) {
 	fs->numFreeClusters = FATDataToInt32(data+0x1e8);
 	fs->mostRecentCluster = FATDataToInt32(data+0x1ec);
 
+	// Load the sequential file name hint, if one was left by a previous mount
+	fs->seqHintValid = 0;
+	if (data[FAT32_FSINFO_HINT_MARKER] == FAT32_FSINFO_HINT_MAGIC) {
+		uint8_t check = 0;
+		uint16_t i;
+		for (i=FAT32_FSINFO_HINT_NAME;i<FAT32_FSINFO_HINT_CHECK;i++) {
+			check += data[i];
+		}
+		if (check == data[FAT32_FSINFO_HINT_CHECK]) {
+			memcpy(fs->seqHintName, data + FAT32_FSINFO_HINT_NAME, 8);
+			fs->seqHintEntry = FATDataToInt16(data + FAT32_FSINFO_HINT_ENTRY);
+			fs->seqHintValid = 1;
+			DBG_DATA_printf("Sequential name hint = %.8s at entry %u", fs->seqHintName, fs->seqHintEntry);
+		}
+	}
+
 	DBG_DATA_printf("Number of Free Clusters = %lu", fs->numFreeClusters);
 	DBG_DATA_printf("Most Recently Allocated Cluster = 0x%08lx", fs->mostRecentCluster);
 
@@ -177,6 +200,7 @@ fs_result_t FAT32_ParseFSInfoSector(FS_FAT32 *fs, uint8_t *data) {
 fs_result_t FAT32_Initialize(FS_FAT32 *fs, SD_Card *card) {
 	fs->State = FS_INITIALIZING;
 	fs->card = card;
+	fs->freeMapState = FS_FREEMAP_NONE;
 
 	fs->SubState = FS_INIT_SUB_BEGIN;
 
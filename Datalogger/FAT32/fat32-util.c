@@ -7,6 +7,7 @@
  * Revision History
  * Date			Author	Change
  * 28 Jul 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Sequential file name hint in the FS Information Sector.
  *
  * @file
  * Helper funcitons for the FAT32 library. These are all simple calculation
@@ -105,6 +106,15 @@ void FAT32_FillFSInformationSector(FS_FAT32 *fs, uint8_t *data) {
 	Int32ToFATData(data + 0x1e8, fs->numFreeClusters);
 	Int32ToFATData(data + 0x1ec, fs->mostRecentCluster);
 	memset(data+0x1f0, 0, 0x1fe - 0x1f0);
+	if (fs->seqHintValid) {
+		uint16_t i;
+		memcpy(data + FAT32_FSINFO_HINT_NAME, fs->seqHintName, 8);
+		Int16ToFATData(data + FAT32_FSINFO_HINT_ENTRY, fs->seqHintEntry);
+		data[FAT32_FSINFO_HINT_MARKER] = FAT32_FSINFO_HINT_MAGIC;
+		for (i=FAT32_FSINFO_HINT_NAME;i<FAT32_FSINFO_HINT_CHECK;i++) {
+			data[FAT32_FSINFO_HINT_CHECK] += data[i];
+		}
+	}
 	data[0x1fe] = 0x55;
 	data[0x1ff] = 0xaa;
 }
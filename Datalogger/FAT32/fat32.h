@@ -7,6 +7,9 @@
  * Revision History
  * Date			Author	Change
  * 29 Jul 2011	Ducky	Initial implementation
+ * 17 Oct 2026	agent	Sequential file name hint.
+ * 17 Oct 2026	agent	Free extent map.
+ * 17 Oct 2026	agent	Free cluster runs in partly used FAT sectors.
  *
  * @file
  * FAT32 file system library.
@@ -39,6 +42,30 @@ typedef struct {
 	fs_addr_t directoryTableAvailableLBA;		/// LBA of the first available entry in the directory table
 } FS_Directory;
 
+/**
+ * Number of free extents kept in the free extent map - only the largest are
+ * kept, as only the largest are allocated from.
+ * This can be overridden in the project options.
+ */
+#ifndef FS_FREEMAP_EXTENTS
+	#define FS_FREEMAP_EXTENTS	8
+#endif
+
+typedef enum {
+	FS_FREEMAP_NONE,		/// No map, clusters are allocated after the most recently allocated cluster without checking the FAT.
+	FS_FREEMAP_SCANNING,	/// Map being built from the FAT in the background, only the part scanned so far is used.
+	FS_FREEMAP_READY,		/// Map complete.
+	FS_FREEMAP_CLUSTERS		/// No free FAT sectors left, partly used FAT sectors are searched for a run of free clusters whenever one is needed.
+} FS_FreeMapState;
+
+/**
+ * A run of free FAT sectors, that is, FAT sectors with every cluster free.
+ */
+typedef struct {
+	uint32_t start;						/// First free FAT sector, relative to the beginning of the FAT.
+	uint32_t length;					/// Number of free FAT sectors.
+} FS_FreeExtent;
+
 /**
  * Data structure holding relevant information for a FAT32 filesystem.
  * When intiailized, it should hold all the information necessary to do file opens, ...
@@ -66,12 +93,47 @@ typedef struct {
 	fs_addr_t Partition_LBA_Begin;		/// LBA where the partition begins
 	fs_addr_t FAT_LBA_Begin;			/// LBA where FAT #1 begins.
 	fs_addr_t Cluster_LBA_Begin;		/// LBA where the Clusters (holding files and directories) section begins.
+	uint32_t numClusters;				/// Number of clusters in the Clusters section.
 
 	uint32_t numFreeClusters;			/// Number of free clusters, as indicated by the FS Information Sector.
 	uint32_t mostRecentCluster;			/// Most recently allocated cluster, as indicated by the FS Information Sector.
 	uint8_t fsInfoDirty;				/// Whether FS Information Sector data has been changed and needs to be committed to disk.
+
+	// Sequential file name hint, kept in the reserved bytes at the end of the
+	// FS Information Sector, so FS_CreateFileSeqName can skip the directory
+	// scan. It is checked against the directory before use.
+	uint8_t seqHintValid;				/// Whether the hint is set.
+	char seqHintName[8];				/// Name of the last sequentially named file created.
+	uint16_t seqHintEntry;				/// Root directory entry index of that file.
+
+	// Free extent map, built by scanning the FAT in the background so files
+	// are allocated in known free space. It is kept in units of whole FAT
+	// sectors, and partially used FAT sectors are only allocated from, one run
+	// of free clusters at a time, once there are no free sectors left.
+	FS_FreeMapState freeMapState;		/// Free extent map state.
+	uint8_t freeMapReading;				/// Whether a FAT sector read is in progress.
+	uint32_t freeMapScanSector;			/// Next FAT sector to be scanned.
+	uint32_t freeMapScanEnd;			/// FAT sector past the last one with only valid clusters.
+	uint32_t freeMapRunStart;			/// First sector of the run of free sectors ending at the scan position.
+	FS_FreeExtent freeExtents[FS_FREEMAP_EXTENTS];	/// Largest free extents found, in no particular order.
+	uint8_t numFreeExtents;				/// Number of valid entries in freeExtents.
+	uint8_t freeMapDropped;				/// Whether free extents were left out because freeExtents was full.
+	uint32_t freeMapClusterNext;		/// Cluster the search for a run of free clusters carries on from.
+	uint32_t freeMapClusterStart;		/// First cluster of the run of free clusters found.
+	uint16_t freeMapClusterLength;		/// Number of clusters in the run found, 0 while searching.
+	uint32_t freeMapClusterSearched;	/// Number of FAT sectors searched without finding a run.
 } FS_FAT32;
 
+/**
+ * FS Information Sector layout of the sequential file name hint, in the
+ * second reserved area (which is otherwise zero).
+ */
+#define FAT32_FSINFO_HINT_NAME		0x1f0	/// 8 bytes, name of the last sequentially named file.
+#define FAT32_FSINFO_HINT_ENTRY		0x1f8	/// 2 bytes, root directory entry index of that file.
+#define FAT32_FSINFO_HINT_MARKER	0x1fa	/// FAT32_FSINFO_HINT_MAGIC if the hint is set.
+#define FAT32_FSINFO_HINT_CHECK		0x1fb	/// Sum of the previous hint bytes, mod 256.
+#define FAT32_FSINFO_HINT_MAGIC		0x5e
+
 #define FS_SUCCESS					0x00
 #define FS_IDLE						0x01
 #define FS_CLOSED					0x10
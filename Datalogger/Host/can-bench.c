@@ -0,0 +1,1192 @@
+/*
+ * File:   can-bench.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 5:50 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Added compressed logs (can-bench-z).
+ * 17 Oct 2026	agent	Added delta-encoded logs (can-bench-delta).
+ * 17 Oct 2026	agent	Added file rotation.
+ * 17 Oct 2026	agent	Free extent map scan, as in the datalogger.
+ * 17 Oct 2026	agent	Count frames in overflow summaries.
+ * 17 Oct 2026	agent	Per-stage loop profile.
+ * 17 Oct 2026	agent	Added the UART copy of records (can-bench-uart).
+ * 17 Oct 2026	agent	Added the live binary CAN stream (can-bench-stream).
+ * 17 Oct 2026	agent	Card busy time histograms against the buffer budget.
+ * 17 Oct 2026	agent	Rotating only once the overflow summary is written.
+ * 17 Oct 2026	agent	Sector caches shared by both files, as in the datalogger.
+ *
+ * @file
+ * Host benchmark for the datalogger CAN intake path. CAN traffic is fed
+ * through the emulated ECAN module (ecan-host.c) into the firmware's
+ * Datalogger_ProcessCANMessages and DataloggerFile code, which write to the
+ * emulated SD Card, all on the host virtual clock.
+ *
+ * Traffic is either synthetic (evenly spaced frames with random payloads) at
+ * a given bus load, or replayed from a recorded log. Recorded logs must be in
+ * the PRM FMT 1 ASCII format; convert PRM FMT 2 logs with dlg-decode first.
+ * A replayed trace keeps its original timing unless a bus load is given, in
+ * which case it is time-scaled to that average load. Frames never overlap on
+ * the bus, and frame lengths include stuff bits.
+ *
+ * The firmware's CPU time is modelled: each main loop iteration and each frame
+ * read costs a fixed amount of virtual time, while the SD Card emulator
+ * charges blocking SPI transfers. The host CPU time spent in
+ * Datalogger_ProcessCANMessages is also measured, which is useful for
+ * comparing firmware changes but is not dsPIC time.
+ *
+ * A logging configuration file (DLGCFG.TXT) may be copied into the image, in
+ * which case it is loaded and its acceptance filters applied as at mount.
+ * Frames the configuration drops, and frames counted in CS records instead of
+ * being logged, are not counted as lost. Neither are frames which could not be
+ * logged while the RAM buffer was full but are counted in an overflow summary
+ * (CO / CP records), though these are reported separately.
+ *
+ * With DATALOGGER_COMPRESS (can-bench-z), compressing the RAM buffer costs a
+ * fixed amount of virtual time per byte, and the host CPU time spent in
+ * DataloggerFile_Tasks is measured.
+ *
+ * With a rotation size, logging moves on to a new file whenever the current
+ * file reaches that size, with the next file created in the background as in
+ * Datalogger_ProcessRotation. The time from the start of a rotation to the
+ * switch, which the RAM buffer has to cover, is reported.
+ *
+ * The free extent map is built in the background, holding the file between
+ * blocks, as in Datalogger_ProcessFreeMap. When the scan completes, and the
+ * longest time the file was held for it, are reported.
+ *
+ * With DATALOGGER_CAN_UART (can-bench-uart), records are also sent out the
+ * emulated UART (uart-dma-host.c), and the ring usage and dropped writes are
+ * reported. With DATALOGGER_CAN_STREAM (can-bench-stream), the live binary CAN
+ * stream is sent out the emulated UART instead. Either way, the UART output
+ * can be saved, to check the stream with dlg-stream.
+ *
+ * The main loop is profiled per stage as in Datalogger_Loop, on the virtual
+ * clock, and the same report that dlg-decode prints from the PS records of a
+ * datalogger log is printed for the run. So is the card busy time report,
+ * with each busy period checked against the budget the RAM buffer allows at
+ * the data rate of the previous second, to show which card profiles would
+ * lose data at the load given.
+ *
+ * After the run, the log files are read back from the image (and unpacked, if
+ * compressed) to count the frames actually logged and the overflow markers.
+ *
+ * Usage: can-bench [options]
+ *   -i path   Image file (default can-bench.img)
+ *   -F MiB    Format a new image of this size first
+ *   -c n      Sectors per cluster when formatting (default 8)
+ *   -C path   Copy this file into the image as DLGCFG.TXT first
+ *   -p name   Card latency profile: ideal, typical, slow, stall (default typical)
+ *   -t path   Replay a PRM FMT 1 log ("-" for stdin) instead of synthetic traffic
+ *   -L pct    Bus load, in percent of the bit rate (default 50, trace: original timing)
+ *   -d ms     Run length, in milliseconds of virtual time; traces loop
+ *             (default 10000, trace: one pass)
+ *   -D n      Synthetic frame data length (default 8)
+ *   -s n      Number of distinct synthetic SIDs (default 32)
+ *   -R n      Synthetic payloads change every n frames of a SID (default 1)
+ *   -V n      Only the last n bytes of synthetic payloads change (default 8)
+ *   -f ns     CPU time per frame read (default 30000)
+ *   -l ns     CPU time per main loop iteration (default 50000)
+ *   -z ns     CPU time per byte compressed (default 500, can-bench-z only)
+ *   -r bytes  Rotate to a new file at this file size (default 0, never)
+ *   -S        Sweep the bus load from 10% to 100% in 10% steps
+ *   -u path   Write the UART output to this file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../hardware.h"
+#include "../timing.h"
+#include "../ecan.h"
+#include "../ecan-host.h"
+#include "../uart-dma.h"
+#include "../uart-dma-host.h"
+#include "../SD-SPI-DMA/sd-spi-dma.h"
+#include "../SD-SPI-DMA/sd-hardware-host.h"
+#include "../FAT32/fat32.h"
+#include "../FAT32/fat32-file.h"
+#include "../FAT32/fat32-freemap.h"
+#include "../Datalogger/datalogger-file.h"
+#include "../Datalogger/datalogger-config.h"
+#include "../Datalogger/datalogger-applications.h"
+#include "../Datalogger/datalogger-records.h"
+#include "../Datalogger/datalogger-profile.h"
+
+#include "fat32-image.h"
+#include "dlz.h"
+#include "loop-profile.h"
+#include "sd-latency-report.h"
+
+#define BENCH_DLG_BUFFER_SIZE	8192	/// Same as DLG_BUFFER_SIZE in datalogger.c
+#define BENCH_TIMEOUT_NS		((uint64_t)60 * 1000000000)	/// Longest time to wait for a file to close
+#define BENCH_BIT_NS			(1000000000 / ECAN_BITRATE)
+#define BENCH_MAX_RUNS			10
+#define BENCH_MAX_FILES			64		/// Most files logged by a run, when rotating
+#define BENCH_FREEMAP_BATCH		8		/// Same as DLG_FREEMAP_BATCH in datalogger.c
+
+typedef struct {
+	const char *imagePath;
+	uint32_t formatMB;
+	uint8_t sectorsPerCluster;
+	const char *configPath;
+	const char *profile;
+	const char *tracePath;
+	uint32_t load;			/// Bus load in percent, 0 for the original trace timing.
+	uint32_t durationMs;	/// Run length, 0 for one pass of the trace.
+	uint8_t dlc;
+	uint16_t numSIDs;
+	uint32_t repeat;		/// Frames of a SID between synthetic payload changes.
+	uint8_t vary;			/// Trailing bytes of synthetic payloads which change.
+	uint32_t frameNs;
+	uint32_t loopNs;
+	uint32_t compressNs;	/// CPU time per byte compressed.
+	uint32_t rotateSize;	/// File size to rotate at, 0 for never.
+	int sweep;
+	const char *uartPath;	/// File to write the UART output to, or NULL.
+} BenchOptions;
+
+typedef struct {
+	uint32_t time;			/// Timestamp, in 1/1024 s.
+	uint16_t sid;
+	uint8_t dlc;
+	uint8_t data[8];
+} TraceFrame;
+
+/**
+ * Frame source state, passed to the ECAN emulator.
+ */
+typedef struct {
+	BenchOptions *opt;
+	uint32_t load;			/// Bus load for this run, 0 for the original trace timing.
+
+	TraceFrame *trace;		/// Recorded frames, or NULL for synthetic traffic.
+	size_t traceLen;
+	size_t tracePos;		/// Next trace frame.
+	uint64_t traceSpanNs;	/// Scaled trace length, including one average frame interval.
+	double traceScale;		/// Trace time scale factor.
+	uint64_t traceOffsetNs;	/// Start time of the current pass of the trace.
+
+	uint64_t startNs;		/// Time traffic starts.
+	uint64_t endNs;			/// No frames start at or after this time, 0 for unlimited.
+	uint64_t nextNs;		/// Earliest start time of the next synthetic frame.
+	uint64_t busFreeNs;		/// Time the bus becomes free.
+	uint32_t random;		/// Payload random number generator state.
+	uint32_t sidFrames[2048];	/// Synthetic frames sent per SID.
+
+	uint32_t frames;		/// Frames put on the bus.
+	uint32_t wanted;		/// Frames put on the bus which the configuration keeps.
+	uint64_t busBits;		/// Bits put on the bus.
+} FrameSource;
+
+typedef struct {
+	char names[BENCH_MAX_FILES][12];	/// Directory entry names of the log files.
+	uint32_t numFiles;
+	uint32_t load;			/// Bus load requested, 0 for the original trace timing.
+	uint64_t durationNs;	/// Time traffic was running.
+
+	uint32_t offered;		/// Frames put on the bus.
+	uint32_t wanted;		/// Frames put on the bus which the configuration keeps.
+	uint64_t busBits;		/// Bits put on the bus.
+	ECAN_Host_Statistics ecan;
+	uint16_t maxRAMUsed;	/// RAM buffer high-water mark, in bytes.
+	uint8_t maxFSFilled;	/// FS_File data buffer high-water mark.
+	uint32_t rotations;
+	uint64_t maxRotateNs;	/// Longest time from the start of a rotation to the switch.
+	uint64_t maxHoldNs;		/// Longest time the file was held to create the next one.
+	uint64_t freeMapNs;		/// Time from the start of traffic to the free extent map completing, 0 if it didn't.
+	uint64_t maxScanHoldNs;	/// Longest time the file was held to scan the FAT.
+	uint64_t hostNs;		/// Host CPU time in Datalogger_ProcessCANMessages.
+	uint64_t compressHostNs;	/// Host CPU time in DataloggerFile_Tasks, when compressing.
+	uint32_t compressed;	/// Bytes compressed.
+	LoopProfile profile;	/// Main loop profile.
+	SDLatencyReport sdLatency;	/// Card busy times.
+
+	uint32_t fileSize;		/// Size of the log files.
+	uint32_t rawSize;		/// Size of the log files, unpacked.
+	DLZ_Stats dlz;			/// Unpacking statistics.
+
+	uint32_t logged;		/// CAN frames found in the file.
+	uint32_t deltas;		/// Of which delta records.
+	uint32_t covf;			/// COVF markers found in the file.
+	uint32_t movf;			/// MOVF markers found in the file.
+	uint32_t seen;			/// Frames counted in CS records found in the file.
+	uint32_t seenRecords;	/// CS records found in the file.
+	uint32_t summarized;	/// Frames counted in overflow summaries found in the file.
+	uint32_t untracked;		/// Of which frames of SIDs which did not fit in the summary.
+	uint32_t overflows;		/// Overflow summaries found in the file.
+} BenchRunResult;
+
+SD_Card card;
+FS_FAT32 fs;
+FS_File files[2];
+FS_FileCache fileCache;
+DataloggerFile dlgFile;
+DataloggerConfig dlgConfig;
+uint8_t dlgBuffer[BENCH_DLG_BUFFER_SIZE];
+
+/** What the file is held for, as in datalogger.c. */
+typedef enum {
+	BENCH_HOLD_NONE,
+	BENCH_HOLD_ROTATE,
+	BENCH_HOLD_FREEMAP
+} BenchHold;
+BenchHold holdOwner;
+
+static uint32_t Random(uint32_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/**
+ * Puts a frame on the bus, no earlier than a given time.
+ */
+static void SourcePlaceFrame(FrameSource *src, ECAN_Host_Frame *frame, uint64_t earliestNs) {
+	uint16_t bits = ECAN_Host_GetFrameBits(frame->SID, frame->DLC, frame->Data);
+	uint64_t startNs = earliestNs > src->busFreeNs ? earliestNs : src->busFreeNs;
+
+	// The frame is received at the end of EOF, before the intermission
+	frame->Time = startNs + (uint64_t)(bits - 3) * BENCH_BIT_NS;
+	src->busFreeNs = startNs + (uint64_t)bits * BENCH_BIT_NS;
+	src->frames++;
+	if (dlgConfig.keepAll || (dlgConfig.keep[frame->SID >> 3] >> (frame->SID & 0x07)) & 0x01) {
+		src->wanted++;
+	}
+	src->busBits += bits;
+}
+
+static uint8_t SyntheticSource(void *context, ECAN_Host_Frame *frame) {
+	FrameSource *src = (FrameSource*)context;
+	uint64_t startNs = src->nextNs > src->busFreeNs ? src->nextNs : src->busFreeNs;
+	uint8_t i;
+
+	if (src->endNs != 0 && startNs >= src->endNs) {
+		return 0;
+	}
+
+	frame->SID = (0x100 + Random(&src->random) % src->opt->numSIDs) & 0x7ff;
+	frame->DLC = src->opt->dlc;
+	if (src->opt->repeat > 1 || src->opt->vary < frame->DLC) {
+		uint32_t fixedSeed = ((uint32_t)frame->SID << 20) ^ 1;
+		uint32_t seed = fixedSeed
+				^ ((src->sidFrames[frame->SID]++ / src->opt->repeat) * 0x9e3779b9);
+		for (i=0;i<frame->DLC;i++) {
+			frame->Data[i] = (i + src->opt->vary < frame->DLC) ? Random(&fixedSeed) : Random(&seed);
+		}
+	} else {
+		for (i=0;i<frame->DLC;i++) {
+			frame->Data[i] = Random(&src->random);
+		}
+	}
+	SourcePlaceFrame(src, frame, startNs);
+	src->nextNs = startNs + (src->busFreeNs - startNs) * 100 / src->load;
+	return 1;
+}
+
+static uint8_t TraceSource(void *context, ECAN_Host_Frame *frame) {
+	FrameSource *src = (FrameSource*)context;
+	TraceFrame *rec;
+	uint64_t timeNs;
+
+	if (src->tracePos >= src->traceLen) {
+		if (src->endNs == 0) {
+			return 0;
+		}
+		src->tracePos = 0;
+		src->traceOffsetNs += src->traceSpanNs;
+	}
+	rec = &src->trace[src->tracePos];
+	timeNs = src->startNs + src->traceOffsetNs
+			+ (uint64_t)((rec->time - src->trace[0].time) * (1e9 / 1024) * src->traceScale);
+	if (src->endNs != 0 && timeNs >= src->endNs) {
+		return 0;
+	}
+	src->tracePos++;
+
+	frame->SID = rec->sid;
+	frame->DLC = rec->dlc;
+	memcpy(frame->Data, rec->data, 8);
+	SourcePlaceFrame(src, frame, timeNs);
+	return 1;
+}
+
+/**
+ * Sets up the trace timing for a bus load.
+ */
+static void SourceScaleTrace(FrameSource *src) {
+	uint64_t bits = 0, spanNs;
+	size_t i;
+
+	for (i=0;i<src->traceLen;i++) {
+		bits += ECAN_Host_GetFrameBits(src->trace[i].sid, src->trace[i].dlc, src->trace[i].data);
+	}
+	spanNs = (uint64_t)((src->trace[src->traceLen-1].time - src->trace[0].time) * (1e9 / 1024));
+	// Count one average frame interval past the last frame, for looping
+	spanNs += spanNs / src->traceLen;
+
+	if (src->load == 0 || spanNs == 0) {
+		src->traceScale = 1;
+	} else {
+		src->traceScale = (double)bits * BENCH_BIT_NS * 100 / src->load / spanNs;
+	}
+	src->traceSpanNs = spanNs * src->traceScale;
+	if (src->traceSpanNs == 0) {
+		src->traceSpanNs = bits * BENCH_BIT_NS;
+	}
+}
+
+/**
+ * Reads a PRM FMT 1 log, keeping only the CAN frames.
+ * @return Number of frames read, 0 on failure.
+ */
+static size_t ReadTrace(const char *path, TraceFrame **trace) {
+	FILE *in = stdin;
+	char line[256];
+	size_t len = 0, size = 1024;
+
+	if (strcmp(path, "-") != 0 && (in = fopen(path, "r")) == NULL) {
+		perror(path);
+		return 0;
+	}
+	*trace = malloc(size * sizeof(TraceFrame));
+
+	while (fgets(line, sizeof(line), in) != NULL) {
+		unsigned int time, dt, channel, flags, dlc, sid;
+		int pos;
+		char *p;
+		uint8_t i;
+
+		if (sscanf(line, "CM %x/%x %x %x %x %x%n", &time, &dt, &channel, &flags,
+				&dlc, &sid, &pos) != 6 || dlc > 8 || sid > 0x7ff) {
+			continue;
+		}
+		if (len == size) {
+			size *= 2;
+			*trace = realloc(*trace, size * sizeof(TraceFrame));
+		}
+		(*trace)[len].time = time;
+		(*trace)[len].sid = sid;
+		(*trace)[len].dlc = dlc;
+		memset((*trace)[len].data, 0, 8);
+		p = line + pos;
+		for (i=0;i<dlc;i++) {
+			while (*p == ' ' || *p == ',') {
+				p++;
+			}
+			(*trace)[len].data[i] = strtoul(p, &p, 16);
+		}
+		len++;
+	}
+
+	if (in != stdin) {
+		fclose(in);
+	}
+	if (len == 0) {
+		fprintf(stderr, "No CAN frames in %s\n", path);
+	}
+	return len;
+}
+
+/**
+ * Copies a configuration file into the image as DLGCFG.TXT.
+ * @return 0 on success, nonzero on failure.
+ */
+static int AddConfigFile(const char *imagePath, const char *configPath) {
+	FILE *in = fopen(configPath, "rb");
+	uint8_t data[65536];
+	size_t size;
+	uint32_t startCluster, oldSize;
+	FAT32_Image img;
+	int exists;
+
+	if (in == NULL) {
+		perror(configPath);
+		return 1;
+	}
+	size = fread(data, 1, sizeof(data), in);
+	fclose(in);
+
+	if (FAT32_Image_Open(&img, imagePath)) {
+		return 1;
+	}
+	exists = !FAT32_Image_FindFile(&img, DLG_CONFIG_FILE_NAME, &startCluster, &oldSize);
+	FAT32_Image_Close(&img);
+	if (exists) {
+		fprintf(stderr, "%s already has a configuration file, format a new image with -F\n",
+				imagePath);
+		return 1;
+	}
+	return FAT32_Image_AddFile(imagePath, DLG_CONFIG_FILE_NAME, data, size);
+}
+
+static int BenchInit(BenchOptions *opt) {
+	sd_result_t sdresult;
+	fs_result_t fsresult;
+
+	card = SD_CreateCard();
+	FS_SetFileCache(&files[0], &fileCache);
+	FS_SetFileCache(&files[1], &fileCache);
+	SD_Initialize(&card);
+	do {
+		Host_AdvanceClock(opt->loopNs);
+		sdresult = SD_GetInitializeResult(&card);
+	} while (sdresult == SD_BUSY);
+	if (sdresult != SD_SUCCESS) {
+		fprintf(stderr, "SD Card initialization failed, got 0x%02x\n", sdresult);
+		return 1;
+	}
+
+	fsresult = FAT32_Initialize(&fs, &card);
+	while (fsresult == FS_BUSY) {
+		Host_AdvanceClock(opt->loopNs);
+		fsresult = FAT32_GetInitializeResult(&fs);
+	}
+	if (fsresult != FS_SUCCESS) {
+		fprintf(stderr, "FAT32 initialization failed, got 0x%02x\n", fsresult);
+		return 1;
+	}
+	FAT32_BeginFreeMap(&fs);
+
+	// Same configuration as main.c: everything into the FIFO
+	ECAN_Init();
+	ECAN_Config();
+	C1FCTRLbits.FSA = 4;
+	ECAN_SetStandardFilter(0, 0x00, 0, 15);
+	ECAN_SetStandardMask(0, 0x00);
+	ECAN_SetMode(ECAN_MODE_OPERATE);
+	ECAN_SetupDMA();
+#ifdef ECAN_RX_INTERRUPT
+	ECAN_EnableRXInterrupt();
+#endif
+	ECAN_Host_SetFrameCost(opt->frameNs);
+
+	// Then as Datalogger_TryFileInit, once the card is mounted
+	fsresult = DataloggerConfig_Load(&dlgConfig, &fs);
+	while (fsresult == FS_BUSY) {
+		Host_AdvanceClock(opt->loopNs);
+		fsresult = DataloggerConfig_GetLoadResult(&dlgConfig);
+	}
+	if (fsresult != FS_SUCCESS) {
+		fprintf(stderr, "Configuration load failed, got 0x%02x\n", fsresult);
+		return 1;
+	}
+	DataloggerConfig_ApplyFilters(&dlgConfig);
+	return 0;
+}
+
+/**
+ * Records the directory entry name of a file logged by the run.
+ */
+static void AddFileName(BenchRunResult *result, FS_File *file) {
+	char *name = result->names[result->numFiles];
+	uint8_t i;
+
+	// file->name is null terminated when shorter than 8 characters
+	for (i=0;i<8;i++) {
+		name[i] = file->name[i] ? file->name[i] : ' ';
+	}
+	memcpy(name + 8, file->ext, 3);
+	name[11] = '\0';
+	if (result->numFiles < BENCH_MAX_FILES - 1) {
+		result->numFiles++;
+	}
+}
+
+/**
+ * Creates the next file in the background and rotates to it at the rotation
+ * size, as Datalogger_ProcessRotation.
+ * @return 0 on success, nonzero on a file creation failure.
+ */
+static int BenchRotate(BenchOptions *opt, BenchRunResult *result,
+		uint64_t *rotateNs, uint64_t *holdNs) {
+	FS_File *current = dlgFile.file;
+	FS_File *next = (current == &files[0]) ? &files[1] : &files[0];
+
+	if (dlgFile.nextFile != NULL || opt->rotateSize == 0) {
+		return 0;
+	}
+
+	if (next->state == FILE_Uninitialized || next->state == FILE_Closed) {
+		if (holdOwner == BENCH_HOLD_ROTATE) {
+			if (FS_IsFileHeld(current)) {
+				FS_CreateFileSeqName(&fs, &fs.rootDirectory, next, "DLG0000", DLG_FILE_EXT, 3, 4);
+			}
+		} else if (holdOwner == BENCH_HOLD_NONE
+				&& current->startCluster != 0 && !current->dirTableDirty
+				&& !dlgFile.requestClose
+				&& dlgFile.bufferFree >= BENCH_DLG_BUFFER_SIZE / 4 * 3) {
+			FS_HoldFile(current, 1);
+			holdOwner = BENCH_HOLD_ROTATE;
+			*holdNs = Host_Clock;
+		}
+	}
+	if (next->state == FILE_Creating) {
+		fs_result_t fsresult = FS_GetCreateFileResult(next);
+		if (fsresult == FS_BUSY) {
+			return 0;
+		}
+		FS_HoldFile(current, 0);
+		holdOwner = BENCH_HOLD_NONE;
+		if (Host_Clock - *holdNs > result->maxHoldNs) {
+			result->maxHoldNs = Host_Clock - *holdNs;
+		}
+		if (fsresult != FS_SUCCESS) {
+			fprintf(stderr, "Next file creation failed, got 0x%02x\n", fsresult);
+			return 1;
+		}
+	}
+
+	if (next->state == FILE_Idle && !dlgFile.requestClose
+			&& dlgFile.bufferFree >= BENCH_DLG_BUFFER_SIZE / 2
+			&& current->position >= opt->rotateSize) {
+		if (Datalogger_FlushCANRecorder(&dlgFile)
+				&& DataloggerFile_Rotate(&dlgFile, next)) {
+			Datalogger_InitCANRecorder(&dlgConfig);
+			DataloggerFile_WriteAtomic(&dlgFile, (uint8_t*)DLG_PRM_FMT, strlen(DLG_PRM_FMT));
+			DataloggerConfig_WriteParameters(&dlgConfig, &dlgFile);
+			*rotateNs = Host_Clock;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Builds the free extent map in the background, as Datalogger_ProcessFreeMap.
+ * @return 0 on success, nonzero on a scan failure.
+ */
+static int BenchFreeMap(FrameSource *src, BenchRunResult *result, uint64_t *holdNs) {
+	static uint8_t batch;
+	FS_File *current = dlgFile.file;
+	fs_result_t fsresult;
+
+	if (holdOwner == BENCH_HOLD_NONE) {
+		if (FAT32_FreeMapWaiting(&fs) || (fs.freeMapState == FS_FREEMAP_SCANNING
+				&& dlgFile.bufferFree >= BENCH_DLG_BUFFER_SIZE / 4 * 3)) {
+			FS_HoldFile(current, 1);
+			holdOwner = BENCH_HOLD_FREEMAP;
+			batch = 0;
+			*holdNs = Host_Clock;
+		}
+		return 0;
+	}
+	if (holdOwner != BENCH_HOLD_FREEMAP || !FS_IsFileHeld(current)) {
+		return 0;
+	}
+
+	fsresult = FAT32_FreeMapTasks(&fs);
+	if (fsresult == FS_BUSY) {
+		return 0;
+	}
+	batch++;
+	if (fsresult == FS_IDLE && (FAT32_FreeMapWaiting(&fs)
+			|| (batch < BENCH_FREEMAP_BATCH && dlgFile.bufferFree >= BENCH_DLG_BUFFER_SIZE / 2))) {
+		return 0;
+	}
+
+	FS_HoldFile(current, 0);
+	holdOwner = BENCH_HOLD_NONE;
+	if (Host_Clock - *holdNs > result->maxScanHoldNs) {
+		result->maxScanHoldNs = Host_Clock - *holdNs;
+	}
+	if (fsresult == FS_SUCCESS) {
+		if (result->freeMapNs == 0) {
+			result->freeMapNs = Host_Clock - src->startNs;
+		}
+	} else if (fsresult != FS_IDLE) {
+		fprintf(stderr, "Free extent map scan failed, got 0x%02x\n", fsresult);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Adds the loop profiler counters to the run result, then clears them, as
+ * Datalogger_ProcessPerfLogger does after writing them.
+ */
+static void BenchAddProfile(BenchRunResult *result) {
+	uint8_t i;
+
+	for (i=0;i<DLG_PROF_NUM_STAGES;i++) {
+		DataloggerProfileStage *stage = &Datalogger_Profile.stages[i];
+		LoopProfile_AddStage(&result->profile, i, Datalogger_Profile.loops,
+				stage->totalCycles, stage->maxCycles, stage->bins);
+	}
+	Datalogger_ProfileClear();
+}
+
+/**
+ * Adds the card busy time histograms to the run result, then clears them and
+ * sets the budget for the next interval, as Datalogger_ProcessPerfLogger does.
+ */
+static void BenchAddSDLatency(BenchRunResult *result) {
+	SDLatencyReport_AddHistograms(&result->sdLatency, card.Latency, card.LatencyBudget);
+	SD_Latency_Clear(&card);
+	SD_Latency_SetBudget(&card, DataloggerFile_GetLatencyBudget(&dlgFile));
+}
+
+/**
+ * Logs one run of CAN traffic, into one file, or several when rotating.
+ */
+static int BenchRun(BenchOptions *opt, FrameSource *src, BenchRunResult *result) {
+	fs_result_t fsresult;
+	uint64_t closeNs, rotateNs = 0, holdNs = 0, scanHoldNs = 0;
+	uint8_t maxFSFilled = 0;
+	seconds_t profileSeconds;
+	FS_File *current;
+
+	files[0].state = FILE_Uninitialized;
+	files[1].state = FILE_Uninitialized;
+	holdOwner = BENCH_HOLD_NONE;
+	fsresult = FS_CreateFileSeqName(&fs, &fs.rootDirectory, &files[0], "DLG0000", DLG_FILE_EXT, 3, 4);
+	while (fsresult == FS_BUSY) {
+		Host_AdvanceClock(opt->loopNs);
+		fsresult = FS_GetCreateFileResult(&files[0]);
+	}
+	if (fsresult != FS_SUCCESS) {
+		fprintf(stderr, "File creation failed, got 0x%02x\n", fsresult);
+		return 1;
+	}
+	AddFileName(result, &files[0]);
+
+	DataloggerFile_Init(&dlgFile, &files[0], dlgBuffer, BENCH_DLG_BUFFER_SIZE);
+	SD_Latency_Clear(&card);
+	SD_Latency_SetBudget(&card, DataloggerFile_GetLatencyBudget(&dlgFile));
+	Datalogger_InitCANRecorder(&dlgConfig);
+	DataloggerFile_WriteAtomic(&dlgFile, (uint8_t*)DLG_PRM_FMT, strlen(DLG_PRM_FMT));
+	DataloggerConfig_WriteParameters(&dlgConfig, &dlgFile);
+
+	// Start traffic
+	src->startNs = Host_Clock;
+	src->nextNs = Host_Clock;
+	src->busFreeNs = Host_Clock;
+	src->endNs = opt->durationMs ? Host_Clock + (uint64_t)opt->durationMs * 1000000 : 0;
+	src->tracePos = 0;
+	src->traceOffsetNs = 0;
+	src->frames = 0;
+	src->wanted = 0;
+	src->busBits = 0;
+	if (src->trace != NULL) {
+		SourceScaleTrace(src);
+		ECAN_Host_SetSource(TraceSource, src);
+	} else {
+		ECAN_Host_SetSource(SyntheticSource, src);
+	}
+	memset(&ECAN_Host_Stats, 0, sizeof(ECAN_Host_Stats));
+	UART_DMA_Init();
+	UART_DMA_HostBytes = 0;
+	UART_DMA_DroppedWrites = 0;
+	UART_DMA_DroppedBytes = 0;
+	UART_DMA_MaxUsed = 0;
+
+	// Main loop, in the same order as Datalogger_Loop
+	closeNs = 0;
+	Datalogger_ProfileInit();
+	profileSeconds = GetTimeSeconds();
+	while (1) {
+		struct timespec t0, t1;
+#ifdef DATALOGGER_COMPRESS
+		uint16_t bufferFree;
+#endif
+
+		Datalogger_ProfileMark(DLG_PROF_OTHER);
+		Datalogger_ProcessCANCommunications(&dlgFile);
+		Datalogger_ProfileMark(DLG_PROF_CAN);
+
+		current = dlgFile.file;
+#ifdef DATALOGGER_COMPRESS
+		// The RAM buffer only drains into the compressor
+		bufferFree = dlgFile.bufferFree;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+		fsresult = DataloggerFile_Tasks(&dlgFile);
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+		result->compressHostNs += (t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec);
+		result->compressed += dlgFile.bufferFree - bufferFree;
+		Host_AdvanceClock((uint64_t)opt->compressNs * (dlgFile.bufferFree - bufferFree));
+#else
+		fsresult = DataloggerFile_Tasks(&dlgFile);
+#endif
+		Datalogger_ProfileMark(DLG_PROF_FILE);
+		if (current->statMaxFilled > maxFSFilled) {
+			maxFSFilled = current->statMaxFilled;
+		}
+		if (fsresult == FS_CLOSED) {
+			break;
+		} else if (fsresult != FS_SUCCESS && fsresult != FS_IDLE && fsresult != FS_BUSY) {
+			fprintf(stderr, "File tasks failed, got 0x%02x\n", fsresult);
+			return 1;
+		}
+		if (dlgFile.file != current) {
+			AddFileName(result, dlgFile.file);
+			result->rotations++;
+			if (Host_Clock - rotateNs > result->maxRotateNs) {
+				result->maxRotateNs = Host_Clock - rotateNs;
+			}
+		}
+
+		if (!dlgFile.requestClose) {
+			Datalogger_ProfileMark(DLG_PROF_OTHER);
+			clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+			Datalogger_ProcessCANMessages(&dlgFile);
+			clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+			Datalogger_ProfileMark(DLG_PROF_CAN);
+			result->hostNs += (t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec);
+
+			if (BENCH_DLG_BUFFER_SIZE - dlgFile.bufferFree > result->maxRAMUsed) {
+				result->maxRAMUsed = BENCH_DLG_BUFFER_SIZE - dlgFile.bufferFree;
+			}
+
+			// Once the source has run dry and every frame has been read, close the file.
+			// The emulator always fetches one frame ahead, so this only
+			// happens after the source has returned its last frame.
+			ECAN_Host_Update();
+			if (ECAN_Host_Stats.Received == src->frames
+					&& C1RXFUL1 == 0 && C1RXFUL2 == 0) {
+				if (result->durationNs == 0) {
+					ECAN_Host_SetSource(NULL, NULL);
+					result->durationNs = Host_Clock - src->startNs;
+					closeNs = Host_Clock;
+				}
+				// An overflow summary waits for room in the RAM buffer
+				if (Datalogger_FlushCANRecorder(&dlgFile)) {
+					DataloggerFile_RequestClose(&dlgFile);
+				} else if (Host_Clock - closeNs > BENCH_TIMEOUT_NS) {
+					fprintf(stderr, "Timed out writing the overflow summary\n");
+					return 1;
+				}
+			}
+		} else if (Host_Clock - closeNs > BENCH_TIMEOUT_NS) {
+			fprintf(stderr, "Timed out closing file\n");
+			return 1;
+		}
+
+		if (BenchRotate(opt, result, &rotateNs, &holdNs)) {
+			return 1;
+		}
+		if (BenchFreeMap(src, result, &scanHoldNs)) {
+			return 1;
+		}
+		Datalogger_ProfileMark(DLG_PROF_FS);
+
+		Host_AdvanceClock(opt->loopNs);
+		Datalogger_ProfileMark(DLG_PROF_OTHER);
+		Datalogger_ProfileEndLoop();
+		if (GetTimeSeconds() != profileSeconds) {
+			BenchAddProfile(result);
+			BenchAddSDLatency(result);
+			profileSeconds = GetTimeSeconds();
+		}
+	}
+	BenchAddProfile(result);
+	BenchAddSDLatency(result);
+
+	result->offered = src->frames;
+	result->wanted = src->wanted;
+	result->busBits = src->busBits;
+	result->ecan = ECAN_Host_Stats;
+	result->maxFSFilled = maxFSFilled;
+	return 0;
+}
+
+/**
+ * Counts the CAN frames and overflow markers in a log file.
+ * @return 0 on success, nonzero if the file could not be read.
+ */
+static int CountFile(FAT32_Image *img, BenchRunResult *result, const char *name) {
+	uint32_t startCluster, size, i;
+	uint8_t *buffer;
+#ifdef DATALOGGER_COMPRESS
+	uint8_t *packed;
+#endif
+
+	if (FAT32_Image_FindFile(img, name, &startCluster, &size)) {
+		printf("Error: %.8s.%.3s not found\n", name, name + 8);
+		return 1;
+	}
+	buffer = malloc(size + 1);
+	if (buffer == NULL || FAT32_Image_ReadFile(img, startCluster, size, buffer)) {
+		printf("Error: unable to read %.8s.%.3s\n", name, name + 8);
+		free(buffer);
+		return 1;
+	}
+	result->fileSize += size;
+
+#ifdef DATALOGGER_COMPRESS
+	packed = buffer;
+	buffer = DLZ_Unpack(packed, size, &size, &result->dlz);
+	free(packed);
+	if (buffer == NULL) {
+		printf("Error: unable to unpack %.8s.%.3s\n", name, name + 8);
+		return 1;
+	}
+	if (result->dlz.badBlocks || result->dlz.skippedBytes) {
+		printf("Error: %.8s.%.3s %lu bad blocks, %lu bytes skipped\n", name,
+				name + 8, result->dlz.badBlocks, result->dlz.skippedBytes);
+	}
+#endif
+	result->rawSize += size;
+
+	i = 0;
+	while (i < size) {
+		uint8_t tag = buffer[i];
+		if (tag & DLG_REC_BINARY_MASK) {
+			if ((tag & ~DLG_REC_CAN_DLC_MASK) == DLG_REC_CAN) {
+				result->logged++;
+				i += DLG_REC_CAN_HEADER_LEN + (tag & DLG_REC_CAN_DLC_MASK);
+			} else if ((tag & ~DLG_REC_CAN_DLC_MASK) == DLG_REC_CAN_DELTA) {
+				uint8_t mask = (i + DLG_REC_CAN_DELTA_HEADER_LEN <= size)
+						? buffer[i+DLG_REC_CAN_DELTA_HEADER_LEN-1] : 0;
+				result->logged++;
+				result->deltas++;
+				i += DLG_REC_CAN_DELTA_HEADER_LEN;
+				for (;mask;mask>>=1) {
+					i += mask & 0x01;
+				}
+			} else if (tag == DLG_REC_TIME) {
+				i += DLG_REC_TIME_LEN;
+			} else if (tag == DLG_REC_COVF || tag == DLG_REC_MOVF) {
+				if (tag == DLG_REC_COVF) {
+					result->covf++;
+				} else {
+					result->movf++;
+				}
+				i += DLG_REC_MARKER_LEN;
+			} else if (tag == DLG_REC_SEEN) {
+				result->seen += buffer[i+4] | (buffer[i+5] << 8);
+				result->seenRecords++;
+				i += DLG_REC_SEEN_LEN;
+			} else if (tag == DLG_REC_OVERFLOW) {
+				result->summarized += buffer[i+7] | (buffer[i+8] << 8);
+				result->untracked += buffer[i+7] | (buffer[i+8] << 8);
+				result->overflows++;
+				i += DLG_REC_OVERFLOW_LEN;
+			} else if ((tag & ~DLG_REC_CAN_DLC_MASK) == DLG_REC_OVERFLOW_SID) {
+				result->summarized += buffer[i+3] | (buffer[i+4] << 8);
+				i += DLG_REC_OVERFLOW_SID_HEADER_LEN + (tag & DLG_REC_CAN_DLC_MASK);
+			} else {
+				printf("Error: %.8s.%.3s bad record 0x%02x at offset %u\n",
+						name, name + 8, tag, i);
+				break;
+			}
+		} else {
+			uint32_t end = i;
+			while (end < size && buffer[end] != '\n') {
+				end++;
+			}
+			if (end - i == 19 && memcmp(buffer + i, "CM ", 3) == 0
+					&& memcmp(buffer + i + 16, "OVF", 3) == 0) {
+				if (buffer[i+15] == 'C') {
+					result->covf++;
+				} else {
+					result->movf++;
+				}
+			} else if (memcmp(buffer + i, "CM ", 3) == 0) {
+				result->logged++;
+			} else if (end - i == 23 && memcmp(buffer + i, "CS ", 3) == 0) {
+				result->seen += strtoul((char*)buffer + i + 19, NULL, 16);
+				result->seenRecords++;
+			} else if (end - i == 31 && memcmp(buffer + i, "CO ", 3) == 0) {
+				result->summarized += strtoul((char*)buffer + i + 27, NULL, 16);
+				result->untracked += strtoul((char*)buffer + i + 27, NULL, 16);
+				result->overflows++;
+			} else if (memcmp(buffer + i, "CP ", 3) == 0) {
+				result->summarized += strtoul((char*)buffer + i + 7, NULL, 16);
+			}
+			i = end + 1;
+		}
+	}
+
+	free(buffer);
+	return 0;
+}
+
+/**
+ * Counts the CAN frames and overflow markers in all the log files of a run.
+ * @return Number of files which could not be read.
+ */
+static int CountLogged(FAT32_Image *img, BenchRunResult *result) {
+	int errors = 0;
+	uint32_t i;
+
+	for (i=0;i<result->numFiles;i++) {
+		errors += CountFile(img, result, result->names[i]);
+	}
+	return errors;
+}
+
+/**
+ * @return Frames which the configuration keeps but were not logged, nor
+ * counted in an overflow summary.
+ */
+static uint32_t RunLost(BenchRunResult *result) {
+	return result->wanted - result->logged - result->seen - result->summarized;
+}
+
+/**
+ * @return Frames which passed the acceptance filters but were dropped by the
+ * software filter.
+ */
+static uint32_t RunSoftwareFiltered(BenchRunResult *result) {
+	return result->offered - result->ecan.Filtered - result->wanted;
+}
+
+static void PrintRunResult(BenchOptions *opt, BenchRunResult *result) {
+	double seconds = result->durationNs / 1e9;
+	uint32_t read = result->ecan.Read - RunSoftwareFiltered(result) - result->seen;
+
+	printf("%.8s.%.3s: %.3f s, bus load %.1f%%, %u frames on the bus\n",
+			result->names[0], result->names[0] + 8, seconds,
+			result->busBits * BENCH_BIT_NS * 100.0 / result->durationNs, result->offered);
+	if (opt->rotateSize != 0) {
+		printf("  %u rotations into %u files, to %.8s.%.3s, %.1f ms max to switch, %.1f ms max held\n",
+				result->rotations, result->numFiles,
+				result->names[result->numFiles-1], result->names[result->numFiles-1] + 8,
+				result->maxRotateNs / 1e6, result->maxHoldNs / 1e6);
+	}
+	if (result->freeMapNs != 0 || result->maxScanHoldNs != 0) {
+		printf("  free extent map ");
+		if (result->freeMapNs != 0) {
+			printf("complete after %.3f s", result->freeMapNs / 1e9);
+		} else {
+			printf("incomplete");
+		}
+		printf(", %u extents, %.1f ms max held\n", fs.numFreeExtents, result->maxScanHoldNs / 1e6);
+	}
+	printf("  logged %u, lost %u (%u in ECAN overflows, %u in RAM buffer overflows), %u COVF, %u MOVF\n",
+			result->logged, RunLost(result), result->ecan.Overflows + result->ecan.Dropped,
+			read > result->logged + result->summarized ? read - result->logged - result->summarized : 0,
+			result->covf, result->movf);
+	if (result->overflows != 0) {
+		printf("  %u frames not logged while the RAM buffer was full, counted in %u overflow summaries (%u without SID)\n",
+				result->summarized, result->overflows, result->untracked);
+	}
+	if (!dlgConfig.keepAll) {
+		printf("  kept %u, %u filtered in hardware (%u filters, %u masks), %u in software\n",
+				result->wanted, result->ecan.Filtered, dlgConfig.numFilters,
+				dlgConfig.numMasks, RunSoftwareFiltered(result));
+	}
+	if (dlgConfig.numPolicies != 0) {
+		printf("  %u frames not logged by CHANGE / EVERY policies, counted in %u CS records\n",
+				result->seen, result->seenRecords);
+	}
+#ifdef DATALOGGER_CAN_DELTA
+	printf("  %u of the frames logged as deltas, %u bytes (%.1f bytes per frame)\n",
+			result->deltas, result->rawSize,
+			result->logged ? (double)result->rawSize / result->logged : 0);
+#endif
+	printf("  ECAN buffers max %u/%u full, read latency %.1f us avg, %.1f us max\n",
+			result->ecan.MaxFull, ECAN_NUM_BUFFERS - 4,
+			result->ecan.Read ? result->ecan.LatencyNs / 1e3 / result->ecan.Read : 0, result->ecan.MaxLatencyNs / 1e3);
+#ifdef ECAN_RX_INTERRUPT
+	printf("  RX queue max %u/%u, %u frames dropped\n",
+			result->ecan.MaxQueued, ECAN_RX_QUEUE_SIZE, result->ecan.Dropped);
+#endif
+	printf("  RAM buffer max %u/%u bytes, FS data buffers max %u/%u\n",
+			result->maxRAMUsed, BENCH_DLG_BUFFER_SIZE, result->maxFSFilled, FS_NUM_DATA_BUFFERS);
+	printf("  CPU per frame: %u ns modelled, %.0f ns on this host\n",
+			opt->frameNs, result->ecan.Read ? (double)result->hostNs / result->ecan.Read : 0);
+#if defined(DATALOGGER_CAN_UART) || defined(DATALOGGER_CAN_STREAM)
+	printf("  UART %llu bytes queued (%.1f%% of the wire), ring max %u/%u bytes, %u writes (%u bytes) dropped\n",
+			(unsigned long long)UART_DMA_HostBytes,
+			result->durationNs ? UART_DMA_HostBytes * 10 * 1e9 / UART_DMA_BAUD * 100 / result->durationNs : 0,
+			UART_DMA_MaxUsed, UART_DMA_RING_SIZE, UART_DMA_DroppedWrites, UART_DMA_DroppedBytes);
+#endif
+#ifdef DATALOGGER_COMPRESS
+	printf("  compressed %u -> %u bytes (%.1f%%), %lu blocks, %lu stored\n",
+			result->rawSize, result->fileSize,
+			result->rawSize ? result->fileSize * 100.0 / result->rawSize : 0,
+			result->dlz.blocks, result->dlz.storedBlocks);
+	printf("  CPU per byte compressed: %u ns modelled, %.1f ns on this host, %.1f%% of the run modelled\n",
+			opt->compressNs, result->compressed ? (double)result->compressHostNs / result->compressed : 0,
+			(double)opt->compressNs * result->compressed * 100.0 / result->durationNs);
+#endif
+	LoopProfile_Print(stdout, &result->profile);
+	SDLatencyReport_Print(stdout, &result->sdLatency);
+}
+
+static void PrintSweepRow(BenchRunResult *result) {
+	uint32_t read = result->ecan.Read;
+	printf("%5u%% %7.1f%% %8u %8u %8u %8u %6u %6u %5u/%u %6u %8.1f %8.0f\n",
+			result->load, result->busBits * BENCH_BIT_NS * 100.0 / result->durationNs,
+			result->offered, result->logged, result->summarized, RunLost(result),
+			result->covf, result->movf,
+			result->ecan.MaxFull, ECAN_NUM_BUFFERS - 4, result->maxRAMUsed,
+			result->ecan.MaxLatencyNs / 1e3, read ? (double)result->hostNs / read : 0);
+}
+
+static void PrintCardStats() {
+	printf("Card: %u commands, %u blocks written (%u MBW in %u runs, %u SBW)\n",
+			SD_Host_Stats.Commands, SD_Host_Stats.BlocksWritten,
+			SD_Host_Stats.MBWBlocks, SD_Host_Stats.MBWBegins, SD_Host_Stats.SBWs);
+	printf("  busy %.3f ms total, %.3f ms max, %u stalls, %u protocol errors\n",
+			SD_Host_Stats.BusyNs / 1e6, SD_Host_Stats.MaxBusyNs / 1e6,
+			SD_Host_Stats.Stalls, SD_Host_Stats.Errors);
+}
+
+static void Usage() {
+	fprintf(stderr, "Usage: can-bench [-i image] [-F MiB] [-c spc] [-C config] [-p profile] [-t trace]"
+			" [-L pct] [-d ms] [-D dlc] [-s sids] [-R n] [-V n] [-f ns] [-l ns] [-z ns] [-r bytes] [-S] [-u path]\n");
+}
+
+int main(int argc, char **argv) {
+	BenchOptions opt;
+	BenchRunResult results[BENCH_MAX_RUNS];
+	FrameSource src;
+	const SD_Host_Profile *profile;
+	FAT32_Image img;
+	uint32_t i, numRuns;
+	int c, errors = 0, loadSet = 0, durationSet = 0;
+
+	opt.imagePath = "can-bench.img";
+	opt.formatMB = 0;
+	opt.sectorsPerCluster = 8;
+	opt.configPath = NULL;
+	opt.profile = "typical";
+	opt.tracePath = NULL;
+	opt.load = 50;
+	opt.durationMs = 10000;
+	opt.dlc = 8;
+	opt.numSIDs = 32;
+	opt.repeat = 1;
+	opt.vary = 8;
+	opt.frameNs = 30000;
+	opt.loopNs = 50000;
+	opt.compressNs = 500;
+	opt.rotateSize = 0;
+	opt.sweep = 0;
+	opt.uartPath = NULL;
+
+	while ((c = getopt(argc, argv, "i:F:c:C:p:t:L:d:D:s:R:V:f:l:z:r:Su:")) != -1) {
+		switch (c) {
+			case 'i':	opt.imagePath = optarg;						break;
+			case 'F':	opt.formatMB = strtoul(optarg, NULL, 0);	break;
+			case 'c':	opt.sectorsPerCluster = strtoul(optarg, NULL, 0);	break;
+			case 'C':	opt.configPath = optarg;					break;
+			case 'p':	opt.profile = optarg;						break;
+			case 't':	opt.tracePath = optarg;						break;
+			case 'L':	opt.load = strtoul(optarg, NULL, 0);	loadSet = 1;		break;
+			case 'd':	opt.durationMs = strtoul(optarg, NULL, 0);	durationSet = 1;	break;
+			case 'D':	opt.dlc = strtoul(optarg, NULL, 0);			break;
+			case 's':	opt.numSIDs = strtoul(optarg, NULL, 0);		break;
+			case 'R':	opt.repeat = strtoul(optarg, NULL, 0);		break;
+			case 'V':	opt.vary = strtoul(optarg, NULL, 0);		break;
+			case 'f':	opt.frameNs = strtoul(optarg, NULL, 0);		break;
+			case 'l':	opt.loopNs = strtoul(optarg, NULL, 0);		break;
+			case 'z':	opt.compressNs = strtoul(optarg, NULL, 0);	break;
+			case 'r':	opt.rotateSize = strtoul(optarg, NULL, 0);	break;
+			case 'S':	opt.sweep = 1;								break;
+			case 'u':	opt.uartPath = optarg;						break;
+			default:	Usage();	return 2;
+		}
+	}
+	if (opt.dlc > 8 || opt.numSIDs == 0 || opt.repeat == 0 || opt.load > 100
+			|| (opt.load == 0 && opt.tracePath == NULL)) {
+		Usage();
+		return 2;
+	}
+
+	memset(&src, 0, sizeof(src));
+	src.opt = &opt;
+	src.random = 0x2545f491;
+	if (opt.tracePath != NULL) {
+		src.traceLen = ReadTrace(opt.tracePath, &src.trace);
+		if (src.traceLen == 0) {
+			return 1;
+		}
+		if (!loadSet) {
+			opt.load = 0;
+		}
+		if (!durationSet) {
+			opt.durationMs = 0;
+		}
+	}
+
+	profile = SD_Host_FindProfile(opt.profile);
+	if (profile == NULL) {
+		fprintf(stderr, "Unknown profile '%s'\n", opt.profile);
+		return 2;
+	}
+
+	if (opt.formatMB != 0) {
+		if (FAT32_Image_Format(opt.imagePath, opt.formatMB, opt.sectorsPerCluster, 1)) {
+			return 1;
+		}
+	}
+
+	if (opt.configPath != NULL && AddConfigFile(opt.imagePath, opt.configPath)) {
+		return 1;
+	}
+	if (opt.uartPath != NULL && (UART_DMA_HostOutput = fopen(opt.uartPath, "wb")) == NULL) {
+		perror(opt.uartPath);
+		return 1;
+	}
+
+	Timing_Init();
+	SD_Host_SetProfile(profile);
+	if (!SD_Host_OpenImage(opt.imagePath)) {
+		return 1;
+	}
+	if (BenchInit(&opt)) {
+		SD_Host_CloseImage();
+		return 1;
+	}
+	printf("Profile %s, %u bit/s, %s, frame %u ns, loop %u ns, %u FS data buffers\n",
+			profile->Name, ECAN_BITRATE,
+			opt.tracePath != NULL ? opt.tracePath : "synthetic traffic",
+			opt.frameNs, opt.loopNs, FS_NUM_DATA_BUFFERS);
+	memset(&SD_Host_Stats, 0, sizeof(SD_Host_Stats));
+
+	numRuns = opt.sweep ? 10 : 1;
+	memset(results, 0, sizeof(results));
+	for (i=0;i<numRuns;i++) {
+		src.load = opt.sweep ? (i + 1) * 10 : opt.load;
+		results[i].load = src.load;
+		if (BenchRun(&opt, &src, &results[i])) {
+			errors++;
+			numRuns = i;
+			break;
+		}
+	}
+	PrintCardStats();
+	SD_Host_CloseImage();
+	if (UART_DMA_HostOutput != NULL) {
+		fclose(UART_DMA_HostOutput);
+	}
+
+	if (FAT32_Image_Open(&img, opt.imagePath)) {
+		return 1;
+	}
+	errors += FAT32_Image_Check(&img, 0);
+	for (i=0;i<numRuns;i++) {
+		errors += CountLogged(&img, &results[i]);
+	}
+	FAT32_Image_Close(&img);
+
+	if (opt.sweep) {
+		uint32_t saturation = 0;
+		printf("  Load    Bus   Frames   Logged  Summary     Lost   COVF   MOVF  ECAN    RAM  Lat(us) Host(ns)\n");
+		for (i=0;i<numRuns;i++) {
+			PrintSweepRow(&results[i]);
+			if (RunLost(&results[i]) == 0 && results[i].summarized == 0 && saturation == i * 10) {
+				saturation = (i + 1) * 10;
+			}
+		}
+		if (saturation == 0) {
+			printf("Frames lost at every load\n");
+		} else {
+			printf("No frames lost up to %u%% bus load\n", saturation);
+		}
+	} else if (numRuns > 0) {
+		PrintRunResult(&opt, &results[0]);
+	}
+	free(src.trace);
+
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,498 @@
+/*
+ * File:   dbg-expand.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:55 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Host tool which expands deferred debug log records (see debug-deferred.h)
+ * in a captured UART stream into the usual text messages. Text in the stream
+ * is passed through unchanged.
+ *
+ * The format strings are found by scanning the firmware source for
+ * DBG_*printf calls and hashing their format string literals the same way
+ * the firmware does. The source line in each record tells apart identical
+ * format strings, and gives the module name from that file's DBG_MODULE.
+ * A format string built with macros can't be found, and its records are
+ * printed raw.
+ *
+ * Usage: dbg-expand [-s srcdir] [input [output]]
+ *   -s srcdir   Firmware source directory, scanned recursively (default ..)
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../debug-deferred.h"
+
+typedef struct {
+	uint32_t hash;
+	uint32_t firstLine;		/// Line of the macro name.
+	uint32_t lastLine;		/// Line of the end of the format string.
+	const char *module;		/// DBG_MODULE of the file, or the file path.
+	char *format;
+} FormatEntry;
+
+typedef struct {
+	FormatEntry *entries;
+	size_t numEntries;
+	size_t maxEntries;
+	unsigned long numFiles;
+} FormatTable;
+
+typedef struct {
+	FILE *out;
+	FormatTable *table;
+
+	unsigned long numRecords;	/// Number of records expanded.
+	unsigned long numUnknown;	/// Number of records with no format string found.
+	unsigned long numTruncated;	/// Number of records with arguments left out.
+	unsigned long numDropped;	/// Number of records the firmware reported dropped.
+	unsigned long numBad;		/// Number of records with a bad length.
+} ExpandState;
+
+static const char *LevelNames[] = {"Info", "Err ", "Data", "Spam"};
+
+static const char *MacroNames[] = {"DBG_printf", "DBG_ERR_printf", "DBG_DATA_printf", "DBG_SPAM_printf"};
+
+/**
+ * Decodes a C string literal starting after its opening quote.
+ * @param p Position after the opening quote, updated to after the closing quote.
+ * @param line Line counter, updated.
+ * @param out Buffer the decoded bytes are appended to.
+ * @param outLen Length of the decoded bytes in the buffer, updated.
+ * @param outMax Size of the buffer.
+ * @return 0 on success, nonzero if the literal isn't terminated.
+ */
+static int ParseLiteral(const char **p, uint32_t *line, char *out, size_t *outLen, size_t outMax) {
+	const char *s = *p;
+
+	while (*s != 0 && *s != '"') {
+		char c = *s++;
+		if (c == '\n') {
+			return 1;
+		} else if (c == '\\') {
+			c = *s++;
+			switch (c) {
+				case 'n':	c = '\n';	break;
+				case 'r':	c = '\r';	break;
+				case 't':	c = '\t';	break;
+				case 'a':	c = '\a';	break;
+				case 'b':	c = '\b';	break;
+				case 'f':	c = '\f';	break;
+				case 'v':	c = '\v';	break;
+				case '\n':	(*line)++;	continue;
+				case 'x': {
+					int value = 0;
+					while ((*s >= '0' && *s <= '9') || (*s >= 'a' && *s <= 'f') || (*s >= 'A' && *s <= 'F')) {
+						value = value * 16 + (*s <= '9' ? *s - '0' : (*s | 0x20) - 'a' + 10);
+						s++;
+					}
+					c = value;
+					break;
+				}
+				default:
+					if (c >= '0' && c <= '7') {
+						int value = c - '0', i;
+						for (i=0;i<2 && *s >= '0' && *s <= '7';i++) {
+							value = value * 8 + (*s++ - '0');
+						}
+						c = value;
+					} else if (c == 0) {
+						return 1;
+					}
+					break;
+			}
+		}
+		if (*outLen < outMax - 1) {
+			out[(*outLen)++] = c;
+		}
+	}
+	if (*s != '"') {
+		return 1;
+	}
+	*p = s + 1;
+	return 0;
+}
+
+/**
+ * Skips whitespace and comments.
+ */
+static const char *SkipSpace(const char *s, uint32_t *line) {
+	while (1) {
+		if (*s == '\n') {
+			(*line)++;
+			s++;
+		} else if (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\\') {
+			s++;
+		} else if (s[0] == '/' && s[1] == '*') {
+			s += 2;
+			while (*s != 0 && !(s[0] == '*' && s[1] == '/')) {
+				if (*s == '\n') {
+					(*line)++;
+				}
+				s++;
+			}
+			if (*s != 0) {
+				s += 2;
+			}
+		} else if (s[0] == '/' && s[1] == '/') {
+			while (*s != 0 && *s != '\n') {
+				s++;
+			}
+		} else {
+			return s;
+		}
+	}
+}
+
+static void AddEntry(FormatTable *table, FormatEntry *entry) {
+	if (table->numEntries == table->maxEntries) {
+		table->maxEntries = table->maxEntries ? table->maxEntries * 2 : 256;
+		table->entries = realloc(table->entries, table->maxEntries * sizeof(FormatEntry));
+		if (table->entries == NULL) {
+			fprintf(stderr, "dbg-expand: out of memory\n");
+			exit(1);
+		}
+	}
+	table->entries[table->numEntries++] = *entry;
+}
+
+/**
+ * Finds the DBG_*printf calls with literal format strings in a source file.
+ */
+static void ScanFile(FormatTable *table, const char *path) {
+	FILE *file = fopen(path, "rb");
+	char *text, *module = NULL;
+	const char *s;
+	long size;
+	uint32_t line = 1;
+
+	if (file == NULL) {
+		perror(path);
+		return;
+	}
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	text = malloc(size + 1);
+	if (text == NULL || fread(text, 1, size, file) != (size_t)size) {
+		fprintf(stderr, "dbg-expand: unable to read %s\n", path);
+		fclose(file);
+		free(text);
+		return;
+	}
+	fclose(file);
+	text[size] = 0;
+	table->numFiles++;
+
+	// The module name, as the file defines it for the debug macros
+	if ((s = strstr(text, "#define DBG_MODULE \"")) != NULL) {
+		const char *end = strchr(s + 20, '"');
+		if (end != NULL) {
+			module = strndup(s + 20, end - s - 20);
+		}
+	}
+	if (module == NULL) {
+		module = strdup(path);
+	}
+
+	for (s = text; *s != 0; s++) {
+		size_t i;
+
+		if (*s == '\n') {
+			line++;
+			continue;
+		}
+		if (*s != 'D' || (s > text && (isalnum((unsigned char)s[-1]) || s[-1] == '_'))) {
+			continue;
+		}
+		for (i=0;i<sizeof(MacroNames)/sizeof(MacroNames[0]);i++) {
+			size_t nameLen = strlen(MacroNames[i]);
+			if (strncmp(s, MacroNames[i], nameLen) == 0 && s[nameLen] == '(') {
+				FormatEntry entry;
+				char format[1024];
+				size_t formatLen = 0;
+				uint32_t callLine = line;
+				const char *p = SkipSpace(s + nameLen + 1, &line);
+				uint32_t hash = DBG_DEFER_HASH_INIT;
+				size_t j;
+
+				if (*p != '"') {
+					break;		// Not a literal, such as the macro definitions
+				}
+				while (*p == '"') {
+					p++;
+					if (ParseLiteral(&p, &line, format, &formatLen, sizeof(format))) {
+						break;
+					}
+					p = SkipSpace(p, &line);
+				}
+				format[formatLen] = 0;
+				for (j=0;j<formatLen;j++) {
+					hash = DBG_Deferred_Hash(hash, format[j]);
+				}
+
+				entry.hash = hash;
+				entry.firstLine = callLine;
+				entry.lastLine = line;
+				entry.module = module;
+				entry.format = strdup(format);
+				AddEntry(table, &entry);
+
+				s = p - 1;
+				break;
+			}
+		}
+	}
+	free(text);
+}
+
+/**
+ * Scans a directory tree for C sources.
+ */
+static void ScanDir(FormatTable *table, const char *path) {
+	DIR *dir = opendir(path);
+	struct dirent *ent;
+
+	if (dir == NULL) {
+		perror(path);
+		return;
+	}
+	while ((ent = readdir(dir)) != NULL) {
+		char child[4096];
+		struct stat st;
+		size_t len = strlen(ent->d_name);
+
+		if (ent->d_name[0] == '.') {
+			continue;
+		}
+		snprintf(child, sizeof(child), "%s/%s", path, ent->d_name);
+		if (stat(child, &st) != 0) {
+			continue;
+		}
+		if (S_ISDIR(st.st_mode)) {
+			ScanDir(table, child);
+		} else if (len > 2 && (strcmp(ent->d_name + len - 2, ".c") == 0
+				|| strcmp(ent->d_name + len - 2, ".h") == 0)) {
+			ScanFile(table, child);
+		}
+	}
+	closedir(dir);
+}
+
+/**
+ * Finds the format string of a record, preferring one whose call spans the line.
+ */
+static FormatEntry *FindEntry(FormatTable *table, uint32_t hash, uint32_t line) {
+	FormatEntry *found = NULL;
+	size_t i;
+
+	for (i=0;i<table->numEntries;i++) {
+		FormatEntry *entry = &table->entries[i];
+		if (entry->hash != hash) {
+			continue;
+		}
+		if (line >= entry->firstLine && line <= entry->lastLine) {
+			return entry;
+		}
+		if (found == NULL) {
+			found = entry;
+		}
+	}
+	return found;
+}
+
+/**
+ * Prints the message of a record, formatting each conversion with its
+ * argument from the record.
+ */
+static void PrintMessage(FILE *out, const char *f, const uint8_t *args, size_t argsLen) {
+	size_t pos = 0;
+
+	while (*f != 0) {
+		char spec[32];
+		size_t specLen = 0;
+		int isLong = 0;
+
+		if (*f != '%') {
+			fputc(*f++, out);
+			continue;
+		}
+		spec[specLen++] = *f++;
+		while (*f != 0 && strchr("-+ #0123456789.", *f) != NULL && specLen < sizeof(spec) - 4) {
+			spec[specLen++] = *f++;
+		}
+		while (*f == 'l' || *f == 'h') {
+			isLong |= (*f == 'l');
+			f++;
+		}
+		if (*f == 0) {
+			break;
+		}
+		if (*f == '%') {
+			fputc('%', out);
+			f++;
+			continue;
+		}
+
+		if (*f == 's') {
+			const uint8_t *end = memchr(args + pos, 0, argsLen - pos);
+			if (end == NULL) {
+				fputs("?", out);
+				pos = argsLen;
+			} else {
+				spec[specLen++] = 's';
+				spec[specLen] = 0;
+				fprintf(out, spec, (const char*)args + pos);
+				pos = end - args + 1;
+			}
+		} else if (isLong) {
+			if (pos + 4 > argsLen) {
+				fputs("?", out);
+			} else {
+				uint32_t value = args[pos] | (args[pos+1] << 8)
+						| ((uint32_t)args[pos+2] << 16) | ((uint32_t)args[pos+3] << 24);
+				spec[specLen++] = 'l';
+				spec[specLen++] = *f;
+				spec[specLen] = 0;
+				if (*f == 'd' || *f == 'i') {
+					fprintf(out, spec, (long)(int32_t)value);
+				} else {
+					fprintf(out, spec, (unsigned long)value);
+				}
+				pos += 4;
+			}
+		} else {
+			if (pos + 2 > argsLen) {
+				fputs("?", out);
+			} else {
+				uint16_t value = args[pos] | (args[pos+1] << 8);
+				spec[specLen++] = *f;
+				spec[specLen] = 0;
+				if (*f == 'd' || *f == 'i') {
+					fprintf(out, spec, (int)(int16_t)value);
+				} else {
+					fprintf(out, spec, (unsigned int)value);
+				}
+				pos += 2;
+			}
+		}
+		f++;
+	}
+}
+
+/**
+ * Expands a single complete record, from the level byte on.
+ */
+static void ExpandRecord(ExpandState *state, const uint8_t *rec, size_t len) {
+	uint8_t level = rec[0] & DBG_DEFER_LEVEL_MASK;
+	uint32_t line = rec[1] | (rec[2] << 8);
+	uint32_t hash = rec[3] | (rec[4] << 8) | ((uint32_t)rec[5] << 16) | ((uint32_t)rec[6] << 24);
+	const uint8_t *args = rec + DBG_DEFER_HEADER_LEN - 2;
+	size_t argsLen = len - (DBG_DEFER_HEADER_LEN - 2);
+	FormatEntry *entry;
+
+	if (level == DBG_DEFER_LEVEL_DROPPED) {
+		uint16_t count = argsLen >= 2 ? args[0] | (args[1] << 8) : 0;
+		fprintf(state->out, "[Drop] %u records dropped\n", count);
+		state->numDropped += count;
+		return;
+	}
+
+	state->numRecords++;
+	fprintf(state->out, "[%s] ", level < 4 ? LevelNames[level] : "????");
+	entry = FindEntry(state->table, hash, line);
+	if (entry == NULL) {
+		size_t i;
+		fprintf(state->out, "? %u: unknown format %08X,", line, hash);
+		for (i=0;i<argsLen;i++) {
+			fprintf(state->out, " %02X", args[i]);
+		}
+		state->numUnknown++;
+	} else {
+		fprintf(state->out, "%s %u: ", entry->module, line);
+		PrintMessage(state->out, entry->format, args, argsLen);
+	}
+	if (rec[0] & DBG_DEFER_TRUNCATED) {
+		fprintf(state->out, " [truncated]");
+		state->numTruncated++;
+	}
+	fputc('\n', state->out);
+}
+
+static void Expand(ExpandState *state, FILE *in) {
+	uint8_t rec[DBG_DEFER_MAX_RECORD];
+	int c;
+
+	while ((c = fgetc(in)) != EOF) {
+		int len;
+
+		if (c != DBG_DEFER_START) {
+			fputc(c, state->out);
+			continue;
+		}
+		len = fgetc(in);
+		if (len == EOF) {
+			break;
+		}
+		if (len < DBG_DEFER_HEADER_LEN - 2 || len > DBG_DEFER_MAX_RECORD - 2) {
+			state->numBad++;
+			continue;
+		}
+		if (fread(rec, 1, len, in) != (size_t)len) {
+			fprintf(stderr, "dbg-expand: truncated record at end of input\n");
+			break;
+		}
+		ExpandRecord(state, rec, len);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	FormatTable table;
+	ExpandState state;
+	const char *srcDir = "..";
+	FILE *in = stdin;
+	int c;
+
+	while ((c = getopt(argc, argv, "s:")) != -1) {
+		switch (c) {
+			case 's':	srcDir = optarg;	break;
+			default:
+				fprintf(stderr, "Usage: dbg-expand [-s srcdir] [input [output]]\n");
+				return 1;
+		}
+	}
+
+	memset(&table, 0, sizeof(table));
+	memset(&state, 0, sizeof(state));
+	state.out = stdout;
+	state.table = &table;
+
+	if (optind < argc && (in = fopen(argv[optind], "rb")) == NULL) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if (optind + 1 < argc && (state.out = fopen(argv[optind + 1], "w")) == NULL) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+
+	ScanDir(&table, srcDir);
+	Expand(&state, in);
+
+	fprintf(stderr, "dbg-expand: %lu format strings in %lu files, %lu records (%lu unknown, %lu truncated), %lu dropped, %lu bad\n",
+			(unsigned long)table.numEntries, table.numFiles, state.numRecords,
+			state.numUnknown, state.numTruncated, state.numDropped, state.numBad);
+	return 0;
+}
@@ -0,0 +1,259 @@
+/*
+ * File:   dlg-decode.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:02 AM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Decode PRM FMT 3 delta records.
+ * 17 Oct 2026	agent	Decode overflow summary records.
+ * 17 Oct 2026	agent	Loop profile report from the PS records.
+ * 17 Oct 2026	agent	SD Card busy time report from the PS records.
+ *
+ * @file
+ * Host tool which converts a PRM FMT 2 or 3 (binary CAN record) log into the
+ * PRM FMT 1 ASCII format, so existing parsers can read it.
+ * Delta records of a SID before its first keyframe can't be decoded and are
+ * counted and dropped.
+ * ASCII lines are passed through unchanged.
+ * If the log has per-stage loop profile records, the loop profile report
+ * (see loop-profile.h) is printed to stderr at the end, and likewise the SD
+ * Card busy time report (see sd-latency-report.h).
+ *
+ * Usage: dlg-decode [input.dla [output.txt]]
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../Datalogger/datalogger-records.h"
+
+#include "loop-profile.h"
+#include "sd-latency-report.h"
+
+typedef struct {
+	FILE *out;
+
+	uint32_t time;			/// Time of the last binary record.
+	uint8_t timeValid;		/// Whether a time record has been seen.
+
+	uint8_t lastDLC[2048];	/// DLC of the last CAN record of each SID, 0xff if none.
+	uint8_t lastData[2048][8];	/// Payload of the last CAN record of each SID.
+	uint32_t overflowStart;	/// Start time of the last overflow summary.
+
+	unsigned long numText;	/// Number of ASCII lines passed through.
+	unsigned long numCAN;	/// Number of CAN records decoded.
+	unsigned long numDelta;	/// Number of which were delta records.
+	unsigned long numUnkeyed;	/// Number of delta records dropped for lack of a keyframe.
+	unsigned long numCOVF;	/// Number of CAN hardware overflow markers.
+	unsigned long numMOVF;	/// Number of message overflow markers.
+	unsigned long numSeen;	/// Number of frames seen records.
+	unsigned long numOverflows;	/// Number of overflow summaries.
+	unsigned long numOverflowFrames;	/// Number of frames in overflow summaries.
+	unsigned long numBad;	/// Number of bytes skipped as undecodable.
+
+	LoopProfile profile;	/// Loop profile from the PS records.
+	SDLatencyReport sdLatency;	/// SD Card busy times from the PS records.
+} DecodeState;
+
+/**
+ * Returns the length of the binary record starting with a tag byte, or 0 if
+ * the tag is not recognized. For delta records, this is the length up to and
+ * including the change mask.
+ */
+static size_t RecordLength(uint8_t tag) {
+	if ((tag & ~DLG_REC_CAN_DLC_MASK) == DLG_REC_CAN
+			&& (tag & DLG_REC_CAN_DLC_MASK) <= 8) {
+		return DLG_REC_CAN_HEADER_LEN + (tag & DLG_REC_CAN_DLC_MASK);
+	} else if ((tag & ~DLG_REC_CAN_DLC_MASK) == DLG_REC_CAN_DELTA
+			&& (tag & DLG_REC_CAN_DLC_MASK) <= 8) {
+		return DLG_REC_CAN_DELTA_HEADER_LEN;
+	} else if (tag == DLG_REC_TIME) {
+		return DLG_REC_TIME_LEN;
+	} else if (tag == DLG_REC_COVF || tag == DLG_REC_MOVF) {
+		return DLG_REC_MARKER_LEN;
+	} else if (tag == DLG_REC_SEEN) {
+		return DLG_REC_SEEN_LEN;
+	} else if (tag == DLG_REC_OVERFLOW) {
+		return DLG_REC_OVERFLOW_LEN;
+	} else if ((tag & ~DLG_REC_CAN_DLC_MASK) == DLG_REC_OVERFLOW_SID
+			&& (tag & DLG_REC_CAN_DLC_MASK) <= 8) {
+		return DLG_REC_OVERFLOW_SID_HEADER_LEN + (tag & DLG_REC_CAN_DLC_MASK);
+	}
+	return 0;
+}
+
+/**
+ * Decodes a single complete binary record.
+ */
+static void DecodeRecord(DecodeState *state, const uint8_t *rec) {
+	uint8_t tag = rec[0];
+
+	if (tag == DLG_REC_TIME) {
+		state->time = (uint32_t)rec[1] | ((uint32_t)rec[2] << 8)
+				| ((uint32_t)rec[3] << 16) | ((uint32_t)rec[4] << 24);
+		state->timeValid = 1;
+		return;
+	} else if ((tag & ~DLG_REC_CAN_DLC_MASK) == DLG_REC_OVERFLOW_SID) {
+		// Part of the preceding overflow summary, with no time delta
+		uint8_t dlc = tag & DLG_REC_CAN_DLC_MASK;
+		uint16_t count = rec[3] | (rec[4] << 8);
+		uint8_t i;
+
+		fprintf(state->out, "CP %03X %04X %08X %08X %X", (rec[1] | (rec[2] << 8)) & 0x7ff, count,
+				state->overflowStart + (rec[5] | (rec[6] << 8)),
+				state->overflowStart + (rec[7] | (rec[8] << 8)), dlc);
+		for (i=0;i<dlc;i++) {
+			fprintf(state->out, "%c%02X", (i == 0) ? ' ' : ',', rec[DLG_REC_OVERFLOW_SID_HEADER_LEN+i]);
+		}
+		fputc('\n', state->out);
+		state->numOverflowFrames += count;
+		return;
+	}
+
+	if (!state->timeValid) {
+		fprintf(stderr, "dlg-decode: record 0x%02x before time base\n", tag);
+	}
+	state->time += rec[1];
+
+	if (tag == DLG_REC_COVF || tag == DLG_REC_MOVF) {
+		fprintf(state->out, "CM %08X/%02X %cOVF\n", state->time, rec[1],
+				(tag == DLG_REC_COVF) ? 'C' : 'M');
+		if (tag == DLG_REC_COVF) {
+			state->numCOVF++;
+		} else {
+			state->numMOVF++;
+		}
+	} else if (tag == DLG_REC_SEEN) {
+		fprintf(state->out, "CS %08X/%02X %03X %04X\n", state->time, rec[1],
+				(rec[2] | (rec[3] << 8)) & 0x7ff, rec[4] | (rec[5] << 8));
+		state->numSeen++;
+	} else if (tag == DLG_REC_OVERFLOW) {
+		state->overflowStart = (uint32_t)rec[2] | ((uint32_t)rec[3] << 8)
+				| ((uint32_t)rec[4] << 16) | ((uint32_t)rec[5] << 24);
+		fprintf(state->out, "CO %08X/%02X %08X %02X %04X\n", state->time, rec[1],
+				state->overflowStart, rec[6], rec[7] | (rec[8] << 8));
+		state->numOverflows++;
+		state->numOverflowFrames += rec[7] | (rec[8] << 8);
+	} else {
+		uint8_t dlc = tag & DLG_REC_CAN_DLC_MASK;
+		uint16_t sid = (rec[2] | (rec[3] << 8)) & 0x7ff;
+		uint8_t *data = state->lastData[sid];
+		uint8_t i;
+
+		if ((tag & ~DLG_REC_CAN_DLC_MASK) == DLG_REC_CAN_DELTA) {
+			const uint8_t *diff = rec + DLG_REC_CAN_DELTA_HEADER_LEN;
+			if (state->lastDLC[sid] != dlc) {
+				state->numUnkeyed++;
+				return;
+			}
+			for (i=0;i<dlc;i++) {
+				if (rec[DLG_REC_CAN_DELTA_HEADER_LEN-1] & (1 << i)) {
+					data[i] ^= *diff++;
+				}
+			}
+			state->numDelta++;
+		} else {
+			memcpy(data, rec + DLG_REC_CAN_HEADER_LEN, dlc);
+			state->lastDLC[sid] = dlc;
+		}
+
+		fprintf(state->out, "CM %08X/%02X 0 00 %X %03X", state->time, rec[1],
+				dlc, sid & 0x7ff);
+		for (i=0;i<dlc;i++) {
+			fprintf(state->out, "%c%02X", (i == 0) ? ' ' : ',', data[i]);
+		}
+		fputc('\n', state->out);
+		state->numCAN++;
+	}
+}
+
+/**
+ * Decodes a whole log stream.
+ */
+static void Decode(DecodeState *state, FILE *in) {
+	uint8_t rec[DLG_REC_OVERFLOW_SID_HEADER_LEN + 8];
+	size_t recLen = 0, recNeeded = 0;
+	char line[256];
+	size_t lineLen = 0;
+	int c;
+
+	while ((c = fgetc(in)) != EOF) {
+		if (recNeeded > 0) {
+			// Continue a binary record
+			rec[recLen++] = c;
+			if (recLen == DLG_REC_CAN_DELTA_HEADER_LEN
+					&& (rec[0] & ~DLG_REC_CAN_DLC_MASK) == DLG_REC_CAN_DELTA) {
+				// Extend to the changed bytes, popcount of the mask
+				uint8_t mask = c;
+				for (;mask;mask>>=1) {
+					recNeeded += mask & 0x01;
+				}
+			}
+			if (recLen == recNeeded) {
+				DecodeRecord(state, rec);
+				recNeeded = 0;
+			}
+		} else if (lineLen > 0 || !(c & DLG_REC_BINARY_MASK)) {
+			// ASCII line
+			if (lineLen < sizeof(line) - 1) {
+				line[lineLen++] = c;
+			}
+			if (c == '\n') {
+				line[lineLen] = 0;
+				if (strcmp(line, "PRM FMT 2\n") == 0 || strcmp(line, "PRM FMT 3\n") == 0) {
+					strcpy(line, "PRM FMT 1\n");
+				}
+				fputs(line, state->out);
+				LoopProfile_ParseLine(&state->profile, line);
+				SDLatencyReport_ParseLine(&state->sdLatency, line);
+				state->numText++;
+				lineLen = 0;
+			}
+		} else if ((recNeeded = RecordLength(c)) > 0) {
+			rec[0] = c;
+			recLen = 1;
+		} else {
+			state->numBad++;
+		}
+	}
+
+	if (recNeeded > 0 || lineLen > 0) {
+		fprintf(stderr, "dlg-decode: truncated record at end of file\n");
+	}
+}
+
+int main(int argc, char *argv[]) {
+	DecodeState state;
+	FILE *in = stdin;
+
+	memset(&state, 0, sizeof(state));
+	state.out = stdout;
+	memset(state.lastDLC, 0xff, sizeof(state.lastDLC));
+
+	if (argc > 1 && (in = fopen(argv[1], "rb")) == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	if (argc > 2 && (state.out = fopen(argv[2], "w")) == NULL) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	Decode(&state, in);
+
+	fprintf(stderr, "dlg-decode: %lu lines, %lu CAN (%lu delta, %lu without keyframe), %lu CS, %lu COVF, %lu MOVF, %lu CO (%lu frames), %lu bad bytes\n",
+			state.numText, state.numCAN, state.numDelta, state.numUnkeyed,
+			state.numSeen, state.numCOVF, state.numMOVF, state.numOverflows,
+			state.numOverflowFrames, state.numBad);
+	if (state.profile.records > 0) {
+		LoopProfile_Print(stderr, &state.profile);
+	}
+	if (state.sdLatency.records > 0) {
+		SDLatencyReport_Print(stderr, &state.sdLatency);
+	}
+	return 0;
+}
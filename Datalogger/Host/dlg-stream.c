@@ -0,0 +1,200 @@
+/*
+ * File:   dlg-stream.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:59 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Host tool which decodes the live binary CAN stream (DATALOGGER_CAN_STREAM,
+ * see datalogger-stream.h) from the datalogger UART into the PRM FMT 1 ASCII
+ * format, so existing parsers can read it. The input may be a capture file or
+ * the serial port itself, set up beforehand (for example, with stty).
+ * Output is flushed after every packet, so it can be piped into a live view.
+ *
+ * Frames the datalogger dropped are written as a "MOVF" marker line at the
+ * time of the packet which reported them. Packets which fail the CRC (or are
+ * not packets at all, like debug messages sharing the UART) are skipped, and
+ * gaps in the sequence numbers are counted as lost packets.
+ *
+ * Usage: dlg-stream [input [output.txt]]
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../Datalogger/datalogger-stream.h"
+
+typedef struct {
+	FILE *out;
+
+	uint32_t lastTime;		/// Time of the last frame.
+	uint8_t lastSequence;	/// Sequence number of the last packet.
+	uint8_t synced;			/// Whether a packet has been decoded.
+
+	unsigned long numPackets;	/// Number of packets decoded.
+	unsigned long numBad;	/// Number of packets which failed to decode or the CRC.
+	unsigned long numLost;	/// Number of packets missing from the sequence.
+	unsigned long numFrames;	/// Number of frames decoded.
+	unsigned long numDropped;	/// Number of frames the datalogger reported dropped.
+} StreamState;
+
+/**
+ * Adds a byte to a CRC-16/CCITT, bit by bit.
+ * @return The new CRC.
+ */
+static uint16_t StreamCRC(uint16_t crc, uint8_t data) {
+	uint8_t i;
+
+	crc ^= (uint16_t)data << 8;
+	for (i=0;i<8;i++) {
+		crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+/**
+ * COBS decodes a packet, without the delimiter.
+ * @return Decoded length, or -1 if the encoding is invalid.
+ */
+static int StreamDecodeCOBS(uint8_t *out, const uint8_t *in, size_t len) {
+	size_t inPos = 0, outPos = 0;
+
+	while (inPos < len) {
+		uint8_t code = in[inPos++];
+		uint8_t i;
+
+		if (code == 0 || inPos + code - 1 > len) {
+			return -1;
+		}
+		for (i=1;i<code;i++) {
+			out[outPos++] = in[inPos++];
+		}
+		if (code != 0xff && inPos < len) {
+			out[outPos++] = 0;
+		}
+	}
+	return outPos;
+}
+
+/**
+ * Decodes one packet, writing its frames.
+ */
+static void StreamDecodePacket(StreamState *state, const uint8_t *encoded, size_t len) {
+	uint8_t packet[DLG_STREAM_MAX_ENCODED];
+	uint16_t crc = DLG_STREAM_CRC_INIT;
+	uint32_t baseTime;
+	uint16_t dropped;
+	int packetLen, pos, i;
+
+	if (len > sizeof(packet)
+			|| (packetLen = StreamDecodeCOBS(packet, encoded, len)) < DLG_STREAM_HEADER_LEN + DLG_STREAM_CRC_LEN
+			|| packet[0] != DLG_STREAM_TYPE_CAN) {
+		state->numBad++;
+		return;
+	}
+	packetLen -= DLG_STREAM_CRC_LEN;
+	for (i=0;i<packetLen;i++) {
+		crc = StreamCRC(crc, packet[i]);
+	}
+	if (crc != (packet[packetLen] | (packet[packetLen+1] << 8))) {
+		state->numBad++;
+		return;
+	}
+
+	if (state->synced) {
+		state->numLost += (uint8_t)(packet[1] - state->lastSequence - 1);
+	}
+	state->lastSequence = packet[1];
+	state->synced = 1;
+	state->numPackets++;
+
+	dropped = packet[2] | (packet[3] << 8);
+	baseTime = (uint32_t)packet[4] | ((uint32_t)packet[5] << 8)
+			| ((uint32_t)packet[6] << 16) | ((uint32_t)packet[7] << 24);
+	if (dropped != 0) {
+		fprintf(state->out, "CM %08X/00 MOVF\n", baseTime);
+		state->numDropped += dropped;
+	}
+
+	pos = DLG_STREAM_HEADER_LEN;
+	while (pos + DLG_STREAM_FRAME_HEADER_LEN <= packetLen) {
+		uint32_t time = baseTime + packet[pos];
+		uint32_t dt = time - state->lastTime;
+		uint16_t sid = packet[pos+1] | ((packet[pos+2] & 0x07) << 8);
+		uint8_t dlc = packet[pos+2] >> 4;
+
+		if (dlc > 8 || pos + DLG_STREAM_FRAME_HEADER_LEN + dlc > packetLen) {
+			fprintf(stderr, "dlg-stream: malformed frame in packet %u\n", packet[1]);
+			break;
+		}
+		if (state->numFrames == 0 || dt > 255) {
+			dt = 255;
+		}
+		fprintf(state->out, "CM %08X/%02X 0 00 %X %03X", time, dt, dlc, sid);
+		for (i=0;i<dlc;i++) {
+			fprintf(state->out, "%c%02X", (i == 0) ? ' ' : ',',
+					packet[pos + DLG_STREAM_FRAME_HEADER_LEN + i]);
+		}
+		fputc('\n', state->out);
+
+		state->lastTime = time;
+		state->numFrames++;
+		pos += DLG_STREAM_FRAME_HEADER_LEN + dlc;
+	}
+	fflush(state->out);
+}
+
+/**
+ * Decodes a whole stream.
+ */
+static void StreamDecode(StreamState *state, FILE *in) {
+	uint8_t encoded[DLG_STREAM_MAX_ENCODED];
+	size_t len = 0;
+	uint8_t overlong = 0;
+	int c;
+
+	while ((c = fgetc(in)) != EOF) {
+		if (c == 0) {
+			if (overlong) {
+				state->numBad++;
+			} else if (len > 0) {
+				StreamDecodePacket(state, encoded, len);
+			}
+			len = 0;
+			overlong = 0;
+		} else if (len < sizeof(encoded)) {
+			encoded[len++] = c;
+		} else {
+			overlong = 1;
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+	StreamState state;
+	FILE *in = stdin;
+
+	memset(&state, 0, sizeof(state));
+	state.out = stdout;
+
+	if (argc > 1 && (in = fopen(argv[1], "rb")) == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	if (argc > 2 && (state.out = fopen(argv[2], "w")) == NULL) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	fputs("PRM FMT 1\n", state.out);
+	StreamDecode(&state, in);
+
+	fprintf(stderr, "dlg-stream: %lu packets, %lu frames, %lu frames dropped, %lu packets lost, %lu bad packets\n",
+			state.numPackets, state.numFrames, state.numDropped, state.numLost, state.numBad);
+	return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * File:   dlg-unpack.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 10:40 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Host tool which unpacks a compressed (.DLZ) datalogger log into the
+ * uncompressed log, which can then be read as a .DLA file (or passed through
+ * dlg-decode if it holds binary records).
+ *
+ * Usage: dlg-unpack [input.dlz [output.dla]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "dlz.h"
+
+int main(int argc, char *argv[]) {
+	FILE *in = stdin, *out = stdout;
+	uint8_t *packed = NULL, *unpacked;
+	size_t packedLen = 0, packedSize = 0, readLen;
+	uint32_t unpackedLen;
+	DLZ_Stats stats;
+
+	if (argc > 1 && (in = fopen(argv[1], "rb")) == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	if (argc > 2 && (out = fopen(argv[2], "wb")) == NULL) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	do {
+		if (packedLen == packedSize) {
+			packedSize = packedSize ? packedSize * 2 : 65536;
+			packed = realloc(packed, packedSize);
+			if (packed == NULL) {
+				fprintf(stderr, "dlg-unpack: out of memory\n");
+				return 1;
+			}
+		}
+		readLen = fread(packed + packedLen, 1, packedSize - packedLen, in);
+		packedLen += readLen;
+	} while (readLen > 0);
+
+	unpacked = DLZ_Unpack(packed, packedLen, &unpackedLen, &stats);
+	if (unpacked == NULL) {
+		fprintf(stderr, "dlg-unpack: out of memory\n");
+		return 1;
+	}
+	fwrite(unpacked, 1, unpackedLen, out);
+
+	fprintf(stderr, "dlg-unpack: %lu -> %lu bytes (%.1f%%), %lu blocks (%lu stored), %lu bad blocks, %lu bytes skipped\n",
+			(unsigned long)packedLen, (unsigned long)unpackedLen,
+			unpackedLen ? packedLen * 100.0 / unpackedLen : 0,
+			stats.blocks, stats.storedBlocks, stats.badBlocks, stats.skippedBytes);
+
+	free(packed);
+	free(unpacked);
+	return (stats.badBlocks || stats.skippedBytes) ? 1 : 0;
+}
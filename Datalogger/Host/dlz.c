@@ -0,0 +1,164 @@
+/*
+ * File:   dlz.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 10:40 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Host decoder for compressed (.DLZ) datalogger logs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../types.h"
+#include "../Datalogger/datalogger-compress.h"
+
+#include "dlz.h"
+
+/**
+ * Checks whether a valid block header starts at a position.
+ * @return Whether the header is valid and the payload fits in the input.
+ */
+static int HeaderValid(const uint8_t *in, uint32_t inLen, uint32_t pos) {
+	uint16_t rawLen, payloadLen;
+	uint8_t sum = 0;
+	uint8_t i;
+
+	if (inLen - pos < DLG_COMPRESS_HEADER_LEN
+			|| in[pos] != DLG_COMPRESS_MAGIC_0 || in[pos+1] != DLG_COMPRESS_MAGIC_1) {
+		return 0;
+	}
+	for (i=0;i<DLG_COMPRESS_HEADER_LEN-1;i++) {
+		sum += in[pos+i];
+	}
+	if (sum != in[pos+DLG_COMPRESS_HEADER_LEN-1]) {
+		return 0;
+	}
+	rawLen = (in[pos+2] | (in[pos+3] << 8)) & ~DLG_COMPRESS_STORED;
+	payloadLen = in[pos+4] | (in[pos+5] << 8);
+	if (rawLen == 0 || rawLen > DLG_COMPRESS_BLOCK_SIZE
+			|| inLen - pos - DLG_COMPRESS_HEADER_LEN < payloadLen) {
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * Decodes the LZSS payload of a block.
+ * @return Whether the payload decoded to exactly rawLen bytes.
+ */
+static int DecodePayload(const uint8_t *in, uint16_t inLen, uint8_t *out,
+		uint16_t rawLen) {
+	uint16_t ip = 0, op = 0;
+	uint8_t flags = 0, flagBit = 8;
+
+	while (op < rawLen) {
+		if (flagBit == 8) {
+			if (ip >= inLen) {
+				return 0;
+			}
+			flags = in[ip++];
+			flagBit = 0;
+		}
+		if (flags & (1 << flagBit)) {
+			uint16_t dist, len;
+			if (inLen - ip < 2) {
+				return 0;
+			}
+			dist = ((in[ip] & 0xf0) << 4 | in[ip+1]) + 1;
+			len = (in[ip] & 0x0f) + DLG_COMPRESS_MIN_MATCH;
+			ip += 2;
+			if (len == DLG_COMPRESS_MIN_MATCH + 15) {
+				if (ip >= inLen) {
+					return 0;
+				}
+				len += in[ip++];
+			}
+			if (dist > op || rawLen - op < len) {
+				return 0;
+			}
+			// Byte at a time, since matches may overlap themselves
+			while (len-- > 0) {
+				out[op] = out[op - dist];
+				op++;
+			}
+		} else {
+			if (ip >= inLen) {
+				return 0;
+			}
+			out[op++] = in[ip++];
+		}
+		flagBit++;
+	}
+	return ip == inLen;
+}
+
+uint8_t* DLZ_Unpack(const uint8_t *in, uint32_t inLen, uint32_t *outLen,
+		DLZ_Stats *stats) {
+	uint8_t *out;
+	uint32_t pos = 0, op = 0;
+
+	memset(stats, 0, sizeof(*stats));
+
+	// The output can't be larger than the largest raw block per header
+	out = malloc((inLen / DLG_COMPRESS_HEADER_LEN + 1) * DLG_COMPRESS_BLOCK_SIZE);
+	if (out == NULL) {
+		return NULL;
+	}
+
+	while (pos < inLen) {
+		uint16_t rawLen, payloadLen;
+		const uint8_t *payload;
+		uint8_t sum1 = 0, sum2 = 0;
+		uint16_t i;
+		int ok;
+
+		if (!HeaderValid(in, inLen, pos)) {
+			stats->skippedBytes++;
+			pos++;
+			continue;
+		}
+		rawLen = in[pos+2] | (in[pos+3] << 8);
+		payloadLen = in[pos+4] | (in[pos+5] << 8);
+		payload = in + pos + DLG_COMPRESS_HEADER_LEN;
+
+		if (rawLen & DLG_COMPRESS_STORED) {
+			rawLen &= ~DLG_COMPRESS_STORED;
+			ok = (payloadLen == rawLen);
+			if (ok) {
+				memcpy(out + op, payload, rawLen);
+			}
+		} else {
+			ok = DecodePayload(payload, payloadLen, out + op, rawLen);
+		}
+		if (ok) {
+			for (i=0;i<rawLen;i++) {
+				sum1 += out[op+i];
+				sum2 += sum1;
+			}
+			ok = (sum1 == in[pos+6] && sum2 == in[pos+7]);
+		}
+
+		if (ok) {
+			if (in[pos+3] & (DLG_COMPRESS_STORED >> 8)) {
+				stats->storedBlocks++;
+			}
+			stats->blocks++;
+			op += rawLen;
+			pos += DLG_COMPRESS_HEADER_LEN + payloadLen;
+		} else {
+			// Don't trust the payload length, search from just after the magic
+			stats->badBlocks++;
+			stats->skippedBytes += 2;
+			pos += 2;
+		}
+	}
+
+	*outLen = op;
+	return out;
+}
@@ -0,0 +1,41 @@
+/*
+ * File:   dlz.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 10:40 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Host decoder for compressed (.DLZ) datalogger logs, see
+ * Datalogger/datalogger-compress.h for the format.
+ * Damaged blocks are skipped by searching for the next valid block header.
+ */
+
+#ifndef DLZ_H
+#define DLZ_H
+
+#include <stdint.h>
+
+typedef struct {
+	unsigned long blocks;		/// Number of good blocks.
+	unsigned long storedBlocks;	/// Number of good blocks stored uncompressed.
+	unsigned long badBlocks;	/// Number of blocks with valid headers but bad payloads.
+	unsigned long skippedBytes;	/// Number of bytes skipped while searching for a block header.
+} DLZ_Stats;
+
+/**
+ * Unpacks a compressed log.
+ *
+ * @param in Compressed log.
+ * @param inLen Compressed log length, in bytes.
+ * @param outLen Receives the unpacked length, in bytes.
+ * @param stats Receives decoding statistics.
+ * @return Unpacked log, allocated with malloc, or NULL if out of memory.
+ */
+uint8_t* DLZ_Unpack(const uint8_t *in, uint32_t inLen, uint32_t *outLen,
+		DLZ_Stats *stats);
+
+#endif
@@ -0,0 +1,644 @@
+/*
+ * File:   fat32-image.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 3:10 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Fragmenting the free space, counting file fragments.
+ *
+ * @file
+ * Host tools for FAT32 disk images.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fat32-image.h"
+
+#define SECTOR_SIZE			512
+#define PARTITION_LBA		2048		/// Partition start, when partitioned (1 MiB aligned like most cards)
+#define RESERVED_SECTORS	32
+#define NUM_FATS			2
+#define FAT32_EOC_MIN		0x0ffffff8
+#define FAT32_MASK			0x0fffffff
+
+static void PutInt16(uint8_t *dest, uint16_t data) {
+	dest[0] = data & 0xff;
+	dest[1] = (data >> 8) & 0xff;
+}
+
+static void PutInt32(uint8_t *dest, uint32_t data) {
+	dest[0] = data & 0xff;
+	dest[1] = (data >> 8) & 0xff;
+	dest[2] = (data >> 16) & 0xff;
+	dest[3] = (data >> 24) & 0xff;
+}
+
+static uint16_t GetInt16(uint8_t *data) {
+	return data[0] | ((uint16_t)data[1] << 8);
+}
+
+static uint32_t GetInt32(uint8_t *data) {
+	return data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static int WriteSector(FILE *file, uint32_t lba, uint8_t *data) {
+	if (fseek(file, (long)lba * SECTOR_SIZE, SEEK_SET) != 0
+			|| fwrite(data, SECTOR_SIZE, 1, file) != 1) {
+		return 1;
+	}
+	return 0;
+}
+
+static int ReadSector(FILE *file, uint32_t lba, uint8_t *data) {
+	if (fseek(file, (long)lba * SECTOR_SIZE, SEEK_SET) != 0
+			|| fread(data, SECTOR_SIZE, 1, file) != 1) {
+		return 1;
+	}
+	return 0;
+}
+
+int FAT32_Image_Format(const char *path, uint32_t sizeMB, uint8_t sectorsPerCluster,
+		uint8_t partitioned) {
+	uint8_t sector[SECTOR_SIZE];
+	uint32_t totalSectors = sizeMB * 2048;
+	uint32_t partitionLBA = partitioned ? PARTITION_LBA : 0;
+	uint32_t partitionSectors = totalSectors - partitionLBA;
+	uint32_t sectorsPerFAT, numClusters, i;
+	FILE *file;
+
+	if (sectorsPerCluster == 0 || (sectorsPerCluster & (sectorsPerCluster - 1)) != 0) {
+		fprintf(stderr, "Sectors per cluster must be a power of 2\n");
+		return 1;
+	}
+	if (totalSectors <= partitionLBA + RESERVED_SECTORS + 64) {
+		fprintf(stderr, "Image too small\n");
+		return 1;
+	}
+
+	// FAT size, from the Microsoft FAT specification
+	sectorsPerFAT = partitionSectors - RESERVED_SECTORS;
+	sectorsPerFAT = (sectorsPerFAT + (256 * sectorsPerCluster + NUM_FATS) / 2 - 1)
+			/ ((256 * sectorsPerCluster + NUM_FATS) / 2);
+	numClusters = (partitionSectors - RESERVED_SECTORS - NUM_FATS * sectorsPerFAT)
+			/ sectorsPerCluster;
+
+	file = fopen(path, "w+b");
+	if (file == NULL) {
+		perror(path);
+		return 1;
+	}
+	// Sparse file of the full size
+	if (ftruncate(fileno(file), (off_t)totalSectors * SECTOR_SIZE) != 0) {
+		perror(path);
+		fclose(file);
+		return 1;
+	}
+
+	// Master boot record
+	if (partitioned) {
+		memset(sector, 0, SECTOR_SIZE);
+		sector[446 + 0] = 0x00;				// not bootable
+		sector[446 + 4] = 0x0c;				// FAT32 LBA
+		PutInt32(sector + 446 + 8, partitionLBA);
+		PutInt32(sector + 446 + 12, partitionSectors);
+		sector[510] = 0x55;
+		sector[511] = 0xaa;
+		WriteSector(file, 0, sector);
+	}
+
+	// Boot sector and its backup
+	memset(sector, 0, SECTOR_SIZE);
+	sector[0] = 0xeb;	sector[1] = 0x58;	sector[2] = 0x90;
+	memcpy(sector + 3, "CALSOL  ", 8);
+	PutInt16(sector + 11, SECTOR_SIZE);
+	sector[13] = sectorsPerCluster;
+	PutInt16(sector + 14, RESERVED_SECTORS);
+	sector[16] = NUM_FATS;
+	sector[21] = 0xf8;						// media descriptor
+	PutInt16(sector + 24, 63);				// sectors per track
+	PutInt16(sector + 26, 255);				// heads
+	PutInt32(sector + 28, partitionLBA);	// hidden sectors
+	PutInt32(sector + 32, partitionSectors);
+	PutInt32(sector + 36, sectorsPerFAT);
+	PutInt32(sector + 44, 2);				// root directory cluster
+	PutInt16(sector + 48, 1);				// FS information sector
+	PutInt16(sector + 50, 6);				// backup boot sector
+	sector[0x40] = 0x80;					// drive number
+	sector[0x42] = 0x29;					// extended boot signature
+	PutInt32(sector + 0x43, 0xca150126);	// volume ID
+	memcpy(sector + 0x47, "DATALOGGER ", 11);
+	memcpy(sector + 0x52, "FAT32   ", 8);
+	sector[510] = 0x55;
+	sector[511] = 0xaa;
+	WriteSector(file, partitionLBA, sector);
+	WriteSector(file, partitionLBA + 6, sector);
+
+	// FS information sector and its backup
+	memset(sector, 0, SECTOR_SIZE);
+	memcpy(sector, "RRaA", 4);
+	memcpy(sector + 0x1e4, "rrAa", 4);
+	PutInt32(sector + 0x1e8, numClusters - 1);		// root directory uses one
+	PutInt32(sector + 0x1ec, 2);					// most recently allocated
+	sector[0x1fe] = 0x55;
+	sector[0x1ff] = 0xaa;
+	WriteSector(file, partitionLBA + 1, sector);
+	WriteSector(file, partitionLBA + 7, sector);
+
+	// FATs - everything past the first sector is already zero
+	memset(sector, 0, SECTOR_SIZE);
+	PutInt32(sector + 0, 0x0ffffff8);
+	PutInt32(sector + 4, 0x0fffffff);
+	PutInt32(sector + 8, 0x0fffffff);		// root directory
+	for (i=0;i<NUM_FATS;i++) {
+		WriteSector(file, partitionLBA + RESERVED_SECTORS + i * sectorsPerFAT, sector);
+	}
+
+	// Root directory cluster
+	memset(sector, 0, SECTOR_SIZE);
+	for (i=0;i<sectorsPerCluster;i++) {
+		WriteSector(file, partitionLBA + RESERVED_SECTORS + NUM_FATS * sectorsPerFAT + i, sector);
+	}
+
+	if (fclose(file) != 0) {
+		perror(path);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Opens an image and loads its FAT, with the given fopen mode.
+ */
+static int OpenImage(FAT32_Image *img, const char *path, const char *mode) {
+	uint8_t sector[SECTOR_SIZE];
+	uint32_t reserved, totalSectors, i;
+
+	memset(img, 0, sizeof(*img));
+	img->file = fopen(path, mode);
+	if (img->file == NULL) {
+		perror(path);
+		return 1;
+	}
+
+	if (ReadSector(img->file, 0, sector)) {
+		fprintf(stderr, "%s: unable to read sector 0\n", path);
+		FAT32_Image_Close(img);
+		return 1;
+	}
+	// Same test as the firmware: no jump instruction means a MBR
+	if (!((sector[0] == 0xeb && sector[2] == 0x90) || sector[0] == 0xe9)) {
+		img->partitionLBA = GetInt32(sector + 446 + 8);
+		if (ReadSector(img->file, img->partitionLBA, sector)) {
+			fprintf(stderr, "%s: unable to read boot sector\n", path);
+			FAT32_Image_Close(img);
+			return 1;
+		}
+	}
+	if (sector[510] != 0x55 || sector[511] != 0xaa || sector[0x42] != 0x29
+			|| GetInt16(sector + 11) != SECTOR_SIZE) {
+		fprintf(stderr, "%s: not a FAT32 filesystem\n", path);
+		FAT32_Image_Close(img);
+		return 1;
+	}
+
+	img->sectorsPerCluster = sector[13];
+	reserved = GetInt16(sector + 14);
+	img->numFATs = sector[16];
+	totalSectors = GetInt32(sector + 32);
+	img->sectorsPerFAT = GetInt32(sector + 36);
+	img->rootCluster = GetInt32(sector + 44);
+	img->fsInfoLBA = img->partitionLBA + GetInt16(sector + 48);
+	img->fatLBA = img->partitionLBA + reserved;
+	img->clusterLBA = img->fatLBA + img->numFATs * img->sectorsPerFAT;
+	img->numClusters = (totalSectors - reserved - img->numFATs * img->sectorsPerFAT)
+			/ img->sectorsPerCluster;
+	if (img->numClusters + 2 > img->sectorsPerFAT * (SECTOR_SIZE / 4)) {
+		img->numClusters = img->sectorsPerFAT * (SECTOR_SIZE / 4) - 2;
+	}
+
+	img->fat = malloc((size_t)img->sectorsPerFAT * SECTOR_SIZE);
+	if (img->fat == NULL) {
+		FAT32_Image_Close(img);
+		return 1;
+	}
+	for (i=0;i<img->sectorsPerFAT;i++) {
+		uint32_t j;
+		if (ReadSector(img->file, img->fatLBA + i, sector)) {
+			fprintf(stderr, "%s: unable to read FAT\n", path);
+			FAT32_Image_Close(img);
+			return 1;
+		}
+		for (j=0;j<SECTOR_SIZE/4;j++) {
+			img->fat[i * (SECTOR_SIZE/4) + j] = GetInt32(sector + j*4) & FAT32_MASK;
+		}
+	}
+
+	return 0;
+}
+
+int FAT32_Image_Open(FAT32_Image *img, const char *path) {
+	return OpenImage(img, path, "rb");
+}
+
+void FAT32_Image_Close(FAT32_Image *img) {
+	if (img->file != NULL) {
+		fclose(img->file);
+	}
+	free(img->fat);
+	img->file = NULL;
+	img->fat = NULL;
+}
+
+static uint32_t ClusterLBA(FAT32_Image *img, uint32_t cluster) {
+	return img->clusterLBA + (cluster - 2) * img->sectorsPerCluster;
+}
+
+static int ValidCluster(FAT32_Image *img, uint32_t cluster) {
+	return cluster >= 2 && cluster < img->numClusters + 2;
+}
+
+/**
+ * Calls @a entryFn for every used entry in the root directory.
+ * Stops early if @a entryFn returns nonzero, returning that value.
+ */
+static int ForEachRootEntry(FAT32_Image *img,
+		int (*entryFn)(FAT32_Image*, uint8_t*, void*), void *arg) {
+	uint8_t sector[SECTOR_SIZE];
+	uint32_t cluster = img->rootCluster;
+	uint32_t numRootClusters = 0;
+
+	while (ValidCluster(img, cluster) && numRootClusters++ < img->numClusters) {
+		uint8_t i;
+		for (i=0;i<img->sectorsPerCluster;i++) {
+			uint16_t pos;
+			ReadSector(img->file, ClusterLBA(img, cluster) + i, sector);
+			for (pos=0;pos<SECTOR_SIZE;pos+=32) {
+				int result;
+				if (sector[pos] == 0x00) {
+					return 0;
+				} else if (sector[pos] == 0xe5 || sector[pos + 11] == 0x0f
+						|| (sector[pos + 11] & 0x08)) {
+					continue;	// deleted, long file name or volume label
+				}
+				result = entryFn(img, sector + pos, arg);
+				if (result != 0) {
+					return result;
+				}
+			}
+		}
+		cluster = img->fat[cluster];
+	}
+	return 0;
+}
+
+typedef struct {
+	uint8_t *owner;			/// Per cluster, whether it is used by a file.
+	int verbose;
+	int errors;
+	uint32_t files;
+} CheckState;
+
+static int CheckEntry(FAT32_Image *img, uint8_t *entry, void *arg) {
+	CheckState *state = arg;
+	uint32_t clusterBytes = (uint32_t)img->sectorsPerCluster * SECTOR_SIZE;
+	uint32_t cluster = ((uint32_t)GetInt16(entry + 0x14) << 16) | GetInt16(entry + 0x1a);
+	uint32_t size = GetInt32(entry + 0x1c);
+	uint32_t expected = (size + clusterBytes - 1) / clusterBytes;
+	uint32_t count = 0;
+	uint8_t isDir = entry[11] & 0x10;
+
+	state->files++;
+	if (state->verbose) {
+		printf("  %.8s.%.3s %10u bytes, cluster %u\n", entry, entry + 8, size, cluster);
+	}
+
+	if (cluster == 0) {
+		if (size != 0) {
+			printf("Error: %.8s.%.3s has %u bytes but no clusters\n", entry, entry + 8, size);
+			state->errors++;
+		}
+		return 0;
+	}
+
+	while (ValidCluster(img, cluster)) {
+		if (state->owner[cluster]) {
+			printf("Error: %.8s.%.3s cross-linked at cluster %u\n", entry, entry + 8, cluster);
+			state->errors++;
+			return 0;
+		}
+		state->owner[cluster] = 1;
+		count++;
+		cluster = img->fat[cluster];
+	}
+	if (cluster < FAT32_EOC_MIN) {
+		printf("Error: %.8s.%.3s chain broken at cluster entry 0x%08x\n", entry, entry + 8, cluster);
+		state->errors++;
+	} else if (!isDir && count != expected) {
+		printf("Error: %.8s.%.3s has %u clusters for %u bytes (expected %u)\n",
+				entry, entry + 8, count, size, expected);
+		state->errors++;
+	}
+	return 0;
+}
+
+int FAT32_Image_Check(FAT32_Image *img, int verbose) {
+	uint8_t sector[SECTOR_SIZE];
+	CheckState state;
+	uint32_t cluster, numFree = 0, numLost = 0, rootCluster;
+
+	memset(&state, 0, sizeof(state));
+	state.verbose = verbose;
+	state.owner = calloc(img->numClusters + 2, 1);
+	if (state.owner == NULL) {
+		return 1;
+	}
+
+	// Root directory chain
+	rootCluster = img->rootCluster;
+	while (ValidCluster(img, rootCluster) && !state.owner[rootCluster]) {
+		state.owner[rootCluster] = 1;
+		rootCluster = img->fat[rootCluster];
+	}
+
+	ForEachRootEntry(img, &CheckEntry, &state);
+
+	for (cluster=2;cluster<img->numClusters+2;cluster++) {
+		if (img->fat[cluster] == 0) {
+			numFree++;
+		} else if (!state.owner[cluster]) {
+			numLost++;
+		}
+	}
+	if (numLost > 0) {
+		printf("Error: %u lost clusters (allocated but not in any file)\n", numLost);
+		state.errors++;
+	}
+
+	ReadSector(img->file, img->fsInfoLBA, sector);
+	if (GetInt32(sector + 0x1e8) != numFree) {
+		printf("Error: FS Information Sector free count is %u, FAT has %u free clusters\n",
+				GetInt32(sector + 0x1e8), numFree);
+		state.errors++;
+	}
+
+	printf("Checked %u files, %u of %u clusters free, %d errors\n",
+			state.files, numFree, img->numClusters, state.errors);
+
+	free(state.owner);
+	return state.errors;
+}
+
+typedef struct {
+	const char *name;
+	uint32_t startCluster;
+	uint32_t size;
+	int found;
+} FindState;
+
+static int FindEntry(FAT32_Image *img, uint8_t *entry, void *arg) {
+	FindState *state = arg;
+	if (!memcmp(entry, state->name, 11)) {
+		state->startCluster = ((uint32_t)GetInt16(entry + 0x14) << 16) | GetInt16(entry + 0x1a);
+		state->size = GetInt32(entry + 0x1c);
+		state->found = 1;
+		return 1;
+	}
+	return 0;
+}
+
+int FAT32_Image_FindFile(FAT32_Image *img, const char *name,
+		uint32_t *startCluster, uint32_t *size) {
+	FindState state;
+	state.name = name;
+	state.found = 0;
+	ForEachRootEntry(img, &FindEntry, &state);
+	if (!state.found) {
+		return 1;
+	}
+	*startCluster = state.startCluster;
+	*size = state.size;
+	return 0;
+}
+
+int FAT32_Image_ReadFile(FAT32_Image *img, uint32_t startCluster, uint32_t size,
+		uint8_t *buffer) {
+	uint8_t sector[SECTOR_SIZE];
+	uint32_t cluster = startCluster;
+	uint32_t pos = 0;
+
+	while (pos < size) {
+		uint8_t i;
+		if (!ValidCluster(img, cluster)) {
+			return 1;
+		}
+		for (i=0;i<img->sectorsPerCluster && pos<size;i++) {
+			uint32_t len = size - pos;
+			if (len > SECTOR_SIZE) {
+				len = SECTOR_SIZE;
+			}
+			if (ReadSector(img->file, ClusterLBA(img, cluster) + i, sector)) {
+				return 1;
+			}
+			memcpy(buffer + pos, sector, len);
+			pos += len;
+		}
+		cluster = img->fat[cluster];
+	}
+	return 0;
+}
+
+/**
+ * Writes the FAT copy back to every FAT on the image.
+ */
+static void WriteFAT(FAT32_Image *img) {
+	uint8_t sector[SECTOR_SIZE];
+	uint32_t lba, i;
+
+	for (lba=0;lba<img->sectorsPerFAT;lba++) {
+		uint8_t j;
+		for (i=0;i<SECTOR_SIZE/4;i++) {
+			PutInt32(sector + i*4, img->fat[lba * (SECTOR_SIZE/4) + i]);
+		}
+		for (j=0;j<img->numFATs;j++) {
+			WriteSector(img->file, img->fatLBA + j * img->sectorsPerFAT + lba, sector);
+		}
+	}
+}
+
+int FAT32_Image_AddFile(const char *path, const char *name,
+		const uint8_t *data, uint32_t size) {
+	FAT32_Image img;
+	uint8_t sector[SECTOR_SIZE];
+	uint32_t clusterBytes, numClusters, startCluster, cluster, prev, pos;
+	uint32_t dirLBA = 0, i;
+	uint16_t dirPos = 0;
+	int found = 0;
+
+	if (OpenImage(&img, path, "r+b")) {
+		return 1;
+	}
+	clusterBytes = (uint32_t)img.sectorsPerCluster * SECTOR_SIZE;
+	numClusters = (size + clusterBytes - 1) / clusterBytes;
+
+	// Free directory entry, in the first root directory cluster like the firmware
+	for (i=0;i<img.sectorsPerCluster && !found;i++) {
+		dirLBA = ClusterLBA(&img, img.rootCluster) + i;
+		ReadSector(img.file, dirLBA, sector);
+		for (dirPos=0;dirPos<SECTOR_SIZE;dirPos+=32) {
+			if (sector[dirPos] == 0x00 || sector[dirPos] == 0xe5) {
+				found = 1;
+				break;
+			}
+		}
+	}
+	if (!found) {
+		fprintf(stderr, "%s: root directory full\n", path);
+		FAT32_Image_Close(&img);
+		return 1;
+	}
+
+	// Allocate and write the clusters, chaining them in the FAT copy
+	startCluster = 0;
+	prev = 0;
+	pos = 0;
+	for (cluster=2;cluster<img.numClusters+2 && pos<size;cluster++) {
+		if (img.fat[cluster] != 0) {
+			continue;
+		}
+		if (prev == 0) {
+			startCluster = cluster;
+		} else {
+			img.fat[prev] = cluster;
+		}
+		img.fat[cluster] = FAT32_MASK;
+		prev = cluster;
+		for (i=0;i<img.sectorsPerCluster;i++) {
+			uint32_t len = size - pos > SECTOR_SIZE ? SECTOR_SIZE : size - pos;
+			memset(sector, 0, SECTOR_SIZE);
+			memcpy(sector, data + pos, len);
+			WriteSector(img.file, ClusterLBA(&img, cluster) + i, sector);
+			pos += len;
+		}
+	}
+	if (pos < size) {
+		fprintf(stderr, "%s: not enough free space\n", path);
+		FAT32_Image_Close(&img);
+		return 1;
+	}
+
+	// Directory entry
+	ReadSector(img.file, dirLBA, sector);
+	memset(sector + dirPos, 0, 32);
+	memcpy(sector + dirPos, name, 11);
+	sector[dirPos + 11] = 0x20;				// archive
+	PutInt16(sector + dirPos + 0x14, startCluster >> 16);
+	PutInt16(sector + dirPos + 0x1a, startCluster & 0xffff);
+	PutInt32(sector + dirPos + 0x1c, size);
+	WriteSector(img.file, dirLBA, sector);
+
+	WriteFAT(&img);
+
+	// FS Information Sector: the firmware allocates after the most recent
+	// cluster without checking the FAT, so this must move past the new file
+	ReadSector(img.file, img.fsInfoLBA, sector);
+	PutInt32(sector + 0x1e8, GetInt32(sector + 0x1e8) - numClusters);
+	if (prev > GetInt32(sector + 0x1ec)) {
+		PutInt32(sector + 0x1ec, prev);
+	}
+	WriteSector(img.file, img.fsInfoLBA, sector);
+
+	FAT32_Image_Close(&img);
+	return 0;
+}
+
+int FAT32_Image_Fragment(const char *path, uint32_t size) {
+	FAT32_Image img;
+	uint8_t sector[SECTOR_SIZE];
+	uint32_t clusterBytes, numClusters, cluster, dirLBA, i, numFree = 0;
+	uint16_t dirPos = 0;
+	int files = 0;
+
+	if (OpenImage(&img, path, "r+b")) {
+		return -1;
+	}
+	clusterBytes = (uint32_t)img.sectorsPerCluster * SECTOR_SIZE;
+	numClusters = (size + clusterBytes - 1) / clusterBytes;
+	if (numClusters == 0) {
+		FAT32_Image_Close(&img);
+		return 0;
+	}
+
+	// Start after whatever is already allocated
+	cluster = img.numClusters + 2;
+	while (cluster > 2 && img.fat[cluster - 1] == 0) {
+		cluster--;
+	}
+
+	dirLBA = ClusterLBA(&img, img.rootCluster);
+	ReadSector(img.file, dirLBA, sector);
+	for (;cluster+numClusters<=img.numClusters+2;cluster+=2*numClusters) {
+		char name[12];
+
+		// Next free directory entry, in the first root directory cluster
+		while (sector[dirPos] != 0x00 && sector[dirPos] != 0xe5) {
+			dirPos += 32;
+			if (dirPos >= SECTOR_SIZE) {
+				WriteSector(img.file, dirLBA, sector);
+				dirLBA++;
+				dirPos = 0;
+				if (dirLBA >= ClusterLBA(&img, img.rootCluster) + img.sectorsPerCluster) {
+					fprintf(stderr, "%s: root directory full\n", path);
+					FAT32_Image_Close(&img);
+					return -1;
+				}
+				ReadSector(img.file, dirLBA, sector);
+			}
+		}
+
+		for (i=0;i<numClusters;i++) {
+			img.fat[cluster + i] = (i == numClusters - 1) ? FAT32_MASK : cluster + i + 1;
+		}
+		snprintf(name, sizeof(name), "FILL%04XDAT", files & 0xffff);
+		memset(sector + dirPos, 0, 32);
+		memcpy(sector + dirPos, name, 11);
+		sector[dirPos + 11] = 0x20;			// archive
+		PutInt16(sector + dirPos + 0x14, cluster >> 16);
+		PutInt16(sector + dirPos + 0x1a, cluster & 0xffff);
+		PutInt32(sector + dirPos + 0x1c, size);
+		files++;
+	}
+	WriteSector(img.file, dirLBA, sector);
+	WriteFAT(&img);
+
+	// The FS Information Sector's most recently allocated cluster is left as
+	// it was, so allocating after it without checking the FAT runs into files
+	for (cluster=2;cluster<img.numClusters+2;cluster++) {
+		if (img.fat[cluster] == 0) {
+			numFree++;
+		}
+	}
+	ReadSector(img.file, img.fsInfoLBA, sector);
+	PutInt32(sector + 0x1e8, numFree);
+	WriteSector(img.file, img.fsInfoLBA, sector);
+
+	FAT32_Image_Close(&img);
+	return files;
+}
+
+uint32_t FAT32_Image_CountFragments(FAT32_Image *img, uint32_t startCluster) {
+	uint32_t cluster = startCluster;
+	uint32_t fragments = 0, count = 0;
+
+	while (ValidCluster(img, cluster) && count++ < img->numClusters) {
+		if (img->fat[cluster] != cluster + 1) {
+			fragments++;
+		}
+		cluster = img->fat[cluster];
+	}
+	return fragments;
+}
@@ -0,0 +1,128 @@
+/*
+ * File:   fat32-image.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 3:10 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Fragmenting the free space, counting file fragments.
+ *
+ * @file
+ * Host tools for FAT32 disk images: formatting a blank image for the SD Card
+ * emulator, adding files for the datalogger to read, and checking the filesystem the datalogger left behind (cluster
+ * chains against directory entries, cross-links, lost clusters and the FS
+ * Information Sector free count).
+ * Only the root directory is checked, since that is all the datalogger writes.
+ */
+
+#ifndef FAT32_IMAGE_H
+#define FAT32_IMAGE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+typedef struct {
+	FILE *file;
+
+	uint32_t partitionLBA;		/// LBA of the FAT boot sector.
+	uint8_t sectorsPerCluster;
+	uint32_t sectorsPerFAT;
+	uint8_t numFATs;
+	uint32_t fatLBA;			/// LBA of the first FAT.
+	uint32_t clusterLBA;		/// LBA of cluster 2.
+	uint32_t fsInfoLBA;
+	uint32_t rootCluster;
+	uint32_t numClusters;		/// Number of data clusters.
+
+	uint32_t *fat;				/// Copy of the first FAT.
+} FAT32_Image;
+
+/**
+ * Creates (or overwrites) a blank FAT32 image.
+ *
+ * @param path Image file path.
+ * @param sizeMB Image size, in MiB.
+ * @param sectorsPerCluster Sectors per cluster, a power of 2.
+ * @param partitioned Whether to put the filesystem in a partition behind a
+ * master boot record (like a real card), or directly at sector 0.
+ * @return 0 on success, nonzero on failure.
+ */
+int FAT32_Image_Format(const char *path, uint32_t sizeMB, uint8_t sectorsPerCluster,
+		uint8_t partitioned);
+
+/**
+ * Opens an image and loads its FAT.
+ *
+ * @return 0 on success, nonzero on failure.
+ */
+int FAT32_Image_Open(FAT32_Image *img, const char *path);
+
+void FAT32_Image_Close(FAT32_Image *img);
+
+/**
+ * Checks the filesystem consistency, printing problems to stdout.
+ *
+ * @param verbose Whether to also list every file.
+ * @return Number of errors found.
+ */
+int FAT32_Image_Check(FAT32_Image *img, int verbose);
+
+/**
+ * Finds a file in the root directory.
+ *
+ * @param name 8.3 name as stored in the directory entry (11 characters,
+ * space padded, no dot).
+ * @param startCluster Set to the file's first cluster.
+ * @param size Set to the file's size.
+ * @return 0 if the file was found, nonzero otherwise.
+ */
+int FAT32_Image_FindFile(FAT32_Image *img, const char *name,
+		uint32_t *startCluster, uint32_t *size);
+
+/**
+ * Reads a file by following its cluster chain.
+ *
+ * @param buffer Buffer at least @a size bytes long.
+ * @return 0 on success, nonzero if the chain is shorter than the file.
+ */
+int FAT32_Image_ReadFile(FAT32_Image *img, uint32_t startCluster, uint32_t size,
+		uint8_t *buffer);
+
+/**
+ * Adds a file to the root directory of an image, allocating the first free
+ * clusters. The image must not be open.
+ *
+ * @param path Image file path.
+ * @param name 8.3 name as stored in the directory entry (11 characters,
+ * space padded, no dot).
+ * @param data File contents.
+ * @param size File size, in bytes.
+ * @return 0 on success, nonzero on failure.
+ */
+int FAT32_Image_AddFile(const char *path, const char *name,
+		const uint8_t *data, uint32_t size);
+
+/**
+ * Fills the free space at the end of an image with files of @a size bytes,
+ * each followed by a free gap of the same size, like a card which has had
+ * every other file deleted. The files are named FILL0000.DAT onwards, and
+ * their data is not written. The FS Information Sector's most recently
+ * allocated cluster is left as it was. The image must not be open.
+ *
+ * @param path Image file path.
+ * @param size Size of each file and gap, in bytes.
+ * @return Number of files added, or -1 on failure.
+ */
+int FAT32_Image_Fragment(const char *path, uint32_t size);
+
+/**
+ * Counts the runs of contiguous clusters in a cluster chain.
+ *
+ * @param startCluster First cluster of the chain.
+ * @return Number of fragments, 0 for an empty chain.
+ */
+uint32_t FAT32_Image_CountFragments(FAT32_Image *img, uint32_t startCluster);
+
+#endif
@@ -0,0 +1,173 @@
+/*
+ * File:   fw-registers.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:59 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Stand-ins for the dsPIC33F registers, pin assignments and C30 built-ins used
+ * by the application code which has no host emulation (main.c, datalogger.c
+ * and the loggers), so it can be compiled on the host to check it builds.
+ * Nothing here is linked or run. Pin assignments are the Run 3 board's (see
+ * hardware-run3.h).
+ *
+ * This is included ahead of each file by the fw-check target of the Makefile.
+ */
+
+#ifndef FW_REGISTERS_H
+#define FW_REGISTERS_H
+
+#include "../types.h"
+
+#define __C30_VERSION__		320
+
+/*
+ * Reset control
+ */
+typedef struct {
+	unsigned POR:1;
+	unsigned BOR:1;
+	unsigned IDLE:1;
+	unsigned SLEEP:1;
+	unsigned WDTO:1;
+	unsigned SWDTEN:1;
+	unsigned SWR:1;
+	unsigned EXTR:1;
+	unsigned VREGS:1;
+	unsigned CM:1;
+	unsigned :4;
+	unsigned IOPUWR:1;
+	unsigned TRAPR:1;
+} RCONBITS;
+extern volatile RCONBITS RCONbits;
+
+/*
+ * Oscillator
+ */
+extern volatile uint16_t _PLLPRE;
+extern volatile uint16_t _PLLPOST;
+extern volatile uint16_t _PLLDIV;
+void __builtin_write_OSCCONL(uint8_t value);
+
+/*
+ * ADC
+ */
+typedef struct {
+	unsigned DONE:1;
+	unsigned SAMP:1;
+	unsigned ASAM:1;
+	unsigned SIMSAM:1;
+	unsigned SSRCG:1;
+	unsigned SSRC:3;
+	unsigned FORM:2;
+	unsigned AD12B:1;
+	unsigned :1;
+	unsigned ADDMABM:1;
+	unsigned ADSIDL:1;
+	unsigned :1;
+	unsigned ADON:1;
+} AD1CON1BITS;
+extern volatile AD1CON1BITS AD1CON1bits;
+
+typedef struct {
+	unsigned ALTS:1;
+	unsigned BUFM:1;
+	unsigned SMPI:4;
+	unsigned :1;
+	unsigned BUFS:1;
+	unsigned CHPS:2;
+	unsigned CSCNA:1;
+	unsigned :2;
+	unsigned VCFG:3;
+} AD1CON2BITS;
+extern volatile AD1CON2BITS AD1CON2bits;
+
+typedef struct {
+	unsigned ADCS:8;
+	unsigned SAMC:5;
+	unsigned :2;
+	unsigned ADRC:1;
+} AD1CON3BITS;
+extern volatile AD1CON3BITS AD1CON3bits;
+
+typedef struct {
+	unsigned CH0SA:5;
+	unsigned :2;
+	unsigned CH0NA:1;
+	unsigned CH0SB:5;
+	unsigned :2;
+	unsigned CH0NB:1;
+} AD1CHS0BITS;
+extern volatile AD1CHS0BITS AD1CHS0bits;
+
+extern volatile uint16_t AD1PCFGL;
+
+#define ANA_CH_12VDIV		1
+
+/*
+ * UART
+ */
+typedef struct {
+	unsigned URXDA:1;
+	unsigned OERR:1;
+	unsigned FERR:1;
+	unsigned PERR:1;
+	unsigned RIDLE:1;
+	unsigned ADDEN:1;
+	unsigned URXISEL:2;
+	unsigned TRMT:1;
+	unsigned UTXBF:1;
+	unsigned UTXEN:1;
+	unsigned UTXBRK:1;
+	unsigned :1;
+	unsigned UTXISEL0:1;
+	unsigned UTXINV:1;
+	unsigned UTXISEL1:1;
+} U2STABITS;
+extern volatile U2STABITS U2STAbits;
+extern volatile uint16_t U2RXREG;
+
+/*
+ * ECAN
+ */
+extern volatile uint16_t C1FEN1;
+
+/*
+ * Pins and peripheral pin select
+ */
+extern volatile uint16_t LATB;
+extern volatile uint16_t TRISB;
+#define SD_SPI_CS_IO		LATB
+#define SD_SPI_CS_TRIS		TRISB
+
+extern volatile uint16_t _RP5R;
+extern volatile uint16_t _RP10R;
+extern volatile uint16_t _RP13R;
+extern volatile uint16_t _RP14R;
+extern volatile uint16_t _U2RXR;
+extern volatile uint16_t _C1RXR;
+extern volatile uint16_t _SDI2R;
+
+#define UART_TX_RPR			_RP10R
+#define UART_RX_RPN			11
+#define ECAN_RXD_RPN		6
+#define ECAN_TXD_RPR		_RP5R
+#define SD_SPI_SCK_RPR		_RP13R
+#define SD_SPI_MOSI_RPR		_RP14R
+#define SD_SPI_MISO_RPN		12
+
+#define U2TX_IO				5
+#define SDO2_IO				10
+#define SCK2OUT_IO			11
+#define C1TX_IO				16
+
+/*
+ * C30 library functions outside the standard
+ */
+char *itoa(char *buf, int val, int base);
+
+#endif
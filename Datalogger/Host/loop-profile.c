@@ -0,0 +1,133 @@
+/*
+ * File:   loop-profile.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:45 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Host report of the datalogger per-stage loop profile.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "loop-profile.h"
+
+void LoopProfile_AddStage(LoopProfile *profile, uint8_t stage, uint32_t loops,
+		uint32_t totalCycles, uint32_t maxCycles, const uint16_t *bins) {
+	LoopProfileStage *s = &profile->stages[stage];
+	uint8_t i;
+
+	s->loops += loops;
+	s->totalCycles += totalCycles;
+	if (maxCycles > s->maxCycles) {
+		s->maxCycles = maxCycles;
+	}
+	if (bins != NULL) {
+		for (i=0;i<DLG_PROF_NUM_BINS;i++) {
+			s->bins[i] += bins[i];
+		}
+	}
+}
+
+/**
+ * @return The stage index of a three letter stage name, or -1.
+ */
+static int LoopProfile_FindStage(const char *name) {
+	int i;
+
+	for (i=0;i<DLG_PROF_NUM_STAGES;i++) {
+		if (memcmp(name, DLG_PROF_STAGE_NAMES + 3*i, 3) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int LoopProfile_ParseLine(LoopProfile *profile, const char *line) {
+	int stage;
+
+	// "PS tttttttt Sxxx " or "PS tttttttt Hxxx "
+	if (strncmp(line, "PS ", 3) != 0 || strlen(line) < 17 || line[11] != ' '
+			|| (line[12] != 'S' && line[12] != 'H') || line[16] != ' ') {
+		return 0;
+	}
+	if ((stage = LoopProfile_FindStage(line + 13)) < 0) {
+		return 0;
+	}
+
+	if (line[12] == 'S') {
+		unsigned long loops, totalCycles, maxCycles;
+		if (sscanf(line + 17, "%lx %lx %lx", &loops, &totalCycles, &maxCycles) != 3) {
+			return 0;
+		}
+		LoopProfile_AddStage(profile, stage, loops, totalCycles, maxCycles, NULL);
+	} else {
+		uint16_t bins[DLG_PROF_NUM_BINS];
+		const char *pos = line + 16;
+		char *end;
+		int i;
+
+		for (i=0;i<DLG_PROF_NUM_BINS;i++) {
+			bins[i] = strtoul(pos, &end, 16);
+			if (end == pos) {
+				return 0;
+			}
+			pos = end;
+		}
+		LoopProfile_AddStage(profile, stage, 0, 0, 0, bins);
+	}
+	profile->records++;
+	return 1;
+}
+
+/**
+ * Prints a bin limit, in cycles, as a time.
+ */
+static void LoopProfile_PrintLimit(FILE *out, const char *prefix, uint32_t cycles) {
+	char label[16];
+	double us = cycles * 1e6 / LOOP_PROFILE_FCY;
+
+	if (us < 1000) {
+		snprintf(label, sizeof(label), "%s%.0fus", prefix, us);
+	} else {
+		snprintf(label, sizeof(label), "%s%.0fms", prefix, us / 1000);
+	}
+	fprintf(out, " %7s", label);
+}
+
+void LoopProfile_Print(FILE *out, LoopProfile *profile) {
+	uint32_t limit = DLG_PROF_BIN0_CYCLES;
+	double loopUs = 0;
+	uint64_t loops = profile->stages[0].loops;
+	int i, j;
+
+	fprintf(out, "Loop profile, %llu iterations\n", (unsigned long long)loops);
+	fprintf(out, "  Stage  avg us   max us");
+	for (i=0;i<DLG_PROF_NUM_BINS-1;i++) {
+		LoopProfile_PrintLimit(out, "<", limit);
+		if (i < DLG_PROF_NUM_BINS-2) {
+			limit <<= DLG_PROF_BIN_SHIFT;
+		}
+	}
+	LoopProfile_PrintLimit(out, ">=", limit);
+	fprintf(out, "\n");
+
+	for (i=0;i<DLG_PROF_NUM_STAGES;i++) {
+		LoopProfileStage *s = &profile->stages[i];
+		double avgUs = s->loops ? s->totalCycles * 1e6 / LOOP_PROFILE_FCY / s->loops : 0;
+
+		loopUs += avgUs;
+		fprintf(out, "  %.3s %9.1f %8.1f", DLG_PROF_STAGE_NAMES + 3*i, avgUs,
+				s->maxCycles * 1e6 / LOOP_PROFILE_FCY);
+		for (j=0;j<DLG_PROF_NUM_BINS;j++) {
+			fprintf(out, " %7llu", (unsigned long long)s->bins[j]);
+		}
+		fprintf(out, "\n");
+	}
+	fprintf(out, "  Loop %8.1f\n", loopUs);
+}
@@ -0,0 +1,63 @@
+/*
+ * File:   loop-profile.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:45 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Host report of the datalogger per-stage loop profile (see
+ * datalogger-profile.h). Counters are accumulated either straight from the
+ * profiler, when running the datalogger code on the host, or from the PS
+ * records in a log, so both print the same report.
+ */
+
+#ifndef LOOP_PROFILE_H
+#define LOOP_PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "../Datalogger/datalogger-profile.h"
+
+/**
+ * Fcy of the datalogger boards, which the profile counts cycles of.
+ */
+#define LOOP_PROFILE_FCY		20000000
+
+typedef struct {
+	uint64_t loops;
+	uint64_t totalCycles;
+	uint32_t maxCycles;
+	uint64_t bins[DLG_PROF_NUM_BINS];
+} LoopProfileStage;
+
+typedef struct {
+	LoopProfileStage stages[DLG_PROF_NUM_STAGES];
+	uint32_t records;			/// Number of PS records parsed.
+} LoopProfile;
+
+/**
+ * Adds the counters of one stage.
+ */
+void LoopProfile_AddStage(LoopProfile *profile, uint8_t stage, uint32_t loops,
+		uint32_t totalCycles, uint32_t maxCycles, const uint16_t *bins);
+
+/**
+ * Parses an ASCII log line, adding the counters if it is a PS stage or
+ * histogram record.
+ *
+ * @return Whether the line was a stage or histogram record.
+ */
+int LoopProfile_ParseLine(LoopProfile *profile, const char *line);
+
+/**
+ * Prints the report, per stage: average and maximum time per loop iteration
+ * and the histogram.
+ */
+void LoopProfile_Print(FILE *out, LoopProfile *profile);
+
+#endif
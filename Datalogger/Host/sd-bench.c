@@ -0,0 +1,1004 @@
+/*
+ * File:   sd-bench.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 3:45 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Sync interval sweep and power cut test.
+ * 17 Oct 2026	agent	File creation time, remounting between files.
+ * 17 Oct 2026	agent	Free extent map scan, fragmented free space.
+ * 17 Oct 2026	agent	Reading files back through the firmware read path.
+ * 17 Oct 2026	agent	Raw write throughput benchmark.
+ * 17 Oct 2026	agent	Card busy time histograms.
+ * 17 Oct 2026	agent	Closing files after they go idle.
+ * 17 Oct 2026	agent	Setting the file's sector caches.
+ * 17 Oct 2026	agent	Intake stalls split by cause: card stalls, filesystem
+ *						pauses and ordinary block writes.
+ * 17 Oct 2026	agent	Late close with a partial last block.
+ *
+ * @file
+ * Host benchmark for the FAT32 + SD-SPI-DMA write path. This runs the
+ * firmware's FS_CreateFileSeqName / FS_WriteFile / FS_FileTasks against the
+ * emulated SD Card on the host virtual clock, then checks the resulting image.
+ *
+ * The main loop mirrors the datalogger: each iteration offers data to the
+ * file, runs the file tasks, and costs a fixed amount of CPU time. Data is
+ * generated as a function of the file offset, so the file contents can be
+ * verified even when intake stalls.
+ *
+ * Intake stalls are put down to a cause: a stall inserted by the emulated card
+ * (see SD_Host_Profile.StallInterval) if they overlap one, otherwise a
+ * filesystem pause (FAT write, sync point or hold) if the file stopped writing
+ * data during them, otherwise the card's ordinary busy time after blocks.
+ * Card stalls which never stalled intake were absorbed by the data buffers.
+ *
+ * The cost of sync points (see FS_SYNC_INTERVAL) is measured by sweeping the
+ * sync interval, one file each. The data they protect is measured by cutting
+ * the power partway through the first file: the run stops dead, without
+ * closing the file, and the image is read back to see how much of the data
+ * written survived. The file's preallocated cluster chain is left open-ended
+ * by a power cut, so the filesystem check reports it, as a real card would
+ * need a check disk.
+ *
+ * File creation time is reported for each file, which with many files on the
+ * card mostly depends on whether the sequential file name hint in the FS
+ * Information Sector can be used or the whole directory has to be scanned.
+ * Remounting before each file (-m) loads the hint from the card, as at power
+ * up, and ignoring it (-H) forces the scan.
+ *
+ * Without the free extent map (see fat32-freemap.h), clusters are allocated
+ * after the FS Information Sector's most recently allocated cluster, without
+ * checking the FAT. Filling the card with files and gaps first (-f) shows
+ * what that does to existing files, and building the map in the background
+ * (-s), like the datalogger does, shows how the files are split up across the
+ * gaps instead. Each file's fragment count is reported when checking.
+ *
+ * Reading back (-R) opens each file written with FS_OpenFile and reads it
+ * with FS_ReadFile, while FS_FileTasks reads ahead, checking the data and
+ * comparing the read throughput against the SPI bus limit. Each file is then
+ * read at a few random positions with FS_Seek.
+ *
+ * The raw write benchmark (-W) runs after the files, writing blocks to the
+ * largest free extent with Multiple Block Writes and no filesystem (see
+ * sd-benchmark.h), which shows what the card and bus sustain at the bus clock
+ * chosen, and how the bus speed control backs off on a card which can't keep
+ * up (-p marginal). The blocks are then checked in the image.
+ *
+ * Files are normally closed as soon as the last data is offered, so the close
+ * finds data pending. Closing late (-L) waits for the file tasks to write all
+ * the full blocks and go idle first, which is how the datalogger closes a
+ * file after a quiet period, and covers files ending exactly on a cluster
+ * run. A partial last block is left for the close to write.
+ *
+ * With the card statistics, the busy time histograms the SD layer keeps (see
+ * sd-latency.c) are printed, as timed by the firmware rather than the
+ * emulator.
+ *
+ * Usage: sd-bench [options]
+ *   -i path   Image file (default sd-bench.img)
+ *   -F MiB    Format a new image of this size first
+ *   -c n      Sectors per cluster when formatting (default 8)
+ *   -p name   Card latency profile: ideal, typical, slow, stall (default typical)
+ *   -n bytes  Bytes to write per file (default 4194304)
+ *   -k n      Number of files to write (default 1)
+ *   -r Bps    Data rate offered, in bytes/s, 0 for as fast as possible (default 0)
+ *   -w bytes  Write size per FS_WriteFile call (default 32)
+ *   -l ns     CPU time per main loop iteration (default 20000)
+ *   -y bytes  Sync interval, 0 for none (default FS_SYNC_INTERVAL)
+ *   -Y        Sweep the sync interval from none to 4 KiB, one file each
+ *   -X ms     Cut the power this long into the first file
+ *   -m        Remount the filesystem before each file
+ *   -H        Ignore the sequential file name hint, always scanning the directory
+ *   -f bytes  Fill the free space with files of this size, each followed by a gap
+ *             of the same size, first
+ *   -s n      Build the free extent map while writing, n FAT sectors per hold
+ *   -R bytes  Read each file back afterwards, this many bytes per FS_ReadFile call
+ *   -W blocks Write this many raw blocks to free space afterwards
+ *   -L        Close each file only once all its data is written and the file is idle
+ *   -v        List every file when checking
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../hardware.h"
+#include "../timing.h"
+#include "../SD-SPI-DMA/sd-spi-dma.h"
+#include "../SD-SPI-DMA/sd-hardware-host.h"
+#include "../SD-SPI-DMA/sd-benchmark.h"
+#include "../FAT32/fat32.h"
+#include "../FAT32/fat32-file.h"
+#include "../FAT32/fat32-freemap.h"
+
+#include "fat32-image.h"
+#include "sd-latency-report.h"
+
+#define BENCH_MAX_WRITE		512
+#define BENCH_TIMEOUT_NS	((uint64_t)3600 * 1000000000)
+#define BENCH_READ_SEEKS	16		/// Random positions read after reading back each file
+#define BENCH_SEEK_READ		64		/// Bytes read at each random position
+#define BENCH_MAX_PHY_ERRORS	64		/// Card errors in a file after which the file fails
+
+typedef struct {
+	const char *imagePath;
+	uint32_t formatMB;
+	uint8_t sectorsPerCluster;
+	const char *profile;
+	uint32_t fileBytes;
+	uint32_t numFiles;
+	uint32_t rate;
+	uint16_t writeSize;
+	uint32_t loopNs;
+	uint32_t syncInterval;
+	int sweep;
+	uint32_t cutMs;			/// Time into the first file to cut the power, 0 for none.
+	int remount;
+	int noHint;
+	uint32_t fragmentSize;	/// Size of the files and gaps to fill the card with first, 0 for none.
+	uint32_t scanBatch;		/// FAT sectors scanned per hold when building the free extent map, 0 for no map.
+	uint32_t readSize;		/// Bytes per FS_ReadFile call when reading files back, 0 to not read them back.
+	uint32_t rawBlocks;		/// Blocks written by the raw write benchmark, 0 to not run it.
+	int lateClose;			/// Request the close only once all the data is written and the file is idle.
+	int verbose;
+} BenchOptions;
+
+typedef struct {
+	uint64_t startNs;		/// Time the scan started.
+	uint64_t endNs;			/// Time the scan completed, 0 if it hasn't.
+	uint32_t holds;			/// Number of times the file was held for the scan.
+	uint64_t holdNs;		/// Total time the file was held.
+	uint64_t maxHoldNs;		/// Longest time the file was held.
+	uint64_t holdStartNs;
+	uint32_t batch;			/// FAT sectors scanned in the current hold.
+} BenchScanResult;
+
+typedef struct {
+	char name[12];			/// Directory entry name of the file written.
+	uint64_t createNs;		/// Time to create the file.
+	uint32_t createReads;	/// Blocks read to create the file.
+	uint32_t written;		/// Bytes accepted by FS_WriteFile.
+	uint32_t dropped;		/// Bytes offered at the data rate but refused.
+	uint64_t startNs;
+	uint64_t endNs;
+	uint32_t stalls;		/// Number of times intake was refused.
+	uint32_t stallsCard;	/// Of which overlapping a card stall.
+	uint32_t stallsFS;		/// Of which, otherwise, overlapping a filesystem pause (FAT, sync or hold).
+	uint32_t cardStalls;	/// Stalls inserted by the emulated card while writing.
+	uint64_t cardStallEnd;	/// End of the last card stall an intake stall was put down to.
+	uint64_t stallNs;		/// Total time intake was refused.
+	uint64_t maxStallNs;	/// Longest time intake was refused.
+	uint16_t maxFilled;		/// Highest number of data buffers filled.
+	uint32_t syncInterval;
+	uint16_t syncs;			/// Number of directory entry writes.
+	uint8_t cut;			/// Whether the power was cut during this file.
+	uint16_t phyErrors;		/// Card errors, after which the file retries, like the datalogger.
+
+	uint64_t openNs;		/// Time to open the file for reading back.
+	uint32_t readBytes;		/// Bytes read back.
+	uint64_t readNs;		/// Time to read the file back.
+	uint16_t readStalls;	/// Number of times FS_ReadFile found no data read ahead.
+	uint16_t readMaxFilled;	/// Highest number of data buffers read ahead.
+	uint64_t seekNs;		/// Total time of the random position reads.
+	uint16_t readErrors;	/// Card errors while reading back, after which the file retries.
+} BenchFileResult;
+
+typedef struct {
+	fs_addr_t lba;			/// LBA of the first block written.
+	uint32_t blocks;		/// Blocks written.
+	uint64_t ns;			/// Time to write them.
+} BenchRawResult;
+
+/** Sync intervals swept by -Y. */
+static const uint32_t sweepIntervals[] = {0, 1048576, 262144, 65536, 16384, 4096};
+#define BENCH_NUM_SWEEP		(sizeof(sweepIntervals) / sizeof(sweepIntervals[0]))
+
+SD_Card card;
+FS_FAT32 fs;
+FS_File file;
+FS_FileCache fileCache;
+BenchScanResult scan;
+
+/**
+ * @return The benchmark data byte at a file offset.
+ */
+static uint8_t BenchData(uint32_t offset) {
+	return (uint8_t)(offset * 31 + (offset >> 9) + (offset >> 17));
+}
+
+/**
+ * Runs the main loop tail: costs a loop iteration of CPU time.
+ */
+static void BenchLoop(BenchOptions *opt) {
+	Host_AdvanceClock(opt->loopNs);
+}
+
+static int BenchInit(BenchOptions *opt) {
+	sd_result_t sdresult;
+	fs_result_t fsresult;
+
+	card = SD_CreateCard();
+	FS_SetFileCache(&file, &fileCache);
+	SD_Initialize(&card);
+	do {
+		BenchLoop(opt);
+		sdresult = SD_GetInitializeResult(&card);
+	} while (sdresult == SD_BUSY);
+	if (sdresult != SD_SUCCESS) {
+		fprintf(stderr, "SD Card initialization failed, got 0x%02x\n", sdresult);
+		return 1;
+	}
+
+	fsresult = FAT32_Initialize(&fs, &card);
+	while (fsresult == FS_BUSY) {
+		BenchLoop(opt);
+		fsresult = FAT32_GetInitializeResult(&fs);
+	}
+	if (fsresult != FS_SUCCESS) {
+		fprintf(stderr, "FAT32 initialization failed, got 0x%02x\n", fsresult);
+		return 1;
+	}
+	if (opt->scanBatch != 0) {
+		FAT32_BeginFreeMap(&fs);
+		memset(&scan, 0, sizeof(scan));
+		scan.startNs = Host_Clock;
+	}
+	return 0;
+}
+
+/**
+ * Builds the free extent map in the background, like the datalogger: the file
+ * is held while a batch of FAT sectors is scanned, whenever it has caught up
+ * with the data, or can't go on until the scan finds free space.
+ * @return 0 on success, nonzero if the scan failed.
+ */
+static int BenchFreeMap(BenchOptions *opt) {
+	fs_result_t fsresult;
+
+	if (fs.freeMapState != FS_FREEMAP_SCANNING && !FAT32_FreeMapWaiting(&fs)) {
+		return 0;
+	}
+	if (!file.requestHold) {
+		if (file.dataBufferNumFilled == 0 || FAT32_FreeMapWaiting(&fs)) {
+			FS_HoldFile(&file, 1);
+			scan.holdStartNs = Host_Clock;
+			scan.batch = 0;
+		}
+		return 0;
+	}
+	if (!FS_IsFileHeld(&file)) {
+		return 0;
+	}
+
+	fsresult = FAT32_FreeMapTasks(&fs);
+	if (fsresult == FS_BUSY) {
+		return 0;
+	}
+	scan.batch++;
+	if (fsresult == FS_IDLE && (FAT32_FreeMapWaiting(&fs)
+			|| (scan.batch < opt->scanBatch && file.dataBufferNumFilled < FS_NUM_DATA_BUFFERS))) {
+		return 0;
+	}
+
+	FS_HoldFile(&file, 0);
+	scan.holds++;
+	scan.holdNs += Host_Clock - scan.holdStartNs;
+	if (Host_Clock - scan.holdStartNs > scan.maxHoldNs) {
+		scan.maxHoldNs = Host_Clock - scan.holdStartNs;
+	}
+	if (fsresult == FS_SUCCESS) {
+		if (scan.endNs == 0) {
+			scan.endNs = Host_Clock;
+		}
+	} else if (fsresult != FS_IDLE) {
+		fprintf(stderr, "Free extent map scan failed, got 0x%02x\n", fsresult);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Puts an intake stall down to a card stall if it overlapped one, otherwise to
+ * a filesystem pause if the file stopped writing data during it, otherwise to
+ * the card being busy with blocks.
+ * The card's busy period is timed on the bus, which can run a DMA transfer
+ * ahead of the virtual clock, so an intake stall just after a card stall can
+ * still seem to overlap it. Each card stall is only counted once.
+ */
+static void BenchClassifyStall(BenchFileResult *result, uint64_t stallStart, uint8_t stallFS) {
+	uint64_t cardStallEnd = SD_Host_GetStallEnd();
+
+	if (cardStallEnd > stallStart && cardStallEnd != result->cardStallEnd) {
+		result->cardStallEnd = cardStallEnd;
+		result->stallsCard++;
+	} else if (stallFS) {
+		result->stallsFS++;
+	}
+}
+
+static int BenchFile(BenchOptions *opt, uint32_t syncInterval, uint32_t cutMs,
+		BenchFileResult *result) {
+	uint8_t data[BENCH_MAX_WRITE];
+	fs_result_t fsresult;
+	uint64_t credit = 0;		// offered bytes, scaled by 1e9
+	uint64_t stallStart = 0;
+	uint8_t stalled = 0;
+	uint8_t stallFS = 0;		// whether the file left the data writing states during the stall
+	uint8_t closing = 0;
+
+	memset(result, 0, sizeof(*result));
+
+	if (opt->noHint) {
+		fs.seqHintValid = 0;
+	}
+	result->createNs = Host_Clock;
+	result->createReads = SD_Host_Stats.BlocksRead;
+	fsresult = FS_CreateFileSeqName(&fs, &fs.rootDirectory, &file, "BNCH0000", "BIN", 4, 4);
+	while (fsresult == FS_BUSY) {
+		BenchLoop(opt);
+		fsresult = FS_GetCreateFileResult(&file);
+	}
+	if (fsresult != FS_SUCCESS) {
+		fprintf(stderr, "File creation failed, got 0x%02x\n", fsresult);
+		return 1;
+	}
+	result->createNs = Host_Clock - result->createNs;
+	result->createReads = SD_Host_Stats.BlocksRead - result->createReads;
+	memcpy(result->name, file.name, 8);
+	memcpy(result->name + 8, file.ext, 3);
+	result->name[11] = '\0';
+	result->startNs = Host_Clock;
+	result->cardStalls = SD_Host_Stats.Stalls;
+	result->syncInterval = syncInterval;
+	FS_SetFileSyncInterval(&file, syncInterval);
+
+	while (1) {
+		// Offer data
+		if (!closing) {
+			uint32_t remaining = opt->fileBytes - result->written - result->dropped;
+			uint32_t offer = remaining;
+			if (opt->rate != 0) {
+				credit += (uint64_t)opt->rate * opt->loopNs;
+				offer = credit / 1000000000;
+				credit -= (uint64_t)offer * 1000000000;
+				if (offer > remaining) {
+					offer = remaining;
+				}
+			}
+			while (offer > 0) {
+				fs_length_t len = offer < opt->writeSize ? offer : opt->writeSize;
+				fs_length_t accepted;
+				uint16_t i;
+				for (i=0;i<len;i++) {
+					data[i] = BenchData(result->written + i);
+				}
+				accepted = FS_WriteFile(&file, data, len);
+				result->written += accepted;
+				offer -= len;
+				if (accepted < len) {
+					if (!stalled) {
+						stalled = 1;
+						stallStart = Host_Clock;
+						stallFS = 0;
+						result->stalls++;
+					}
+					if (opt->rate == 0) {
+						break;
+					}
+					// The source doesn't wait, so refused data is lost
+					result->dropped += len - accepted;
+				} else if (stalled) {
+					stalled = 0;
+					BenchClassifyStall(result, stallStart, stallFS);
+					result->stallNs += Host_Clock - stallStart;
+					if (Host_Clock - stallStart > result->maxStallNs) {
+						result->maxStallNs = Host_Clock - stallStart;
+					}
+				}
+			}
+			if (result->written + result->dropped >= opt->fileBytes && !opt->lateClose) {
+				FS_RequestFileClose(&file);
+				closing = 1;
+			}
+		}
+
+		if (file.statMaxFilled > result->maxFilled) {
+			result->maxFilled = file.statMaxFilled;
+		}
+
+		if (BenchFreeMap(opt)) {
+			return 1;
+		}
+
+		fsresult = FS_FileTasks(&file);
+		if (stalled && (FS_IsFileHeld(&file) || file.state == FILE_TerminatingData
+				|| file.state == FILE_WritingFAT || file.state == FILE_WritingFSInformation
+				|| file.state == FILE_WritingDirTable)) {
+			stallFS = 1;
+		}
+		if (fsresult == FS_CLOSED) {
+			break;
+		} else if (fsresult == FS_PHY_ERR && result->phyErrors < BENCH_MAX_PHY_ERRORS) {
+			result->phyErrors++;
+		} else if (fsresult == FS_IDLE && !closing
+				&& result->written + result->dropped >= opt->fileBytes
+				&& file.dataBufferNumFilled == 0
+				&& !file.requestHold && !FAT32_FreeMapWaiting(&fs)) {
+			// Late close: every full block has been written out, and the file
+			// isn't held, so it would otherwise go on to place its next run.
+			// A partial last block is only written by the close.
+			FS_RequestFileClose(&file);
+			closing = 1;
+		} else if (fsresult != FS_SUCCESS && fsresult != FS_IDLE && fsresult != FS_BUSY) {
+			fprintf(stderr, "File tasks failed, got 0x%02x\n", fsresult);
+			return 1;
+		}
+
+		BenchLoop(opt);
+		if (cutMs != 0 && Host_Clock - result->startNs >= (uint64_t)cutMs * 1000000) {
+			result->cut = 1;
+			break;
+		}
+		if (Host_Clock - result->startNs > BENCH_TIMEOUT_NS) {
+			fprintf(stderr, "Timed out\n");
+			return 1;
+		}
+	}
+	result->endNs = Host_Clock;
+	result->cardStalls = SD_Host_Stats.Stalls - result->cardStalls;
+	if (stalled) {
+		BenchClassifyStall(result, stallStart, stallFS);
+	}
+	result->syncs = file.statSyncs;
+	return 0;
+}
+
+/**
+ * Runs the file tasks while reading back.
+ * @return 0 on success, nonzero on failure.
+ */
+static int BenchReadTasks(BenchFileResult *result) {
+	fs_result_t fsresult = FS_FileTasks(&file);
+	if (fsresult == FS_PHY_ERR && result->readErrors < BENCH_MAX_PHY_ERRORS) {
+		result->readErrors++;
+	} else if (fsresult != FS_SUCCESS && fsresult != FS_IDLE && fsresult != FS_BUSY) {
+		fprintf(stderr, "File tasks failed, got 0x%02x\n", fsresult);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Reads a file back with the firmware read path, checking the data, first
+ * sequentially, then at random positions.
+ * @return Number of errors.
+ */
+static int BenchReadFile(BenchOptions *opt, BenchFileResult *result) {
+	uint8_t data[BENCH_MAX_WRITE];
+	fs_result_t fsresult;
+	uint32_t offset, end, i;
+	uint64_t startNs;
+	uint16_t seek;
+
+	result->openNs = Host_Clock;
+	fsresult = FS_OpenFile(&fs, &fs.rootDirectory, &file, result->name, result->name + 8);
+	while (fsresult == FS_BUSY) {
+		BenchLoop(opt);
+		fsresult = FS_GetOpenFileResult(&file);
+	}
+	if (fsresult != FS_SUCCESS) {
+		printf("Error: unable to open %.8s.%.3s, got 0x%02x\n", result->name, result->name + 8, fsresult);
+		return 1;
+	}
+	result->openNs = Host_Clock - result->openNs;
+
+	// Sequential read, as fast as the data is read ahead
+	startNs = Host_Clock;
+	offset = 0;
+	while (offset < file.size) {
+		fs_length_t len = FS_ReadFile(&file, data, opt->readSize);
+		for (i=0;i<len;i++) {
+			if (data[i] != BenchData(offset + i)) {
+				printf("Error: %.8s.%.3s read back mismatch at offset %u\n",
+						result->name, result->name + 8, offset + i);
+				return 1;
+			}
+		}
+		offset += len;
+		if (BenchReadTasks(result)) {
+			return 1;
+		}
+		BenchLoop(opt);
+		if (Host_Clock - startNs > BENCH_TIMEOUT_NS) {
+			fprintf(stderr, "Timed out\n");
+			return 1;
+		}
+	}
+	result->readNs = Host_Clock - startNs;
+	result->readBytes = offset;
+	result->readStalls = file.statReadStalls;
+	result->readMaxFilled = file.statMaxFilled;
+
+	// Random positions, seeking both ways
+	srand(result->written);
+	startNs = Host_Clock;
+	for (seek=0;seek<BENCH_READ_SEEKS && file.size > 0;seek++) {
+		offset = ((uint32_t)rand() * 65536 + rand()) % file.size;
+		end = offset + BENCH_SEEK_READ < file.size ? offset + BENCH_SEEK_READ : file.size;
+		if (FS_Seek(&file, offset) != FS_SUCCESS) {
+			printf("Error: %.8s.%.3s seek to %u failed\n", result->name, result->name + 8, offset);
+			return 1;
+		}
+		while (offset < end) {
+			fs_length_t len = FS_ReadFile(&file, data, end - offset);
+			for (i=0;i<len;i++) {
+				if (data[i] != BenchData(offset + i)) {
+					printf("Error: %.8s.%.3s seek read mismatch at offset %u\n",
+							result->name, result->name + 8, offset + i);
+					return 1;
+				}
+			}
+			offset += len;
+			if (BenchReadTasks(result)) {
+				return 1;
+			}
+			BenchLoop(opt);
+			if (Host_Clock - startNs > BENCH_TIMEOUT_NS) {
+				fprintf(stderr, "Timed out\n");
+				return 1;
+			}
+		}
+	}
+	result->seekNs = Host_Clock - startNs;
+
+	FS_RequestFileClose(&file);
+	while (FS_FileTasks(&file) != FS_CLOSED) {
+		BenchLoop(opt);
+	}
+	return 0;
+}
+
+static void PrintReadResult(BenchFileResult *result) {
+	double seconds = result->readNs / 1e9;
+	printf("%.8s.%.3s: read back %u bytes in %.3f s (%.1f KiB/s, SPI limit %.1f KiB/s)\n",
+			result->name, result->name + 8, result->readBytes, seconds,
+			seconds > 0 ? result->readBytes / seconds / 1024 : 0,
+			1e9 / SD_Host_GetByteTime() / 1024);
+	printf("  opened in %.3f ms, read stalls %u, max buffers read ahead %u/%u, %u card errors\n",
+			result->openNs / 1e6, result->readStalls, result->readMaxFilled, FS_NUM_DATA_BUFFERS,
+			result->readErrors);
+	printf("  %u random reads of %u bytes, %.3f ms avg\n",
+			BENCH_READ_SEEKS, BENCH_SEEK_READ, result->seekNs / 1e6 / BENCH_READ_SEEKS);
+}
+
+static void PrintFileResult(BenchOptions *opt, BenchFileResult *result) {
+	double seconds = (result->endNs - result->startNs) / 1e9;
+	printf("%.8s.%.3s: %u bytes in %.3f s (%.1f KiB/s)",
+			result->name, result->name + 8, result->written, seconds,
+			seconds > 0 ? result->written / seconds / 1024 : 0);
+	if (opt->rate != 0) {
+		printf(", %u dropped", result->dropped);
+	}
+	printf("\n  intake stalls %u, stalled %.3f ms total, %.3f ms max, max buffers filled %u/%u\n",
+			result->stalls, result->stallNs / 1e6, result->maxStallNs / 1e6,
+			result->maxFilled, FS_NUM_DATA_BUFFERS);
+	printf("  of which %u on card stalls, %u on filesystem pauses, %u on block writes; %u card stalls, %u absorbed\n",
+			result->stallsCard, result->stallsFS, result->stalls - result->stallsCard - result->stallsFS,
+			result->cardStalls,
+			result->cardStalls > result->stallsCard ? result->cardStalls - result->stallsCard : 0);
+	printf("  sync interval %u bytes, %u directory entry writes, %u card errors\n",
+			result->syncInterval, result->syncs, result->phyErrors);
+	printf("  created in %.3f ms, %u blocks read\n",
+			result->createNs / 1e6, result->createReads);
+}
+
+static void PrintCreateSummary(BenchFileResult *results, uint32_t numFiles) {
+	uint64_t totalNs = 0, maxNs = 0;
+	uint32_t i;
+
+	for (i=0;i<numFiles;i++) {
+		totalNs += results[i].createNs;
+		if (results[i].createNs > maxNs) {
+			maxNs = results[i].createNs;
+		}
+	}
+	printf("File creation: %.3f ms avg, %.3f ms max, %.3f ms for the last file (%u blocks read)\n",
+			totalNs / 1e6 / numFiles, maxNs / 1e6, results[numFiles-1].createNs / 1e6,
+			results[numFiles-1].createReads);
+}
+
+static void PrintSweep(BenchFileResult *results, uint32_t numFiles) {
+	double baseRate = 0;
+	uint32_t i;
+
+	printf("   Interval     KiB/s   Cost  Syncs  Max stall(ms)\n");
+	for (i=0;i<numFiles;i++) {
+		double seconds = (results[i].endNs - results[i].startNs) / 1e9;
+		double rate = seconds > 0 ? results[i].written / seconds / 1024 : 0;
+		if (i == 0) {
+			baseRate = rate;
+		}
+		if (results[i].syncInterval == 0) {
+			printf("%11s", "none");
+		} else {
+			printf("%11u", results[i].syncInterval);
+		}
+		printf(" %9.1f %5.1f%% %6u %14.3f\n", rate,
+				baseRate > 0 ? (baseRate - rate) * 100 / baseRate : 0,
+				results[i].syncs, results[i].maxStallNs / 1e6);
+	}
+}
+
+static void PrintScanStats() {
+	uint32_t largest = 0;
+	uint8_t i;
+
+	for (i=0;i<fs.numFreeExtents;i++) {
+		if (fs.freeExtents[i].length > largest) {
+			largest = fs.freeExtents[i].length;
+		}
+	}
+	if (scan.endNs != 0) {
+		printf("Free extent map: %u FAT sectors scanned in %.3f s",
+				fs.freeMapScanSector, (scan.endNs - scan.startNs) / 1e9);
+	} else {
+		printf("Free extent map: incomplete, %u of %u FAT sectors scanned",
+				fs.freeMapScanSector, fs.freeMapScanEnd);
+	}
+	printf(", %u extents, largest %u sectors (%u clusters)\n",
+			fs.numFreeExtents, largest, largest * (FS_SECTOR_SIZE / 4));
+	printf("  file held %u times, %.3f ms total, %.3f ms max\n",
+			scan.holds, scan.holdNs / 1e6, scan.maxHoldNs / 1e6);
+}
+
+static void PrintCardStats() {
+	SDLatencyReport latency;
+
+	printf("Card: %u commands, %u blocks read (%u MBR in %u runs), %u blocks written (%u MBW in %u runs, %u SBW)\n",
+			SD_Host_Stats.Commands, SD_Host_Stats.BlocksRead,
+			SD_Host_Stats.MBRBlocks, SD_Host_Stats.MBRBegins, SD_Host_Stats.BlocksWritten,
+			SD_Host_Stats.MBWBlocks, SD_Host_Stats.MBWBegins, SD_Host_Stats.SBWs);
+	printf("  busy %.3f ms total, %.3f ms max, %u stalls, %u protocol errors, %u injected errors\n",
+			SD_Host_Stats.BusyNs / 1e6, SD_Host_Stats.MaxBusyNs / 1e6,
+			SD_Host_Stats.Stalls, SD_Host_Stats.Errors, SD_Host_Stats.InjectedErrors);
+
+	// Busy times as the firmware measured them, since the last report
+	memset(&latency, 0, sizeof(latency));
+	SDLatencyReport_AddHistograms(&latency, card.Latency, card.LatencyBudget);
+	SD_Latency_Clear(&card);
+	if (latency.kinds[SD_LATENCY_BLOCK].count != 0) {
+		SDLatencyReport_Print(stdout, &latency);
+	}
+}
+
+/**
+ * Verifies the contents of a written file against the benchmark data.
+ * @return Number of errors.
+ */
+static int VerifyFile(FAT32_Image *img, BenchFileResult *result) {
+	uint32_t startCluster, size, i;
+	uint8_t *buffer;
+	int errors = 0;
+
+	if (FAT32_Image_FindFile(img, result->name, &startCluster, &size)) {
+		printf("Error: %.8s.%.3s not found\n", result->name, result->name + 8);
+		return 1;
+	}
+	if (result->cut) {
+		printf("Power cut at %.3f s: %u of %u bytes written survived, %u lost (sync interval %u)\n",
+				(result->endNs - result->startNs) / 1e9, size, result->written,
+				result->written - size, result->syncInterval);
+		if (size > result->written) {
+			printf("Error: %.8s.%.3s is %u bytes, only wrote %u\n",
+					result->name, result->name + 8, size, result->written);
+			return 1;
+		}
+	} else if (size != result->written) {
+		printf("Error: %.8s.%.3s is %u bytes, wrote %u\n",
+				result->name, result->name + 8, size, result->written);
+		errors++;
+	}
+	printf("%.8s.%.3s: %u fragments\n", result->name, result->name + 8,
+			FAT32_Image_CountFragments(img, startCluster));
+	buffer = malloc(size + 1);
+	if (buffer == NULL || FAT32_Image_ReadFile(img, startCluster, size, buffer)) {
+		printf("Error: unable to read %.8s.%.3s\n", result->name, result->name + 8);
+		free(buffer);
+		return errors + 1;
+	}
+	for (i=0;i<size;i++) {
+		if (buffer[i] != BenchData(i)) {
+			printf("Error: %.8s.%.3s data mismatch at offset %u\n",
+					result->name, result->name + 8, i);
+			errors++;
+			break;
+		}
+	}
+	free(buffer);
+	return errors;
+}
+
+/**
+ * @return The raw write benchmark data byte at an offset in a data block.
+ */
+static uint8_t BenchRawData(uint8_t dataBlock, uint16_t offset) {
+	return (uint8_t)(offset * 7 + dataBlock * 101 + (offset >> 8));
+}
+
+/**
+ * Runs the raw write benchmark in the largest free extent, completing the free
+ * extent map scan first.
+ * @return 0 on success, nonzero on failure.
+ */
+static int BenchRaw(BenchOptions *opt, BenchRawResult *result) {
+	SD_Benchmark bench;
+	sd_result_t sdresult;
+	fs_result_t fsresult;
+	uint32_t freeBlocks;
+	uint64_t startNs;
+	uint8_t mapped = (fs.freeMapState != FS_FREEMAP_NONE);
+	uint8_t i;
+	uint16_t j;
+
+	memset(result, 0, sizeof(*result));
+	if (!mapped) {
+		FAT32_BeginFreeMap(&fs);
+	}
+	do {
+		BenchLoop(opt);
+		fsresult = FAT32_FreeMapTasks(&fs);
+	} while (fsresult == FS_BUSY || fsresult == FS_IDLE);
+	if (fsresult != FS_SUCCESS) {
+		fprintf(stderr, "Free extent map scan failed, got 0x%02x\n", fsresult);
+		return 1;
+	}
+	if (scan.endNs == 0) {
+		scan.endNs = Host_Clock;
+	}
+	result->lba = FAT32_FreeMapGetLargest(&fs, &freeBlocks);
+	if (!mapped) {
+		fs.freeMapState = FS_FREEMAP_NONE;
+	}
+	if (result->lba == 0 || freeBlocks < opt->rawBlocks) {
+		fprintf(stderr, "Not enough free space for %u blocks, largest free extent is %u blocks\n",
+				opt->rawBlocks, freeBlocks);
+		return 1;
+	}
+
+	for (i=1;i<card.NumDataBlocks;i++) {
+		for (j=0;j<card.BlockSize;j++) {
+			card.DataBlocks[i].Data[j+2] = BenchRawData(i, j);
+		}
+	}
+
+	memset(&SD_Host_Stats, 0, sizeof(SD_Host_Stats));
+	startNs = Host_Clock;
+	SD_Benchmark_Begin(&bench, &card, result->lba, opt->rawBlocks, 0);
+	do {
+		BenchLoop(opt);
+		sdresult = SD_Benchmark_Tasks(&bench);
+	} while (sdresult == SD_BUSY);
+	result->ns = Host_Clock - startNs;
+	result->blocks = bench.blocks;
+
+	printf("Raw write: %u blocks at LBA %u in %.3f s (%.1f KiB/s, SPI limit %.1f KiB/s), %u errors\n",
+			bench.blocks, (uint32_t)result->lba, result->ns / 1e9,
+			result->ns > 0 ? bench.blocks * 512.0 / (result->ns / 1e9) / 1024 : 0,
+			1e9 / SD_Host_GetByteTime() / 1024, bench.errors);
+	printf("  bus clock %u kHz (card maximum %u kHz), high speed %s, %u back-offs\n",
+			card.SpeedkHz, card.MaxSpeedkHz, SD_Host_GetHighSpeed() ? "on" : "off",
+			card.SpeedBackoffs);
+	PrintCardStats();
+	if (sdresult != SD_SUCCESS) {
+		fprintf(stderr, "Raw write failed, got 0x%02x\n", sdresult);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Verifies the blocks written by the raw write benchmark in the image.
+ * @return Number of errors.
+ */
+static int VerifyRaw(FAT32_Image *img, BenchRawResult *result) {
+	uint8_t data[512];
+	uint32_t block;
+	uint16_t j;
+
+	for (block=0;block<result->blocks;block++) {
+		uint8_t dataBlock = 1 + block % (card.NumDataBlocks - 1);
+		if (fseek(img->file, (long)(result->lba + block) * 512, SEEK_SET) != 0
+				|| fread(data, 1, sizeof(data), img->file) != sizeof(data)) {
+			printf("Error: unable to read raw block at LBA %u\n", (uint32_t)(result->lba + block));
+			return 1;
+		}
+		for (j=0;j<sizeof(data);j++) {
+			if (data[j] != BenchRawData(dataBlock, j)) {
+				printf("Error: raw block at LBA %u mismatch at offset %u\n",
+						(uint32_t)(result->lba + block), j);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+static void Usage() {
+	fprintf(stderr, "Usage: sd-bench [-i image] [-F MiB] [-c spc] [-p profile] [-n bytes]"
+			" [-k files] [-r Bps] [-w bytes] [-l ns] [-y bytes] [-Y] [-X ms] [-m] [-H]"
+			" [-f bytes] [-s n] [-R bytes] [-W blocks] [-L] [-v]\n");
+}
+
+int main(int argc, char **argv) {
+	BenchOptions opt;
+	BenchFileResult *results;
+	BenchRawResult raw;
+	const SD_Host_Profile *profile;
+	FAT32_Image img;
+	uint32_t i;
+	int c, errors = 0;
+
+	opt.imagePath = "sd-bench.img";
+	opt.formatMB = 0;
+	opt.sectorsPerCluster = 8;
+	opt.profile = "typical";
+	opt.fileBytes = 4194304;
+	opt.numFiles = 1;
+	opt.rate = 0;
+	opt.writeSize = 32;
+	opt.loopNs = 20000;
+	opt.syncInterval = FS_SYNC_INTERVAL;
+	opt.sweep = 0;
+	opt.cutMs = 0;
+	opt.remount = 0;
+	opt.noHint = 0;
+	opt.fragmentSize = 0;
+	opt.scanBatch = 0;
+	opt.readSize = 0;
+	opt.rawBlocks = 0;
+	opt.lateClose = 0;
+	opt.verbose = 0;
+
+	while ((c = getopt(argc, argv, "i:F:c:p:n:k:r:w:l:y:YX:mHf:s:R:W:Lv")) != -1) {
+		switch (c) {
+			case 'i':	opt.imagePath = optarg;						break;
+			case 'F':	opt.formatMB = strtoul(optarg, NULL, 0);	break;
+			case 'c':	opt.sectorsPerCluster = strtoul(optarg, NULL, 0);	break;
+			case 'p':	opt.profile = optarg;						break;
+			case 'n':	opt.fileBytes = strtoul(optarg, NULL, 0);	break;
+			case 'k':	opt.numFiles = strtoul(optarg, NULL, 0);	break;
+			case 'r':	opt.rate = strtoul(optarg, NULL, 0);		break;
+			case 'w':	opt.writeSize = strtoul(optarg, NULL, 0);	break;
+			case 'l':	opt.loopNs = strtoul(optarg, NULL, 0);		break;
+			case 'y':	opt.syncInterval = strtoul(optarg, NULL, 0);	break;
+			case 'Y':	opt.sweep = 1;								break;
+			case 'X':	opt.cutMs = strtoul(optarg, NULL, 0);		break;
+			case 'm':	opt.remount = 1;							break;
+			case 'H':	opt.noHint = 1;								break;
+			case 'f':	opt.fragmentSize = strtoul(optarg, NULL, 0);	break;
+			case 's':	opt.scanBatch = strtoul(optarg, NULL, 0);	break;
+			case 'R':	opt.readSize = strtoul(optarg, NULL, 0);	break;
+			case 'W':	opt.rawBlocks = strtoul(optarg, NULL, 0);	break;
+			case 'L':	opt.lateClose = 1;							break;
+			case 'v':	opt.verbose = 1;							break;
+			default:	Usage();	return 2;
+		}
+	}
+	if (opt.writeSize == 0 || opt.writeSize > BENCH_MAX_WRITE || opt.numFiles == 0
+			|| opt.readSize > BENCH_MAX_WRITE
+			|| (opt.sweep && opt.cutMs != 0)) {
+		Usage();
+		return 2;
+	}
+	if (opt.sweep) {
+		opt.numFiles = BENCH_NUM_SWEEP;
+	}
+
+	profile = SD_Host_FindProfile(opt.profile);
+	if (profile == NULL) {
+		fprintf(stderr, "Unknown profile '%s'\n", opt.profile);
+		return 2;
+	}
+
+	if (opt.formatMB != 0) {
+		if (FAT32_Image_Format(opt.imagePath, opt.formatMB, opt.sectorsPerCluster, 1)) {
+			return 1;
+		}
+	}
+	if (opt.fragmentSize != 0) {
+		int files = FAT32_Image_Fragment(opt.imagePath, opt.fragmentSize);
+		if (files < 0) {
+			return 1;
+		}
+		printf("Filled the card with %d files of %u bytes, each followed by a gap\n",
+				files, opt.fragmentSize);
+	}
+
+	Timing_Init();
+	SD_Host_SetProfile(profile);
+	if (!SD_Host_OpenImage(opt.imagePath)) {
+		return 1;
+	}
+	if (BenchInit(&opt)) {
+		SD_Host_CloseImage();
+		return 1;
+	}
+	printf("Profile %s, SPI byte time %u ns (%u kHz, high speed %s), loop %u ns, %u data buffers, %u FAT sectors preallocated\n",
+			profile->Name, SD_Host_GetByteTime(), card.SpeedkHz, SD_Host_GetHighSpeed() ? "on" : "off",
+			opt.loopNs, FS_NUM_DATA_BUFFERS, FS_PREALLOC_FAT_SECTORS);
+	memset(&SD_Host_Stats, 0, sizeof(SD_Host_Stats));
+
+	results = calloc(opt.numFiles, sizeof(BenchFileResult));
+	for (i=0;i<opt.numFiles;i++) {
+		if (opt.remount && i != 0 && BenchInit(&opt)) {
+			errors++;
+			opt.numFiles = i;
+			break;
+		}
+		if (BenchFile(&opt, opt.sweep ? sweepIntervals[i] : opt.syncInterval,
+				i == 0 ? opt.cutMs : 0, &results[i])) {
+			errors++;
+			opt.numFiles = i + 1;
+			break;
+		}
+		PrintFileResult(&opt, &results[i]);
+		if (results[i].cut) {
+			opt.numFiles = i + 1;
+			break;
+		}
+	}
+	if (opt.sweep && errors == 0) {
+		PrintSweep(results, opt.numFiles);
+	}
+	if (opt.numFiles > 1) {
+		PrintCreateSummary(results, opt.numFiles);
+	}
+	if (opt.scanBatch != 0) {
+		PrintScanStats();
+	}
+	PrintCardStats();
+	if (opt.readSize != 0) {
+		memset(&SD_Host_Stats, 0, sizeof(SD_Host_Stats));
+		for (i=0;i<opt.numFiles;i++) {
+			if (results[i].endNs != 0 && !results[i].cut) {
+				if (BenchReadFile(&opt, &results[i])) {
+					errors++;
+				} else {
+					PrintReadResult(&results[i]);
+				}
+			}
+		}
+		PrintCardStats();
+	}
+	memset(&raw, 0, sizeof(raw));
+	if (opt.rawBlocks != 0 && BenchRaw(&opt, &raw)) {
+		errors++;
+	}
+	SD_Host_CloseImage();
+
+	if (FAT32_Image_Open(&img, opt.imagePath)) {
+		free(results);
+		return 1;
+	}
+	if (FAT32_Image_Check(&img, opt.verbose)) {
+		if (opt.cutMs != 0) {
+			printf("Filesystem errors expected after a power cut\n");
+		} else {
+			errors++;
+		}
+	}
+	for (i=0;i<opt.numFiles;i++) {
+		if (results[i].endNs != 0) {
+			errors += VerifyFile(&img, &results[i]);
+		}
+	}
+	errors += VerifyRaw(&img, &raw);
+	FAT32_Image_Close(&img);
+	free(results);
+
+	return errors ? 1 : 0;
+}
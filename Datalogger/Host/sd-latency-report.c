@@ -0,0 +1,159 @@
+/*
+ * File:   sd-latency-report.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:59 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Host report of the SD Card busy time histograms.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "sd-latency-report.h"
+
+void SDLatencyReport_AddKind(SDLatencyReport *report, uint8_t kind, uint32_t count,
+		uint32_t overBudget, uint32_t totalCycles, uint32_t maxCycles, uint32_t budget,
+		const uint16_t *bins) {
+	SDLatencyReportKind *k = &report->kinds[kind];
+	uint8_t i;
+
+	k->count += count;
+	k->overBudget += overBudget;
+	k->totalCycles += totalCycles;
+	if (maxCycles > k->maxCycles) {
+		k->maxCycles = maxCycles;
+	}
+	if (budget != 0 && (k->minBudget == 0 || budget < k->minBudget)) {
+		k->minBudget = budget;
+	}
+	if (bins != NULL) {
+		for (i=0;i<SD_LATENCY_NUM_BINS;i++) {
+			k->bins[i] += bins[i];
+		}
+	}
+}
+
+void SDLatencyReport_AddHistograms(SDLatencyReport *report, const SD_Latency *latency,
+		uint32_t budget) {
+	uint8_t i;
+
+	for (i=0;i<SD_LATENCY_NUM_KINDS;i++) {
+		SDLatencyReport_AddKind(report, i, latency[i].Count, latency[i].OverBudget,
+				latency[i].TotalCycles, latency[i].MaxCycles, budget, latency[i].Bins);
+	}
+}
+
+int SDLatencyReport_ParseLine(SDLatencyReport *report, const char *line) {
+	const char *name;
+
+	// "PS tttttttt SDLx " or "PS tttttttt SDHx "
+	if (strncmp(line, "PS ", 3) != 0 || strlen(line) < 17 || line[11] != ' '
+			|| strncmp(line + 12, "SD", 2) != 0
+			|| (line[14] != 'L' && line[14] != 'H') || line[16] != ' ') {
+		return 0;
+	}
+	if (line[15] == 0 || (name = strchr(SD_LATENCY_KIND_NAMES, line[15])) == NULL) {
+		return 0;
+	}
+
+	if (line[14] == 'L') {
+		unsigned long count, overBudget, totalCycles, maxCycles, budget;
+		if (sscanf(line + 17, "%lx %lx %lx %lx %lx", &count, &overBudget,
+				&totalCycles, &maxCycles, &budget) != 5) {
+			return 0;
+		}
+		SDLatencyReport_AddKind(report, name - SD_LATENCY_KIND_NAMES, count,
+				overBudget, totalCycles, maxCycles, budget, NULL);
+	} else {
+		uint16_t bins[SD_LATENCY_NUM_BINS];
+		const char *pos = line + 16;
+		char *end;
+		int i;
+
+		for (i=0;i<SD_LATENCY_NUM_BINS;i++) {
+			bins[i] = strtoul(pos, &end, 16);
+			if (end == pos) {
+				return 0;
+			}
+			pos = end;
+		}
+		SDLatencyReport_AddKind(report, name - SD_LATENCY_KIND_NAMES, 0, 0, 0, 0, 0, bins);
+	}
+	report->records++;
+	return 1;
+}
+
+/**
+ * @return A time in cycles, in milliseconds.
+ */
+static double SDLatencyReport_Ms(uint64_t cycles) {
+	return cycles * 1e3 / SD_LATENCY_REPORT_FCY;
+}
+
+/**
+ * Prints a bin limit, in cycles, as a time.
+ */
+static void SDLatencyReport_PrintLimit(FILE *out, const char *prefix, uint32_t cycles) {
+	char label[16];
+	double ms = SDLatencyReport_Ms(cycles);
+
+	if (ms < 1) {
+		snprintf(label, sizeof(label), "%s%.0fus", prefix, ms * 1000);
+	} else if (ms < 10) {
+		snprintf(label, sizeof(label), "%s%.1fms", prefix, ms);
+	} else {
+		snprintf(label, sizeof(label), "%s%.0fms", prefix, ms);
+	}
+	fprintf(out, " %7s", label);
+}
+
+void SDLatencyReport_Print(FILE *out, SDLatencyReport *report) {
+	static const char *names[SD_LATENCY_NUM_KINDS] = {"Block", "Stop"};
+	uint32_t limit = SD_LATENCY_BIN0_CYCLES;
+	int i, j;
+
+	fprintf(out, "SD Card busy time\n");
+	fprintf(out, "  Kind     count   avg ms   max ms budget ms   over");
+	for (i=0;i<SD_LATENCY_NUM_BINS-1;i++) {
+		SDLatencyReport_PrintLimit(out, "<", limit);
+		if (i < SD_LATENCY_NUM_BINS-2) {
+			limit <<= SD_LATENCY_BIN_SHIFT;
+		}
+	}
+	SDLatencyReport_PrintLimit(out, ">=", limit);
+	fprintf(out, "\n");
+
+	for (i=0;i<SD_LATENCY_NUM_KINDS;i++) {
+		SDLatencyReportKind *k = &report->kinds[i];
+
+		fprintf(out, "  %-5s %8llu %8.3f %8.3f", names[i], (unsigned long long)k->count,
+				k->count ? SDLatencyReport_Ms(k->totalCycles) / k->count : 0,
+				SDLatencyReport_Ms(k->maxCycles));
+		if (k->minBudget != 0) {
+			fprintf(out, " %9.3f", SDLatencyReport_Ms(k->minBudget));
+		} else {
+			fprintf(out, " %9s", "-");
+		}
+		fprintf(out, " %6llu", (unsigned long long)k->overBudget);
+		for (j=0;j<SD_LATENCY_NUM_BINS;j++) {
+			fprintf(out, " %7llu", (unsigned long long)k->bins[j]);
+		}
+		fprintf(out, "\n");
+	}
+
+	for (i=0;i<SD_LATENCY_NUM_KINDS;i++) {
+		SDLatencyReportKind *k = &report->kinds[i];
+
+		if (k->overBudget != 0) {
+			fprintf(out, "  Slow card: %s busy up to %.3f ms, %llu times over the budget\n",
+					(i == SD_LATENCY_BLOCK) ? "block" : "Stop Tran", SDLatencyReport_Ms(k->maxCycles),
+					(unsigned long long)k->overBudget);
+		}
+	}
+}
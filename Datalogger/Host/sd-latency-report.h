@@ -0,0 +1,76 @@
+/*
+ * File:   sd-latency-report.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:59 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Host report of the SD Card busy time histograms (see sd-latency.c).
+ * Counters are accumulated either straight from the SD_Card struct, when
+ * running the SD code on the host, or from the PS SDL / SDH records in a
+ * datalogger log, so both print the same report.
+ */
+
+#ifndef SD_LATENCY_REPORT_H
+#define SD_LATENCY_REPORT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "../SD-SPI-DMA/sd-latency.h"
+
+/**
+ * Fcy of the datalogger boards, which the busy times count cycles of.
+ */
+#define SD_LATENCY_REPORT_FCY		20000000
+
+typedef struct {
+	uint64_t count;
+	uint64_t overBudget;
+	uint64_t totalCycles;
+	uint32_t maxCycles;
+	uint32_t minBudget;			/// Tightest budget in force, 0 if none was set.
+	uint64_t bins[SD_LATENCY_NUM_BINS];
+} SDLatencyReportKind;
+
+typedef struct {
+	SDLatencyReportKind kinds[SD_LATENCY_NUM_KINDS];
+	uint32_t records;			/// Number of PS records parsed.
+} SDLatencyReport;
+
+/**
+ * Adds the counters of one kind of operation.
+ *
+ * @param budget Budget the counters were taken under, in cycles, 0 if none.
+ * @param bins Histogram, or NULL.
+ */
+void SDLatencyReport_AddKind(SDLatencyReport *report, uint8_t kind, uint32_t count,
+		uint32_t overBudget, uint32_t totalCycles, uint32_t maxCycles, uint32_t budget,
+		const uint16_t *bins);
+
+/**
+ * Adds the histograms of a card (SD_Card.Latency), under its current budget.
+ */
+void SDLatencyReport_AddHistograms(SDLatencyReport *report, const SD_Latency *latency,
+		uint32_t budget);
+
+/**
+ * Parses an ASCII log line, adding the counters if it is a PS SDL or SDH
+ * record.
+ *
+ * @return Whether the line was a busy time record.
+ */
+int SDLatencyReport_ParseLine(SDLatencyReport *report, const char *line);
+
+/**
+ * Prints the report, per kind: count, average and maximum busy time, the
+ * budget and the histogram, followed by a warning if the card went over the
+ * budget.
+ */
+void SDLatencyReport_Print(FILE *out, SDLatencyReport *report);
+
+#endif
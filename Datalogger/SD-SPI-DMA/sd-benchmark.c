@@ -0,0 +1,140 @@
+/*
+ * File:   sd-benchmark.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 10:40 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Raw write throughput benchmark.
+ */
+
+#include "../timing.h"
+
+#include "sd-defs.h"
+#include "sd-benchmark.h"
+
+#define DEBUG_UART
+#define DEBUG_UART_DATA
+#define DBG_MODULE "SD/Bench"
+#include "../debug-common.h"
+
+#define SD_BENCH_BEGIN			0	/// Starting a Multiple Block Write
+#define SD_BENCH_SEND			1	/// Sending the next block
+#define SD_BENCH_SENDING		2	/// Waiting for the block to be written
+#define SD_BENCH_TERMINATE		3	/// Ending the Multiple Block Write
+#define SD_BENCH_TERMINATING	4	/// Waiting for the card to finish programming
+#define SD_BENCH_DONE			5	/// Complete
+
+void SD_Benchmark_Begin(SD_Benchmark *bench, SD_Card *card, sd_block_t addr,
+		uint32_t numBlocks, uint32_t runBlocks) {
+	bench->card = card;
+	bench->addr = addr;
+	bench->numBlocks = numBlocks;
+	bench->runBlocks = runBlocks;
+
+	bench->state = SD_BENCH_BEGIN;
+	bench->runLeft = 0;
+	bench->consecutiveErrors = 0;
+
+	bench->blocks = 0;
+	bench->runs = 0;
+	bench->errors = 0;
+	bench->startTime = Get32bitTime();
+	bench->endTime = bench->startTime;
+
+	DBG_DATA_printf("Writing %lu blocks at LBA %lu", numBlocks, addr);
+}
+
+/**
+ * Counts a failed block, which is written again in a new Multiple Block Write.
+ *
+ * @param bench Benchmark struct.
+ */
+static void SD_Benchmark_Error(SD_Benchmark *bench) {
+	bench->errors++;
+	bench->consecutiveErrors++;
+	if (bench->card->State == SD_DMA_MBW_IDLE) {
+		bench->state = SD_BENCH_TERMINATE;
+	} else {
+		bench->state = SD_BENCH_BEGIN;
+	}
+}
+
+sd_result_t SD_Benchmark_Tasks(SD_Benchmark *bench) {
+	SD_Card *card = bench->card;
+	sd_result_t result;
+
+	while (1) {
+		if (bench->state == SD_BENCH_BEGIN) {
+			if (bench->blocks >= bench->numBlocks
+					|| bench->consecutiveErrors >= SD_BENCHMARK_MAX_ERRORS) {
+				bench->endTime = Get32bitTime();
+				bench->state = SD_BENCH_DONE;
+				DBG_DATA_printf("Wrote %lu blocks in %u runs, %u errors",
+						bench->blocks, bench->runs, bench->errors);
+				return (bench->blocks >= bench->numBlocks) ? SD_SUCCESS : SD_PHY_ERR;
+			}
+			result = SD_DMA_MBW_Begin(card, bench->addr + bench->blocks);
+			if (result != SD_SUCCESS) {
+				SD_Benchmark_Error(bench);
+				return SD_BUSY;
+			}
+			bench->runs++;
+			bench->runLeft = bench->numBlocks - bench->blocks;
+			if (bench->runBlocks != 0 && bench->runLeft > bench->runBlocks) {
+				bench->runLeft = bench->runBlocks;
+			}
+			bench->state = SD_BENCH_SEND;
+		}
+		if (bench->state == SD_BENCH_SEND) {
+			if (bench->runLeft == 0) {
+				bench->state = SD_BENCH_TERMINATE;
+			} else {
+				result = SD_DMA_MBW_SendBlock(card,
+						&card->DataBlocks[1 + bench->blocks % (card->NumDataBlocks - 1)]);
+				bench->state = SD_BENCH_SENDING;
+			}
+		}
+		if (bench->state == SD_BENCH_SENDING) {
+			result = SD_DMA_MBW_GetSendBlockResult(card);
+			if (result == SD_BUSY) {
+				return SD_BUSY;
+			} else if (result != SD_SUCCESS) {
+				SD_Benchmark_Error(bench);
+			} else {
+				bench->blocks++;
+				bench->runLeft--;
+				bench->consecutiveErrors = 0;
+				bench->state = SD_BENCH_SEND;
+			}
+		}
+		if (bench->state == SD_BENCH_TERMINATE) {
+			SD_DMA_MBW_Terminate(card);
+			bench->state = SD_BENCH_TERMINATING;
+		}
+		if (bench->state == SD_BENCH_TERMINATING) {
+			result = SD_DMA_MBW_GetTerminateStatus(card);
+			if (result == SD_BUSY) {
+				return SD_BUSY;
+			}
+			bench->state = SD_BENCH_BEGIN;
+		}
+		if (bench->state == SD_BENCH_DONE) {
+			return (bench->blocks >= bench->numBlocks) ? SD_SUCCESS : SD_PHY_ERR;
+		}
+	}
+}
+
+uint32_t SD_Benchmark_GetRate(SD_Benchmark *bench) {
+	uint32_t ticks = bench->endTime - bench->startTime;		// 1/1024 s
+
+	if (ticks == 0) {
+		return 0;
+	}
+	// bytes / (ticks / 1024) / 1024
+	return bench->blocks * bench->card->BlockSize / ticks;
+}
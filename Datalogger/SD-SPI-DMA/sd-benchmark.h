@@ -0,0 +1,87 @@
+/*
+ * File:   sd-benchmark.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 10:40 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Raw write throughput benchmark.
+ * This writes the data blocks as they are, with Multiple Block Writes, to a
+ * range of blocks on the card, without the filesystem, so it shows what the
+ * card and bus can sustain at the current bus speed. Blocks which fail are
+ * written again after restarting the Multiple Block Write, and the bus speed
+ * control may back off meanwhile.
+ * The range written is overwritten, so it should be free space, for example
+ * from FAT32_FreeMapGetLargest.
+ */
+
+#ifndef SD_BENCHMARK_H
+#define SD_BENCHMARK_H
+
+#include "../types.h"
+
+#include "sd-spi-dma.h"
+
+/**
+ * Number of consecutive errors after which the benchmark gives up.
+ */
+#ifndef SD_BENCHMARK_MAX_ERRORS
+	#define SD_BENCHMARK_MAX_ERRORS		8
+#endif
+
+typedef struct {
+	SD_Card *card;
+	sd_block_t addr;			/// Block address of the first block written.
+	uint32_t numBlocks;			/// Number of blocks to write.
+	uint32_t runBlocks;			/// Blocks per Multiple Block Write, 0 for all of them in one.
+
+	uint8_t state;				/// Benchmark state, see sd-benchmark.c.
+	uint32_t runLeft;			/// Blocks left in the current Multiple Block Write.
+	uint8_t consecutiveErrors;	/// Errors since the last block written.
+
+	uint32_t blocks;			/// Number of blocks written.
+	uint16_t runs;				/// Number of Multiple Block Writes.
+	uint16_t errors;			/// Number of blocks which failed, and were written again.
+	uint32_t startTime;			/// Get32bitTime() at the start.
+	uint32_t endTime;			/// Get32bitTime() at the end.
+} SD_Benchmark;
+
+/**
+ * Starts the benchmark. The card must be idle, and stay reserved for the
+ * benchmark until it is complete.
+ * Block n is written from data block 1 + n % (NumDataBlocks - 1), which the
+ * caller may fill in first.
+ *
+ * @param bench Benchmark struct.
+ * @param card SD Card struct.
+ * @param addr Block address of the first block to write.
+ * @param numBlocks Number of blocks to write.
+ * @param runBlocks Blocks per Multiple Block Write, 0 for all of them in one.
+ */
+void SD_Benchmark_Begin(SD_Benchmark *bench, SD_Card *card, sd_block_t addr,
+		uint32_t numBlocks, uint32_t runBlocks);
+
+/**
+ * Runs the benchmark. This should be called periodically until it returns
+ * something other than SD_BUSY.
+ *
+ * @param bench Benchmark struct.
+ * @return Result.
+ * @retval SD_BUSY The benchmark is running.
+ * @retval SD_SUCCESS The benchmark is complete, and the card is idle.
+ * @retval SD_PHY_ERR The benchmark was ended after SD_BENCHMARK_MAX_ERRORS
+ * consecutive errors, and the card is idle.
+ */
+sd_result_t SD_Benchmark_Tasks(SD_Benchmark *bench);
+
+/**
+ * @param bench Benchmark struct, of a completed benchmark.
+ * @return The throughput, in KiB/s.
+ */
+uint32_t SD_Benchmark_GetRate(SD_Benchmark *bench);
+
+#endif
@@ -8,6 +8,7 @@
  * Date			Author	Change
  * 21 Jul 2011	Ducky	Minor changes for refactoring.
  * 24 Jul 2011	Ducky	Added timeout constants.
+ * 17 Oct 2026	agent	Added bus speed constants and SWITCH_FUNC arguments.
  *
  * @file
  * Various definitions used by the SD card.
@@ -30,6 +31,28 @@
 #define SD_CMD_TIMEOUT				64
 #define SD_BLOCK_TIMEOUT			512
 
+/**
+ * Bus speed constants, in kHz.
+ * The bus clock is halved on errors, down to SD_SPEED_MIN_KHZ, and doubled
+ * again after SD_SPEED_RECOVER_OPS blocks without errors.
+ */
+#define SD_SPEED_LOW_KHZ			400		/// Bus clock during card identification
+#define SD_SPEED_DEFAULT_KHZ		25000	/// Fastest bus clock in default speed mode
+#ifndef SD_SPEED_MIN_KHZ
+	#define SD_SPEED_MIN_KHZ		1000
+#endif
+#ifndef SD_SPEED_RECOVER_OPS
+	#define SD_SPEED_RECOVER_OPS	4096
+#endif
+
+/**
+ * Whether to switch cards which support it to high speed mode (50MHz bus
+ * clock) on initialization. This can be overridden in the project options.
+ */
+#ifndef SD_HIGH_SPEED
+	#define SD_HIGH_SPEED			1
+#endif
+
 /**
  * Standard SPI commands (Simplified Physical Layer Spec 7.3.1.3).
  */
@@ -60,6 +83,20 @@
 #define SD_CMD_READ_OCR				58		/// R3, reads OCR register
 #define SD_CMD_CRC_ON_OFF			59		/// R1, turns CRC option on/off
 
+/**
+ * SWITCH_FUNC arguments and status (Simplified Physical Layer Spec 4.3.10).
+ * The argument leaves function groups 2-6 unchanged (0xf), and the status is
+ * a 512-bit data block.
+ */
+#define SD_SWITCH_MODE_CHECK		0x00	/// Argument byte 0, checks a function
+#define SD_SWITCH_MODE_SWITCH		0x80	/// Argument byte 0, switches to a function
+#define SD_SWITCH_HIGH_SPEED		0xf1	/// Argument byte 3, function group 1 function 1 (high speed)
+#define SD_SWITCH_STATUS_LEN		64		/// Length of the switch function status, in bytes
+#define SD_SWITCH_B13_HIGH_SPEED	0x02	/// Function group 1 function 1 supported bit, in status byte 13
+#define SD_SWITCH_B16_GROUP1		0x0f	/// Function group 1 selected function bits, in status byte 16
+#define SD_CCC_SWITCH				0x0400	/// Command class 10 (switch) in CSD CCC
+#define SD_TRAN_SPEED_HIGH_SPEED	0x5a	/// TRAN_SPEED of a card in high speed mode (50MHz)
+
 /**
  * Application-specific Commands (Simplified Physical Layer Spec 7.3.1.3).
  */
@@ -0,0 +1,205 @@
+/*
+ * File:   sd-dma-multipleblockread.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 9:05 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Bus speed control.
+ *
+ * Multiple Block Read operation functionality.
+ * The card streams consecutive blocks after a single READ_MULTIPLE_BLOCK
+ * command, each preceded by a start block token, until STOP_TRANSMISSION.
+ * Between blocks the card waits for the bus to be clocked again, so the
+ * caller can hold off receiving the next block until it has a free buffer.
+ * Alternating between data blocks (double buffering) lets the caller use one
+ * block while the next is being received.
+ */
+
+#include "sd-defs.h"
+#include "sd-spi-dma.h"
+
+#define DEBUG_UART
+//#define DEBUG_UART_DATA
+#define DBG_MODULE "SD/MBR"
+#include "../debug-common.h"
+#include "../debug-log.h"
+
+#define SD_MBR_SUB_TOKEN		0	// Waiting for the start block token
+#define SD_MBR_SUB_RECEIVING	1	// Receiving the block through DMA
+
+/**
+ * Number of bytes polled for the start block token per call, so the wait for
+ * the card's read latency is spread over several main loop iterations rather
+ * than blocking them.
+ */
+#define SD_MBR_TOKEN_POLL		16
+
+sd_result_t SD_DMA_MBR_Begin(SD_Card *card, sd_block_t addr) {
+	uint8_t result;
+	uint8_t args[4];
+
+	if (card->State != SD_IDLE) {
+		DBG_ERR_printf("MBR Begin failed: Card not in idle state");
+		return SD_FAILED;
+	}
+
+	if (!card->SDHC) {
+		addr = addr * card->BlockSize;
+	}
+
+	args[0] = (uint8_t)((addr >> 24) & 0xff);
+	args[1] = (uint8_t)((addr >> 16) & 0xff);
+	args[2] = (uint8_t)((addr >> 8) & 0xff);
+	args[3] = (uint8_t)((addr >> 0) & 0xff);
+
+	SD_Speed_Apply(card);
+	SD_SPI_Open(card);
+	result = SD_SendCommand(card, SD_CMD_READ_MULTIPLE_BLOCK, args, 0x00);
+	if (result != 0x00) {
+		DBG_ERR_printf("MBR failed: Bad response to READ_MULTIPLE_BLOCK - got 0x%02x", result);
+
+		SD_SPI_Terminate(card);
+		SD_SPI_Close(card);
+
+		SD_Speed_OnError(card);
+		return SD_PHY_ERR;
+	}
+
+	card->State = SD_DMA_MBR_IDLE;
+	card->SubState = 0;
+
+	return SD_SUCCESS;
+}
+
+sd_result_t SD_DMA_MBR_ReceiveBlock(SD_Card *card, SD_Data_Block *data) {
+	if (card->State != SD_DMA_MBR_IDLE) {
+		DBG_ERR_printf("MBR Receive Block failed: Card not in MBR Idle state");
+		return SD_FAILED;
+	}
+
+	card->MBRData = data;
+	card->TimeoutCount = 0;
+	card->State = SD_DMA_MBR_RECEIVING;
+	card->SubState = SD_MBR_SUB_TOKEN;
+
+	return SD_DMA_MBR_GetReceiveBlockResult(card);
+}
+
+sd_result_t SD_DMA_MBR_GetReceiveBlockResult(SD_Card *card) {
+	if (card->State != SD_DMA_MBR_RECEIVING) {
+		DBG_ERR_printf("MBR Receive Block failed: Card not in MBR Receiving state");
+		return SD_FAILED;
+	}
+
+	if (card->SubState == SD_MBR_SUB_TOKEN) {
+		uint8_t result = SD_IDLE_BYTE;
+		uint8_t i;
+
+		for (i=0;i<SD_MBR_TOKEN_POLL && result == SD_IDLE_BYTE;i++) {
+			result = SD_SPI_Transfer(card, SD_DUMMY_BYTE);
+		}
+		card->TimeoutCount += i;
+
+		if (result == SD_IDLE_BYTE) {
+			if (card->TimeoutCount >= SD_BLOCK_TIMEOUT) {
+				card->State = SD_DMA_MBR_IDLE;
+				DBG_ERR_printf("MBR failed: Card did not send block");
+				SD_Speed_OnError(card);
+				return SD_PHY_ERR;
+			}
+			return SD_BUSY;
+		} else if (result != SD_TOKEN_START_BLOCK) {
+			card->State = SD_DMA_MBR_IDLE;
+			DBG_ERR_printf("MBR failed: Bad start block token - got 0x%02x", result);
+			SD_Speed_OnError(card);
+			return SD_PHY_ERR;
+		}
+
+		card->MBRData->StartOffset = 2;
+		card->MBRData->BlockLen = 514;
+		SD_DMA_ReceiveBlock(card, card->MBRData);
+
+		SD_DMA_OnBlockRead();
+
+		card->SubState = SD_MBR_SUB_RECEIVING;
+	}
+	if (card->SubState == SD_MBR_SUB_RECEIVING) {
+		if (SD_DMA_GetTransferComplete(card)) {
+			card->State = SD_DMA_MBR_IDLE;
+			SD_Speed_OnSuccess(card);
+
+			return SD_SUCCESS;
+		} else {
+			return SD_BUSY;
+		}
+	}
+
+	// Code should never reach this
+	DBG_ERR_printf("MBR failed: Bad substate 0x%02x", card->SubState);
+	return SD_FAILED;
+}
+
+sd_result_t SD_DMA_MBR_Terminate(SD_Card *card) {
+	uint8_t result = 0xff;
+	uint16_t i = 0;
+
+	if (card->State != SD_DMA_MBR_IDLE) {
+		DBG_ERR_printf("MBR Terminate failed: Card not in MBR Idle state");
+		return SD_FAILED;
+	}
+
+	// The card may be partway through sending the next block, so the byte
+	// following STOP_TRANSMISSION is a stuff byte, which may look like a
+	// response, and is discarded
+	SD_SPI_Transfer(card, 0b01000000 | SD_CMD_STOP_TRANSMISSION);
+	SD_SPI_Transfer(card, 0x00);
+	SD_SPI_Transfer(card, 0x00);
+	SD_SPI_Transfer(card, 0x00);
+	SD_SPI_Transfer(card, 0x00);
+	SD_SPI_Transfer(card, 0x01);
+	SD_SPI_Transfer(card, SD_DUMMY_BYTE);
+
+	while (result & 0x80 && i < SD_CMD_TIMEOUT) {
+		result = SD_SPI_Transfer(card, SD_DUMMY_BYTE);
+		i++;
+	}
+	if (result != 0x00) {
+		DBG_ERR_printf("MBR Terminate failed: Bad response to STOP_TRANSMISSION - got 0x%02x", result);
+
+		SD_SPI_Terminate(card);
+		SD_SPI_Close(card);
+		card->State = SD_IDLE;
+
+		SD_Speed_OnError(card);
+		return SD_PHY_ERR;
+	}
+
+	card->State = SD_DMA_MBR_TERMINATING;
+
+	return SD_BUSY;
+}
+
+sd_result_t SD_DMA_MBR_GetTerminateStatus(SD_Card *card) {
+	uint8_t result = 0x01;
+
+	if (card->State != SD_DMA_MBR_TERMINATING) {
+		DBG_ERR_printf("MBR Terminate failed: Card not in MBR Terminating state");
+		return SD_FAILED;
+	}
+
+	while ((result != SD_IDLE_BYTE) && (result != SD_BUSY_BYTE)) {
+		result = SD_SPI_Transfer(card, SD_DUMMY_BYTE);
+	}
+	if (result == SD_IDLE_BYTE) {
+		SD_SPI_Terminate(card);
+		SD_SPI_Close(card);
+		card->State = SD_IDLE;
+
+		return SD_SUCCESS;
+	} else {
+		return SD_BUSY;
+	}
+}
@@ -7,6 +7,8 @@
  * Revision History
  * Date			Author	Change
  * 26 Jul 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Bus speed control.
+ * 17 Oct 2026	agent	Busy time histograms.
  *
  * TODOs
  * 26 Jul 2011	Ducky	SDHC Support.
@@ -42,6 +44,7 @@ sd_result_t SD_DMA_MBW_Begin(SD_Card *card, sd_block_t addr) {
 	args[2] = (uint8_t)((addr >> 8) & 0xff);
 	args[3] = (uint8_t)((addr >> 0) & 0xff);
 
+	SD_Speed_Apply(card);
 	SD_SPI_Open(card);
 	result = SD_SendCommand(card, SD_CMD_WRITE_MULTIPLE_BLOCK, args, 0x00);
 	if (result != 0x00) {
@@ -50,6 +53,7 @@ sd_result_t SD_DMA_MBW_Begin(SD_Card *card, sd_block_t addr) {
 		SD_SPI_Terminate(card);
 		SD_SPI_Close(card);
 
+		SD_Speed_OnError(card);
 		return SD_PHY_ERR;
 	}
 
@@ -93,6 +97,7 @@ sd_result_t SD_DMA_MBW_GetSendBlockResult(SD_Card *card) {
 		if (SD_DMA_GetTransferComplete(card)) {
 			uint8_t result;
 			uint16_t timeout = 0;
+			SD_Latency_Start(card);
 			result = *card->RXBuffer;
 			while ((result & 0b00010001) != 0b00000001) {
 				if (timeout == 0) {
@@ -102,6 +107,7 @@ sd_result_t SD_DMA_MBW_GetSendBlockResult(SD_Card *card) {
 
 					DBG_ERR_printf("MBW failed: No data response token - got 0x%02x", result);
 
+					SD_Speed_OnError(card);
 					return SD_PHY_ERR;
 				}
 				timeout++;
@@ -115,6 +121,7 @@ sd_result_t SD_DMA_MBW_GetSendBlockResult(SD_Card *card) {
 
 				DBG_ERR_printf("MBW failed: Bad data response token - got 0x%02x", result);
 
+				SD_Speed_OnError(card);
 				return SD_PHY_ERR;
 			}
 
@@ -129,6 +136,8 @@ sd_result_t SD_DMA_MBW_GetSendBlockResult(SD_Card *card) {
 		}
 		if (result == SD_IDLE_BYTE) {
 			card->State = SD_DMA_MBW_IDLE;
+			SD_Latency_Stop(card, SD_LATENCY_BLOCK);
+			SD_Speed_OnSuccess(card);
 
 			return SD_SUCCESS;
 		} else {
@@ -148,6 +157,7 @@ sd_result_t SD_DMA_MBW_Terminate(SD_Card *card) {
 	}
 
 	SD_SPI_Transfer(card, SD_TOKEN_MBW_STOP_TRAN);
+	SD_Latency_Start(card);
 
 	card->State = SD_DMA_MBW_TERMINATING;
 
@@ -166,6 +176,7 @@ sd_result_t SD_DMA_MBW_GetTerminateStatus(SD_Card *card) {
 		result = SD_SPI_Transfer(card, SD_DUMMY_BYTE);
 	}
 	if (result == SD_IDLE_BYTE) {
+		SD_Latency_Stop(card, SD_LATENCY_STOP_TRAN);
 		SD_SPI_Terminate(card);
 		SD_SPI_Close(card);
 		card->State = SD_IDLE;
@@ -7,6 +7,7 @@
  * Revision History
  * Date			Author	Change
  * 25 Jul 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Bus speed control.
  *
  * TODOs
  * 25 Jul 2011	Ducky	Wait for start block token in background.
@@ -42,6 +43,7 @@ sd_result_t SD_DMA_SingleBlockRead(SD_Card *card, sd_block_t addr, SD_Data_Block
 	args[2] = (uint8_t)((addr >> 8) & 0xff);
 	args[3] = (uint8_t)((addr >> 0) & 0xff);
 
+	SD_Speed_Apply(card);
 	SD_SPI_Open(card);
 	result = SD_SendCommand(card, SD_CMD_READ_SINGLE_BLOCK, args, 0x00);
 	if (result != 0x00) {
@@ -50,6 +52,7 @@ sd_result_t SD_DMA_SingleBlockRead(SD_Card *card, sd_block_t addr, SD_Data_Block
 		SD_SPI_Terminate(card);
 		SD_SPI_Close(card);
 
+		SD_Speed_OnError(card);
 		return SD_PHY_ERR;
 	}
 
@@ -65,6 +68,7 @@ sd_result_t SD_DMA_SingleBlockRead(SD_Card *card, sd_block_t addr, SD_Data_Block
 		SD_SPI_Terminate(card);
 		SD_SPI_Close(card);
 
+		SD_Speed_OnError(card);
 		return SD_PHY_ERR;
 	}
 
@@ -91,6 +95,7 @@ sd_result_t SD_DMA_GetSingleBlockReadResult(SD_Card *card) {
 		SD_SPI_Close(card);
 
 		card->State = SD_IDLE;
+		SD_Speed_OnSuccess(card);
 
 		return SD_SUCCESS;
 	} else {
@@ -7,6 +7,7 @@
  * Revision History
  * Date			Author	Change
  * 26 Jul 2011	Ducky	Initial implementation.
+ * 17 Oct 2026	agent	Bus speed control.
  *
  * TODOs
  * 26 Jul 2011	Ducky	SDHC Support.
@@ -44,6 +45,7 @@ sd_result_t SD_DMA_SingleBlockWrite(SD_Card *card, sd_block_t addr, SD_Data_Bloc
 	args[2] = (uint8_t)((addr >> 8) & 0xff);
 	args[3] = (uint8_t)((addr >> 0) & 0xff);
 
+	SD_Speed_Apply(card);
 	SD_SPI_Open(card);
 	result = SD_SendCommand(card, SD_CMD_WRITE_BLOCK, args, 0x00);
 	if (result != 0x00) {
@@ -52,6 +54,7 @@ sd_result_t SD_DMA_SingleBlockWrite(SD_Card *card, sd_block_t addr, SD_Data_Bloc
 		SD_SPI_Terminate(card);
 		SD_SPI_Close(card);
 
+		SD_Speed_OnError(card);
 		return SD_PHY_ERR;
 	}
 
@@ -98,6 +101,7 @@ sd_result_t SD_DMA_GetSingleBlockWriteResult(SD_Card *card) {
 				
 				DBG_ERR_printf("SBW failed: Bad data response token - got 0x%02x", result);
 
+				SD_Speed_OnError(card);
 				return SD_PHY_ERR;
 			}
 
@@ -115,7 +119,8 @@ sd_result_t SD_DMA_GetSingleBlockWriteResult(SD_Card *card) {
 			SD_SPI_Close(card);
 
 			card->State = SD_IDLE;
-			
+			SD_Speed_OnSuccess(card);
+
 			return SD_SUCCESS;
 		} else {
 			return SD_BUSY;
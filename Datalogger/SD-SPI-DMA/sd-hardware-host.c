@@ -0,0 +1,719 @@
+/*
+ * File:   sd-hardware-host.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 2:31 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Multiple block read.
+ * 17 Oct 2026	agent	High speed mode, bus clock from a requested speed, and
+ *						errors injected when the bus is too fast.
+ * 17 Oct 2026	agent	Remember when the last stall ends.
+ *
+ * @file
+ * Hardware abstraction functions for the host build, talking to an emulated
+ * SD Card backed by a disk image file.
+ *
+ * The card is modelled at the SPI byte level: each byte shifted out returns
+ * the byte the card drives back, determined by the card state before the
+ * outgoing byte is processed, as on a real bus.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sd-hardware.h"
+#include "sd-hardware-host.h"
+#include "sd-defs.h"
+
+#ifdef HARDWARE_HOST
+
+#define DEBUG_UART
+#define DBG_MODULE "SD/Host"
+#include "../debug-common.h"
+
+const SD_Host_Profile SD_Host_Profiles[] = {
+	//	Name		Block	SBW		StopTran	Read	MBR		Stall interval / time	Jitter	Init	TRAN_SPEED	HS	Reliable
+	{"ideal",		0,		0,		0,			0,		0,		0,		0,				0,		1,		0x32,		1,	0},
+	{"typical",		150000,	900000,	1500000,	80000,	10000,	512,	20000000,		20,		8,		0x32,		1,	0},
+	{"slow",		600000,	2500000, 5000000,	200000,	40000,	128,	100000000,		30,		64,		0x32,		0,	0},
+	{"stall",		150000,	900000,	1500000,	80000,	10000,	64,		250000000,		10,		8,		0x32,		1,	0},
+	{"marginal",	150000,	900000,	1500000,	80000,	10000,	512,	20000000,		20,		8,		0x32,		1,	5000},
+	{NULL}
+};
+
+SD_Host_Statistics SD_Host_Stats;
+
+#define HOST_BLOCK_SIZE		512
+#define HOST_CRC_SIZE		2
+#define HOST_QUEUE_SIZE		1024
+#define HOST_MAX_READ_DELAY	(HOST_QUEUE_SIZE - HOST_BLOCK_SIZE - 16)	/// Longest read latency, in bytes, which fits in the queue
+#define HOST_ERROR_INTERVAL	16		/// Block commands per injected error when the bus is too fast
+
+typedef enum {
+	HOST_CARD_CMD,				/// Waiting for a command
+	HOST_CARD_WRITE_TOKEN,		/// Waiting for a start block or Stop Tran token
+	HOST_CARD_WRITE_DATA,		/// Receiving a data block
+	HOST_CARD_BUSY,				/// Programming, signalling busy
+	HOST_CARD_READ,				/// Sending blocks of a multiple block read
+} SD_Host_CardMode;
+
+/**
+ * Emulated card state.
+ */
+static struct {
+	FILE *image;					/// Backing image file.
+	uint32_t numBlocks;				/// Capacity, in blocks.
+
+	SD_Host_Profile profile;		/// Latency profile.
+	uint32_t random;				/// Jitter random number generator state.
+
+	uint8_t selected;				/// Whether CS is asserted.
+	uint8_t idle;					/// Whether the card is in the idle (initializing) state.
+	uint8_t appCmd;					/// Whether the previous command was APP_CMD.
+	uint16_t initPolls;				/// Remaining ACMD41 polls before initialization completes.
+	uint8_t highSpeed;				/// Whether the card is in high speed mode.
+	uint16_t blockCmds;				/// Block commands since the last injected error.
+
+	SD_Host_CardMode mode;
+	uint8_t multiBlock;				/// Whether a multiple block write is in progress.
+	uint32_t writeAddr;				/// Block address of the next block to be written.
+	uint16_t writeCount;			/// Bytes of the current data block received.
+	uint8_t writeData[HOST_BLOCK_SIZE + HOST_CRC_SIZE];
+	uint32_t blocksSinceStall;		/// Blocks written since the last stall.
+	uint32_t readAddr;				/// Block address of the next block of a multiple block read.
+
+	uint64_t busyUntil;				/// Bus time at which the busy period ends.
+	uint64_t stallUntil;			/// Bus time at which the busy period of the last stall ends.
+
+	uint8_t cmd[6];					/// Command being received.
+	uint8_t cmdLen;
+
+	uint8_t queue[HOST_QUEUE_SIZE];	/// Response bytes waiting to be shifted out.
+	uint16_t queueHead;
+	uint16_t queueTail;
+
+	uint32_t byteNs;				/// Time to shift one byte at the current bus speed.
+	uint32_t sckkHz;				/// Current bus clock, in kHz.
+	uint64_t busTime;				/// Time at which the bus is next free.
+	uint64_t dmaDone;				/// Time at which the current DMA transfer completes.
+} SD_Host;
+
+uint8_t SD_DMA_Buffer[SD_NUM_DATA_BLOCKS][SD_DATA_BLOCK_LENGTH];
+
+volatile uint8_t SD_DMA_TXBuffer;
+volatile uint8_t SD_DMA_RXBuffer;
+
+/*
+ * Image and profile
+ */
+uint8_t SD_Host_OpenImage(const char *path) {
+	long size;
+
+	SD_Host_CloseImage();
+
+	SD_Host.image = fopen(path, "r+b");
+	if (SD_Host.image == NULL) {
+		DBG_ERR_printf("Unable to open image '%s'", path);
+		return 0;
+	}
+	fseek(SD_Host.image, 0, SEEK_END);
+	size = ftell(SD_Host.image);
+	if (size <= 0 || size % (512 * 1024) != 0) {
+		DBG_ERR_printf("Image size must be a multiple of 512 KiB, got %ld", (int32_t)size);
+		fclose(SD_Host.image);
+		SD_Host.image = NULL;
+		return 0;
+	}
+	SD_Host.numBlocks = size / HOST_BLOCK_SIZE;
+
+	if (SD_Host.profile.Name == NULL) {
+		SD_Host_SetProfile(&SD_Host_Profiles[0]);
+	}
+	SD_Host.idle = 1;
+	SD_Host.highSpeed = 0;
+	SD_Host.blockCmds = 0;
+	SD_Host.stallUntil = 0;
+	SD_Host.mode = HOST_CARD_CMD;
+	SD_Host.random = 0x2545f491;
+	memset(&SD_Host_Stats, 0, sizeof(SD_Host_Stats));
+
+	return 1;
+}
+
+void SD_Host_CloseImage() {
+	if (SD_Host.image != NULL) {
+		fclose(SD_Host.image);
+		SD_Host.image = NULL;
+	}
+}
+
+void SD_Host_SetProfile(const SD_Host_Profile *profile) {
+	SD_Host.profile = *profile;
+}
+
+SD_Host_Profile* SD_Host_GetProfile() {
+	return &SD_Host.profile;
+}
+
+const SD_Host_Profile* SD_Host_FindProfile(const char *name) {
+	const SD_Host_Profile *profile;
+	for (profile=SD_Host_Profiles;profile->Name!=NULL;profile++) {
+		if (!strcmp(profile->Name, name)) {
+			return profile;
+		}
+	}
+	return NULL;
+}
+
+uint32_t SD_Host_GetByteTime() {
+	return SD_Host.byteNs;
+}
+
+uint8_t SD_Host_GetHighSpeed() {
+	return SD_Host.highSpeed;
+}
+
+uint64_t SD_Host_GetStallEnd() {
+	return SD_Host.stallUntil;
+}
+
+/*
+ * Card emulation
+ */
+
+/**
+ * @return @a ns with the profile jitter applied.
+ */
+static uint32_t SD_Host_Jitter(uint32_t ns) {
+	uint32_t range = (uint64_t)ns * SD_Host.profile.JitterPercent / 100;
+	if (range == 0) {
+		return ns;
+	}
+	// xorshift32
+	SD_Host.random ^= SD_Host.random << 13;
+	SD_Host.random ^= SD_Host.random >> 17;
+	SD_Host.random ^= SD_Host.random << 5;
+	return ns - range + SD_Host.random % (2 * range + 1);
+}
+
+/**
+ * Starts a busy period after the byte currently being shifted.
+ */
+static void SD_Host_StartBusy(uint32_t ns) {
+	SD_Host.busyUntil = SD_Host.busTime + ns;
+	SD_Host_Stats.BusyNs += ns;
+	if (ns > SD_Host_Stats.MaxBusyNs) {
+		SD_Host_Stats.MaxBusyNs = ns;
+	}
+	SD_Host.mode = HOST_CARD_BUSY;
+}
+
+static void SD_Host_Queue(uint8_t data) {
+	SD_Host.queue[SD_Host.queueTail] = data;
+	SD_Host.queueTail = (SD_Host.queueTail + 1) % HOST_QUEUE_SIZE;
+}
+
+static void SD_Host_QueueBlock(uint8_t *data, uint16_t len) {
+	uint16_t i;
+	SD_Host_Queue(SD_TOKEN_START_BLOCK);
+	for (i=0;i<len;i++) {
+		SD_Host_Queue(data[i]);
+	}
+	SD_Host_Queue(0x00);	// CRC, not checked
+	SD_Host_Queue(0x00);
+}
+
+/**
+ * Queues a block read from the image, after the read latency.
+ *
+ * @param addr Block address.
+ * @param latencyNs Time before the start block token.
+ */
+static void SD_Host_QueueReadBlock(uint32_t addr, uint32_t latencyNs) {
+	uint8_t block[HOST_BLOCK_SIZE];
+	uint32_t i;
+
+	for (i=0;i<latencyNs / SD_Host.byteNs && i<HOST_MAX_READ_DELAY;i++) {
+		SD_Host_Queue(SD_IDLE_BYTE);
+	}
+	if (addr >= SD_Host.numBlocks) {
+		SD_Host_Stats.Errors++;
+		SD_Host_Queue(0b00001000);		// data error token, out of range
+		return;
+	}
+	fseek(SD_Host.image, (long)addr * HOST_BLOCK_SIZE, SEEK_SET);
+	if (fread(block, HOST_BLOCK_SIZE, 1, SD_Host.image) != 1) {
+		memset(block, 0, HOST_BLOCK_SIZE);
+	}
+	SD_Host_QueueBlock(block, HOST_BLOCK_SIZE);
+	SD_Host_Stats.BlocksRead++;
+}
+
+static uint8_t SD_Host_R1(uint8_t flags) {
+	return flags | (SD_Host.idle ? SD_R1_IDLE_STATE : 0);
+}
+
+static void SD_Host_FillCID(uint8_t *cid) {
+	memset(cid, 0, 16);
+	cid[0] = 0xca;							// MID
+	cid[1] = 'C';	cid[2] = 'S';			// OID
+	memcpy(cid+3, "EMU01", 5);				// PNM
+	cid[8] = 0x10;							// PRV 1.0
+	cid[9] = 0x12;	cid[10] = 0x34;			// PSN
+	cid[11] = 0x56;	cid[12] = 0x78;
+	cid[13] = 0x01;	cid[14] = 0xaa;			// MDT, Oct 2026
+	cid[15] = 0x01;
+}
+
+static void SD_Host_FillCSD(uint8_t *csd) {
+	uint32_t C_SIZE = SD_Host.numBlocks / 1024 - 1;
+	memset(csd, 0, 16);
+	csd[0] = 0x40;							// CSD_STRUCTURE 1.0 (SDHC)
+	csd[1] = 0x0e;							// TAAC
+	csd[3] = SD_Host.highSpeed ? SD_TRAN_SPEED_HIGH_SPEED : SD_Host.profile.TRAN_SPEED;
+	csd[4] = 0x5b;	csd[5] = 0x59;			// CCC, READ_BL_LEN = 9
+	csd[7] = (C_SIZE >> 16) & 0x3f;
+	csd[8] = (C_SIZE >> 8) & 0xff;
+	csd[9] = (C_SIZE >> 0) & 0xff;
+	csd[10] = 0x7f;	csd[11] = 0x80;
+	csd[12] = 0x0a;	csd[13] = 0x40;
+	csd[15] = 0x01;
+}
+
+/**
+ * Fills in the switch function status for SWITCH_FUNC, switching function
+ * group 1 if requested, where only functions 0 (default speed) and 1 (high
+ * speed) are supported, and only function 0 in other groups.
+ *
+ * @param status Switch function status, SD_SWITCH_STATUS_LEN bytes.
+ * @param arg Command argument.
+ */
+static void SD_Host_SwitchFunction(uint8_t *status, uint32_t arg) {
+	uint8_t function = arg & 0x0f;
+	uint8_t selected;
+
+	memset(status, 0, SD_SWITCH_STATUS_LEN);
+	status[0] = 0x00;	status[1] = 0x64;		// 100mA maximum current
+	status[13] = 0x01 | (SD_Host.profile.HighSpeed ? SD_SWITCH_B13_HIGH_SPEED : 0);
+	status[11] = 0x01;	status[9] = 0x01;		// groups 2-6 support function 0 only
+	status[7] = 0x01;	status[5] = 0x01;	status[3] = 0x01;
+
+	if (function == 0x0f) {
+		selected = SD_Host.highSpeed;
+	} else if (function == 0 || (function == 1 && SD_Host.profile.HighSpeed)) {
+		selected = function;
+	} else {
+		selected = 0x0f;
+	}
+	status[16] = selected;
+	status[17] = 0x01;							// data structure version 1
+
+	if ((arg & 0x80000000) && selected != 0x0f) {
+		SD_Host.highSpeed = selected;
+	}
+}
+
+/**
+ * Executes a completely received command, queueing the response.
+ */
+static void SD_Host_ExecuteCommand() {
+	uint8_t command = SD_Host.cmd[0] & 0x3f;
+	uint32_t arg = ((uint32_t)SD_Host.cmd[1] << 24) | ((uint32_t)SD_Host.cmd[2] << 16)
+			| ((uint32_t)SD_Host.cmd[3] << 8) | SD_Host.cmd[4];
+	uint8_t appCmd = SD_Host.appCmd;
+	uint8_t block[HOST_BLOCK_SIZE];
+
+	SD_Host_Stats.Commands++;
+	SD_Host.appCmd = 0;
+	SD_Host.queueHead = SD_Host.queueTail = 0;
+
+	if (SD_Host.mode == HOST_CARD_READ) {
+		if (command != SD_CMD_STOP_TRANSMISSION) {
+			DBG_ERR_printf("Command %u during a multiple block read", command);
+			SD_Host_Stats.Errors++;
+		}
+		// The card finishes the byte it was sending, which the host discards
+		SD_Host_Queue(0x3f);
+		SD_Host_Queue(SD_Host_R1(0));
+		SD_Host.mode = HOST_CARD_CMD;
+		SD_Host_StartBusy(3 * SD_Host.byteNs);
+		return;
+	}
+
+	SD_Host_Queue(SD_IDLE_BYTE);				// NCR
+
+	// A bus faster than the wiring allows garbles the occasional command
+	if (SD_Host.profile.ReliablekHz != 0 && SD_Host.sckkHz > SD_Host.profile.ReliablekHz
+			&& !appCmd && (command == SD_CMD_READ_SINGLE_BLOCK || command == SD_CMD_READ_MULTIPLE_BLOCK
+			|| command == SD_CMD_WRITE_BLOCK || command == SD_CMD_WRITE_MULTIPLE_BLOCK)) {
+		SD_Host.blockCmds++;
+		if (SD_Host.blockCmds >= HOST_ERROR_INTERVAL) {
+			SD_Host.blockCmds = 0;
+			SD_Host_Stats.InjectedErrors++;
+			SD_Host_Queue(SD_Host_R1(SD_R1_COM_CRC_ERROR));
+			return;
+		}
+	}
+
+	if (appCmd && command == SD_ACMD_SD_SEND_OP_COND) {
+		if (SD_Host.initPolls > 0) {
+			SD_Host.initPolls--;
+		} else {
+			SD_Host.idle = 0;
+		}
+		SD_Host_Queue(SD_Host_R1(0));
+		return;
+	}
+
+	switch (command) {
+		case SD_CMD_GO_IDLE_STATE:
+			SD_Host.idle = 1;
+			SD_Host.highSpeed = 0;
+			SD_Host.initPolls = SD_Host.profile.InitPolls;
+			SD_Host.mode = HOST_CARD_CMD;
+			SD_Host_Queue(SD_Host_R1(0));
+			break;
+		case SD_CMD_SEND_IF_COND:
+			SD_Host_Queue(SD_Host_R1(0));
+			SD_Host_Queue(0x00);
+			SD_Host_Queue(0x00);
+			SD_Host_Queue(SD_Host.cmd[3] & 0x0f);
+			SD_Host_Queue(SD_Host.cmd[4]);
+			break;
+		case SD_CMD_READ_OCR:
+			SD_Host_Queue(SD_Host_R1(0));
+			SD_Host_Queue(SD_Host.idle ? 0x00 : 0xc0);	// power up status, CCS
+			SD_Host_Queue(0xff);
+			SD_Host_Queue(0x80);
+			SD_Host_Queue(0x00);
+			break;
+		case SD_CMD_APP_CMD:
+			SD_Host.appCmd = 1;
+			SD_Host_Queue(SD_Host_R1(0));
+			break;
+		case SD_CMD_SEND_CSD:
+		case SD_CMD_SEND_CID:
+			if (SD_Host.idle) {
+				SD_Host_Queue(SD_Host_R1(SD_R1_ILLEGAL_COMMAND));
+				break;
+			}
+			SD_Host_Queue(SD_Host_R1(0));
+			SD_Host_Queue(SD_IDLE_BYTE);
+			if (command == SD_CMD_SEND_CSD) {
+				SD_Host_FillCSD(block);
+			} else {
+				SD_Host_FillCID(block);
+			}
+			SD_Host_QueueBlock(block, 16);
+			break;
+		case SD_CMD_SWITCH_FUNC:
+			if (SD_Host.idle) {
+				SD_Host_Queue(SD_Host_R1(SD_R1_ILLEGAL_COMMAND));
+				break;
+			}
+			SD_Host_Queue(SD_Host_R1(0));
+			SD_Host_Queue(SD_IDLE_BYTE);
+			SD_Host_SwitchFunction(block, arg);
+			SD_Host_QueueBlock(block, SD_SWITCH_STATUS_LEN);
+			break;
+		case SD_CMD_READ_SINGLE_BLOCK:
+			if (SD_Host.idle) {
+				SD_Host_Queue(SD_Host_R1(SD_R1_ILLEGAL_COMMAND));
+				break;
+			} else if (arg >= SD_Host.numBlocks) {
+				SD_Host_Stats.Errors++;
+				SD_Host_Queue(SD_Host_R1(SD_R1_ADDRESS_ERROR));
+				break;
+			}
+			SD_Host_Queue(SD_Host_R1(0));
+			SD_Host_QueueReadBlock(arg, SD_Host.profile.ReadLatencyNs);
+			break;
+		case SD_CMD_READ_MULTIPLE_BLOCK:
+			if (SD_Host.idle) {
+				SD_Host_Queue(SD_Host_R1(SD_R1_ILLEGAL_COMMAND));
+				break;
+			} else if (arg >= SD_Host.numBlocks) {
+				SD_Host_Stats.Errors++;
+				SD_Host_Queue(SD_Host_R1(SD_R1_ADDRESS_ERROR));
+				break;
+			}
+			SD_Host_Queue(SD_Host_R1(0));
+			SD_Host_QueueReadBlock(arg, SD_Host.profile.ReadLatencyNs);
+			SD_Host_Stats.MBRBegins++;
+			SD_Host_Stats.MBRBlocks++;
+			SD_Host.readAddr = arg + 1;
+			SD_Host.mode = HOST_CARD_READ;
+			break;
+		case SD_CMD_STOP_TRANSMISSION:
+			SD_Host_Queue(SD_Host_R1(SD_R1_ILLEGAL_COMMAND));
+			break;
+		case SD_CMD_WRITE_BLOCK:
+		case SD_CMD_WRITE_MULTIPLE_BLOCK:
+			if (SD_Host.idle) {
+				SD_Host_Queue(SD_Host_R1(SD_R1_ILLEGAL_COMMAND));
+				break;
+			} else if (arg >= SD_Host.numBlocks) {
+				SD_Host_Stats.Errors++;
+				SD_Host_Queue(SD_Host_R1(SD_R1_ADDRESS_ERROR));
+				break;
+			}
+			SD_Host_Queue(SD_Host_R1(0));
+			SD_Host.multiBlock = (command == SD_CMD_WRITE_MULTIPLE_BLOCK);
+			if (SD_Host.multiBlock) {
+				SD_Host_Stats.MBWBegins++;
+			} else {
+				SD_Host_Stats.SBWs++;
+			}
+			SD_Host.writeAddr = arg;
+			SD_Host.mode = HOST_CARD_WRITE_TOKEN;
+			break;
+		default:
+			SD_Host_Queue(SD_Host_R1(SD_R1_ILLEGAL_COMMAND));
+			break;
+	}
+}
+
+/**
+ * Called when a complete data block (including CRC) has been received.
+ * Programs the block and queues the data response token.
+ */
+static void SD_Host_FinishWriteBlock() {
+	uint32_t busyNs;
+	uint8_t stalled = 0;
+
+	if (SD_Host.writeAddr >= SD_Host.numBlocks) {
+		SD_Host_Stats.Errors++;
+		SD_Host_Queue(0b00001101);		// data rejected, write error
+		SD_Host_StartBusy(0);
+		return;
+	}
+
+	fseek(SD_Host.image, (long)SD_Host.writeAddr * HOST_BLOCK_SIZE, SEEK_SET);
+	fwrite(SD_Host.writeData, HOST_BLOCK_SIZE, 1, SD_Host.image);
+	SD_Host.writeAddr++;
+	SD_Host_Stats.BlocksWritten++;
+
+	if (SD_Host.multiBlock) {
+		SD_Host_Stats.MBWBlocks++;
+		busyNs = SD_Host_Jitter(SD_Host.profile.BlockBusyNs);
+	} else {
+		busyNs = SD_Host_Jitter(SD_Host.profile.SBWBusyNs);
+	}
+	SD_Host.blocksSinceStall++;
+	if (SD_Host.profile.StallInterval != 0
+			&& SD_Host.blocksSinceStall >= SD_Host.profile.StallInterval) {
+		SD_Host.blocksSinceStall = 0;
+		SD_Host_Stats.Stalls++;
+		busyNs += SD_Host_Jitter(SD_Host.profile.StallNs);
+		stalled = 1;
+	}
+
+	SD_Host_Queue(0b00000101);		// data accepted
+	// Busy starts after the data response token
+	SD_Host_StartBusy(SD_Host.byteNs + busyNs);
+	if (stalled) {
+		SD_Host.stallUntil = SD_Host.busyUntil;
+	}
+}
+
+/**
+ * Shifts one byte over the SPI bus.
+ *
+ * @param data Byte sent to the card.
+ * @return Byte received from the card.
+ */
+static uint8_t SD_Host_Exchange(uint8_t data) {
+	uint8_t response = SD_IDLE_BYTE;
+
+	if (SD_Host.busTime < Host_Clock) {
+		SD_Host.busTime = Host_Clock;
+	}
+	SD_Host.busTime += SD_Host.byteNs;
+	SD_Host_Stats.BusBytes++;
+
+	if (!SD_Host.selected || SD_Host.image == NULL) {
+		return SD_IDLE_BYTE;
+	}
+
+	// Card output, based on the state before this byte
+	if (SD_Host.queueHead == SD_Host.queueTail && SD_Host.mode == HOST_CARD_READ) {
+		// The next block of a multiple block read, once the host clocks for it
+		SD_Host_QueueReadBlock(SD_Host.readAddr++, SD_Host.profile.MBRLatencyNs);
+		SD_Host_Stats.MBRBlocks++;
+	}
+	if (SD_Host.queueHead != SD_Host.queueTail) {
+		response = SD_Host.queue[SD_Host.queueHead];
+		SD_Host.queueHead = (SD_Host.queueHead + 1) % HOST_QUEUE_SIZE;
+	} else if (SD_Host.mode == HOST_CARD_BUSY) {
+		if (SD_Host.busTime <= SD_Host.busyUntil) {
+			response = SD_BUSY_BYTE;
+		} else {
+			SD_Host.mode = SD_Host.multiBlock ? HOST_CARD_WRITE_TOKEN : HOST_CARD_CMD;
+		}
+	}
+
+	// Card input
+	switch (SD_Host.mode) {
+		case HOST_CARD_CMD:
+		case HOST_CARD_READ:
+			if (SD_Host.cmdLen == 0 && (data & 0xc0) != 0x40) {
+				break;
+			}
+			SD_Host.cmd[SD_Host.cmdLen++] = data;
+			if (SD_Host.cmdLen == 6) {
+				SD_Host.cmdLen = 0;
+				SD_Host_ExecuteCommand();
+			}
+			break;
+		case HOST_CARD_WRITE_TOKEN:
+			if (SD_Host.queueHead != SD_Host.queueTail) {
+				break;		// still sending the command response
+			}
+			if (data == (SD_Host.multiBlock ? SD_TOKEN_MBW_START_BLOCK : SD_TOKEN_START_BLOCK)) {
+				SD_Host.mode = HOST_CARD_WRITE_DATA;
+				SD_Host.writeCount = 0;
+			} else if (data == SD_TOKEN_MBW_STOP_TRAN && SD_Host.multiBlock) {
+				SD_Host.multiBlock = 0;
+				SD_Host_StartBusy(SD_Host.byteNs + SD_Host_Jitter(SD_Host.profile.StopTranBusyNs));
+			} else if (data != SD_DUMMY_BYTE) {
+				DBG_ERR_printf("Unexpected token 0x%02x while waiting for a data block", data);
+				SD_Host_Stats.Errors++;
+			}
+			break;
+		case HOST_CARD_WRITE_DATA:
+			SD_Host.writeData[SD_Host.writeCount++] = data;
+			if (SD_Host.writeCount == HOST_BLOCK_SIZE + HOST_CRC_SIZE) {
+				SD_Host_FinishWriteBlock();
+			}
+			break;
+		case HOST_CARD_BUSY:
+			break;
+	}
+
+	return response;
+}
+
+/*
+ * Hardware abstraction functions
+ */
+SD_Card SD_CreateCard() {
+	SD_Card newCard;
+	uint8_t i;
+
+	newCard.State = SD_UNINITIALIZED;
+	newCard.SubState = 0;
+
+	newCard.NumDataBlocks = SD_NUM_DATA_BLOCKS;
+
+	for (i=0;i<SD_NUM_DATA_BLOCKS;i++) {
+		newCard.DataBlocks[i].Data = SD_DMA_Buffer[i];
+		newCard.DataBlocks[i].DMAOffset = i * SD_DATA_BLOCK_LENGTH;
+	}
+
+	newCard.TXBuffer = &SD_DMA_TXBuffer;
+	newCard.RXBuffer = &SD_DMA_RXBuffer;
+	newCard.TXBufferOffset = 0;
+	newCard.RXBufferOffset = 0;
+
+	return newCard;
+}
+
+/**
+ * Sets the bus speed from the SPI prescalers, SCK = Fcy / (primary * secondary).
+ */
+static void SD_Host_SetPrescale(uint8_t primary, uint8_t secondary) {
+	SD_Host.byteNs = (uint64_t)8 * primary * secondary * 1000000000 / Fcy;
+	SD_Host.sckkHz = (Fcy / 1000) / (primary * secondary);
+}
+
+void SD_DMA_Initialize(SD_Card *card) {
+	// Same prescale as sd-hardware.c: 64:1 primary, 1:1 secondary
+	SD_Host_SetPrescale(64, 1);
+}
+
+uint32_t SD_DMA_InitializeFast(SD_Card *card, uint32_t speedkHz) {
+	uint8_t primary, secondary;
+	uint32_t actualkHz;
+
+	if (speedkHz == 0) {
+		speedkHz = SD_SPEED_LOW_KHZ;
+	}
+	actualkHz = SD_SPI_GetPrescale(speedkHz, &primary, &secondary);
+	SD_Host_SetPrescale(primary, secondary);
+
+	return actualkHz;
+}
+
+inline void SD_SPI_Open(SD_Card *card) {
+	SD_Host.selected = 1;
+}
+
+inline void SD_SPI_Terminate(SD_Card *card) {
+	SD_SPI_Transfer(card, SD_IDLE_BYTE);
+}
+
+inline void SD_SPI_Close(SD_Card *card) {
+	SD_Host.selected = 0;
+	SD_Host.cmdLen = 0;
+	SD_Host.queueHead = SD_Host.queueTail = 0;
+	if (SD_Host.mode == HOST_CARD_WRITE_DATA) {
+		DBG_ERR_printf("CS deasserted during a data block");
+		SD_Host_Stats.Errors++;
+		SD_Host.mode = HOST_CARD_CMD;
+	} else if (SD_Host.mode == HOST_CARD_READ) {
+		DBG_ERR_printf("CS deasserted during a multiple block read");
+		SD_Host_Stats.Errors++;
+		SD_Host.mode = HOST_CARD_CMD;
+	}
+}
+
+inline uint8_t SD_SPI_Transfer(SD_Card *card, uint8_t data) {
+	data = SD_Host_Exchange(data);
+	// Blocking, so the CPU waits for the byte to finish shifting
+	Host_Clock = SD_Host.busTime;
+	return data;
+}
+
+uint8_t SD_SendCommand(SD_Card *card, uint8_t command, uint8_t* args, uint8_t crc) {
+	uint8_t response = 0xff;
+	uint16_t i = 0;
+
+	SD_SPI_Transfer(card, 0b01000000 | command);
+	SD_SPI_Transfer(card, args[0]);
+	SD_SPI_Transfer(card, args[1]);
+	SD_SPI_Transfer(card, args[2]);
+	SD_SPI_Transfer(card, args[3]);
+	SD_SPI_Transfer(card, crc | 0b00000001);
+
+	// Wait for a proper received response
+	while (response & 0x80 && i < SD_CMD_TIMEOUT) {
+		response = SD_SPI_Transfer(card, SD_DUMMY_BYTE);
+		i++;
+	}
+	return response;
+}
+
+inline void SD_DMA_SendBlock(SD_Card *card, SD_Data_Block *data) {
+	uint16_t i;
+	for (i=0;i<data->BlockLen;i++) {
+		*card->RXBuffer = SD_Host_Exchange(data->Data[data->StartOffset + i]);
+	}
+	SD_Host.dmaDone = SD_Host.busTime;
+}
+
+inline void SD_DMA_ReceiveBlock(SD_Card *card, SD_Data_Block *data) {
+	uint16_t i;
+	for (i=0;i<data->BlockLen;i++) {
+		data->Data[data->StartOffset + i] = SD_Host_Exchange(SD_DUMMY_BYTE);
+	}
+	SD_Host.dmaDone = SD_Host.busTime;
+}
+
+inline uint8_t SD_DMA_GetTransferComplete(SD_Card *card) {
+	return Host_Clock >= SD_Host.dmaDone;
+}
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * File:   sd-hardware-host.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 2:20 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	High speed mode and bus clock dependent errors.
+ * 17 Oct 2026	agent	End of the last stall, to tell card stalls from others.
+ *
+ * @file
+ * Host-only interface to the emulated SD Card, which replaces sd-hardware.c
+ * on host builds. The emulator answers the SPI protocol byte by byte (command
+ * responses, start block and data response tokens, busy signalling) and stores
+ * data in a disk image file.
+ *
+ * Timing runs on the host virtual clock. Every byte on the bus takes one SPI
+ * byte time at the currently configured bus speed; blocking transfers advance
+ * the virtual clock, while DMA transfers complete in the background.
+ * The emulated card is always SDHC (block addressed) with a v2 CSD.
+ */
+
+#ifndef SD_HARDWARE_HOST_H
+#define SD_HARDWARE_HOST_H
+
+#include "../types.h"
+
+/**
+ * Card latency profile. All times are in nanoseconds.
+ */
+typedef struct {
+	const char *Name;			/// Profile name.
+
+	uint32_t BlockBusyNs;		/// Busy time after each block of a multiple block write.
+	uint32_t SBWBusyNs;			/// Busy time after a single block write.
+	uint32_t StopTranBusyNs;	/// Busy time after the Stop Tran token.
+	uint32_t ReadLatencyNs;		/// Time from a read command response to the start block token.
+	uint32_t MBRLatencyNs;		/// Time between blocks of a multiple block read, to the next start block token.
+
+	uint16_t StallInterval;		/// A stall happens every this many blocks written, 0 for never.
+	uint32_t StallNs;			/// Busy time of a stall, for example from card garbage collection.
+
+	uint8_t JitterPercent;		/// Random variation applied to busy times, in percent.
+
+	uint16_t InitPolls;			/// Number of ACMD41 polls before the card leaves the idle state.
+	uint8_t TRAN_SPEED;			/// TRAN_SPEED byte reported in the CSD.
+	uint8_t HighSpeed;			/// Whether the card supports high speed mode (SWITCH_FUNC).
+	uint32_t ReliablekHz;		/// Fastest bus clock without errors, in kHz, 0 for any. Above this,
+								/// every HOST_ERROR_INTERVAL block commands gets a CRC error response.
+} SD_Host_Profile;
+
+/**
+ * Built-in profiles, terminated by an entry with a NULL name.
+ */
+extern const SD_Host_Profile SD_Host_Profiles[];
+
+/**
+ * Emulator statistics, these may be reset by the user at any time.
+ */
+typedef struct {
+	uint32_t Commands;			/// Commands received.
+	uint32_t BlocksRead;		/// Data blocks sent to the host.
+	uint32_t BlocksWritten;		/// Data blocks written to the image.
+	uint32_t MBWBlocks;			/// Data blocks written as part of a multiple block write.
+	uint32_t MBWBegins;			/// Number of WRITE_MULTIPLE_BLOCK commands.
+	uint32_t SBWs;				/// Number of WRITE_BLOCK commands.
+	uint32_t MBRBlocks;			/// Data blocks sent as part of a multiple block read.
+	uint32_t MBRBegins;			/// Number of READ_MULTIPLE_BLOCK commands.
+	uint32_t Stalls;			/// Number of stalls inserted.
+
+	uint64_t BusBytes;			/// Bytes clocked over the SPI bus.
+	uint64_t BusyNs;			/// Total time the card signalled busy.
+	uint32_t MaxBusyNs;			/// Longest single busy period.
+
+	uint32_t Errors;			/// Protocol errors, like bad tokens or out of range addresses.
+	uint32_t InjectedErrors;	/// CRC error responses injected because the bus was too fast.
+} SD_Host_Statistics;
+
+extern SD_Host_Statistics SD_Host_Stats;
+
+/**
+ * Opens the disk image backing the emulated card. The image size must be a
+ * multiple of 512 KiB (the SDHC capacity granularity).
+ *
+ * @param path Path to the image file, which must already exist.
+ * @return Result.
+ * @retval 1 Success.
+ * @retval 0 Failure, the image could not be opened or has a bad size.
+ */
+uint8_t SD_Host_OpenImage(const char *path);
+
+/**
+ * Flushes and closes the disk image.
+ */
+void SD_Host_CloseImage();
+
+/**
+ * Sets the latency profile of the emulated card. The profile is copied.
+ *
+ * @param profile Profile to use.
+ */
+void SD_Host_SetProfile(const SD_Host_Profile *profile);
+
+/**
+ * @return The current latency profile. This may be modified.
+ */
+SD_Host_Profile* SD_Host_GetProfile();
+
+/**
+ * Looks up a built-in profile by name.
+ *
+ * @param name Profile name.
+ * @return The profile, or NULL if there is no profile by that name.
+ */
+const SD_Host_Profile* SD_Host_FindProfile(const char *name);
+
+/**
+ * @return The current SPI bus byte time, in nanoseconds.
+ */
+uint32_t SD_Host_GetByteTime();
+
+/**
+ * @return Whether the card has been switched to high speed mode.
+ */
+uint8_t SD_Host_GetHighSpeed();
+
+/**
+ * @return Time, on the host virtual clock, at which the busy period of the
+ * last stall inserted (see SD_Host_Profile.StallInterval) ends, or 0 if there
+ * has been none.
+ */
+uint64_t SD_Host_GetStallEnd();
+
+#endif
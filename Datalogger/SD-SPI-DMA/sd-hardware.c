@@ -11,6 +11,7 @@
  * 24 Jul 2011	Ducky	Added GetTransferComplete(...) function, changed
  *						send DMA transfers to do receive counting.
  *						Major bug fixes after initial testing.
+ * 17 Oct 2026	agent	Bus clock from a requested speed in kHz.
  *
  * @file
  * Hardware abstraction function prototypes and defines.
@@ -50,9 +51,7 @@
 #define SD_SPISTATbits	SPI2STATbits
 #define SD_SPIBUF		SPI2BUF
 
-uint8_t SD_DMA_Buffer0[SD_DATA_BLOCK_LENGTH] __attribute__((space(dma)));
-uint8_t SD_DMA_Buffer1[SD_DATA_BLOCK_LENGTH] __attribute__((space(dma)));
-uint8_t SD_DMA_Buffer2[SD_DATA_BLOCK_LENGTH] __attribute__((space(dma)));
+uint8_t SD_DMA_Buffer[SD_NUM_DATA_BLOCKS][SD_DATA_BLOCK_LENGTH] __attribute__((space(dma)));
 
 volatile uint8_t SD_DMA_TXBuffer __attribute__((space(dma)));
 volatile uint8_t SD_DMA_RXBuffer __attribute__((space(dma)));
@@ -60,18 +59,18 @@ volatile uint8_t SD_DMA_RXBuffer __attribute__((space(dma)));
 SD_Card SD_CreateCard()
  {
 	SD_Card newCard;
+	uint8_t i;
 
 	newCard.State = SD_UNINITIALIZED;
 	newCard.SubState = 0;
 
 	newCard.NumDataBlocks = SD_NUM_DATA_BLOCKS;
 	
-	newCard.DataBlocks[0].Data = SD_DMA_Buffer0;
-	newCard.DataBlocks[0].DMAOffset = __builtin_dmaoffset(SD_DMA_Buffer0);
-	newCard.DataBlocks[1].Data = SD_DMA_Buffer1;
-	newCard.DataBlocks[1].DMAOffset = __builtin_dmaoffset(SD_DMA_Buffer1);
-	newCard.DataBlocks[2].Data = SD_DMA_Buffer2;
-	newCard.DataBlocks[2].DMAOffset = __builtin_dmaoffset(SD_DMA_Buffer2);
+	for (i=0;i<SD_NUM_DATA_BLOCKS;i++) {
+		newCard.DataBlocks[i].Data = SD_DMA_Buffer[i];
+		newCard.DataBlocks[i].DMAOffset = __builtin_dmaoffset(SD_DMA_Buffer)
+				+ i * SD_DATA_BLOCK_LENGTH;
+	}
 
 	newCard.TXBuffer = &SD_DMA_TXBuffer;
 	newCard.RXBuffer = &SD_DMA_RXBuffer;
@@ -108,18 +107,28 @@ void SD_DMA_Initialize(SD_Card *card) {
 	RX_DMAPAD = (volatile unsigned int) &SD_SPIBUF;
 }
 
-void SD_DMA_InitializeFast(SD_Card *card, uint8_t speedMHz) {
+uint32_t SD_DMA_InitializeFast(SD_Card *card, uint32_t speedkHz) {
+	uint8_t primary, secondary;
+	uint32_t actualkHz;
+
+	if (speedkHz == 0) {
+		speedkHz = SD_SPEED_LOW_KHZ;
+	}
+	actualkHz = SD_SPI_GetPrescale(speedkHz, &primary, &secondary);
+
 	SD_SPISTATbits.SPIEN = 0;
 	SD_SPICON1bits.MSTEN = 1;
 	SD_SPISTATbits.SPIROV = 0;
-	if (speedMHz > 10) {				// 2:1 (minimum) prescale
-		SD_SPICON1bits.SPRE = 0b110;
-		SD_SPICON1bits.PPRE = 0b11;
-	} else {							// anything else - low speed mode
-		SD_SPICON1bits.SPRE = 0b111;
-		SD_SPICON1bits.PPRE = 0b00;
+	SD_SPICON1bits.SPRE = 8 - secondary;	// 0b111 is 1:1, down to 0b000 for 8:1
+	switch (primary) {
+		case 1:		SD_SPICON1bits.PPRE = 0b11;		break;
+		case 4:		SD_SPICON1bits.PPRE = 0b10;		break;
+		case 16:	SD_SPICON1bits.PPRE = 0b01;		break;
+		default:	SD_SPICON1bits.PPRE = 0b00;		break;
 	}
 	SD_SPISTATbits.SPIEN = 1;
+
+	return actualkHz;
 }
 
 inline void SD_SPI_Open(SD_Card *card) {
@@ -10,6 +10,9 @@
  * 21 Jul 2011	Ducky	Added some more functions, removed the "write-back"
  *						returns in favor of doing command-specific get result
  *						functions.
+ * 17 Oct 2026	agent	Multiple Block Read states.
+ * 17 Oct 2026	agent	Bus speed from TRAN_SPEED, with back-off on errors.
+ * 17 Oct 2026	agent	Busy time histograms.
  *
  * @file
  * Hardware abstraction interface function prototypes and defines.
@@ -27,6 +30,8 @@
 #include "../types.h"
 #include "../hardware.h"
 
+#include "sd-latency.h"
+
 /**
  * States a SD Card can be in.
  */
@@ -44,6 +49,10 @@ typedef enum {
 	SD_DMA_MBW_IDLE,	/// Multiple Block Write - idle
 	SD_DMA_MBW_SENDING,	/// Multiple Block Write - sending a block
 SD_DMA_MBW_TERMINATING,	/// Multiple Block Write - operation terminating
+
+	SD_DMA_MBR_IDLE,	/// Multiple Block Read - idle, between blocks
+	SD_DMA_MBR_RECEIVING,	/// Multiple Block Read - receiving a block
+	SD_DMA_MBR_TERMINATING,	/// Multiple Block Read - operation terminating
 } SD_State;
 
 /**
@@ -67,7 +76,20 @@ typedef struct {
 	uint8_t* Data;		/// Pointer to the actual data block.
 } SD_Data_Block;
 
-#define SD_NUM_DATA_BLOCKS		3
+/**
+ * Number of data blocks. Block 0 is reserved for filesystem (FAT, directory
+ * table and FS information) transfers and the rest form the write pipeline, so
+ * the pipeline depth is SD_NUM_DATA_BLOCKS - 1.
+ * This can be overridden in the project options.
+ *
+ * All blocks live in DMA RAM, which is only 2 KB on the dsPIC33FJ128MC802 and
+ * is shared with the ECAN, UART and ADC buffers. The default of 3 blocks
+ * (1554 bytes) leaves room for everything else; a deeper pipeline needs a part
+ * with more DMA-accessible RAM.
+ */
+#ifndef SD_NUM_DATA_BLOCKS
+	#define SD_NUM_DATA_BLOCKS		3
+#endif
 #define SD_DATA_BLOCK_LENGTH	518
 
 /**
@@ -80,6 +102,7 @@ typedef struct {
 	SD_State State;				/// Card state
 	uint8_t SubState;			/// Sub-state within the card-state
 	uint16_t TimeoutCount;		/// State-specific timeout count variable
+	SD_Data_Block *MBRData;		/// Data block receiving the current Multiple Block Read block
 
 	// Buffering variables
 	uint8_t NumDataBlocks;		/// Number of data blocks
@@ -98,9 +121,24 @@ typedef struct {
 
 	uint16_t BlockSize;			// Size of a block
 	uint32_t BlockCapacity;		/// Size, in number of blocks, of the card.
+	uint8_t HighSpeed;			/// Whether the card was switched to high speed mode.
+
+	// Bus speed
+	uint32_t MaxSpeedkHz;		/// Fastest bus clock the card supports, from TRAN_SPEED, in kHz.
+	uint32_t SpeedLimitkHz;		/// Fastest bus clock currently allowed, lowered after errors, in kHz.
+	uint32_t SpeedkHz;			/// Current bus clock, in kHz.
+	uint8_t SpeedChange;		/// Whether SpeedLimitkHz changed, to be applied before the next operation.
+	uint16_t SpeedCleanOps;		/// Operations completed since the last error or speed change.
+	uint16_t SpeedBackoffs;		/// Number of times the bus clock was lowered after errors.
+
+	// Busy time
+	uint32_t LatencyStart;		/// GetCycleCount() at the start of the operation being timed.
+	uint32_t LatencyBudget;		/// Longest busy time the application can absorb, in cycles, or 0 for no limit.
+	SD_Latency Latency[SD_LATENCY_NUM_KINDS];	/// Busy time histograms, by SD_LATENCY_*.
 
 	// Card-Specific data (CSD)
 	uint8_t TRAN_SPEED;	/// Transmission speed
+	uint16_t CCC;		/// Card command classes
 
 	// Card ID (CID) data
 	uint8_t MID;			/// Manufacturer ID
@@ -125,14 +163,30 @@ SD_Card SD_CreateCard();
 void SD_DMA_Initialize(SD_Card *card);
 
 /**
- * Initializes the SPI bus to the desired speed.
+ * Initializes the SPI bus to the fastest clock not above the desired speed.
+ * This must only be called with the SPI line closed.
  * @pre SD_DMA_Initialize has already been called previously.
  *
  * @param card SD Card structure.
- * @param speedkHz Requested operation speed in MHz, rounded down. A value of 0
- * indicates operation in low speed (400kbit/s mode).
+ * @param speedkHz Requested bus clock in kHz. A value of 0 indicates operation
+ * in low speed (400kbit/s mode).
+ * @return The resulting bus clock in kHz.
+ */
+uint32_t SD_DMA_InitializeFast(SD_Card *card, uint32_t speedkHz);
+
+/**
+ * Chooses the SPI prescalers for the fastest clock not above the desired
+ * speed, with SCK = Fcy / (primary * secondary). The primary prescale is one
+ * of 1, 4, 16 or 64, and the secondary one of 1 to 8, not both 1.
+ * This is hardware independent, and is implemented in sd-speed.c.
+ *
+ * @param speedkHz Requested bus clock in kHz.
+ * @param[out] primary Primary prescale.
+ * @param[out] secondary Secondary prescale.
+ * @return The resulting bus clock in kHz. If even the slowest clock is faster
+ * than requested, that is used.
  */
-void SD_DMA_InitializeFast(SD_Card *card, uint8_t speedMHz);
+uint32_t SD_SPI_GetPrescale(uint32_t speedkHz, uint8_t *primary, uint8_t *secondary);
 
 /**
  * Opens the SPI line (asserts CS low).
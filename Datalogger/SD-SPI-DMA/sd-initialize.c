@@ -8,6 +8,8 @@
  * Date			Author	Change
  * 24 Jul 2011	Ducky	Initial implementation.
  * 25 Jul 2011	Ducky	Added CSD/CID parsing and dynamic bus speed config.
+ * 17 Oct 2026	agent	High speed mode, bus speed control.
+ * 17 Oct 2026	agent	Busy time histograms.
  *
  * TODOs
  * 25 Jul 2011	Ducky	Wait for start block token in background.
@@ -32,17 +34,13 @@ const uint8_t SD_Init_NumBytes = 32;	/// Number of idle bytes to send the
 #define SD_INIT_SUB_INIT	1			/// Waiting for card init (ACMD41)
 #define SD_INIT_SUB_CID		2			/// Reading card CID
 #define SD_INIT_SUB_CSD		3			/// Reading card CSD
+#define SD_INIT_SUB_SWITCH_CHECK	4	/// Reading switch function status, checking for high speed mode
+#define SD_INIT_SUB_SWITCH	5			/// Reading switch function status, switching to high speed mode
 
 uint8_t SD_Null_Argument[4] = {0x00, 0x00, 0x00, 0x00};
 uint8_t SD_IfCond_Argument[4] = {0x00, 0x00, 0x01, 0xaa};
 uint8_t SD_ACMD41_HCS_Argument[4] = {0x40, 0x00, 0x00, 0x00};
 
-uint16_t SD_TRAN_SPEED_LUT[] = {
-	0,	10,	12,	13,
-	15,	20,	25,	30,
-	35,	40,	45,	50,
-	55,	60,	70,	80
-};
 char *SD_MONTH_LUT[] = {
 	"Unk",
 	"Jan", "Feb", "Mar", "Apr",
@@ -58,11 +56,81 @@ char *SD_MONTH_LUT[] = {
 uint8_t SD_ParseCID(SD_Card *card, SD_Data_Block *csdBlock);
 uint8_t SD_ParseCSD(SD_Card *card, SD_Data_Block *csdBlock);
 
+/**
+ * Sends SWITCH_FUNC for high speed mode, and begins receiving the switch
+ * function status into data block 0.
+ *
+ * @param card SD Card structure.
+ * @param mode SD_SWITCH_MODE_CHECK or SD_SWITCH_MODE_SWITCH.
+ * @return Whether the status is being received. On failure, the SPI line is
+ * closed.
+ */
+static uint8_t SD_Initialize_SendSwitch(SD_Card *card, uint8_t mode) {
+	uint8_t args[4] = {mode, 0xff, 0xff, SD_SWITCH_HIGH_SPEED};
+	uint8_t result;
+	uint16_t i = 0;
+
+	SD_SPI_Open(card);
+	result = SD_SendCommand(card, SD_CMD_SWITCH_FUNC, args, 0x00);
+	if (result != 0x00) {
+		DBG_ERR_printf("Warning: Bad response to SWITCH_FUNC, got 0x%02x", result);
+
+		SD_SPI_Terminate(card);
+		SD_SPI_Close(card);
+		return 0;
+	}
+	// wait for the start block token
+	result = 0xff;
+	while (result != SD_TOKEN_START_BLOCK && i < SD_BLOCK_TIMEOUT) {
+		result = SD_SPI_Transfer(card, SD_DUMMY_BYTE);
+		i++;
+	}
+	if (result != SD_TOKEN_START_BLOCK) {
+		DBG_ERR_printf("Warning: Card did not send switch function status, got 0x%02x", result);
+
+		SD_SPI_Terminate(card);
+		SD_SPI_Close(card);
+		return 0;
+	}
+
+	card->DataBlocks[0].StartOffset = 0;
+	card->DataBlocks[0].BlockLen = SD_SWITCH_STATUS_LEN + 2;
+	SD_DMA_ReceiveBlock(card, &card->DataBlocks[0]);
+
+	SD_DMA_OnCardDataRead();
+
+	return 1;
+}
+
+/**
+ * Finishes initialization, running the bus at the maximum speed reported by
+ * the card.
+ *
+ * @param card SD Card structure.
+ * @return Result of the initialization operation.
+ */
+static sd_result_t SD_Initialize_Finish(SD_Card *card) {
+	SD_Speed_Initialize(card, SD_DecodeTranSpeed(card->TRAN_SPEED));
+	SD_Latency_Initialize(card);
+
+	if (card->BlockSize > SD_DATA_BLOCK_LENGTH + 4) {
+		DBG_ERR_printf("Failed: Card block size exceeds DMA buffer size, block size is %u", card->BlockSize);
+
+		card->State = SD_UNINITIALIZED;
+		return SD_INITIALIZE_NOSUPPORT;
+	}
+	DBG_DATA_printf("Card block size: %u", card->BlockSize);
+
+	card->State = SD_IDLE;
+	return SD_SUCCESS;
+}
+
 sd_result_t SD_Initialize(SD_Card *card) {
 	uint8_t i=0;
 
 	card->State = SD_INITIALIZING;
 	card->SubState = 0;
+	card->HighSpeed = 0;
 
 	SD_DMA_Initialize(card);
 
@@ -276,7 +344,7 @@ sd_result_t SD_GetInitializeResult(SD_Card *card) {
 		}
 
 		// Re-initialize SPI in fast mode at 25MHz
-		SD_DMA_InitializeFast(card, 25);
+		SD_DMA_InitializeFast(card, SD_SPEED_DEFAULT_KHZ);
 
 		// Read CID after initialization
 		SD_SPI_Open(card);
@@ -391,29 +459,56 @@ sd_result_t SD_GetInitializeResult(SD_Card *card) {
 				return SD_INITIALIZE_FAILED;
 			}
 
-			// Reinitialize at maximum speed reported by card
-			// Get transmission speed in MHz
-			uint16_t transSpeed = SD_TRAN_SPEED_LUT[(card->TRAN_SPEED >> 3) & 0b1111];
-			switch ((card->TRAN_SPEED >> 0) & 0b111) {
-				default:
-				case 0:		transSpeed /= 100;		break;
-				case 1:		transSpeed /= 10;		break;
-				case 2:		;						break;
-				case 3:		transSpeed *= 10;		break;
+#if SD_HIGH_SPEED
+			// Switch function (CMD6) is only in Ver2.00 and later, and optional
+			if (card->Ver2SDCard && (card->CCC & SD_CCC_SWITCH)) {
+				DBG_DATA_printf("Checking for high speed mode");
+				if (SD_Initialize_SendSwitch(card, SD_SWITCH_MODE_CHECK)) {
+					card->SubState = SD_INIT_SUB_SWITCH_CHECK;
+					return SD_BUSY;
+				}
 			}
-			DBG_DATA_printf("Reinitialize SPI bus at %u MHz", transSpeed);
-			SD_DMA_InitializeFast(card, transSpeed);
-
-			if (card->BlockSize > SD_DATA_BLOCK_LENGTH + 4) {
-				DBG_ERR_printf("Failed: Card block size exceeds DMA buffer size, block size is %u", card->BlockSize);
+#endif
+			return SD_Initialize_Finish(card);
+		} else {
+			return SD_BUSY;
+		}
+	}
+	if (card->SubState == SD_INIT_SUB_SWITCH_CHECK) {
+		if (SD_DMA_GetTransferComplete(card)) {
+			SD_SPI_Terminate(card);
+			SD_SPI_Close(card);
 
-				card->State = SD_UNINITIALIZED;
-				return SD_INITIALIZE_NOSUPPORT;
+			if (card->DataBlocks[0].Data[13] & SD_SWITCH_B13_HIGH_SPEED) {
+				DBG_DATA_printf("Switching to high speed mode");
+				if (SD_Initialize_SendSwitch(card, SD_SWITCH_MODE_SWITCH)) {
+					card->SubState = SD_INIT_SUB_SWITCH;
+					return SD_BUSY;
+				}
+			} else {
+				DBG_DATA_printf("High speed mode not supported");
 			}
-			DBG_DATA_printf("Card block size: %u", card->BlockSize);
+			return SD_Initialize_Finish(card);
+		} else {
+			return SD_BUSY;
+		}
+	}
+	if (card->SubState == SD_INIT_SUB_SWITCH) {
+		if (SD_DMA_GetTransferComplete(card)) {
+			SD_SPI_Terminate(card);
+			SD_SPI_Close(card);
 
-			card->State = SD_IDLE;
-			return SD_SUCCESS;
+			if ((card->DataBlocks[0].Data[16] & SD_SWITCH_B16_GROUP1) == 0x01) {
+				// The CSD now reports the high speed TRAN_SPEED, so there's
+				// no need to read it again
+				DBG_DATA_printf("Switched to high speed mode");
+				card->HighSpeed = 1;
+				card->TRAN_SPEED = SD_TRAN_SPEED_HIGH_SPEED;
+			} else {
+				DBG_ERR_printf("Warning: Switch to high speed mode failed, got 0x%02x",
+						card->DataBlocks[0].Data[16]);
+			}
+			return SD_Initialize_Finish(card);
 		} else {
 			return SD_BUSY;
 		}
@@ -478,6 +573,7 @@ uint8_t SD_ParseCSD(SD_Card *card, SD_Data_Block *csdBlock) {
 		card->BlockSize = 512;
 
 		card->TRAN_SPEED = csdData[3];
+		card->CCC = ((uint16_t)csdData[4] << 4) | (csdData[5] >> 4);
 
 		C_SIZE = (csdData[6] >> 0) & 0b11;		C_SIZE = C_SIZE << 8;
 		C_SIZE |= csdData[7];					C_SIZE = C_SIZE << 2;
@@ -501,6 +597,7 @@ uint8_t SD_ParseCSD(SD_Card *card, SD_Data_Block *csdBlock) {
 		card->BlockSize = 512;
 
 		card->TRAN_SPEED = csdData[3];
+		card->CCC = ((uint16_t)csdData[4] << 4) | (csdData[5] >> 4);
 		C_SIZE = (csdData[7] >> 0) & 0b111111;	C_SIZE = C_SIZE << 6;
 		C_SIZE |= csdData[8];					C_SIZE = C_SIZE << 8;
 		C_SIZE |= csdData[9];
@@ -0,0 +1,85 @@
+/*
+ * File:   sd-latency.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:59 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Busy time histograms.
+ * After each Multiple Block Write block, and after the Stop Tran token, the
+ * card holds the bus busy while it programs. This is normally well under a
+ * millisecond, but some cards stall for tens or hundreds of milliseconds, for
+ * garbage collection or wear levelling, and the application has to buffer
+ * incoming data for that long. The time from the end of the data block (or
+ * the Stop Tran token) to the card idling, including any wait for a late data
+ * response token, is timed with GetCycleCount and added to a log-scale
+ * histogram, so slow cards can be spotted before they lose data.
+ *
+ * Histogram bin 0 counts operations which took less than
+ * SD_LATENCY_BIN0_CYCLES, and each following bin ends at
+ * 1 << SD_LATENCY_BIN_SHIFT times the previous limit, with the last bin
+ * counting everything longer.
+ *
+ * Since busy periods are only seen when the block operations are polled,
+ * times include up to one poll interval of the application.
+ */
+
+#include <string.h>
+
+#include "sd-defs.h"
+#include "sd-spi-dma.h"
+
+#include "../timing.h"
+
+void SD_Latency_Initialize(SD_Card *card) {
+	card->LatencyBudget = 0;
+	SD_Latency_Clear(card);
+}
+
+void SD_Latency_Clear(SD_Card *card) {
+	memset(card->Latency, 0, sizeof(card->Latency));
+}
+
+void SD_Latency_SetBudget(SD_Card *card, uint32_t budgetCycles) {
+	card->LatencyBudget = budgetCycles;
+}
+
+void SD_Latency_Start(SD_Card *card) {
+	card->LatencyStart = GetCycleCount();
+}
+
+uint8_t SD_Latency_GetBin(uint32_t cycles) {
+	uint32_t limit = SD_LATENCY_BIN0_CYCLES;
+	uint8_t bin = 0;
+
+	while (bin < SD_LATENCY_NUM_BINS - 1 && cycles >= limit) {
+		limit <<= SD_LATENCY_BIN_SHIFT;
+		bin++;
+	}
+	return bin;
+}
+
+void SD_Latency_Stop(SD_Card *card, uint8_t kind) {
+	SD_Latency *latency = &card->Latency[kind];
+	uint32_t cycles = GetCycleCount() - card->LatencyStart;
+	uint8_t bin = SD_Latency_GetBin(cycles);
+
+	if (latency->Count != 0xffff) {
+		latency->Count++;
+	}
+	if (card->LatencyBudget != 0 && cycles > card->LatencyBudget
+			&& latency->OverBudget != 0xffff) {
+		latency->OverBudget++;
+	}
+	latency->TotalCycles += cycles;
+	if (cycles > latency->MaxCycles) {
+		latency->MaxCycles = cycles;
+	}
+	if (latency->Bins[bin] != 0xffff) {
+		latency->Bins[bin]++;
+	}
+}
@@ -0,0 +1,46 @@
+/*
+ * File:   sd-latency.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:59 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Busy time histogram definitions, shared between the SD-SPI-DMA layer and
+ * the host tools. The functions are in sd-spi-dma.h.
+ */
+
+#ifndef SD_LATENCY_H
+#define SD_LATENCY_H
+
+#include "../types.h"
+
+#define SD_LATENCY_BLOCK		0	/// Multiple Block Write block, from the end of the data to the card idling.
+#define SD_LATENCY_STOP_TRAN	1	/// Multiple Block Write Stop Tran, from the token to the card idling.
+#define SD_LATENCY_NUM_KINDS	2
+
+/**
+ * One letter kind names used in reports, in kind order.
+ */
+#define SD_LATENCY_KIND_NAMES	"BS"
+
+#define SD_LATENCY_NUM_BINS		12
+#define SD_LATENCY_BIN0_CYCLES	2000	/// Upper limit of the first bin, 100 us at 20 MHz.
+#define SD_LATENCY_BIN_SHIFT	1		/// Each bin limit is twice the last.
+
+/**
+ * Busy time histogram of one kind of operation, see sd-latency.c.
+ * Counts saturate at 0xffff.
+ */
+typedef struct {
+	uint16_t Count;			/// Operations timed since the histogram was cleared.
+	uint16_t OverBudget;	/// Of which took longer than the budget.
+	uint32_t TotalCycles;	/// Busy time of all operations, in cycles.
+	uint32_t MaxCycles;		/// Longest busy time, in cycles.
+	uint16_t Bins[SD_LATENCY_NUM_BINS];	/// Histogram of busy times.
+} SD_Latency;
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * File:   sd-speed.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 10:05 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Bus speed control.
+ * The bus runs at the fastest clock the card reports in its CSD (after
+ * switching to high speed mode where supported), limited by the SPI
+ * prescalers. Long or noisy wiring may not keep up with that, which shows as
+ * bad or missing responses, so the clock is halved on errors and raised again
+ * once transfers have been clean for a while.
+ */
+
+#include "sd-defs.h"
+#include "sd-spi-dma.h"
+
+#define DEBUG_UART
+#define DEBUG_UART_DATA
+#define DBG_MODULE "SD/Speed"
+#include "../debug-common.h"
+
+/**
+ * TRAN_SPEED time values, in tenths.
+ */
+const uint8_t SD_TRAN_SPEED_LUT[] = {
+	0,	10,	12,	13,
+	15,	20,	25,	30,
+	35,	40,	45,	50,
+	55,	60,	70,	80
+};
+
+/**
+ * TRAN_SPEED transfer rate units, in hundreds of bit/s (so that multiplying
+ * by the time value in tenths gives kbit/s). Units 4-7 are reserved.
+ */
+const uint16_t SD_TRAN_SPEED_UNIT_LUT[] = {
+	10, 100, 1000, 10000,
+	0, 0, 0, 0
+};
+
+uint32_t SD_DecodeTranSpeed(uint8_t tranSpeed) {
+	return (uint32_t)SD_TRAN_SPEED_LUT[(tranSpeed >> 3) & 0b1111]
+			* SD_TRAN_SPEED_UNIT_LUT[(tranSpeed >> 0) & 0b111];
+}
+
+uint32_t SD_SPI_GetPrescale(uint32_t speedkHz, uint8_t *primary, uint8_t *secondary) {
+	uint32_t bestkHz = 0;
+	uint16_t p;
+	uint8_t s;
+
+	*primary = 64;
+	*secondary = 8;
+	for (p=1;p<=64;p*=4) {
+		for (s=1;s<=8;s++) {
+			uint32_t kHz = (Fcy / 1000) / (p * s);
+			if (p == 1 && s == 1) {
+				continue;
+			}
+			if (kHz <= speedkHz && kHz > bestkHz) {
+				bestkHz = kHz;
+				*primary = (uint8_t)p;
+				*secondary = s;
+			}
+		}
+	}
+	if (bestkHz == 0) {
+		bestkHz = (Fcy / 1000) / (64 * 8);
+	}
+	return bestkHz;
+}
+
+void SD_Speed_Initialize(SD_Card *card, uint32_t maxkHz) {
+	card->MaxSpeedkHz = maxkHz;
+	card->SpeedLimitkHz = maxkHz;
+	card->SpeedChange = 0;
+	card->SpeedCleanOps = 0;
+	card->SpeedBackoffs = 0;
+	card->SpeedkHz = SD_DMA_InitializeFast(card, maxkHz);
+	DBG_DATA_printf("Bus clock %lu kHz (card maximum %lu kHz)", card->SpeedkHz, maxkHz);
+}
+
+void SD_Speed_OnError(SD_Card *card) {
+	card->SpeedCleanOps = 0;
+	if (card->SpeedkHz <= SD_SPEED_MIN_KHZ) {
+		return;
+	}
+	card->SpeedLimitkHz = card->SpeedkHz / 2;
+	if (card->SpeedLimitkHz < SD_SPEED_MIN_KHZ) {
+		card->SpeedLimitkHz = SD_SPEED_MIN_KHZ;
+	}
+	card->SpeedChange = 1;
+	card->SpeedBackoffs++;
+}
+
+void SD_Speed_OnSuccess(SD_Card *card) {
+	if (card->SpeedLimitkHz >= card->MaxSpeedkHz) {
+		return;
+	}
+	card->SpeedCleanOps++;
+	if (card->SpeedCleanOps >= SD_SPEED_RECOVER_OPS) {
+		card->SpeedCleanOps = 0;
+		card->SpeedLimitkHz *= 2;
+		if (card->SpeedLimitkHz > card->MaxSpeedkHz) {
+			card->SpeedLimitkHz = card->MaxSpeedkHz;
+		}
+		card->SpeedChange = 1;
+	}
+}
+
+void SD_Speed_Apply(SD_Card *card) {
+	uint32_t prevkHz = card->SpeedkHz;
+
+	if (!card->SpeedChange) {
+		return;
+	}
+	card->SpeedChange = 0;
+	card->SpeedkHz = SD_DMA_InitializeFast(card, card->SpeedLimitkHz);
+	DBG_DATA_printf("Bus clock %lu kHz -> %lu kHz", prevkHz, card->SpeedkHz);
+}
@@ -8,6 +8,9 @@
  * Date			Author	Change
  * 18 Jul 2011	Ducky	Initial definition.
  * 26 Jul 2011	Ducky	Changed return mechanism to use polling functions.
+ * 17 Oct 2026	agent	Multiple Block Read.
+ * 17 Oct 2026	agent	Bus speed control.
+ * 17 Oct 2026	agent	Busy time histograms.
  *
  * @file
  * sd-spi-dma functions intended to be called by the user and data structure
@@ -17,7 +20,7 @@
 #ifndef SD_SPI_DMA_H
 #define SD_SPI_DMA_H
 
-#include "..\types.h"
+#include "../types.h"
 
 #include "sd-hardware.h"
 
@@ -180,6 +183,161 @@ sd_result_t SD_DMA_MBW_Terminate(SD_Card *card);
  */
 sd_result_t SD_DMA_MBW_GetTerminateStatus(SD_Card *card);
 
+/**
+ * Begins a multiple block read at the specified address. Blocks are then
+ * received one at a time with SD_DMA_MBR_ReceiveBlock, from consecutive
+ * addresses, until the operation is terminated. The card waits between
+ * blocks, so the next block need not be received right away, but the card
+ * can't be used for anything else until the operation is terminated.
+ *
+ * @param card SD Card struct.
+ * @param addr Block address on the card of the first block to read.
+ * @return Result of the begin multiple block read operation.
+ * @retval SD_SUCCESS Multiple Block Read started.
+ * @retval SD_FAILED Operation failed, card not idle.
+ * @retval SD_PHY_ERR Card rejected the command.
+ */
+sd_result_t SD_DMA_MBR_Begin(SD_Card *card, sd_block_t addr);
+
+/**
+ * Receives the next data block during the Multiple Block Read operation.
+ * The wait for the card's read latency is done in the background, in
+ * SD_DMA_MBR_GetReceiveBlockResult, followed by the DMA transfer.
+ *
+ * @param card SD Card struct.
+ * @param data SD Data Block structure to hold the read data.
+ * @return Result of the read operation.
+ * @retval SD_BUSY Operation not yet complete.
+ * @retval SD_SUCCESS Block received.
+ * @retval SD_PHY_ERR Card did not send the block. The operation must still
+ * be terminated.
+ * @retval SD_FAILED Operation failed, card not in a Multiple Block Read.
+ */
+sd_result_t SD_DMA_MBR_ReceiveBlock(SD_Card *card, SD_Data_Block *data);
+
+/**
+ * Gets the result of the current receive block in progress, or returns a
+ * busy signal if the operation is not yet complete.
+ *
+ * @param card SD Card struct.
+ * @return Result of the read operation, as SD_DMA_MBR_ReceiveBlock.
+ */
+sd_result_t SD_DMA_MBR_GetReceiveBlockResult(SD_Card *card);
+
+/**
+ * Terminates a Multiple Block Read operation, between blocks.
+ *
+ * @param card SD Card struct.
+ * @return Result of the terminate operation.
+ * @retval SD_BUSY Operation not yet complete.
+ * @retval SD_PHY_ERR Card rejected the command, the card is deselected.
+ * @retval SD_FAILED Operation failed, card not between Multiple Block Read
+ * blocks.
+ */
+sd_result_t SD_DMA_MBR_Terminate(SD_Card *card);
+
+/**
+ * Gets the result of the current Multiple Block Read Terminate operation
+ * in progress, or returns a busy signal if the operation is not yet complete.
+ *
+ * @param card SD Card struct.
+ * @return Result of the terminate operation.
+ * @retval SD_BUSY Operation not yet complete.
+ * @retval SD_SUCCESS Termination successful, card idle.
+ * @retval SD_FAILED Operation failed, card not terminating.
+ */
+sd_result_t SD_DMA_MBR_GetTerminateStatus(SD_Card *card);
+
+/**
+ * Decodes a CSD TRAN_SPEED byte.
+ *
+ * @param tranSpeed TRAN_SPEED byte.
+ * @return Maximum data transfer rate, in kbit/s, which is the bus clock in kHz.
+ */
+uint32_t SD_DecodeTranSpeed(uint8_t tranSpeed);
+
+/**
+ * Sets the fastest bus clock the card supports and runs the bus at it,
+ * clearing any back-off. This is called at the end of initialization.
+ *
+ * @param card SD Card struct.
+ * @param maxkHz Fastest bus clock the card supports, in kHz.
+ */
+void SD_Speed_Initialize(SD_Card *card, uint32_t maxkHz);
+
+/**
+ * Called by the block operations when the card responds with an error or not
+ * at all, which is usually a sign of the bus being too fast for the wiring.
+ * The bus clock is halved, down to SD_SPEED_MIN_KHZ, from the next operation.
+ *
+ * @param card SD Card struct.
+ */
+void SD_Speed_OnError(SD_Card *card);
+
+/**
+ * Called by the block operations when a block is transferred. After
+ * SD_SPEED_RECOVER_OPS blocks without errors, the bus clock is doubled again,
+ * up to the card's maximum, from the next operation.
+ *
+ * @param card SD Card struct.
+ */
+void SD_Speed_OnSuccess(SD_Card *card);
+
+/**
+ * Called by the block operations when beginning, with the SPI line closed,
+ * to apply any bus clock change.
+ *
+ * @param card SD Card struct.
+ */
+void SD_Speed_Apply(SD_Card *card);
+
+/**
+ * Clears the busy time histograms and the budget. This is called at the end
+ * of initialization.
+ *
+ * @param card SD Card struct.
+ */
+void SD_Latency_Initialize(SD_Card *card);
+
+/**
+ * Clears the busy time histograms, keeping the budget. The application calls
+ * this after reading them out.
+ *
+ * @param card SD Card struct.
+ */
+void SD_Latency_Clear(SD_Card *card);
+
+/**
+ * Sets the longest busy time the application can absorb. Operations taking
+ * longer are counted in the histogram's OverBudget.
+ *
+ * @param card SD Card struct.
+ * @param budgetCycles Budget, in cycles, or 0 for no limit.
+ */
+void SD_Latency_SetBudget(SD_Card *card, uint32_t budgetCycles);
+
+/**
+ * Called by the block operations to start timing a busy period.
+ *
+ * @param card SD Card struct.
+ */
+void SD_Latency_Start(SD_Card *card);
+
+/**
+ * Called by the block operations when the card idles, to add the time since
+ * SD_Latency_Start to a histogram.
+ *
+ * @param card SD Card struct.
+ * @param kind Histogram, SD_LATENCY_*.
+ */
+void SD_Latency_Stop(SD_Card *card, uint8_t kind);
+
+/**
+ * @param cycles Busy time, in cycles.
+ * @return Histogram bin for the time.
+ */
+uint8_t SD_Latency_GetBin(uint32_t cycles);
+
 /**
  * This function is intended to be user-defined and is called once when
  * card-specific data (CSD or CID blocks) are read.
@@ -8,6 +8,9 @@
  * Date			Author	Change
  * 25 Jul 2011	Ducky	Added this change history box.
  *						Added support for hex data dumping.
+ * 17 Oct 2026	agent	Messages and hex dump lines are sent with a single
+ *						non-blocking write.
+ * 17 Oct 2026	agent	Check messages fit in the UART ring.
  *
  * @file
  * Debugging console features.
@@ -19,10 +22,68 @@
 
 #include "uart-dma.h"
 
-char DBG_buffer[128];
+#if DBG_BUFFER_SIZE > UART_DMA_RING_SIZE - 1
+	#error "UART_DMA_RING_SIZE too small for a whole debug message"
+#endif
+
+char DBG_buffer[DBG_BUFFER_SIZE];
+uint8_t DBG_bufferPos = 0;
 char next = 0;
 char DBG_swirly[] = {'|', '/', '-', '\\'};
 
+/**
+ * Sends the first @a len bytes of DBG_buffer. This only waits for the UART
+ * with DBG_BLOCK, otherwise the write is dropped if the UART ring is full.
+ */
+static void DBG_Send(uint16_t len) {
+#ifdef DBG_BLOCK
+	UART_DMA_WriteBlocking(DBG_buffer, len);
+#else
+	UART_DMA_WriteAtomic(DBG_buffer, len);
+#endif
+}
+
+void DBG_Begin(const char *start, const char *end) {
+	uint8_t pos = 0;
+
+	while (*start != 0 && pos < DBG_PREFIX_MAX - 1) {
+		DBG_buffer[pos++] = *start++;
+	}
+	DBG_buffer[pos++] = DBG_swirly[(uint8_t)next];
+	next++;
+	if (next >= sizeof(DBG_swirly)) {
+		next = 0;
+	}
+	while (*end != 0 && pos < DBG_PREFIX_MAX) {
+		DBG_buffer[pos++] = *end++;
+	}
+	DBG_bufferPos = pos;
+}
+
+void DBG_End(const char *suffix) {
+	uint16_t len = DBG_bufferPos + strlen(DBG_buffer + DBG_bufferPos);
+
+	while (*suffix != 0 && len < DBG_BUFFER_SIZE) {
+		DBG_buffer[len++] = *suffix++;
+	}
+	DBG_Send(len);
+}
+
+/**
+ * Appends a string to the hex dump line in DBG_buffer, sending the line so
+ * far first if it would not fit.
+ */
+static void DBG_HexdumpPut(const char *string) {
+	uint16_t len = strlen(string);
+
+	if (DBG_bufferPos + len > DBG_BUFFER_SIZE) {
+		DBG_Send(DBG_bufferPos);
+		DBG_bufferPos = 0;
+	}
+	memcpy(DBG_buffer + DBG_bufferPos, string, len);
+	DBG_bufferPos += len;
+}
+
 /**
  * Converts signed integer @a n to hexadecimal ASCII characters in @a s.
  * Output string will have a minimum length @a len.
@@ -77,6 +138,8 @@ char* lenhtoa(int n, char s[], unsigned char len)
 
 /**
  * Dumps a segment of memory to UART displaying both hexadecimal and ASCII.
+ * Each line is sent as one write, so lines are dropped whole when the UART
+ * ring is full. Dumps longer than the ring need DBG_BLOCK.
  *
  * @param[in] buf Pointer to start of the location to dump.
  * @param[in] len Length, in bytes, of the location to dump.
@@ -88,34 +151,43 @@ void DBG_hexdump(uint8_t *buf, uint16_t len, uint8_t breakLen, uint8_t lineLen)
 	char buffer[16];
 	int i = 0;
 
+	DBG_bufferPos = 0;
 	lenhtoa(0, buffer, 4);
-	UART_DMA_WriteBlockingS(buffer);
-	UART_DMA_WriteBlockingS(" - ");
+	DBG_HexdumpPut(buffer);
+	DBG_HexdumpPut(" - ");
 
 	for (i=0;i<len;i++) {
 		lenhtoa(*(unsigned char*)buf, buffer, 2);
-		UART_DMA_WriteBlockingS(buffer);
-		UART_DMA_WriteBlockingS(" ");
+		DBG_HexdumpPut(buffer);
+		DBG_HexdumpPut(" ");
 		buf++;
 
 		if ((i + 1) % lineLen == 0) {
-			UART_DMA_WriteBlockingS(" - ");
+			DBG_HexdumpPut(" - ");
 			while (lineStart < buf) {
 				if (*lineStart >= 32 && *lineStart <= 127) {
-					UART_DMA_WriteBlocking((char*)lineStart, 1);
+					buffer[0] = *lineStart;
+					buffer[1] = 0;
+					DBG_HexdumpPut(buffer);
 				} else {
-					UART_DMA_WriteBlockingS(".");
+					DBG_HexdumpPut(".");
 				}
 				lineStart++;
 			}
-			UART_DMA_WriteBlockingS("\n");
+			DBG_HexdumpPut("\n");
+			DBG_Send(DBG_bufferPos);
+			DBG_bufferPos = 0;
 			if (i+1 < len) {
 				lenhtoa(i+1, buffer, 4);
-				UART_DMA_WriteBlockingS(buffer);
-				UART_DMA_WriteBlockingS(" - ");
+				DBG_HexdumpPut(buffer);
+				DBG_HexdumpPut(" - ");
 			}
 		} else if ((i + 1) % breakLen == 0) {
-			UART_DMA_WriteBlockingS(" ");
+			DBG_HexdumpPut(" ");
 		}
 	}
+
+	if (DBG_bufferPos != 0) {
+		DBG_Send(DBG_bufferPos);
+	}
 }
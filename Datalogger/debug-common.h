@@ -8,6 +8,11 @@
  * Date			Author	Change
  * 25 Jul 2011	Ducky	Added this change history box.
  *						Added support for hex data dumping.
+ * 17 Oct 2026	agent	Host builds print to stderr.
+ * 17 Oct 2026	agent	Deferred logging.
+ * 17 Oct 2026	agent	Messages are sent with a single non-blocking write.
+ * 17 Oct 2026	agent	Host messages fitted to the host's integer sizes, and data
+ *						and spam messages compiled but not printed.
  *
  * @file
  * Debugging console features.
@@ -15,7 +20,38 @@
 
 //	#define DBG_BLOCK
 
-#if defined(DEBUG_UART) && !defined(DEBUG_UART_DISABLE)
+/**
+ * Size of DBG_buffer: the message prefix, up to DBG_PREFIX_MAX bytes, the
+ * formatted message, up to 128 bytes, and the line end.
+ */
+#define DBG_PREFIX_MAX		48
+#define DBG_BUFFER_SIZE		(DBG_PREFIX_MAX + 128 + 8)
+
+/**
+ * Uncomment to queue binary records instead of formatting messages, see
+ * debug-deferred.h. The output must be expanded with dbg-expand on the host.
+ */
+//	#define DEBUG_UART_DEFERRED
+
+#if defined(DEBUG_UART) && !defined(DEBUG_UART_DISABLE) && defined(DEBUG_UART_DEFERRED)
+	#include "debug-deferred.h"
+
+	#define DBG_printf(f, ...)		DBG_Deferred(DBG_DEFER_LEVEL_INFO, __LINE__, f, ## __VA_ARGS__);
+	#define DBG_ERR_printf(f, ...)	DBG_Deferred(DBG_DEFER_LEVEL_ERR, __LINE__, f, ## __VA_ARGS__);
+
+	#ifdef DEBUG_UART_DATA
+		#define DBG_DATA_printf(f, ...)	DBG_Deferred(DBG_DEFER_LEVEL_DATA, __LINE__, f, ## __VA_ARGS__);
+	#else
+		#define DBG_DATA_printf(f, ...)		;
+	#endif
+	// Hex dumps would need the blocking text output
+	#define DBG_DATA_hexdump(data, len, breakLen, lineLen)	;
+	#ifdef DEBUG_UART_SPAM
+		#define DBG_SPAM_printf(f, ...)	DBG_Deferred(DBG_DEFER_LEVEL_SPAM, __LINE__, f, ## __VA_ARGS__);
+	#else
+		#define DBG_SPAM_printf(f, ...)		;
+	#endif
+#elif defined(DEBUG_UART) && !defined(DEBUG_UART_DISABLE) && !defined(HARDWARE_HOST)
 	// This file should win an award for most complicated preprocessor statements
 	#include <stdio.h>
 	#include "uart-dma.h"
@@ -31,45 +67,48 @@
 		#define DBG_BLOCKFN()	;
 	#endif
 
-	extern char DBG_buffer[128];
+	extern char DBG_buffer[DBG_BUFFER_SIZE];
+	extern uint8_t DBG_bufferPos;
 	extern char DBG_swirly[];
 	extern char next;
-	extern volatile uint16_t UART_DMA_Active;
 	#define STR_HELPER(x) #x
 	#define STR(x) STR_HELPER(x)
 
-	#define SH_printf(f, ...)		sprintf(DBG_buffer, f, ## __VA_ARGS__);													\
-									UART_DMA_WriteBlockingS(DBG_buffer);													\
-									UART_DMA_WriteBlockingS("\23337m\r\n");													\
-									DBG_BLOCKFN();
+	/**
+	 * Starts a message in DBG_buffer: @a start, the next swirly character and
+	 * @a end, together at most DBG_PREFIX_MAX bytes. The message is formatted
+	 * at DBG_bufferPos.
+	 */
+	void DBG_Begin(const char *start, const char *end);
+
+	/**
+	 * Appends @a suffix to the message in DBG_buffer and sends it as a single
+	 * write, so a message is either sent whole or dropped (and counted in
+	 * UART_DMA_DroppedWrites) without stalling on the UART. With DBG_BLOCK,
+	 * this waits for room in the UART ring instead.
+	 */
+	void DBG_End(const char *suffix);
 
-	#define DBG_printf(f, ...)		UART_DMA_WriteBlockingS("\23336m[");													\
-									UART_DMA_WriteBlocking(DBG_swirly+next, 1);												\
-									UART_DMA_WriteBlockingS(" Info]\23337m " DBG_MODULE " " STR(__LINE__) ": ");			\
-									next++; if (next >= NUM_SWIRLY) next=0;													\
+	#define SH_printf(f, ...)		DBG_bufferPos = 0;																		\
 									sprintf(DBG_buffer, f, ## __VA_ARGS__);													\
-									UART_DMA_WriteBlockingS(DBG_buffer);													\
-									UART_DMA_WriteBlockingS("\r\n");														\
+									DBG_End("\23337m\r\n");																	\
 									DBG_BLOCKFN();
 
-	#define DBG_ERR_printf(f, ...)	UART_DMA_WriteBlockingS("\23331m[");													\
-									UART_DMA_WriteBlocking(DBG_swirly+next, 1);												\
-									UART_DMA_WriteBlockingS(" Err ]\23337m " DBG_MODULE " " STR(__LINE__) ": ");			\
-									next++; if (next >= NUM_SWIRLY) next=0;													\
-									sprintf(DBG_buffer, f, ## __VA_ARGS__);													\
-									UART_DMA_WriteBlockingS(DBG_buffer);													\
-									UART_DMA_WriteBlockingS("\r\n");														\
+	#define DBG_printf(f, ...)		DBG_Begin("\23336m[", " Info]\23337m " DBG_MODULE " " STR(__LINE__) ": ");				\
+									sprintf(DBG_buffer + DBG_bufferPos, f, ## __VA_ARGS__);									\
+									DBG_End("\r\n");																		\
+									DBG_BLOCKFN();
+
+	#define DBG_ERR_printf(f, ...)	DBG_Begin("\23331m[", " Err ]\23337m " DBG_MODULE " " STR(__LINE__) ": ");				\
+									sprintf(DBG_buffer + DBG_bufferPos, f, ## __VA_ARGS__);									\
+									DBG_End("\r\n");																		\
 									DBG_BLOCKFN();
 
 	#ifdef DEBUG_UART_DATA
 	void DBG_hexdump(uint8_t *buf, uint16_t len, uint8_t breakLen, uint8_t lineLen);
-	#define DBG_DATA_printf(f, ...)	UART_DMA_WriteBlockingS("\23333m[");													\
-									UART_DMA_WriteBlocking(DBG_swirly+next, 1);												\
-									UART_DMA_WriteBlockingS(" Data]\23337m " DBG_MODULE " " STR(__LINE__) ": ");			\
-									next++; if (next >= NUM_SWIRLY) next=0;													\
-									sprintf(DBG_buffer, f, ## __VA_ARGS__);													\
-									UART_DMA_WriteBlockingS(DBG_buffer);													\
-									UART_DMA_WriteBlockingS("\r\n");														\
+	#define DBG_DATA_printf(f, ...)	DBG_Begin("\23333m[", " Data]\23337m " DBG_MODULE " " STR(__LINE__) ": ");				\
+									sprintf(DBG_buffer + DBG_bufferPos, f, ## __VA_ARGS__);									\
+									DBG_End("\r\n");																		\
 									DBG_BLOCKFN();
 
 	#define DBG_DATA_hexdump(data, len, breakLen, lineLen)	DBG_hexdump(data, len, breakLen, lineLen);
@@ -78,18 +117,34 @@
 		#define DBG_DATA_hexdump(data)
 	#endif
 	#ifdef DEBUG_UART_SPAM
-	#define DBG_SPAM_printf(f, ...)	UART_DMA_WriteBlockingS("\23335m[");													\
-									UART_DMA_WriteBlocking(DBG_swirly+next, 1);												\
-									UART_DMA_WriteBlockingS(" Spam]\23337m " DBG_MODULE " " STR(__LINE__) ": ");			\
-									next++; if (next >= NUM_SWIRLY) next=0;													\
-									sprintf(DBG_buffer, f, ## __VA_ARGS__);													\
-									UART_DMA_WriteBlockingS(DBG_buffer);													\
-									UART_DMA_WriteBlockingS("\r\n");														\
+	#define DBG_SPAM_printf(f, ...)	DBG_Begin("\23335m[", " Spam]\23337m " DBG_MODULE " " STR(__LINE__) ": ");				\
+									sprintf(DBG_buffer + DBG_bufferPos, f, ## __VA_ARGS__);									\
+									DBG_End("\r\n");																		\
 									DBG_BLOCKFN();
 
 	#else
 		#define DBG_SPAM_printf(f, ...)
 	#endif
+#elif defined(DEBUG_UART) && !defined(DEBUG_UART_DISABLE)
+	// Host build - there is no UART, so info and error messages go to stderr.
+	// Data and spam messages are compiled, so their arguments are checked,
+	// but not printed.
+	#ifndef DBG_MODULE
+		#define DBG_MODULE __FILE__
+	#endif
+
+	/**
+	 * Prints a message to stderr. Formats are written for C30, where the l
+	 * length modifier is for 32-bit values, so it is dropped to fit the
+	 * host's uint32_t, which is an int.
+	 */
+	void DBG_Host_printf(const char *prefix, uint16_t line, const char *f, ...);
+
+	#define DBG_printf(f, ...)		DBG_Host_printf("[Info] " DBG_MODULE, __LINE__, f, ## __VA_ARGS__);
+	#define DBG_ERR_printf(f, ...)	DBG_Host_printf("[Err ] " DBG_MODULE, __LINE__, f, ## __VA_ARGS__);
+	#define DBG_DATA_printf(f, ...)	do { if (0) { DBG_Host_printf("", __LINE__, f, ## __VA_ARGS__); } } while (0);
+	#define DBG_DATA_hexdump(data, len, breakLen, lineLen)	;
+	#define DBG_SPAM_printf(f, ...)	do { if (0) { DBG_Host_printf("", __LINE__, f, ## __VA_ARGS__); } } while (0);
 #else
 	#define DBG_printf(f, ...)			;
 	#define DBG_ERR_printf(f, ...)		;
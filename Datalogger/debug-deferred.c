@@ -0,0 +1,241 @@
+/*
+ * File:   debug-deferred.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:55 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Drain into whatever room the UART ring has.
+ * 17 Oct 2026	agent	Arguments stop at the first one which doesn't fit.
+ * 17 Oct 2026	agent	Only built with DEBUG_UART_DEFERRED, to save the RAM.
+ * 17 Oct 2026	agent	Drain whole records only, so other UART output can't
+ *						land in the middle of one.
+ *
+ * @file
+ * Deferred debug logging.
+ */
+
+#include <stdarg.h>
+
+#include "types.h"
+#include "hardware.h"
+
+#ifdef HARDWARE_HOST
+	#include <stdio.h>
+#else
+	#include "uart-dma.h"
+#endif
+
+#include "debug-common.h"
+#include "debug-deferred.h"
+
+// The ring is left out of builds which don't use it, except on the host, where
+// the code is compiled with everything else.
+#if defined(DEBUG_UART_DEFERRED) || defined(HARDWARE_HOST)
+
+uint8_t DBG_DeferredBuffer[DBG_DEFER_BUFFER_SIZE];
+uint16_t DBG_DeferredStart = 0;		/// Index of the first queued byte.
+uint16_t DBG_DeferredEnd = 0;		/// Index after the last queued byte.
+uint16_t DBG_DeferredDropped = 0;
+uint16_t DBG_DeferredUnreported = 0;	/// Dropped records not yet reported.
+
+/**
+ * @return Free space in the ring, in bytes. One byte is always left free, so
+ * a full ring can be told apart from an empty one.
+ */
+static uint16_t DBG_Deferred_GetFree() {
+	if (DBG_DeferredEnd >= DBG_DeferredStart) {
+		return DBG_DEFER_BUFFER_SIZE - 1 - (DBG_DeferredEnd - DBG_DeferredStart);
+	} else {
+		return DBG_DeferredStart - DBG_DeferredEnd - 1;
+	}
+}
+
+/**
+ * Copies a complete record into the ring, or counts it as dropped.
+ * @return Whether the record was queued.
+ */
+static uint8_t DBG_Deferred_Queue(uint8_t *record, uint8_t len) {
+	uint8_t i;
+
+	if (DBG_Deferred_GetFree() < len) {
+		if (DBG_DeferredDropped != 0xffff) {
+			DBG_DeferredDropped++;
+		}
+		if (DBG_DeferredUnreported != 0xffff) {
+			DBG_DeferredUnreported++;
+		}
+		return 0;
+	}
+	for (i=0;i<len;i++) {
+		DBG_DeferredBuffer[DBG_DeferredEnd] = record[i];
+		DBG_DeferredEnd++;
+		if (DBG_DeferredEnd >= DBG_DEFER_BUFFER_SIZE) {
+			DBG_DeferredEnd = 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Fills in a record header.
+ */
+static void DBG_Deferred_WriteHeader(uint8_t *record, uint8_t len, uint8_t level,
+		uint16_t line, uint32_t hash) {
+	record[0] = DBG_DEFER_START;
+	record[1] = len - 2;
+	record[2] = level;
+	record[3] = line & 0xff;
+	record[4] = (line >> 8) & 0xff;
+	record[5] = hash & 0xff;
+	record[6] = (hash >> 8) & 0xff;
+	record[7] = (hash >> 16) & 0xff;
+	record[8] = (hash >> 24) & 0xff;
+}
+
+void DBG_Deferred(uint8_t level, uint16_t line, const char *f, ...) {
+	uint8_t record[DBG_DEFER_MAX_RECORD];
+	uint8_t len = DBG_DEFER_HEADER_LEN;
+	uint32_t hash = DBG_DEFER_HASH_INIT;
+	va_list args;
+
+	// Report dropped records first, so the count lands where they were lost
+	if (DBG_DeferredUnreported != 0 && DBG_Deferred_GetFree() >= DBG_DEFER_HEADER_LEN + 2) {
+		uint8_t dropped[DBG_DEFER_HEADER_LEN + 2];
+		DBG_Deferred_WriteHeader(dropped, sizeof(dropped), DBG_DEFER_LEVEL_DROPPED, 0, 0);
+		dropped[DBG_DEFER_HEADER_LEN] = DBG_DeferredUnreported & 0xff;
+		dropped[DBG_DEFER_HEADER_LEN + 1] = (DBG_DeferredUnreported >> 8) & 0xff;
+		DBG_Deferred_Queue(dropped, sizeof(dropped));
+		DBG_DeferredUnreported = 0;
+	}
+
+	// Walk the format string, hashing it and copying out the arguments
+	va_start(args, f);
+	while (*f != 0) {
+		uint8_t isLong = 0;
+		uint8_t precision = DBG_DEFER_MAX_STRING;
+
+		hash = DBG_Deferred_Hash(hash, *f);
+		if (*f != '%') {
+			f++;
+			continue;
+		}
+		f++;
+		// Flags, width and precision
+		while (*f == '-' || *f == '+' || *f == ' ' || *f == '#' || *f == '0'
+				|| (*f >= '1' && *f <= '9')) {
+			hash = DBG_Deferred_Hash(hash, *f);
+			f++;
+		}
+		if (*f == '.') {
+			hash = DBG_Deferred_Hash(hash, *f);
+			f++;
+			precision = 0;
+			while (*f >= '0' && *f <= '9') {
+				precision = precision * 10 + (*f - '0');
+				hash = DBG_Deferred_Hash(hash, *f);
+				f++;
+			}
+			if (precision > DBG_DEFER_MAX_STRING) {
+				precision = DBG_DEFER_MAX_STRING;
+			}
+		}
+		// Length modifiers
+		while (*f == 'l' || *f == 'h') {
+			if (*f == 'l') {
+				isLong = 1;
+			}
+			hash = DBG_Deferred_Hash(hash, *f);
+			f++;
+		}
+		if (*f == 0) {
+			break;
+		}
+		hash = DBG_Deferred_Hash(hash, *f);
+
+		// Arguments are only decoded in order, so once one is left out, the
+		// rest are too, though the format string is still hashed
+		if (*f == '%' || (level & DBG_DEFER_TRUNCATED)) {
+			// Literal percent sign, no argument, or an argument left out
+		} else if (*f == 's') {
+			const char *s = va_arg(args, const char*);
+			uint8_t i, sLen;
+
+			for (sLen=0;sLen<precision && s[sLen] != 0;sLen++);
+			if (len + sLen + 1 > DBG_DEFER_MAX_RECORD) {
+				level |= DBG_DEFER_TRUNCATED;
+			} else {
+				for (i=0;i<sLen;i++) {
+					record[len++] = s[i];
+				}
+				record[len++] = 0;
+			}
+		} else if (isLong) {
+			uint32_t value = va_arg(args, unsigned long);
+
+			if (len + 4 > DBG_DEFER_MAX_RECORD) {
+				level |= DBG_DEFER_TRUNCATED;
+			} else {
+				record[len++] = value & 0xff;
+				record[len++] = (value >> 8) & 0xff;
+				record[len++] = (value >> 16) & 0xff;
+				record[len++] = (value >> 24) & 0xff;
+			}
+		} else {
+			uint16_t value = va_arg(args, unsigned int);
+
+			if (len + 2 > DBG_DEFER_MAX_RECORD) {
+				level |= DBG_DEFER_TRUNCATED;
+			} else {
+				record[len++] = value & 0xff;
+				record[len++] = (value >> 8) & 0xff;
+			}
+		}
+		f++;
+	}
+	va_end(args);
+
+	DBG_Deferred_WriteHeader(record, len, level, line, hash);
+	DBG_Deferred_Queue(record, len);
+	DBG_Deferred_Tasks();
+}
+
+void DBG_Deferred_Tasks() {
+	// Other code writes to the UART between calls (CAN lines, stream packets),
+	// so records are only moved whole, or dbg-expand would lose sync
+	while (DBG_DeferredStart != DBG_DeferredEnd) {
+		uint8_t record[DBG_DEFER_MAX_RECORD];
+		uint16_t pos = DBG_DeferredStart;
+		uint8_t len, i;
+
+		// The length follows the start byte, and the ring only holds whole records
+		pos++;
+		if (pos >= DBG_DEFER_BUFFER_SIZE) {
+			pos = 0;
+		}
+		len = DBG_DeferredBuffer[pos] + 2;
+#ifndef HARDWARE_HOST
+		if (len > UART_DMA_GetFree()) {
+			return;		// UART ring full, try again later
+		}
+#endif
+		pos = DBG_DeferredStart;
+		for (i=0;i<len;i++) {
+			record[i] = DBG_DeferredBuffer[pos];
+			pos++;
+			if (pos >= DBG_DEFER_BUFFER_SIZE) {
+				pos = 0;
+			}
+		}
+#ifdef HARDWARE_HOST
+		fwrite(record, 1, len, stderr);
+#else
+		UART_DMA_WriteAtomic((char*)record, len);
+#endif
+		DBG_DeferredStart = pos;
+	}
+}
+
+#endif
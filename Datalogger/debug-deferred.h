@@ -0,0 +1,104 @@
+/*
+ * File:   debug-deferred.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:55 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Records are only drained whole.
+ *
+ * @file
+ * Deferred debug logging. With DEBUG_UART_DEFERRED, the DBG_*printf macros
+ * store a binary record instead of formatting the message: the message level,
+ * the source line, a hash of the format string (which identifies it) and the
+ * raw arguments. Records go into a RAM ring which is drained into the UART DMA
+ * buffer without blocking, and are expanded into text on the host by
+ * dbg-expand, which finds the format strings in the source. This keeps the
+ * debug build timing close to the release build.
+ *
+ * Records which don't fit in the ring are dropped and counted, and the count
+ * is sent as a record of its own once there is room.
+ *
+ * Record, multi-byte fields little-endian:
+ *   [0x00] Start byte, which never appears in the text output.
+ *   [length] Number of bytes following.
+ *   [level] DBG_DEFER_LEVEL_*, with DBG_DEFER_TRUNCATED set if arguments
+ *     were left out because the record was full.
+ *   [line, 2 bytes]
+ *   [format hash, 4 bytes] See DBG_Deferred_Hash.
+ *   [arguments] In format order: 2 bytes for int sized conversions (%d, %u,
+ *     %x, %c and the like), 4 bytes for long (%l*) conversions, and strings
+ *     (%s) copied with a terminating null, up to the precision if one is given,
+ *     and at most DBG_DEFER_MAX_STRING characters.
+ * A dropped records record has level DBG_DEFER_LEVEL_DROPPED, line and hash 0
+ * and a 2 byte count.
+ */
+
+#ifndef DEBUG_DEFERRED_H
+#define DEBUG_DEFERRED_H
+
+#include "types.h"
+
+#define DBG_DEFER_START				0x00	/// Record start byte.
+#define DBG_DEFER_HEADER_LEN		9		/// Start byte to the end of the format hash.
+
+#define DBG_DEFER_LEVEL_INFO		0
+#define DBG_DEFER_LEVEL_ERR			1
+#define DBG_DEFER_LEVEL_DATA		2
+#define DBG_DEFER_LEVEL_SPAM		3
+#define DBG_DEFER_LEVEL_DROPPED		4
+#define DBG_DEFER_LEVEL_MASK		0x0f
+#define DBG_DEFER_TRUNCATED			0x80	/// Level flag, arguments were left out.
+
+#define DBG_DEFER_HASH_INIT			5381	/// Initial format hash value.
+
+/**
+ * Longest record, including the header.
+ */
+#define DBG_DEFER_MAX_RECORD		64
+
+/**
+ * Longest string argument copied into a record.
+ */
+#define DBG_DEFER_MAX_STRING		32
+
+/**
+ * Size of the RAM ring records are queued in before going to the UART.
+ */
+#ifndef DBG_DEFER_BUFFER_SIZE
+	#define DBG_DEFER_BUFFER_SIZE	512
+#endif
+
+/**
+ * Adds a format string character to the hash.
+ * @param hash Hash so far, DBG_DEFER_HASH_INIT to start.
+ * @param c Next character.
+ * @return The new hash.
+ */
+#define DBG_Deferred_Hash(hash, c)	(((hash) * 33) ^ (uint8_t)(c))
+
+/**
+ * Number of records dropped because the ring was full, since power on.
+ */
+extern uint16_t DBG_DeferredDropped;
+
+/**
+ * Queues a record, or drops it if there is no room. Use the DBG_*printf
+ * macros instead of calling this directly.
+ *
+ * @param level DBG_DEFER_LEVEL_*.
+ * @param line Source line.
+ * @param f printf format string.
+ */
+void DBG_Deferred(uint8_t level, uint16_t line, const char *f, ...);
+
+/**
+ * Moves queued records into the UART ring, as many whole records as fit.
+ * This is also done after queueing each record, but should be called
+ * periodically so the ring drains while nothing is being logged.
+ */
+void DBG_Deferred_Tasks();
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ * File:   debug-host.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:59 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Debugging console for the host build, which prints to stderr.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "hardware.h"
+
+#ifdef HARDWARE_HOST
+
+#define DEBUG_UART
+#include "debug-common.h"
+
+void DBG_Host_printf(const char *prefix, uint16_t line, const char *f, ...) {
+	char format[DBG_BUFFER_SIZE];
+	uint16_t len = 0;
+	uint8_t conversion = 0;
+	va_list args;
+
+	// Copy the format, dropping the l length modifiers
+	for (;*f != 0 && len < sizeof(format) - 1;f++) {
+		if (conversion && *f == 'l') {
+			continue;
+		}
+		format[len++] = *f;
+		if (*f == '%') {
+			conversion = !conversion;		// %% is a literal percent sign
+		} else if (conversion && ((*f >= 'a' && *f <= 'z') || (*f >= 'A' && *f <= 'Z'))) {
+			conversion = 0;
+		}
+	}
+	format[len] = 0;
+
+	fprintf(stderr, "%s %u: ", prefix, line);
+	va_start(args, f);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+#endif
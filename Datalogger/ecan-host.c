@@ -0,0 +1,658 @@
+/*
+ * File:   ecan-host.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 5:20 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Masking the receive interrupt.
+ *
+ * @file
+ * ECAN functions for the host build, running against an emulated ECAN module.
+ * Buffers use the same layout as the hardware DMA buffers, and the acceptance
+ * filters, masks and RX FIFO behave as on the dsPIC33F.
+ */
+
+#include <string.h>
+
+#include "ecan.h"
+#include "ecan-host.h"
+#include "hardware.h"
+#include "timing.h"
+
+#ifdef HARDWARE_HOST
+
+/*
+ * Variables
+ */
+
+uint16_t ECANMsgBuf[ECAN_NUM_BUFFERS][ECAN_BUFFER_WORDS];
+
+volatile uint16_t C1RXFUL1;
+volatile uint16_t C1RXFUL2;
+volatile uint16_t C1RXOVF1;
+volatile uint16_t C1RXOVF2;
+volatile C1TR01CONBITS C1TR01CONbits;
+volatile C1FCTRLBITS C1FCTRLbits;
+
+ECAN_Host_Statistics ECAN_Host_Stats;
+
+#ifdef ECAN_RX_INTERRUPT
+ECAN_RXFrame ECAN_RXQueue[ECAN_RX_QUEUE_SIZE];
+volatile uint8_t ECAN_RXQueueHead = 0;	/// Count of frames put in the queue, only modified by the ISR.
+volatile uint8_t ECAN_RXQueueTail = 0;	/// Count of frames taken from the queue, only modified by the user program.
+volatile uint8_t ECAN_RXLost = 0;		/// Count of overflow events, only modified by the ISR.
+uint8_t ECAN_RXLostSeen = 0;			/// Value of ECAN_RXLost at the last ECAN_CheckRXOverflow.
+static uint64_t ECAN_RXQueueArrival[ECAN_RX_QUEUE_SIZE];	/// Bus arrival time of each queued frame.
+#endif
+
+/**
+ * Emulated module state.
+ */
+static struct {
+	eECANMode mode;
+
+	uint16_t filterSID[16];		/// Filter SID bits.
+	uint8_t filterMask[16];		/// Mask used by each filter.
+	uint8_t filterBuffer[16];	/// Buffer each filter directs frames to.
+	uint16_t filterEnable;		/// Enabled filters, as C1FEN1.
+	uint16_t maskSID[3];		/// Mask SID bits.
+
+	uint8_t fifoWrite;			/// Next FIFO buffer to be written.
+	uint64_t arrival[ECAN_NUM_BUFFERS];	/// Arrival time of the frame in each buffer.
+
+	ECAN_Host_FrameSource source;
+	void *context;
+	ECAN_Host_Frame next;		/// Next frame from the source.
+	uint8_t nextValid;			/// Whether next holds a frame.
+
+	uint32_t frameCostNs;		/// CPU time charged per frame read.
+	uint8_t rxInterrupt;		/// Whether the receive interrupt is enabled.
+} ECAN_Host;
+
+/*
+ * Emulator
+ */
+
+void ECAN_Host_SetSource(ECAN_Host_FrameSource source, void *context) {
+	ECAN_Host.source = source;
+	ECAN_Host.context = context;
+	ECAN_Host.nextValid = 0;
+}
+
+void ECAN_Host_SetFrameCost(uint32_t ns) {
+	ECAN_Host.frameCostNs = ns;
+}
+
+/**
+ * @return Whether a receive buffer is full.
+ */
+static uint8_t ECAN_Host_IsFull(uint8_t buffer) {
+	if (buffer > 15) {
+		return (C1RXFUL2 >> (buffer - 16)) & 1;
+	} else {
+		return (C1RXFUL1 >> buffer) & 1;
+	}
+}
+
+/**
+ * Copies a frame out of a receive buffer and clears its 'full' bit.
+ *
+ * @return Number of payload bytes read.
+ */
+static uint8_t ECAN_Host_ReadRaw(uint8_t buffer, uint16_t *sid, uint8_t dlc, uint8_t *data) {
+	uint16_t *canBuffer = &(ECANMsgBuf[buffer][0]);
+	uint8_t *canPayloadBuffer = (uint8_t*)(canBuffer + 3);
+	uint8_t i, payload;
+
+	if (sid != 0) {
+		*sid = (canBuffer[0] >> 2) & 0b11111111111;
+	}
+
+	payload = canBuffer[2] & 0b1111;
+	if (payload > 8) {
+		payload = 8;
+	}
+	if (dlc > payload) {
+		dlc = payload;
+	}
+	for (i=0; i<dlc; i++) {
+		data[i] = canPayloadBuffer[i];
+	}
+
+	// clear 'full' bit
+	if (buffer > 15) {
+		C1RXFUL2 = C1RXFUL2 & ~(0b1 << (buffer - 16));
+	} else {
+		C1RXFUL1 = C1RXFUL1 & ~(0b1 << buffer);
+	}
+
+	return dlc;
+}
+
+/**
+ * Records the main loop reading a frame which arrived at a given time.
+ */
+static void ECAN_Host_CountRead(uint64_t arrival) {
+	uint64_t latency = Host_Clock - arrival;
+	ECAN_Host_Stats.Read++;
+	ECAN_Host_Stats.LatencyNs += latency;
+	if (latency > ECAN_Host_Stats.MaxLatencyNs) {
+		ECAN_Host_Stats.MaxLatencyNs = latency;
+	}
+}
+
+#ifdef ECAN_RX_INTERRUPT
+/**
+ * Runs the receive ISR, as it would have run when a frame arrived. The
+ * virtual clock is wound back to the arrival time while the ISR runs, then
+ * the ISR's CPU time is charged to the interrupted code.
+ *
+ * @param time Arrival time.
+ */
+static void ECAN_Host_Interrupt(uint64_t time) {
+	uint64_t now = Host_Clock;
+	uint8_t buffer, queued;
+
+	Host_Clock = time;
+
+	if ((C1RXOVF1 != 0) || (C1RXOVF2 != 0)) {
+		C1RXOVF1 = 0;
+		C1RXOVF2 = 0;
+		ECAN_RXLost++;
+	}
+
+	for (buffer=0;buffer<ECAN_NUM_BUFFERS;buffer++) {
+		uint8_t head = ECAN_RXQueueHead;
+		if (!ECAN_Host_IsFull(buffer)) {
+			continue;
+		}
+		if ((uint8_t)(head - ECAN_RXQueueTail) >= ECAN_RX_QUEUE_SIZE) {
+			ECAN_Host_ReadRaw(buffer, 0, 0, 0);
+			ECAN_RXLost++;
+			ECAN_Host_Stats.Dropped++;
+		} else {
+			ECAN_RXFrame *frame = &ECAN_RXQueue[head & (ECAN_RX_QUEUE_SIZE - 1)];
+			frame->Time = Get32bitTime();
+			frame->DLC = ECAN_Host_ReadRaw(buffer, &frame->SID, 8, frame->Data);
+			ECAN_RXQueueArrival[head & (ECAN_RX_QUEUE_SIZE - 1)] = ECAN_Host.arrival[buffer];
+			ECAN_RXQueueHead = head + 1;
+		}
+	}
+
+	queued = ECAN_RXQueueHead - ECAN_RXQueueTail;
+	if (queued > ECAN_Host_Stats.MaxQueued) {
+		ECAN_Host_Stats.MaxQueued = queued;
+	}
+
+	Host_Clock = now;
+	Host_AdvanceClock(ECAN_HOST_ISR_NS);
+}
+#endif
+
+/**
+ * Runs a frame through the acceptance filters and stores it.
+ */
+static void ECAN_Host_Receive(ECAN_Host_Frame *frame) {
+	uint16_t *canBuffer;
+	uint8_t *canPayloadBuffer;
+	uint8_t i, buffer, full;
+
+	ECAN_Host_Stats.Received++;
+	if (ECAN_Host.mode != ECAN_MODE_OPERATE && ECAN_Host.mode != ECAN_MODE_LISTEN
+			&& ECAN_Host.mode != ECAN_MODE_LISTENALL) {
+		return;
+	}
+
+	// Acceptance filtering, the lowest numbered matching filter wins
+	for (i=0;i<16;i++) {
+		if ((ECAN_Host.filterEnable >> i) & 1) {
+			uint16_t mask = ECAN_Host.maskSID[ECAN_Host.filterMask[i]];
+			if (((frame->SID ^ ECAN_Host.filterSID[i]) & mask) == 0) {
+				break;
+			}
+		}
+	}
+	if (i == 16) {
+		ECAN_Host_Stats.Filtered++;
+		return;
+	}
+
+	buffer = ECAN_Host.filterBuffer[i];
+	if (buffer == ECAN_FILTER_FIFO) {
+		buffer = ECAN_Host.fifoWrite;
+	}
+	if (buffer >= ECAN_NUM_BUFFERS) {
+		ECAN_Host_Stats.Filtered++;
+		return;
+	}
+
+	if (ECAN_Host_IsFull(buffer)) {
+		if (buffer > 15) {
+			C1RXOVF2 |= 1 << (buffer - 16);
+		} else {
+			C1RXOVF1 |= 1 << buffer;
+		}
+		ECAN_Host_Stats.Overflows++;
+		return;
+	}
+
+	// Store in the hardware buffer layout
+	canBuffer = &(ECANMsgBuf[buffer][0]);
+	canPayloadBuffer = (uint8_t*)(canBuffer + 3);
+	canBuffer[0] = frame->SID << 2;
+	canBuffer[1] = 0;
+	canBuffer[2] = frame->DLC;
+	for (i=0;i<frame->DLC && i<8;i++) {
+		canPayloadBuffer[i] = frame->Data[i];
+	}
+	ECAN_Host.arrival[buffer] = frame->Time;
+
+	if (buffer > 15) {
+		C1RXFUL2 |= 1 << (buffer - 16);
+	} else {
+		C1RXFUL1 |= 1 << buffer;
+	}
+	if (buffer == ECAN_Host.fifoWrite) {
+		ECAN_Host.fifoWrite++;
+		if (ECAN_Host.fifoWrite >= ECAN_NUM_BUFFERS) {
+			ECAN_Host.fifoWrite = C1FCTRLbits.FSA;
+		}
+	}
+
+	full = 0;
+	for (i=0;i<ECAN_NUM_BUFFERS;i++) {
+		full += ECAN_Host_IsFull(i);
+	}
+	if (full > ECAN_Host_Stats.MaxFull) {
+		ECAN_Host_Stats.MaxFull = full;
+	}
+
+#ifdef ECAN_RX_INTERRUPT
+	if (ECAN_Host.rxInterrupt) {
+		ECAN_Host_Interrupt(frame->Time);
+	}
+#endif
+}
+
+void ECAN_Host_Update() {
+	while (ECAN_Host.source != NULL) {
+		if (!ECAN_Host.nextValid) {
+			ECAN_Host.nextValid = ECAN_Host.source(ECAN_Host.context, &ECAN_Host.next);
+			if (!ECAN_Host.nextValid) {
+				ECAN_Host.source = NULL;
+				break;
+			}
+		}
+		if (ECAN_Host.next.Time > Host_Clock) {
+			break;
+		}
+		ECAN_Host_Receive(&ECAN_Host.next);
+		ECAN_Host.nextValid = 0;
+	}
+}
+
+uint16_t ECAN_Host_GetFrameBits(uint16_t sid, uint8_t dlc, const uint8_t *data) {
+	uint8_t bits[19 + 64 + 15];
+	uint8_t i, numBits = 0, last = 2, run = 0, stuffed = 0;
+	uint16_t crc = 0;
+
+	if (dlc > 8) {
+		dlc = 8;
+	}
+
+	// SOF, identifier, RTR, IDE, r0, DLC, data
+	bits[numBits++] = 0;
+	for (i=0;i<11;i++) {
+		bits[numBits++] = (sid >> (10 - i)) & 1;
+	}
+	bits[numBits++] = 0;
+	bits[numBits++] = 0;
+	bits[numBits++] = 0;
+	for (i=0;i<4;i++) {
+		bits[numBits++] = (dlc >> (3 - i)) & 1;
+	}
+	for (i=0;i<dlc*8;i++) {
+		bits[numBits++] = (data[i/8] >> (7 - i%8)) & 1;
+	}
+
+	// CRC-15
+	for (i=0;i<numBits;i++) {
+		uint8_t crcNext = bits[i] ^ ((crc >> 14) & 1);
+		crc = (crc << 1) & 0x7fff;
+		if (crcNext) {
+			crc ^= 0x4599;
+		}
+	}
+	for (i=0;i<15;i++) {
+		bits[numBits++] = (crc >> (14 - i)) & 1;
+	}
+
+	// Stuff bits are inserted after 5 equal bits, from SOF to the end of the CRC
+	for (i=0;i<numBits;i++) {
+		if (bits[i] == last) {
+			run++;
+		} else {
+			last = bits[i];
+			run = 1;
+		}
+		if (run == 5) {
+			stuffed++;
+			last = !last;
+			run = 1;
+		}
+	}
+
+	// CRC delimiter, ACK slot and delimiter, EOF, intermission
+	return numBits + stuffed + 1 + 2 + 7 + 3;
+}
+
+/*
+ * ECAN functions
+ */
+
+/**
+ * Initializes ECAN.
+ * Next step is to configure it.
+ */
+void ECAN_Init() {
+	memset(ECANMsgBuf, 0, sizeof(ECANMsgBuf));
+	memset(ECAN_Host.filterSID, 0, sizeof(ECAN_Host.filterSID));
+	memset(ECAN_Host.filterMask, 0, sizeof(ECAN_Host.filterMask));
+	memset(ECAN_Host.filterBuffer, 0, sizeof(ECAN_Host.filterBuffer));
+	memset(ECAN_Host.maskSID, 0, sizeof(ECAN_Host.maskSID));
+	ECAN_Host.filterEnable = 0;
+	ECAN_Host.mode = ECAN_MODE_CONFIG;
+	ECAN_Host.rxInterrupt = 0;
+	C1RXFUL1 = 0;
+	C1RXFUL2 = 0;
+	C1RXOVF1 = 0;
+	C1RXOVF2 = 0;
+	memset((void*)&C1TR01CONbits, 0, sizeof(C1TR01CONbits));
+}
+
+/**
+ * Configures the ECAN module.
+ */
+void ECAN_Config() {
+	ECAN_SetMode(ECAN_MODE_CONFIG);
+	C1FCTRLbits.DMABS = ECAN_DMABS;
+}
+
+/**
+ * Requests a mode change in the ECAN module.
+ *
+ * @param[in] mode Target mode
+ */
+void ECAN_SetMode(eECANMode mode) {
+	ECAN_Host_Update();
+	ECAN_Host.mode = mode;
+	ECAN_Host.fifoWrite = C1FCTRLbits.FSA;
+}
+
+/**
+ * Sets a ECAN filter
+ *
+ * @param[in] filNum Filter number to set. (0-15)
+ * @param[in] sidFilter SID filter bits.
+ * @param[in] maskNum Mask number to use. (0-2)
+ * @param[in] bufNum Buffer number to store filter hit CAN frames into,
+ *		or use ECAN_FILTER_FIFO (15) to store into RX FIFO buffer.
+ */
+int8_t ECAN_SetStandardFilter(uint8_t filNum, uint16_t sidFilter, uint8_t maskNum, uint8_t bufNum) {
+	// Sanity checks
+	if (filNum > 15) {
+		return -1;
+	} else if (maskNum > 2) {
+		return -2;
+	} else if (bufNum > 15) {
+		return -3;
+	} else if (sidFilter > 0b11111111111) {
+		return -4;
+	}
+
+	ECAN_Host.filterSID[filNum] = sidFilter;
+	ECAN_Host.filterMask[filNum] = maskNum;
+	ECAN_Host.filterBuffer[filNum] = bufNum;
+	ECAN_Host.filterEnable |= 1 << filNum;
+
+	return 1;
+}
+
+/**
+ * Sets a ECAN mask.
+ *
+ * @param[in] maskNum Mask number to set. (0-2)
+ * @param[in] sidFilter SID filter bits.
+ */
+int8_t ECAN_SetStandardMask(uint8_t maskNum,  uint16_t sidFilter) {
+	// Sanity checks
+	if (maskNum > 2) {
+		return -1;
+	} else if (sidFilter > 0b11111111111) {
+		return -2;
+	}
+
+	ECAN_Host.maskSID[maskNum] = sidFilter;
+
+	return 1;
+}
+
+/**
+ * Disables the specified ECAN filter.
+ *
+ * @param[in] filNum Filter number to disable. (0-15)
+ */
+void ECAN_DisableFilter(uint8_t filNum) {
+	ECAN_Host.filterEnable &= ~(1 << filNum);
+}
+
+/**
+ * Initializes (and enables) DMA for ECAN.
+ */
+void ECAN_SetupDMA() {
+}
+
+/**
+ * Scans for and returns the number of the next full RX buffer.
+ *
+ * @returns The number of the next full RX buffer.
+ * @retval -1 All buffers are empty.
+ */
+int8_t ECAN_GetNextRXBuffer() {
+	uint8_t i;
+
+	ECAN_Host_Update();
+	for (i=0;i<ECAN_NUM_BUFFERS;i++) {
+		if (ECAN_Host_IsFull(i)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Loads a CAN frame into a buffer for transmission. Transmitted frames are
+ * not put on the emulated bus.
+ *
+ * @param[in] buffer Buffer number to load data into.
+ * @param[in] sid Standard ID of the CAN frame.
+ * @param[in] dlc ("Data Length Code") Length of CAN frame payload.
+ * @param[in] data Pointer to data[0].
+ *
+ * @returns 1 on success, or negative number on error.
+ */
+int8_t ECAN_WriteStandardBuffer(uint8_t buffer,
+	uint16_t sid, uint8_t dlc, uint8_t *data) {
+	uint16_t *canBuffer = &(ECANMsgBuf[buffer][0]);
+	uint8_t *canPayloadBuffer = (uint8_t*)(canBuffer + 3);
+	uint8_t i;
+
+	if (buffer >= ECAN_NUM_BUFFERS) {
+		return -1;
+	} else if (sid > 2047) {
+		return -2;
+	} else if (dlc > 8) {
+		return -3;
+	} else if ((dlc != 0) && (data == 0)) {
+		return -4;
+	}
+
+	canBuffer[0] = sid << 2;
+	canBuffer[2] = dlc;
+	for (i=0;i<dlc;i++) {
+		canPayloadBuffer[i] = data[i];
+	}
+
+	return 1;
+}
+
+/**
+ * Reads a CAN buffer. This automatically clears the 'buffer full' bit, and
+ * charges the per-frame CPU time to the virtual clock.
+ *
+ * @param[in] buffer Buffer number to read from. (0-31)
+ * @param[in] dlc Maximum number of bytes to read from payload.
+ *
+ * @param[out] sid Pointer to location to store the Standard ID of the CAN frame in the buffer.
+ *		Set pointer to 0 to ignore this field.
+ * @param[out] eid Pointer to location to store the Extended ID of the CAN frame in the buffer.
+ *		Always -1, the emulator only carries standard frames.
+ *		Set pointer to 0 to ignore this field.
+ * @param[out] data Pointer to location to store payload.
+ *		Up to a maximum of @a DLC bytes are stored.
+ *
+ * @returns Number of bytes read from payload
+ */
+int8_t ECAN_ReadBuffer(uint8_t buffer, uint16_t *sid, uint32_t *eid,
+	uint8_t dlc, uint8_t *data) {
+	if (buffer >= ECAN_NUM_BUFFERS) {
+		return -1;
+	}
+
+	if (ECAN_Host_IsFull(buffer)) {
+		ECAN_Host_CountRead(ECAN_Host.arrival[buffer]);
+	}
+	if (eid != 0) {
+		*eid = -1;
+	}
+	dlc = ECAN_Host_ReadRaw(buffer, sid, dlc, data);
+
+	Host_AdvanceClock(ECAN_Host.frameCostNs);
+
+	return dlc;
+}
+
+/**
+ * Requests transmission of ECAN buffer @a buffer. Transmission always
+ * succeeds immediately.
+ *
+ * @param buffer Buffer number to transmit.
+ *
+ * @returns 1 on success, negative on failure.
+ */
+uint8_t ECAN_TransmitBuffer(uint8_t buffer) {
+	if (buffer > 7) {
+		return -1;
+	}
+	return 1;
+}
+
+#ifdef ECAN_RX_INTERRUPT
+/*
+ * Interrupt-driven receive
+ */
+
+/**
+ * Enables the ECAN receive interrupt. After this, received frames should only
+ * be read through ECAN_PeekRXFrame and ECAN_PopRXFrame.
+ */
+void ECAN_EnableRXInterrupt() {
+	ECAN_RXQueueHead = 0;
+	ECAN_RXQueueTail = 0;
+	ECAN_RXLost = 0;
+	ECAN_RXLostSeen = 0;
+	ECAN_Host.rxInterrupt = 1;
+}
+
+/**
+ * Masks the ECAN receive interrupt. Frames received in the meantime stay in
+ * the receive buffers until the interrupt is restored.
+ *
+ * @returns Whether the interrupt was enabled, to pass to ECAN_RestoreRXInterrupt.
+ */
+uint8_t ECAN_DisableRXInterrupt() {
+	uint8_t enabled = ECAN_Host.rxInterrupt;
+
+	ECAN_Host_Update();
+	ECAN_Host.rxInterrupt = 0;
+	return enabled;
+}
+
+/**
+ * Restores the ECAN receive interrupt after ECAN_DisableRXInterrupt. The
+ * interrupt is taken at once if frames arrived while it was masked.
+ *
+ * @param enabled Whether the interrupt was enabled.
+ */
+void ECAN_RestoreRXInterrupt(uint8_t enabled) {
+	uint8_t i;
+
+	ECAN_Host_Update();
+	ECAN_Host.rxInterrupt = enabled;
+	for (i=0;i<ECAN_NUM_BUFFERS;i++) {
+		if (enabled && ECAN_Host_IsFull(i)) {
+			ECAN_Host_Interrupt(Host_Clock);
+			break;
+		}
+	}
+}
+
+/**
+ * Returns the oldest frame in the receive queue, without removing it.
+ * The frame stays valid until ECAN_PopRXFrame is called.
+ *
+ * @returns Pointer to the oldest frame.
+ * @retval NULL The queue is empty.
+ */
+ECAN_RXFrame* ECAN_PeekRXFrame() {
+	uint8_t tail = ECAN_RXQueueTail;
+
+	ECAN_Host_Update();
+	if (ECAN_RXQueueHead == tail) {
+		return NULL;
+	}
+	return &ECAN_RXQueue[tail & (ECAN_RX_QUEUE_SIZE - 1)];
+}
+
+/**
+ * Removes the oldest frame from the receive queue, and charges the per-frame
+ * CPU time to the virtual clock.
+ */
+void ECAN_PopRXFrame() {
+	if (ECAN_RXQueueHead != ECAN_RXQueueTail) {
+		ECAN_Host_CountRead(ECAN_RXQueueArrival[ECAN_RXQueueTail & (ECAN_RX_QUEUE_SIZE - 1)]);
+		ECAN_RXQueueTail++;
+		Host_AdvanceClock(ECAN_Host.frameCostNs);
+	}
+}
+
+/**
+ * Checks whether any frames were lost since the last call, either to a
+ * hardware buffer overflow or to a full receive queue.
+ *
+ * @returns Whether frames were lost.
+ */
+uint8_t ECAN_CheckRXOverflow() {
+	uint8_t lost = ECAN_RXLost;
+	if (lost != ECAN_RXLostSeen) {
+		ECAN_RXLostSeen = lost;
+		return 1;
+	}
+	return 0;
+}
+#endif
+
+#endif
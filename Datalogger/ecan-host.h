@@ -0,0 +1,107 @@
+/*
+ * File:   ecan-host.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 5:05 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Host-only interface to the emulated ECAN module, which replaces ecan.c on
+ * host builds. Received frames come from a frame source supplied by the host
+ * harness, each with the virtual time at which it finishes on the bus.
+ *
+ * Frames are delivered lazily: whenever the firmware looks at the receive
+ * buffers, every frame which has arrived by the current virtual time is first
+ * run through the acceptance filters into its buffer (or the FIFO), setting
+ * the overflow flags when the target buffer is still full, as the hardware
+ * would have done in the background. When the receive interrupt is enabled,
+ * the ISR also runs for each frame at its arrival time, so the frames in the
+ * receive queue carry the time they arrived.
+ */
+
+#ifndef ECAN_HOST_H
+#define ECAN_HOST_H
+
+#include "types.h"
+
+/**
+ * Simulated CPU time of one run of the receive ISR, in nanoseconds.
+ */
+#define ECAN_HOST_ISR_NS	5000
+
+/**
+ * A CAN frame on the emulated bus.
+ */
+typedef struct {
+	uint64_t Time;			/// Virtual time the frame finishes on the bus, in ns.
+	uint16_t SID;			/// Standard identifier.
+	uint8_t DLC;			/// Data length.
+	uint8_t Data[8];		/// Payload.
+} ECAN_Host_Frame;
+
+/**
+ * Frame source callback. Frames must be returned in time order.
+ *
+ * @param context Context pointer passed to ECAN_Host_SetSource.
+ * @param frame Frame to fill in.
+ * @return 1 if a frame was returned, 0 if there are no more frames.
+ */
+typedef uint8_t (*ECAN_Host_FrameSource)(void *context, ECAN_Host_Frame *frame);
+
+/**
+ * Emulator statistics, these may be reset by the user at any time.
+ */
+typedef struct {
+	uint32_t Received;		/// Frames seen on the bus.
+	uint32_t Filtered;		/// Frames rejected by the acceptance filters.
+	uint32_t Overflows;		/// Frames lost because the target buffer was full.
+	uint32_t Dropped;		/// Frames dropped by the ISR because the receive queue was full.
+	uint32_t Read;			/// Frames read by the main loop, with ECAN_ReadBuffer or ECAN_PopRXFrame.
+	uint8_t MaxFull;		/// Highest number of receive buffers full at once.
+	uint8_t MaxQueued;		/// Highest number of frames in the receive queue at once.
+
+	uint64_t LatencyNs;		/// Total time from frame arrival to the main loop reading it.
+	uint64_t MaxLatencyNs;	/// Longest time from frame arrival to the main loop reading it.
+} ECAN_Host_Statistics;
+
+extern ECAN_Host_Statistics ECAN_Host_Stats;
+
+/**
+ * Sets the source of received frames. Any frame fetched from the previous
+ * source but not yet delivered is discarded.
+ *
+ * @param source Frame source, or NULL for an idle bus.
+ * @param context Context pointer passed to the source.
+ */
+void ECAN_Host_SetSource(ECAN_Host_FrameSource source, void *context);
+
+/**
+ * Sets the simulated CPU time charged for each frame read by the main loop
+ * (with ECAN_ReadBuffer, or ECAN_PopRXFrame when receiving through the
+ * interrupt), standing in for the firmware's cost of reading, formatting and
+ * buffering a frame. The ISR is charged separately, see ECAN_HOST_ISR_NS.
+ *
+ * @param ns CPU time per frame, in nanoseconds.
+ */
+void ECAN_Host_SetFrameCost(uint32_t ns);
+
+/**
+ * Delivers every frame which has arrived by the current virtual time.
+ */
+void ECAN_Host_Update();
+
+/**
+ * Calculates the length of a standard data frame on the bus, including stuff
+ * bits and the interframe space.
+ *
+ * @param sid Standard identifier.
+ * @param dlc Data length.
+ * @param data Payload.
+ * @return Frame length, in bit times.
+ */
+uint16_t ECAN_Host_GetFrameBits(uint16_t sid, uint8_t dlc, const uint8_t *data);
+
+#endif
@@ -15,6 +15,7 @@
 
 #include "ecan.h"
 #include "hardware.h"
+#include "timing.h"
 
 /*
  * Variables
@@ -22,6 +23,17 @@
 
 uint16_t ECANMsgBuf[ECAN_NUM_BUFFERS][ECAN_BUFFER_WORDS] __attribute__((space(dma), aligned(ECAN_ALIGN)));
 
+#ifdef ECAN_RX_INTERRUPT
+ECAN_RXFrame ECAN_RXQueue[ECAN_RX_QUEUE_SIZE];
+volatile uint8_t ECAN_RXQueueHead = 0;	/// Count of frames put in the queue, the next entry to write is this modulo the queue size.
+										/// This should ONLY be modified by the ECAN ISR.
+volatile uint8_t ECAN_RXQueueTail = 0;	/// Count of frames taken from the queue, the next entry to read is this modulo the queue size.
+										/// This should ONLY be modified by the user program.
+volatile uint8_t ECAN_RXLost = 0;		/// Count of overflow events, from hardware buffer overflows or a full queue.
+										/// This should ONLY be modified by the ECAN ISR.
+uint8_t ECAN_RXLostSeen = 0;			/// Value of ECAN_RXLost at the last ECAN_CheckRXOverflow.
+#endif
+
 /**
  * Initializes ECAN.
  * Next step is to configure it.
@@ -394,3 +406,130 @@ uint8_t ECAN_TransmitBuffer(uint8_t buffer) {
 		}
 	}
 }
+
+#ifdef ECAN_RX_INTERRUPT
+/*
+ * Interrupt-driven receive
+ */
+
+/**
+ * Enables the ECAN receive interrupt. After this, received frames should only
+ * be read through ECAN_PeekRXFrame and ECAN_PopRXFrame.
+ */
+void ECAN_EnableRXInterrupt() {
+	ECAN_RXQueueHead = 0;
+	ECAN_RXQueueTail = 0;
+	ECAN_RXLost = 0;
+	ECAN_RXLostSeen = 0;
+
+	C1INTFbits.RBIF = 0;
+	C1INTFbits.RBOVIF = 0;
+	C1INTEbits.RBIE = 1;
+	C1INTEbits.RBOVIE = 1;
+	_C1IP = ECAN_RX_IPL;
+	_C1IF = 0;
+	_C1IE = 1;
+}
+
+/**
+ * Masks the ECAN receive interrupt, such as while reprogramming the filters
+ * once the interrupt is running. Frames received in the meantime stay in the
+ * receive buffers until the interrupt is restored.
+ *
+ * @returns Whether the interrupt was enabled, to pass to ECAN_RestoreRXInterrupt.
+ */
+uint8_t ECAN_DisableRXInterrupt() {
+	uint8_t enabled = _C1IE;
+	_C1IE = 0;
+	return enabled;
+}
+
+/**
+ * Restores the ECAN receive interrupt after ECAN_DisableRXInterrupt.
+ *
+ * @param enabled Whether the interrupt was enabled.
+ */
+void ECAN_RestoreRXInterrupt(uint8_t enabled) {
+	_C1IE = enabled;
+}
+
+/**
+ * Returns the oldest frame in the receive queue, without removing it.
+ * The frame stays valid until ECAN_PopRXFrame is called.
+ *
+ * @returns Pointer to the oldest frame.
+ * @retval NULL The queue is empty.
+ */
+ECAN_RXFrame* ECAN_PeekRXFrame() {
+	uint8_t tail = ECAN_RXQueueTail;
+	if (ECAN_RXQueueHead == tail) {
+		return NULL;
+	}
+	return &ECAN_RXQueue[tail & (ECAN_RX_QUEUE_SIZE - 1)];
+}
+
+/**
+ * Removes the oldest frame from the receive queue, freeing its entry for
+ * the ISR.
+ */
+void ECAN_PopRXFrame() {
+	if (ECAN_RXQueueHead != ECAN_RXQueueTail) {
+		ECAN_RXQueueTail++;
+	}
+}
+
+/**
+ * Checks whether any frames were lost since the last call, either to a
+ * hardware buffer overflow or to a full receive queue.
+ *
+ * @returns Whether frames were lost.
+ */
+uint8_t ECAN_CheckRXOverflow() {
+	uint8_t lost = ECAN_RXLost;
+	if (lost != ECAN_RXLostSeen) {
+		ECAN_RXLostSeen = lost;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * ECAN interrupt handler, moves every full receive buffer into the queue.
+ * Frames which do not fit are dropped and counted as lost.
+ * The receive buffer registers share their addresses with the filter
+ * registers, so the register window is switched back for the duration, in
+ * case the interrupted code had it open.
+ */
+void __attribute__((interrupt, no_auto_psv)) _C1Interrupt(void) {
+	int8_t buffer;
+	uint8_t win = C1CTRL1bits.WIN;
+
+	C1CTRL1bits.WIN = 0;
+
+	// Clear flags first, so a frame arriving while draining retriggers the interrupt
+	C1INTFbits.RBIF = 0;
+	C1INTFbits.RBOVIF = 0;
+	_C1IF = 0;
+
+	if ((C1RXOVF1 != 0) || (C1RXOVF2 != 0)) {
+		C1RXOVF1 = 0;
+		C1RXOVF2 = 0;
+		ECAN_RXLost++;
+	}
+
+	while ((buffer = ECAN_GetNextRXBuffer()) != -1) {
+		uint8_t head = ECAN_RXQueueHead;
+		if ((uint8_t)(head - ECAN_RXQueueTail) >= ECAN_RX_QUEUE_SIZE) {
+			ECAN_ReadBuffer(buffer, 0, 0, 0, 0);
+			ECAN_RXLost++;
+		} else {
+			ECAN_RXFrame *frame = &ECAN_RXQueue[head & (ECAN_RX_QUEUE_SIZE - 1)];
+			frame->Time = Get32bitTime();
+			frame->DLC = ECAN_ReadBuffer(buffer, &frame->SID, 0, 8, frame->Data);
+			ECAN_RXQueueHead = head + 1;
+		}
+	}
+
+	C1CTRL1bits.WIN = win;
+}
+#endif
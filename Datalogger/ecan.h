@@ -126,6 +126,46 @@
  */
 #define ECAN_FILTER_FIFO		15
 
+/**
+ * Uncomment to receive through the ECAN interrupt instead of polling the
+ * hardware buffers. The interrupt drains the hardware buffers into a software
+ * queue as frames arrive, timestamping each one, and the main loop reads
+ * frames from the queue with ECAN_PeekRXFrame and ECAN_PopRXFrame.
+ */
+#define ECAN_RX_INTERRUPT
+
+#ifdef ECAN_RX_INTERRUPT
+/**
+ * Number of frames in the software receive queue, on top of the
+ * ECAN_NUM_BUFFERS hardware buffers. Each frame takes 16 bytes of RAM. With
+ * 16, can-bench loses no frames at 90% bus load even with 1 ms main loops.
+ * Must be a power of 2, and at most 128.
+ */
+#ifndef ECAN_RX_QUEUE_SIZE
+	#define ECAN_RX_QUEUE_SIZE	16
+#endif
+#if (ECAN_RX_QUEUE_SIZE & (ECAN_RX_QUEUE_SIZE - 1)) != 0 || ECAN_RX_QUEUE_SIZE > 128
+	#error "ECAN_RX_QUEUE_SIZE must be a power of 2, and at most 128"
+#endif
+
+/**
+ * Priority of the ECAN interrupt (1-7). This should be below the timing
+ * interrupt (the default, 4) so the seconds count is always up to date
+ * when the ISR reads the time.
+ */
+#define ECAN_RX_IPL			3
+
+/**
+ * A received frame in the software receive queue.
+ */
+typedef struct {
+	uint32_t Time;			/// Get32bitTime() when the frame was taken from the hardware buffer.
+	uint16_t SID;			/// Standard identifier.
+	uint8_t DLC;			/// Payload length.
+	uint8_t Data[8];		/// Payload.
+} ECAN_RXFrame;
+#endif
+
 typedef enum {
 	ECAN_MODE_OPERATE = 0b000,
 	ECAN_MODE_DISABLE = 0b001,
@@ -152,4 +192,13 @@ int8_t ECAN_ReadBuffer(uint8_t buffer, uint16_t *sid, uint32_t *eid,
 	uint8_t dlc, uint8_t *data);
 uint8_t ECAN_TransmitBuffer(uint8_t buffer);
 
+#ifdef ECAN_RX_INTERRUPT
+void ECAN_EnableRXInterrupt();
+uint8_t ECAN_DisableRXInterrupt();
+void ECAN_RestoreRXInterrupt(uint8_t enabled);
+ECAN_RXFrame* ECAN_PeekRXFrame();
+void ECAN_PopRXFrame();
+uint8_t ECAN_CheckRXOverflow();
+#endif
+
 #endif
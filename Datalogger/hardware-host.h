@@ -0,0 +1,78 @@
+/*
+ * File:   hardware-host.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 1:40 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Defines the host (Linux, gcc) platform, used to run the filesystem and
+ * datalogger code against emulated peripherals for benchmarking.
+ * The board-specific files are replaced by *-host.c versions.
+ *
+ * There is no real-time clock on the host. Instead, everything runs against a
+ * virtual clock, which is advanced by the emulated peripherals (for example,
+ * blocking SPI transfers) and by the host harness (for simulated CPU time).
+ */
+#ifndef HARDWARE_H
+#define HARDWARE_H
+
+#include "types.h"
+
+/*
+ * Clock Settings, same as the Run 3 board so peripheral timings match
+ */
+#define Fosc 40000000
+#define Fcy (Fosc/2)
+
+/**
+ * Virtual clock, in nanoseconds since power on.
+ */
+extern uint64_t Host_Clock;
+
+/**
+ * Advances the virtual clock.
+ *
+ * @param ns Time to advance by, in nanoseconds.
+ */
+void Host_AdvanceClock(uint64_t ns);
+
+/*
+ * Emulated peripheral registers used outside their drivers
+ */
+extern volatile uint16_t T1CON;			// timing-host.c
+
+extern volatile uint16_t C1RXFUL1;		// ecan-host.c
+extern volatile uint16_t C1RXFUL2;
+extern volatile uint16_t C1RXOVF1;
+extern volatile uint16_t C1RXOVF2;
+
+typedef struct {
+	unsigned TX0PRI:2;
+	unsigned RTREN0:1;
+	unsigned TXREQ0:1;
+	unsigned TXERR0:1;
+	unsigned TXLARB0:1;
+	unsigned TXABT0:1;
+	unsigned TXEN0:1;
+	unsigned TX1PRI:2;
+	unsigned RTREN1:1;
+	unsigned TXREQ1:1;
+	unsigned TXERR1:1;
+	unsigned TXLARB1:1;
+	unsigned TXABT1:1;
+	unsigned TXEN1:1;
+} C1TR01CONBITS;
+extern volatile C1TR01CONBITS C1TR01CONbits;
+
+typedef struct {
+	unsigned FSA:5;
+	unsigned :8;
+	unsigned DMABS:3;
+} C1FCTRLBITS;
+extern volatile C1FCTRLBITS C1FCTRLbits;
+
+#endif
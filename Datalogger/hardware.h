@@ -7,6 +7,7 @@
  * Revision History
  * Date			Author	Change
  * 21 Jul 2011	Ducky	File creation.
+ * 17 Oct 2026	agent	Added the host (desktop) build.
  *
  * @file
  * Defines the hardware platform upon which the code runs.
@@ -22,4 +23,6 @@
 	#include "hardware-run3.h"
 #elif defined HARDWARE_CANBRIDGE
 	#include "hardware-canbridge.h"
+#elif defined HARDWARE_HOST
+	#include "hardware-host.h"
 #endif
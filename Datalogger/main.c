@@ -7,6 +7,7 @@
  * Revision History
  * Date			Author	Change
  * 21 Jul 2011	Ducky	Added this change history box.
+ * 17 Oct 2026	agent	Drain the deferred debug log from the main loop.
  *
  * @file
  * Application level code.
@@ -113,6 +114,9 @@ int main(void) {
 	ECAN_SetStandardMask(0, 0x00);
 	ECAN_SetMode(ECAN_MODE_OPERATE);
 	ECAN_SetupDMA();
+#ifdef ECAN_RX_INTERRUPT
+	ECAN_EnableRXInterrupt();
+#endif
 
 	UI_Switch_Update();
 	if (UI_Switch_GetTest()) {
@@ -137,6 +141,9 @@ int main(void) {
 
 	while(1) {
 		Datalogger_Loop();
+#ifdef DEBUG_UART_DEFERRED
+		DBG_Deferred_Tasks();
+#endif
 	}
 }
 
@@ -0,0 +1,126 @@
+/*
+ * File:   timing-host.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 1:52 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ * 17 Oct 2026	agent	Added the cycle counter.
+ *
+ * @file
+ * Hardware abstraction layer for the real-time clock and timer functions,
+ * running off the host virtual clock. This mirrors the Run 3 timing, where
+ * TMR1 counts the 32.768 kHz secondary oscillator.
+ */
+#include "hardware.h"
+#include "timing.h"
+
+#ifdef HARDWARE_HOST
+
+uint64_t Host_Clock;
+
+volatile uint16_t T1CON;
+
+void Host_AdvanceClock(uint64_t ns) {
+	Host_Clock += ns;
+}
+
+/**
+ * @return The number of 32.768 kHz ticks since power on.
+ */
+static uint64_t Timing_GetTicks() {
+	return Host_Clock * 32768 / 1000000000;
+}
+
+/**
+ * @return The emulated TMR1 value.
+ */
+static uint16_t Timing_GetTMR1() {
+	return Timing_GetTicks() % 32768;
+}
+
+/**
+ * Initializes hardware needed for the timing functions.
+ * This starts the seconds counter at the current time.
+ */
+void Timing_Init() {
+	Host_Clock = 0;
+	T1CON = 0x8002;	// TMR1 on, external (secondary oscillator) clock
+}
+
+/**
+ * @return The number of seconds elapsed since power on, rounded down.
+ */
+inline seconds_t GetTimeSeconds() {
+	return Timing_GetTicks() / 32768;
+}
+
+/**
+ * @return The binary-milliseconds (1/1024 second) offset from the current
+ * second.
+ */
+inline uint16_t GetbmsecOffset() {
+	return Timing_GetTMR1() >> 5;
+}
+
+/**
+ * @return The current time, in 32-bit format. The low 10 bits represent
+ * the fractions of a second in 1/1024 increments while the upper 22 bits
+ * represent the time in seconds.
+ */
+inline uint32_t Get32bitTime() {
+	uint32_t retVal = Timing_GetTMR1() >> 5;
+	retVal = retVal | (GetTimeSeconds() << 10);
+	return retVal;
+}
+
+/**
+ * @return A free running count of instruction cycles (at Fcy), for profiling.
+ */
+inline uint32_t GetCycleCount() {
+	return Host_Clock * (Fcy / 1000000) / 1000;
+}
+
+/**
+ * Starts the countdown for the CountdownTimer object.
+ *
+ * @param timer Timer to start.
+ * @param duration Duration of the timer in 1/1024 seconds.
+ */
+void Timer_StartCountdown(CountdownTimer *timer, uint16_t duration) {
+	uint16_t secs = (duration - (duration % 1024)) / 1024;
+	timer->ExpirationSeconds = GetTimeSeconds() + secs;
+	duration = duration % 1024;
+
+	timer->ExpirationFracSecs = Timing_GetTMR1();
+	timer->ExpirationFracSecs += duration * 32;
+
+	if (timer->ExpirationFracSecs >= 32768) {
+		timer->ExpirationSeconds++;
+		timer->ExpirationFracSecs -= 32768;
+	}
+}
+
+/**
+ * Checks if the CountdownTimer object has expired (time has elapsed).
+ *
+ * @param timer Timer to check.
+ * @return
+ */
+uint8_t Timer_CountdownExpired(CountdownTimer *timer) {
+	if (timer->ExpirationSeconds > GetTimeSeconds()) {
+		return 1;
+	} else if (timer->ExpirationSeconds == GetTimeSeconds()) {
+		if (timer->ExpirationFracSecs > Timing_GetTMR1()) {
+			return 1;
+		} else {
+			return 0;
+		}
+	} else {
+		return 0;
+	}
+}
+
+#endif
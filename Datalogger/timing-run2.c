@@ -10,6 +10,7 @@
  *						Timing now uses TMR1 with the 32.768 kHz secondary
  *						oscillator.
  * 12 Aug 2011	Ducky	Separated Run 2 and Run 3 timing.
+ * 17 Oct 2026	agent	Added the cycle counter.
  *
  * @file
  * Hardware abstraction layer for the real-time clock and timer functions.
@@ -63,6 +64,22 @@ inline uint32_t Get32bitTime() {
 	return retVal;
 }
 
+/**
+ * @return A free running count of instruction cycles (at Fcy), for profiling.
+ * TMR4/TMR5 already count Fcy cycles within the second.
+ */
+inline uint32_t GetCycleCount() {
+	seconds_t seconds;
+	uint16_t lsw, msw;
+
+	do {
+		seconds = TimeSeconds;
+		lsw = TMR4;			// latches TMR5 into TMR5HLD
+		msw = TMR5HLD;
+	} while (seconds != TimeSeconds);
+	return seconds * (uint32_t)Fcy + (((uint32_t)msw << 16) | lsw);
+}
+
 /**
  * Starts the countdown for the CountdownTimer object.
  *
@@ -10,6 +10,7 @@
  *						Timing now uses TMR1 with the 32.768 kHz secondary
  *						oscillator.
  * 12 Aug 2011	Ducky	Separated Run 2 and Run 3 timing.
+ * 17 Oct 2026	agent	Added the cycle counter, on TMR4/TMR5.
  *
  * @file
  * Hardware abstraction layer for the real-time clock and timer functions.
@@ -35,6 +36,14 @@ void Timing_Init() {
 	TMR1 = 0;
 	_T1IE = 1;
 	T1CONbits.TON = 1;
+
+	// Initialize cycle counter, a free running 32-bit timer at Fcy
+	T4CONbits.T32 = 1;
+	PR4 = 0xffff;
+	PR5 = 0xffff;
+	TMR5HLD = 0;
+	TMR4 = 0;
+	T4CONbits.TON = 1;
 }
 
 /**
@@ -63,6 +72,14 @@ inline uint32_t Get32bitTime() {
 	return retVal;
 }
 
+/**
+ * @return A free running count of instruction cycles (at Fcy), for profiling.
+ */
+inline uint32_t GetCycleCount() {
+	uint16_t lsw = TMR4;	// latches TMR5 into TMR5HLD
+	return ((uint32_t)TMR5HLD << 16) | lsw;
+}
+
 /**
  * Starts the countdown for the CountdownTimer object.
  *
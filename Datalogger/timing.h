@@ -7,6 +7,7 @@
  * Revision History
  * Date			Author	Change
  * 27 Jul 2011	Ducky	Added this revision history box.
+ * 17 Oct 2026	agent	Added the cycle counter.
  *
  * @file
  * Hardware abstraction interface for the real-time clock and timer functions.
@@ -32,6 +33,12 @@ inline seconds_t GetTimeSeconds();
 inline uint16_t GetbmsecOffset();
 inline uint32_t Get32bitTime();
 
+/**
+ * @return A free running count of instruction cycles (at Fcy), for profiling.
+ * This wraps around, so only differences are meaningful.
+ */
+inline uint32_t GetCycleCount();
+
 void Timer_StartCountdown(CountdownTimer *timer, uint16_t duration);
 uint8_t Timer_CountdownExpired(CountdownTimer *timer);
 
@@ -8,6 +8,7 @@
  * Date			Author	Change
  * 21 Jul 2011	Ducky	Added this change history box,
  *						separated Run 2/3 hardware.
+ * 17 Oct 2026	agent	Use the standard integer types on host builds.
  *
  * @file
  * Global typedefs.
@@ -16,6 +17,11 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#ifdef HARDWARE_HOST
+// On the host, long is 64 bits and NULL is ((void*)0)
+#include <stddef.h>
+#include <stdint.h>
+#else
 #ifndef NULL
 	#define NULL	0
 #else
@@ -32,6 +38,7 @@ typedef unsigned long uint32_t;
 typedef signed long int32_t;
 typedef unsigned long long uint64_t;
 typedef signed long long int64_t;
+#endif
 
 typedef uint8_t sd_result_t;
 typedef uint8_t fs_result_t;
@@ -0,0 +1,130 @@
+/*
+ * File:   uart-dma-host.c
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:58 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * UART DMA functions for the host build. The ring fills and drains as in
+ * uart-dma.c, with the UART sending continuously at UART_DMA_BAUD on the
+ * host virtual clock, so blocking writes cost their wire time and
+ * non-blocking writes drop when the ring is full. Sent bytes go to
+ * UART_DMA_HostOutput, if set.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hardware.h"
+#include "uart-dma.h"
+#include "uart-dma-host.h"
+
+#ifdef HARDWARE_HOST
+
+/**
+ * Wire time of one byte, with a start and a stop bit.
+ */
+#define UART_DMA_BYTE_NS	(10ULL * 1000000000 / UART_DMA_BAUD)
+
+volatile uint16_t UART_DMA_Active = 0;
+
+uint16_t UART_DMA_DroppedWrites = 0;
+uint32_t UART_DMA_DroppedBytes = 0;
+uint16_t UART_DMA_MaxUsed = 0;
+
+FILE *UART_DMA_HostOutput = NULL;
+uint64_t UART_DMA_HostBytes = 0;
+
+static uint64_t UART_DMA_DoneNs = 0;		/// Virtual time the last queued byte is sent.
+
+void UART_DMA_Init() {
+	UART_DMA_Active = 0;
+	UART_DMA_DoneNs = 0;
+}
+
+/**
+ * @return Number of bytes queued and not yet sent.
+ */
+static uint16_t UART_DMA_GetUsed() {
+	if (UART_DMA_DoneNs <= Host_Clock) {
+		UART_DMA_Active = 0;
+		return 0;
+	}
+	return (UART_DMA_DoneNs - Host_Clock + UART_DMA_BYTE_NS - 1) / UART_DMA_BYTE_NS;
+}
+
+uint16_t UART_DMA_GetFree() {
+	return UART_DMA_RING_SIZE - 1 - UART_DMA_GetUsed();
+}
+
+/**
+ * Queues data, the caller must have checked there is enough space.
+ */
+static void UART_DMA_Queue(char* data, uint16_t dataLen) {
+	uint16_t used;
+
+	if (UART_DMA_DoneNs < Host_Clock) {
+		UART_DMA_DoneNs = Host_Clock;
+	}
+	UART_DMA_DoneNs += dataLen * UART_DMA_BYTE_NS;
+	UART_DMA_Active = 1;
+	UART_DMA_HostBytes += dataLen;
+	if (UART_DMA_HostOutput != NULL) {
+		fwrite(data, 1, dataLen, UART_DMA_HostOutput);
+	}
+
+	used = UART_DMA_GetUsed();
+	if (used > UART_DMA_MaxUsed) {
+		UART_DMA_MaxUsed = used;
+	}
+}
+
+uint16_t UART_DMA_WriteAtomicS(char* string) {
+	return UART_DMA_WriteAtomic(string, strlen(string));
+}
+
+uint16_t UART_DMA_WriteAtomic(char* data, uint16_t dataLen) {
+	if (dataLen > UART_DMA_GetFree()) {
+		if (UART_DMA_DroppedWrites != 0xffff) {
+			UART_DMA_DroppedWrites++;
+		}
+		if (UART_DMA_DroppedBytes <= 0xffffffff - dataLen) {
+			UART_DMA_DroppedBytes += dataLen;
+		}
+		return 0;
+	}
+	UART_DMA_Queue(data, dataLen);
+	return dataLen;
+}
+
+void UART_DMA_WriteBlockingS(char* string) {
+	UART_DMA_WriteBlocking(string, strlen(string));
+}
+
+void UART_DMA_WriteBlocking(char* string, uint16_t dataLen) {
+	while (dataLen > 0) {
+		uint16_t len = UART_DMA_GetFree();
+
+		if (len == 0) {		// Wait for a byte to go out
+			Host_AdvanceClock(UART_DMA_DoneNs - Host_Clock
+					- (uint64_t)(UART_DMA_RING_SIZE - 2) * UART_DMA_BYTE_NS);
+			continue;
+		}
+		if (len > dataLen) {
+			len = dataLen;
+		}
+		UART_DMA_Queue(string, len);
+		string += len;
+		dataLen -= len;
+	}
+}
+
+uint16_t UART_DMA_SendBlock() {
+	return 0;
+}
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * File:   uart-dma-host.h
+ * Author: agent
+ *
+ * Created on October 17, 2026, 11:58 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Initial implementation.
+ *
+ * @file
+ * Host-only interface to the emulated UART, which replaces uart-dma.c on host
+ * builds.
+ */
+
+#ifndef UART_DMA_HOST_H
+#define UART_DMA_HOST_H
+
+#include <stdio.h>
+
+#include "types.h"
+
+/**
+ * File the sent bytes are written to, or NULL to discard them.
+ */
+extern FILE *UART_DMA_HostOutput;
+
+/**
+ * Number of bytes queued since power on, excluding dropped writes.
+ */
+extern uint64_t UART_DMA_HostBytes;
+
+#endif
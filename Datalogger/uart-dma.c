@@ -3,6 +3,17 @@
  * Author: Ducky
  *
  * Created on May 30, 2011, 5:41 PM
+ *
+ * Revision History
+ * Date			Author	Change
+ * 17 Oct 2026	agent	Added this change history box.
+ *						Writes are queued in a RAM ring and sent through
+ *						ping-pong DMA blocks, non-blocking writes count drops.
+ *
+ * @file
+ * UART transmit through DMA. Writes are copied into a RAM ring, which the DMA
+ * interrupt moves into the two halves of the DMA buffer in turn, chaining each
+ * transfer from the end of the previous one.
  */
 #include <string.h>
 #include <libpic30.h>
@@ -13,15 +24,21 @@
 #include "uart.h"
 #include "uart-dma.h"
 
-char UART_DMA_Buffer[UART_DMA_BUFFER_SIZE] __attribute__((space(dma)));
+char UART_DMA_Buffer[2][UART_DMA_BLOCK_SIZE] __attribute__((space(dma)));
+char UART_DMA_Ring[UART_DMA_RING_SIZE];
 volatile uint16_t UART_DMA_Active = 0;				/// Whether the DMA module is transferring data.
-volatile uint16_t UART_DMA_bufStart = 0;			/// Index of the start of the buffer - the position of the start of the next DMA block transfer.
-													/// This should ONLY be modified by the DMA ISR.
-volatile uint16_t UART_DMA_bufEnd = 0;				/// Index of the end of the buffer - the position to store the next byte written.
+volatile uint16_t UART_DMA_ringStart = 0;			/// Index of the start of the ring - the next byte to be copied into a DMA block.
+													/// This should ONLY be modified by the DMA ISR, or with the DMA interrupt disabled.
+volatile uint16_t UART_DMA_ringEnd = 0;				/// Index of the end of the ring - the position to store the next byte written.
 													/// This should ONLY be modified by the user program.
-volatile uint16_t UART_DMA_TransferringSize = 0;	/// Number of bytes currently being transferred by the DMA module.
+volatile uint16_t UART_DMA_BlockSize[2] = {0, 0};	/// Number of bytes in each DMA block, 0 if it is free.
+volatile uint16_t UART_DMA_Sending = 0;				/// DMA block currently being transferred by the DMA module.
+
+uint16_t UART_DMA_DroppedWrites = 0;
+uint32_t UART_DMA_DroppedBytes = 0;
+uint16_t UART_DMA_MaxUsed = 0;
 
-/** 
+/**
  * Initialize the UART module and DMA for UART.
  */
 void UART_DMA_Init() {
@@ -37,7 +54,7 @@ void UART_DMA_Init() {
 	UART_DMACONbits.SIZE = 1;	// Byte transfer
 	UART_DMACONbits.DIR = 1;	// Write to peripheral
 	UART_DMACONbits.AMODE = 0;	// Register indirect with post-increment
-	UART_DMACONbits.MODE = 1;	// One-shot without ping-pong
+	UART_DMACONbits.MODE = 1;	// One-shot without ping-pong, blocks are alternated by the ISR
 
 	UART_DMAREQbits.IRQSEL = UART_IRQSEL_VAL;
 	UART_DMAPAD = UART_DMAPAD_VAL;
@@ -47,6 +64,56 @@ void UART_DMA_Init() {
 	UART_DMAIE = 1;
 }
 
+/**
+ * @return Number of bytes queued in the ring.
+ */
+static uint16_t UART_DMA_GetUsed() {
+	uint16_t localRingStart = UART_DMA_ringStart;		// Take a local copy to avoid parallelism bugs
+
+	if (UART_DMA_ringEnd < localRingStart) {	// Ring wraps around
+		return UART_DMA_RING_SIZE - localRingStart + UART_DMA_ringEnd;
+	} else {
+		return UART_DMA_ringEnd - localRingStart;
+	}
+}
+
+/**
+ * @return Number of bytes which can be written without blocking or dropping.
+ * One byte of the ring is always left free, so a full ring can be told apart
+ * from an empty one.
+ */
+uint16_t UART_DMA_GetFree() {
+	return UART_DMA_RING_SIZE - 1 - UART_DMA_GetUsed();
+}
+
+/**
+ * Copies data into the ring and atomically updates the ring end.
+ * The caller must have checked there is enough space.
+ */
+static void UART_DMA_Queue(char* data, uint16_t dataLen) {
+	uint16_t localRingEnd = UART_DMA_ringEnd;
+	uint16_t used;
+
+	if (localRingEnd + dataLen > UART_DMA_RING_SIZE) {	// Write wraps around
+		uint16_t firstLen = UART_DMA_RING_SIZE - localRingEnd;
+		memcpy(UART_DMA_Ring + localRingEnd, data, firstLen);
+		memcpy(UART_DMA_Ring, data + firstLen, dataLen - firstLen);
+		localRingEnd = dataLen - firstLen;
+	} else {
+		memcpy(UART_DMA_Ring + localRingEnd, data, dataLen);
+		localRingEnd += dataLen;
+		if (localRingEnd >= UART_DMA_RING_SIZE) {
+			localRingEnd = 0;
+		}
+	}
+	UART_DMA_ringEnd = localRingEnd;
+
+	used = UART_DMA_GetUsed();
+	if (used > UART_DMA_MaxUsed) {
+		UART_DMA_MaxUsed = used;
+	}
+}
+
 /**
  * Writes a string to the UART DMA buffer.
  * This either succeeds (the entire string is written) or fails (nothing is written,
@@ -62,177 +129,147 @@ uint16_t UART_DMA_WriteAtomicS(char* string) {
 /**
  * Writes a string to the UART DMA buffer.
  * This either succeeds (the entire string is written) or fails (nothing is written,
- * if there is not enough space in the buffer). This will NOT do a partial write.
+ * if there is not enough space in the buffer). This will NOT do a partial write,
+ * and never waits for the UART. Failed writes are counted in
+ * UART_DMA_DroppedWrites and UART_DMA_DroppedBytes.
  *
  * @param data String to write to the UART DMA buffer.
  * @param dataLen Number of bytes to write to the UART DMA buffer.
  * @return Number of bytes written to the UART DMA buffer.
  */
 uint16_t UART_DMA_WriteAtomic(char* data, uint16_t dataLen) {
-	uint16_t localBufStart = UART_DMA_bufStart;		// Take a local copy to avoid parallelism bugs
-	uint16_t bufSize;
-
-	// Compute current buffer size to determine if there is enough room
-	if (UART_DMA_bufEnd < localBufStart) {	// Buffer wraps around
-		bufSize = UART_DMA_BUFFER_SIZE - localBufStart + UART_DMA_bufEnd;
-	} else {
-		bufSize = UART_DMA_bufEnd - localBufStart;
-	}
-
-	if ((bufSize + dataLen) < (UART_DMA_BUFFER_SIZE - 1)) {	// Enough space in buffer
-		// Write data to buffer and atomically update buffer end
-		uint16_t dataPtr;
-		uint16_t localBufEnd = UART_DMA_bufEnd;
-		for (dataPtr = 0; dataPtr < dataLen; dataPtr++) {
-			UART_DMA_Buffer[localBufEnd] = data[dataPtr];
-			localBufEnd ++;
-			if (localBufEnd >= UART_DMA_BUFFER_SIZE) {
-				localBufEnd = 0;
-				if (localBufEnd == localBufStart) {
-					while(1);
-				}
-			}
+	if (dataLen > UART_DMA_GetFree()) {	// Not enough space in buffer
+		if (UART_DMA_DroppedWrites != 0xffff) {
+			UART_DMA_DroppedWrites++;
+		}
+		if (UART_DMA_DroppedBytes <= 0xffffffff - dataLen) {
+			UART_DMA_DroppedBytes += dataLen;
 		}
-
-		UART_DMA_bufEnd = localBufEnd;
-
-		UART_DMA_SendBlock();
-
-		return dataLen;
-	} else {	// Not enough space in buffer
 		return 0;
 	}
+
+	UART_DMA_Queue(data, dataLen);
+	UART_DMA_SendBlock();
+
+	return dataLen;
 }
 
 /**
  * Writes a string to the UART DMA buffer.
- * This blocks until the entire string is entered into the buffer. Partial writes
- * will NOT happen.
+ * This blocks until the entire string is entered into the buffer, which takes
+ * the wire time of anything queued before it when the ring is full, so this
+ * should only be used on fatal paths (or with DBG_BLOCK), where output must not
+ * be lost. The DMA interrupt must be able to run.
  *
  * @param data Null-terminated string to write to the UART DMA buffer.
  */
 void UART_DMA_WriteBlockingS(char* string) {
-	uint16_t localBufEnd = UART_DMA_bufEnd;
-	uint16_t currBufEnd;
-
-	while (*string != 0) {
-		UART_DMA_Buffer[localBufEnd] = *string;
-
-		currBufEnd = localBufEnd;
-		localBufEnd++;
-		if (localBufEnd == UART_DMA_BUFFER_SIZE) {
-			localBufEnd = 0;
-		}
-		
-		if (localBufEnd == UART_DMA_bufStart) {		// Full buffer
-			UART_DMA_bufEnd = currBufEnd;
-			while (localBufEnd == UART_DMA_bufStart){	// Wait for empty buffer location
-				UART_DMA_SendBlock();
-			}
-		}
-		string++;
-	}
-	UART_DMA_bufEnd = localBufEnd;
-	UART_DMA_SendBlock();
+	UART_DMA_WriteBlocking(string, strlen(string));
 }
 
 /**
  * Writes a string to the UART DMA buffer.
- * This blocks until the entire string is entered into the buffer. Partial writes
- * will NOT happen.
+ * This blocks until the entire string is entered into the buffer, and should
+ * only be used on fatal paths, see UART_DMA_WriteBlockingS.
  *
- * @param data Null-terminated string to write to the UART DMA buffer.
+ * @param data String to write to the UART DMA buffer.
  * @param dataLen Number of bytes to write to the UART DMA buffer.
  */
 void UART_DMA_WriteBlocking(char* string, uint16_t dataLen) {
-	uint16_t localBufEnd = UART_DMA_bufEnd;
-	uint16_t currBufEnd;
-
 	while (dataLen > 0) {
-		UART_DMA_Buffer[localBufEnd] = *string;
+		uint16_t len = UART_DMA_GetFree();
 
-		currBufEnd = localBufEnd;
-		localBufEnd++;
-		if (localBufEnd == UART_DMA_BUFFER_SIZE) {
-			localBufEnd = 0;
+		if (len == 0) {		// Wait for the DMA ISR to free space
+			continue;
 		}
-
-		if (localBufEnd == UART_DMA_bufStart) {		// Full buffer
-			UART_DMA_bufEnd = currBufEnd;
-			while (localBufEnd == UART_DMA_bufStart){	// Wait for empty buffer location
-				UART_DMA_SendBlock();
-			}
+		if (len > dataLen) {
+			len = dataLen;
 		}
-		string++;
-		dataLen--;
+		UART_DMA_Queue(string, len);
+		UART_DMA_SendBlock();
+
+		string += len;
+		dataLen -= len;
 	}
-	UART_DMA_bufEnd = localBufEnd;
-	UART_DMA_SendBlock();
 }
 
 /**
- * Sets the DMA module to transfer the next block of data.
+ * Copies the next bytes from the ring into a DMA block.
+ * This should ONLY be called from the DMA ISR, or with the DMA interrupt disabled.
  *
- * @return Number of bytes to be transferred.
+ * @param block DMA block to fill, which must be free.
+ * @return Number of bytes copied.
  */
-uint16_t UART_DMA_SendBlock() {
-	// Check that there is data and there isn't a transfer ongoing
-	if (!UART_DMA_Active && (UART_DMA_bufStart != UART_DMA_bufEnd)) {
-		UART_DMA_Active = 1;
-
-		UART_DMASTA = __builtin_dmaoffset(UART_DMA_Buffer) + UART_DMA_bufStart;
-		// Calculate transfer size
-		if (UART_DMA_bufEnd < UART_DMA_bufStart) {	// Buffer wraps around, transfer to end
-			UART_DMA_TransferringSize = UART_DMA_BUFFER_SIZE - UART_DMA_bufStart;
-		} else {					// Buffer does not wrap, transfer all
-			UART_DMA_TransferringSize = UART_DMA_bufEnd - UART_DMA_bufStart;
-		}
-		// Upper bound the transfer size to keep the pipe full
-		if (UART_DMA_TransferringSize > UART_DMA_BUFFER_SIZE / 2) {
-			UART_DMA_TransferringSize = UART_DMA_BUFFER_SIZE / 2;
+static uint16_t UART_DMA_FillBlock(uint16_t block) {
+	uint16_t localRingStart = UART_DMA_ringStart;
+	uint16_t localRingEnd = UART_DMA_ringEnd;
+	uint16_t len = 0;
+
+	while (localRingStart != localRingEnd && len < UART_DMA_BLOCK_SIZE) {
+		UART_DMA_Buffer[block][len] = UART_DMA_Ring[localRingStart];
+		len++;
+		localRingStart++;
+		if (localRingStart >= UART_DMA_RING_SIZE) {
+			localRingStart = 0;
 		}
-		UART_DMACNT = UART_DMA_TransferringSize - 1;
+	}
+	UART_DMA_ringStart = localRingStart;
+	UART_DMA_BlockSize[block] = len;
 
-		UART_DMACONbits.CHEN = 1;
-		UART_DMAREQbits.FORCE = 1;
+	return len;
+}
 
-		return UART_DMA_TransferringSize;
-	} else {
-		return 0;
+/**
+ * Starts the DMA module on a filled DMA block.
+ */
+static void UART_DMA_StartBlock(uint16_t block) {
+	UART_DMA_Sending = block;
+	UART_DMASTA = __builtin_dmaoffset(UART_DMA_Buffer) + block * UART_DMA_BLOCK_SIZE;
+	UART_DMACNT = UART_DMA_BlockSize[block] - 1;
+
+	UART_DMACONbits.CHEN = 1;
+	UART_DMAREQbits.FORCE = 1;
+}
+
+/**
+ * Sets the DMA module to transfer the next block of data if it is idle, and
+ * otherwise fills the free DMA block so it is ready to be chained.
+ *
+ * @return Number of bytes moved into a DMA block.
+ */
+uint16_t UART_DMA_SendBlock() {
+	uint16_t len = 0;
+
+	UART_DMAIE = 0;		// The ISR also fills and starts blocks
+	if (!UART_DMA_Active) {
+		len = UART_DMA_FillBlock(0);
+		if (len != 0) {
+			UART_DMA_Active = 1;
+			UART_DMA_StartBlock(0);
+			len += UART_DMA_FillBlock(1);
+		}
+	} else if (UART_DMA_BlockSize[UART_DMA_Sending ^ 1] == 0) {
+		len = UART_DMA_FillBlock(UART_DMA_Sending ^ 1);
 	}
+	UART_DMAIE = 1;
+
+	return len;
 }
 
 void __attribute__((interrupt, no_auto_psv)) UART_DMAInterrupt(void) {
-	UART_DMAIF = 0;
+	uint16_t sent = UART_DMA_Sending;
+	uint16_t nextBlock = sent ^ 1;
 
-	// Set new buffer starting position
-	uint16_t localBufStart = UART_DMA_bufStart;
-	localBufStart += UART_DMA_TransferringSize;
-	if (localBufStart >= UART_DMA_BUFFER_SIZE) {
-		localBufStart = 0;
-	}
-	UART_DMA_bufStart = localBufStart;
-	
-	// Check if there is more data
-	uint16_t localBufEnd = UART_DMA_bufEnd;
-	if (localBufStart != localBufEnd) {
-		UART_DMASTA = __builtin_dmaoffset(UART_DMA_Buffer) + localBufStart;
-		// Calculate transfer size
-		if (localBufEnd < localBufStart) {	// Buffer wraps around, transfer to end
-			UART_DMA_TransferringSize = UART_DMA_BUFFER_SIZE - localBufStart;
-		} else {					// Buffer does not wrap, transfer all
-			UART_DMA_TransferringSize = localBufEnd - localBufStart;
-		}
-		// Upper bound the transfer size to keep the pipe full
-		if (UART_DMA_TransferringSize > UART_DMA_BUFFER_SIZE / 2) {
-			UART_DMA_TransferringSize = UART_DMA_BUFFER_SIZE / 2;
-		}
-		UART_DMACNT = UART_DMA_TransferringSize - 1;
+	UART_DMAIF = 0;
+	UART_DMA_BlockSize[sent] = 0;
 
+	// The next block is normally filled already, otherwise check for new data
+	if (UART_DMA_BlockSize[nextBlock] != 0 || UART_DMA_FillBlock(nextBlock) != 0) {
 		while (UART_USTAbits.UTXBF);
 
-		UART_DMACONbits.CHEN = 1;
-		UART_DMAREQbits.FORCE = 1;
+		UART_DMA_StartBlock(nextBlock);
+		// Refill the block just sent while this one goes out
+		UART_DMA_FillBlock(sent);
 	} else {
 		UART_DMA_Active = 0;
 	}
@@ -20,7 +20,25 @@
 #endif
 //TODO Add compile-time baud error percentage check
 
+/**
+ * Size of the buffer in DMA RAM, in bytes. This is split into two blocks which
+ * are sent alternately (ping-pong): while one is being transferred, the next
+ * is copied in from the ring, so the next transfer can be chained from the DMA
+ * interrupt without waiting on the copy.
+ */
 #define UART_DMA_BUFFER_SIZE	40
+#define UART_DMA_BLOCK_SIZE		(UART_DMA_BUFFER_SIZE / 2)
+
+/**
+ * Size of the RAM ring writes are queued in, in bytes. DMA RAM is mostly taken
+ * by the ECAN and SD Card buffers, so this lives in main RAM, which is tight
+ * (see the RAM budget in datalogger.c). One byte is always left free, and the
+ * longest atomic write, a debug message (DBG_BUFFER_SIZE) or a stream packet
+ * (DLG_STREAM_MAX_ENCODED), must fit in the rest.
+ */
+#ifndef UART_DMA_RING_SIZE
+	#define UART_DMA_RING_SIZE	256
+#endif
 
 #define UART_UMODEbits			U2MODEbits
 #define UART_UBRG				U2BRG
@@ -40,7 +58,18 @@
 #define UART_DMAIF				_DMA7IF
 #define UART_DMAIE				_DMA7IE
 
+extern volatile uint16_t UART_DMA_Active;	/// Whether the DMA module is transferring data.
+
+/*
+ * Drop accounting. The dropped counts are since power on and saturate, the
+ * ring usage high-water mark is cleared by the user (the performance logger).
+ */
+extern uint16_t UART_DMA_DroppedWrites;		/// Writes dropped because the ring was full.
+extern uint32_t UART_DMA_DroppedBytes;		/// Bytes in the dropped writes.
+extern uint16_t UART_DMA_MaxUsed;			/// Most bytes queued in the ring.
+
 void UART_DMA_Init();
+uint16_t UART_DMA_GetFree();
 uint16_t UART_DMA_WriteAtomicS(char* string);
 uint16_t UART_DMA_WriteAtomic(char* data, uint16_t dataLen);
 void UART_DMA_WriteBlockingS(char* string);